@@ -16,6 +16,7 @@
 #define DEFAULT_PROXY_PORT  8000
 #define DEFAULT_REGION      "us-east-1"
 #define DEFAULT_PARENT_CID  "3"
+#define ENTROPY_WAIT_TIMEOUT_MS 5000
 
 #define DECRYPT_CMD "decrypt"
 #define GENKEY_CMD  "genkey"
@@ -312,6 +313,12 @@ static void s_parse_options(int argc, char **argv, const char *subcommand, struc
  * @param[out] client: location to store new kms client
  */
 static void init_kms_client(struct app_ctx *app_ctx, struct aws_credentials **credentials, struct aws_nitro_enclaves_kms_client **client) {
+    /* The client generates its key pair from the entropy pool. */
+    if (aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_WAIT_TIMEOUT_MS) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "Entropy pool is not seeded\n");
+        exit(1);
+    }
+
     /* Parent is always on CID 3 */
     struct aws_socket_endpoint endpoint = {.address = DEFAULT_PARENT_CID, .port = app_ctx->proxy_port};
     struct aws_nitro_enclaves_kms_client_configuration configuration = {
@@ -477,8 +484,11 @@ int main(int argc, char **argv) {
     /* Initialize the SDK */
     aws_nitro_enclaves_library_init(NULL);
 
-    /* Initialize the entropy pool: this is relevant for TLS */
-    AWS_ASSERT(aws_nitro_enclaves_library_seed_entropy(1024) == AWS_OP_SUCCESS);
+    /* Seed the entropy pool in the background while the arguments are parsed: this is relevant for TLS */
+    if (aws_nitro_enclaves_library_start_entropy_feeder(NULL) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "Could not start the entropy feeder\n");
+        exit(1);
+    }
 
     /* Parse the commandline */
     app_ctx.allocator = aws_nitro_enclaves_get_allocator();
@@ -1,21 +1,30 @@
 #include <aws/nitro_enclaves/kms.h>
+#include <aws/nitro_enclaves/logging.h>
 #include <aws/nitro_enclaves/nitro_enclaves.h>
 
 #include <aws/common/command_line_parser.h>
 #include <aws/common/encoding.h>
 #include <aws/common/logging.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
 
 #include <json-c/json.h>
 
 #include <linux/vm_sockets.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #define SERVICE_PORT 3000
 #define PROXY_PORT 8000
 #define BUF_SIZE 8192
+#define ENTROPY_WAIT_TIMEOUT_MS 5000
 AWS_STATIC_STRING_FROM_LITERAL(default_region, "us-east-1");
 
 enum status {
@@ -49,6 +58,17 @@ struct app_ctx {
     uint32_t proxy_port;
     /* alternative kms endpoint hostname */
     const struct aws_string *kms_endpoint;
+    /* vsock port on which metrics are served, 0 if disabled. */
+    uint32_t metrics_port;
+    int metrics_fd;
+    /* The metrics server thread, and the pipe written to stop it. */
+    struct aws_thread metrics_thread;
+    int metrics_stop_fds[2];
+    /* How long attestation documents are reused, in milliseconds, 0 to generate one per call. */
+    uint64_t attestation_ttl_ms;
+    /* The KMS client of the current session, read by the metrics server. Protected by client_mutex. */
+    struct aws_mutex client_mutex;
+    struct aws_nitro_enclaves_kms_client *client;
 };
 
 static void s_usage(int exit_code) {
@@ -57,6 +77,8 @@ static void s_usage(int exit_code) {
     fprintf(stderr, "    --region REGION: AWS region to use for KMS. Default: us-east-1.\n");
     fprintf(stderr, "    --port PORT: Await new connections on PORT. Default: 3000\n");
     fprintf(stderr, "    --proxy-port PORT: Connect to KMS proxy on PORT. Default: 2000\n");
+    fprintf(stderr, "    --metrics-port PORT: Serve OpenMetrics over HTTP on PORT. Default: disabled\n");
+    fprintf(stderr, "    --attestation-ttl-ms MS: Reuse attestation documents for MS milliseconds. Default: 0\n");
     fprintf(stderr, "    --help: Display this message and exit");
     exit(exit_code);
 }
@@ -65,6 +87,8 @@ static struct aws_cli_option s_long_options[] = {
     {"region", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'r'},
     {"port", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'p'},
     {"proxy-port", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'x'},
+    {"metrics-port", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'm'},
+    {"attestation-ttl-ms", AWS_CLI_OPTIONS_REQUIRED_ARGUMENT, NULL, 'a'},
     {"help", AWS_CLI_OPTIONS_NO_ARGUMENT, NULL, 'h'},
     {NULL, 0, NULL, 0},
 };
@@ -74,10 +98,12 @@ static void s_parse_options(int argc, char **argv, struct app_ctx *ctx) {
     ctx->proxy_port = PROXY_PORT;
     ctx->region = NULL;
     ctx->kms_endpoint = NULL;
+    ctx->metrics_port = 0;
+    ctx->attestation_ttl_ms = 0;
 
     while (true) {
         int option_index = 0;
-        int c = aws_cli_getopt_long(argc, argv, "r:p:x:h", s_long_options, &option_index);
+        int c = aws_cli_getopt_long(argc, argv, "r:p:x:m:a:h", s_long_options, &option_index);
         if (c == -1) {
             break;
         }
@@ -94,6 +120,12 @@ static void s_parse_options(int argc, char **argv, struct app_ctx *ctx) {
             case 'x':
                 ctx->proxy_port = atoi(aws_cli_optarg);
                 break;
+            case 'm':
+                ctx->metrics_port = atoi(aws_cli_optarg);
+                break;
+            case 'a':
+                ctx->attestation_ttl_ms = strtoull(aws_cli_optarg, NULL, 10);
+                break;
             case 'h':
                 s_usage(0);
                 break;
@@ -203,6 +235,310 @@ int s_send_status(int peer_fd, int status, const char *msg) {
     return rc;
 }
 
+/* Makes @client the one reported by the metrics server. It must be unpublished before it is destroyed. */
+static void s_publish_client(struct app_ctx *app_ctx, struct aws_nitro_enclaves_kms_client *client) {
+    aws_mutex_lock(&app_ctx->client_mutex);
+    app_ctx->client = client;
+    aws_mutex_unlock(&app_ctx->client_mutex);
+}
+
+static void s_appendf(struct aws_byte_buf *buf, const char *format, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (len > 0) {
+        struct aws_byte_cursor cursor = aws_byte_cursor_from_array(line, AWS_MIN((size_t)len, sizeof(line) - 1));
+        aws_byte_buf_append_dynamic(buf, &cursor);
+    }
+}
+
+/* Label values are escaped as required by the exposition format. */
+static void s_append_label_value(struct aws_byte_buf *buf, const char *value) {
+    for (const char *c = value; *c != '\0'; ++c) {
+        if (*c == '\\' || *c == '"') {
+            s_appendf(buf, "\\%c", *c);
+        } else if (*c == '\n') {
+            s_appendf(buf, "\\n");
+        } else {
+            s_appendf(buf, "%c", *c);
+        }
+    }
+}
+
+static void s_append_summary(
+    struct aws_byte_buf *buf,
+    const char *name,
+    const char *label,
+    const char *label_value,
+    const struct aws_nitro_enclaves_latency_summary *summary) {
+    const char *quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+    const uint64_t values[] = {summary->p50_ns, summary->p90_ns, summary->p99_ns, summary->p999_ns};
+
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(quantiles); ++i) {
+        s_appendf(
+            buf, "%s{%s=\"%s\",quantile=\"%s\"} %.9f\n", name, label, label_value, quantiles[i], values[i] / 1e9);
+    }
+    s_appendf(buf, "%s_sum{%s=\"%s\"} %.9f\n", name, label, label_value, summary->sum_ns / 1e9);
+    s_appendf(buf, "%s_count{%s=\"%s\"} %" PRIu64 "\n", name, label, label_value, summary->count);
+}
+
+/* Renders the metrics of the current KMS client in the OpenMetrics text format. */
+static void s_render_metrics(struct app_ctx *app_ctx, struct aws_byte_buf *buf) {
+    struct aws_nitro_enclaves_kms_metrics metrics;
+    struct aws_nitro_enclaves_rest_client_stats stats;
+    AWS_ZERO_STRUCT(metrics);
+    AWS_ZERO_STRUCT(stats);
+
+    aws_mutex_lock(&app_ctx->client_mutex);
+    bool has_client = app_ctx->client != NULL;
+    if (has_client) {
+        aws_nitro_enclaves_kms_client_get_metrics(app_ctx->client, &metrics);
+        aws_nitro_enclaves_rest_client_get_stats(app_ctx->client->rest_client, &stats);
+    }
+    aws_mutex_unlock(&app_ctx->client_mutex);
+
+    s_appendf(buf, "# HELP kmstool_client_configured Whether SetClient created a KMS client.\n");
+    s_appendf(buf, "# TYPE kmstool_client_configured gauge\n");
+    s_appendf(buf, "kmstool_client_configured %d\n", has_client ? 1 : 0);
+
+    s_appendf(buf, "# HELP kmstool_kms_requests KMS calls completed, including their retries.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_requests counter\n");
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        const char *operation = aws_kms_operation_name((enum aws_kms_operation)i);
+        s_appendf(
+            buf, "kmstool_kms_requests_total{operation=\"%s\"} %" PRIu64 "\n", operation, metrics.operations[i].calls);
+    }
+    s_appendf(buf, "# HELP kmstool_kms_request_failures KMS calls that did not end with HTTP 200.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_request_failures counter\n");
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        const char *operation = aws_kms_operation_name((enum aws_kms_operation)i);
+        s_appendf(
+            buf,
+            "kmstool_kms_request_failures_total{operation=\"%s\"} %" PRIu64 "\n",
+            operation,
+            metrics.operations[i].errors);
+    }
+    s_appendf(buf, "# HELP kmstool_kms_request_duration_seconds Duration of KMS calls, including their retries.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_request_duration_seconds summary\n");
+    s_appendf(buf, "# UNIT kmstool_kms_request_duration_seconds seconds\n");
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        s_append_summary(
+            buf,
+            "kmstool_kms_request_duration_seconds",
+            "operation",
+            aws_kms_operation_name((enum aws_kms_operation)i),
+            &metrics.operations[i].latency);
+    }
+    s_appendf(buf, "# HELP kmstool_kms_stage_duration_seconds Duration of the stages of KMS calls.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_stage_duration_seconds summary\n");
+    s_appendf(buf, "# UNIT kmstool_kms_stage_duration_seconds seconds\n");
+    for (size_t i = 0; i < AWS_KMS_STAGE_COUNT; ++i) {
+        s_append_summary(
+            buf,
+            "kmstool_kms_stage_duration_seconds",
+            "stage",
+            aws_kms_stage_name((enum aws_kms_stage)i),
+            &metrics.stages[i]);
+    }
+
+    s_appendf(buf, "# HELP kmstool_kms_responses KMS responses by HTTP status, over all attempts.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_responses counter\n");
+    for (size_t i = 0; i < metrics.http_status_count; ++i) {
+        s_appendf(
+            buf,
+            "kmstool_kms_responses_total{status=\"%d\"} %" PRIu64 "\n",
+            metrics.http_statuses[i].status,
+            metrics.http_statuses[i].count);
+    }
+    s_appendf(buf, "# HELP kmstool_kms_errors KMS error responses by error type.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_errors counter\n");
+    for (size_t i = 0; i < metrics.error_type_count; ++i) {
+        s_appendf(buf, "kmstool_kms_errors_total{type=\"");
+        s_append_label_value(buf, metrics.error_types[i].name);
+        s_appendf(buf, "\"} %" PRIu64 "\n", metrics.error_types[i].count);
+    }
+    s_appendf(buf, "# HELP kmstool_kms_connection_errors KMS attempts that got no response.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_connection_errors counter\n");
+    s_appendf(buf, "kmstool_kms_connection_errors_total %" PRIu64 "\n", metrics.connection_errors);
+    s_appendf(buf, "# TYPE kmstool_kms_sent_bytes counter\n");
+    s_appendf(buf, "# UNIT kmstool_kms_sent_bytes bytes\n");
+    s_appendf(buf, "kmstool_kms_sent_bytes_total %" PRIu64 "\n", metrics.bytes_out);
+    s_appendf(buf, "# TYPE kmstool_kms_received_bytes counter\n");
+    s_appendf(buf, "# UNIT kmstool_kms_received_bytes bytes\n");
+    s_appendf(buf, "kmstool_kms_received_bytes_total %" PRIu64 "\n", metrics.bytes_in);
+
+    /* Without a TTL every document is generated, so the cache series would only report misses. */
+    if (app_ctx->attestation_ttl_ms != 0) {
+        s_appendf(buf, "# HELP kmstool_attestation_cache_hits Attestation documents reused from the cache.\n");
+        s_appendf(buf, "# TYPE kmstool_attestation_cache_hits counter\n");
+        s_appendf(buf, "kmstool_attestation_cache_hits_total %" PRIu64 "\n", metrics.attestation_cache_hits);
+        s_appendf(buf, "# HELP kmstool_attestation_cache_misses Attestation documents generated.\n");
+        s_appendf(buf, "# TYPE kmstool_attestation_cache_misses counter\n");
+        s_appendf(buf, "kmstool_attestation_cache_misses_total %" PRIu64 "\n", metrics.attestation_cache_misses);
+    }
+
+    s_appendf(buf, "# HELP kmstool_kms_connected Whether the connection to KMS is established.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_connected gauge\n");
+    s_appendf(buf, "kmstool_kms_connected %d\n", stats.is_connected ? 1 : 0);
+    s_appendf(buf, "# HELP kmstool_kms_reconnect_attempts Consecutive failed attempts to reconnect to KMS.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_reconnect_attempts gauge\n");
+    s_appendf(buf, "kmstool_kms_reconnect_attempts %zu\n", stats.reconnect_attempts);
+    s_appendf(buf, "# HELP kmstool_kms_connections Connections established to KMS.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_connections counter\n");
+    s_appendf(buf, "kmstool_kms_connections_total %" PRIu64 "\n", stats.total_connections);
+    s_appendf(buf, "# HELP kmstool_kms_active_streams KMS requests in flight.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_active_streams gauge\n");
+    s_appendf(buf, "kmstool_kms_active_streams %zu\n", stats.active_streams);
+    s_appendf(buf, "# HELP kmstool_kms_max_concurrent_streams Limit of KMS requests in flight.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_max_concurrent_streams gauge\n");
+    s_appendf(buf, "kmstool_kms_max_concurrent_streams %zu\n", stats.max_concurrent_streams);
+    s_appendf(buf, "# HELP kmstool_kms_queued_requests KMS requests waiting for a connection or a free stream.\n");
+    s_appendf(buf, "# TYPE kmstool_kms_queued_requests gauge\n");
+    s_appendf(buf, "kmstool_kms_queued_requests %zu\n", stats.queued_requests);
+
+    s_appendf(buf, "# EOF\n");
+}
+
+/* Answers a single scrape: the request is read up to its blank line and ignored, whatever the path. */
+static void s_serve_metrics(struct app_ctx *app_ctx, int peer_fd) {
+    /* A peer that never finishes its request must not block the next scrapes for long. */
+    struct timeval timeout = {.tv_sec = 2};
+    setsockopt(peer_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char request[2048];
+    size_t request_len = 0;
+    while (request_len < sizeof(request) - 1) {
+        ssize_t bytes = read(peer_fd, request + request_len, sizeof(request) - 1 - request_len);
+        if (bytes == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        request_len += bytes;
+        request[request_len] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL) {
+            break;
+        }
+    }
+
+    struct aws_byte_buf body;
+    if (aws_byte_buf_init(&body, app_ctx->allocator, 8192) != AWS_OP_SUCCESS) {
+        return;
+    }
+    s_render_metrics(app_ctx, &body);
+
+    char header[256];
+    int header_len = snprintf(
+        header,
+        sizeof(header),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n\r\n",
+        body.len);
+    if (s_write_all(peer_fd, header, header_len) == header_len) {
+        s_write_all(peer_fd, (const char *)body.buffer, body.len);
+    }
+    aws_byte_buf_clean_up(&body);
+}
+
+/* Serves one scrape at a time on the metrics port, independently of the KMS session, until stopped. */
+static void s_metrics_server(void *arg) {
+    struct app_ctx *app_ctx = arg;
+    struct pollfd fds[2] = {
+        {.fd = app_ctx->metrics_fd, .events = POLLIN},
+        {.fd = app_ctx->metrics_stop_fds[0], .events = POLLIN},
+    };
+
+    while (true) {
+        if (poll(fds, AWS_ARRAY_SIZE(fds), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Could not wait for metrics connection");
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+
+        int peer_fd = accept(app_ctx->metrics_fd, NULL, NULL);
+        if (peer_fd < 0) {
+            if (errno == EAGAIN || errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("Could not accept metrics connection");
+            return;
+        }
+        s_serve_metrics(app_ctx, peer_fd);
+        close(peer_fd);
+    }
+}
+
+/* Opens the metrics port and serves it from its own thread. */
+static int s_start_metrics_server(struct app_ctx *app_ctx) {
+    app_ctx->metrics_fd = socket(AF_VSOCK, SOCK_STREAM, 0);
+    if (app_ctx->metrics_fd < 0) {
+        perror("Could not create metrics vsock port");
+        return AWS_OP_ERR;
+    }
+
+    struct sockaddr_vm svm = {
+        .svm_family = AF_VSOCK,
+        .svm_cid = VMADDR_CID_ANY,
+        .svm_port = app_ctx->metrics_port,
+        .svm_reserved1 = 0, /* needs to be set to 0 */
+    };
+    if (bind(app_ctx->metrics_fd, (struct sockaddr *)&svm, sizeof(svm)) < 0 || listen(app_ctx->metrics_fd, 4) < 0) {
+        perror("Could not listen on metrics port");
+        close(app_ctx->metrics_fd);
+        return AWS_OP_ERR;
+    }
+
+    if (pipe(app_ctx->metrics_stop_fds) < 0) {
+        perror("Could not create metrics server stop pipe");
+        close(app_ctx->metrics_fd);
+        return AWS_OP_ERR;
+    }
+
+    struct aws_thread_options thread_options = *aws_default_thread_options();
+    thread_options.join_strategy = AWS_TJS_MANUAL;
+    if (aws_thread_init(&app_ctx->metrics_thread, app_ctx->allocator) != AWS_OP_SUCCESS ||
+        aws_thread_launch(&app_ctx->metrics_thread, s_metrics_server, app_ctx, &thread_options) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "Could not start metrics server\n");
+        aws_thread_clean_up(&app_ctx->metrics_thread);
+        close(app_ctx->metrics_stop_fds[0]);
+        close(app_ctx->metrics_stop_fds[1]);
+        close(app_ctx->metrics_fd);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Stops the metrics server and waits for its thread, after which it no longer uses app_ctx or the client. */
+static void s_stop_metrics_server(struct app_ctx *app_ctx) {
+    if (app_ctx->metrics_port == 0) {
+        return;
+    }
+
+    char stop = 0;
+    while (write(app_ctx->metrics_stop_fds[1], &stop, sizeof(stop)) < 0 && errno == EINTR) {
+    }
+    aws_thread_join(&app_ctx->metrics_thread);
+    aws_thread_clean_up(&app_ctx->metrics_thread);
+
+    close(app_ctx->metrics_stop_fds[0]);
+    close(app_ctx->metrics_stop_fds[1]);
+    close(app_ctx->metrics_fd);
+}
+
 static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
     char buf[BUF_SIZE] = {0};
     size_t buf_idx = 0;
@@ -221,6 +557,8 @@ static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
         .endpoint = &endpoint,
         .domain = AWS_SOCKET_VSOCK,
         .host_name = app_ctx->kms_endpoint,
+        .enable_metrics = app_ctx->metrics_port != 0,
+        .attestation_document_ttl_ms = app_ctx->attestation_ttl_ms,
     };
 
     while (true) {
@@ -252,8 +590,8 @@ static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
             }
         }
 
-        /* Safe, because we know the buffer has a 0 before the end. */
-        fprintf(stderr, "Object = %s\n", buf);
+        /* Safe, because we know the buffer has a 0 before the end. The object is not logged, as it
+         * may hold ciphertexts and credentials. */
         object = json_tokener_parse(buf);
 
         /* Remove message from buffer */
@@ -266,16 +604,21 @@ static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
         struct json_object *operation = json_object_object_get(object, "Operation");
         fail_on(operation == NULL, loop_next_err, "JSON structure incomplete");
         fail_on(!json_object_is_type(operation, json_type_string), loop_next_err, "Operation is wrong type");
+        AWS_LOGF_DEBUG(AWS_LS_NITRO_ENCLAVES_GENERAL, "Received %s request.", json_object_get_string(operation));
 
         if (strcmp(json_object_get_string(operation), "SetClient") == 0) {
             /* SetClient operation sets the AWS credentials and optionally a region and
              * creates a matching KMS client. This needs to be called before Decrypt. */
+            rc = aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_WAIT_TIMEOUT_MS);
+            fail_on(rc != AWS_OP_SUCCESS, loop_next_err, "Entropy pool is not seeded");
             struct aws_credentials *new_credentials = s_read_credentials(app_ctx->allocator, object);
             fail_on(new_credentials == NULL, loop_next_err, "Could not read credentials");
 
             /* If credentials or client already exists, replace them. */
             if (credentials != NULL) {
+                s_publish_client(app_ctx, NULL);
                 aws_nitro_enclaves_kms_client_destroy(client);
+                client = NULL;
                 aws_credentials_release(credentials);
             }
 
@@ -292,6 +635,7 @@ static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
             client = aws_nitro_enclaves_kms_client_new(&configuration);
 
             fail_on(client == NULL, loop_next_err, "Could not create new client");
+            s_publish_client(app_ctx, client);
 
             rc = s_send_status(peer_fd, STATUS_OK, NULL);
             fail_on(rc <= 0, exit_clean_json, "Could not send status");
@@ -376,11 +720,13 @@ static void handle_connection(struct app_ctx *app_ctx, int peer_fd) {
         break_on(rc <= 0);
     }
 
+    s_publish_client(app_ctx, NULL);
     aws_nitro_enclaves_kms_client_destroy(client);
     aws_credentials_release(credentials);
     return;
 exit_clean_json:
     json_object_put(object);
+    s_publish_client(app_ctx, NULL);
     aws_nitro_enclaves_kms_client_destroy(client);
     aws_credentials_release(credentials);
     return;
@@ -393,12 +739,17 @@ int main(int argc, char **argv) {
     /* Initialize the SDK */
     aws_nitro_enclaves_library_init(NULL);
 
-    /* Initialize the entropy pool: this is relevant for TLS */
-    AWS_ASSERT(aws_nitro_enclaves_library_seed_entropy(1024) == AWS_OP_SUCCESS);
+    /* Seed the entropy pool in the background: this is relevant for TLS. SetClient waits for it. */
+    if (aws_nitro_enclaves_library_start_entropy_feeder(NULL) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "Could not start the entropy feeder\n");
+        exit(1);
+    }
 
     /* Parse the commandline */
     app_ctx.allocator = aws_nitro_enclaves_get_allocator();
     s_parse_options(argc, argv, &app_ctx);
+    app_ctx.client = NULL;
+    aws_mutex_init(&app_ctx.client_mutex);
 
     /* Set region if not already set and  */
     if (app_ctx.region == NULL && getenv("REGION") != NULL && strlen(getenv("REGION")) > 0) {
@@ -410,15 +761,16 @@ int main(int argc, char **argv) {
         app_ctx.kms_endpoint = aws_string_new_from_c_str(app_ctx.allocator, getenv("ENDPOINT"));
     }
 
-    /* Optional: Enable logging for aws-c-* libraries */
+    /* Optional: Enable logging for aws-c-* libraries. Lines are written to stderr from a background
+     * thread, so that request handling does not wait on the console. */
     struct aws_logger err_logger;
-    struct aws_logger_standard_options options = {
+    struct aws_nitro_enclaves_async_logger_options options = {
         .file = stderr,
         .level = AWS_LL_INFO,
-        .filename = NULL,
     };
-    aws_logger_init_standard(&err_logger, app_ctx.allocator, &options);
-    aws_logger_set(&err_logger);
+    if (aws_nitro_enclaves_logger_init_async(&err_logger, app_ctx.allocator, &options) == AWS_OP_SUCCESS) {
+        aws_logger_set(&err_logger);
+    }
 
     /* Set up a really simple vsock server. We are purposefully using vsock directly
      * in this example, as an example for using it in other projects.
@@ -459,11 +811,17 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
+    /* The parent can scrape the metrics through a TCP to vsock forwarder, such as socat. */
+    if (app_ctx.metrics_port != 0 && s_start_metrics_server(&app_ctx) != AWS_OP_SUCCESS) {
+        close(vsock_fd);
+        exit(1);
+    }
+
     while (true) {
         /* Wait for a new connection. */
-        fprintf(stderr, "Awaiting connection...\n");
+        AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_GENERAL, "Awaiting connection...");
         int peer_fd = accept(vsock_fd, NULL, NULL);
-        fprintf(stderr, "Connected peer\n");
+        AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_GENERAL, "Connected peer.");
         if (peer_fd < 0) {
             if (errno == EAGAIN || errno == EINTR) {
                 /* Try to get a new connection again */
@@ -471,14 +829,16 @@ int main(int argc, char **argv) {
             }
             perror("Could not accept new connection");
             close(vsock_fd);
+            s_stop_metrics_server(&app_ctx);
             aws_nitro_enclaves_library_clean_up();
             exit(1);
         }
         handle_connection(&app_ctx, peer_fd);
-        fprintf(stderr, "Sesssion ended\n");
+        AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_GENERAL, "Session ended.");
         close(peer_fd);
     }
 
+    s_stop_metrics_server(&app_ctx);
     aws_nitro_enclaves_library_clean_up();
 
     return 0;
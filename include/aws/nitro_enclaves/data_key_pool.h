@@ -0,0 +1,171 @@
+#ifndef AWS_NITRO_ENCLAVES_DATA_KEY_POOL_H
+#define AWS_NITRO_ENCLAVES_DATA_KEY_POOL_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/kms.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/string.h>
+
+/**
+ * @file
+ * A pool of data keys generated ahead of time with aws_kms_generate_data_key_blocking. The pool keeps
+ * a number of plaintext/ciphertext pairs ready for every key id and key spec it is asked for, and
+ * refills them from a fixed number of background threads, so that issuing a data key is a local
+ * dequeue. Keys that are not issued before they expire are wiped, and a key id and key spec that is
+ * not used for a while is no longer refilled and is dropped along with its keys.
+ */
+
+/**
+ * A thread safe data key pool.
+ */
+struct aws_nitro_enclaves_data_key_pool;
+
+/**
+ * Generates a data key, as aws_kms_generate_data_key_blocking does.
+ *
+ * @param[in]   user_data       The user_data of the pool options.
+ * @param[in]   key_id          The ARN or alias of the AWS KMS CMK used to encrypt the data key.
+ * @param[in]   key_spec        The spec of the data key.
+ * @param[out]  plaintext       The plaintext data key. An empty aws_byte_buf, to be initialized.
+ * @param[out]  ciphertext_blob The encrypted data key. An empty aws_byte_buf, to be initialized.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR with the error raised otherwise.
+ */
+typedef int(aws_nitro_enclaves_data_key_pool_generate_fn)(
+    void *user_data,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec,
+    struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob);
+
+/**
+ * Options of @ref aws_nitro_enclaves_data_key_pool_new.
+ */
+struct aws_nitro_enclaves_data_key_pool_options {
+    /**
+     * The client used to generate the data keys. It must outlive the pool.
+     *
+     * Required: Yes, unless generate_data_key is set.
+     */
+    struct aws_nitro_enclaves_kms_client *client;
+
+    /**
+     * The function generating the data keys, in place of aws_kms_generate_data_key_blocking on client.
+     * Defaults to aws_kms_generate_data_key_blocking if NULL.
+     *
+     * Required: No.
+     */
+    aws_nitro_enclaves_data_key_pool_generate_fn *generate_data_key;
+
+    /**
+     * The argument of generate_data_key.
+     *
+     * Required: No.
+     */
+    void *user_data;
+
+    /**
+     * Number of data keys kept ready for each key id and key spec.
+     * Defaults to 16 if 0.
+     *
+     * Required: No.
+     */
+    size_t keys_per_spec;
+
+    /**
+     * Number of threads refilling the pool, which bounds the number of concurrent GenerateDataKey calls.
+     * Defaults to 2 if 0.
+     *
+     * Required: No.
+     */
+    size_t max_concurrent_refills;
+
+    /**
+     * Time after which a data key that was not issued is wiped, in milliseconds.
+     * Defaults to 300000 (5 minutes) if 0.
+     *
+     * Required: No.
+     */
+    uint64_t key_ttl_ms;
+
+    /**
+     * Time after which a key id and key spec that was neither warmed nor acquired is no longer
+     * refilled, and is dropped along with its keys, in milliseconds.
+     * Defaults to 600000 (10 minutes) if 0.
+     *
+     * Required: No.
+     */
+    uint64_t idle_timeout_ms;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a data key pool and starts its refill threads. The pool starts empty; keys are generated
+ * for a key id and key spec once they are warmed or first acquired.
+ *
+ * @param[in]   allocator   The allocator used for the pool.
+ * @param[in]   options     The pool options.
+ *
+ * @return                  A new pool or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_data_key_pool *aws_nitro_enclaves_data_key_pool_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_data_key_pool_options *options);
+
+/**
+ * Stops the refill threads, waits for the calls in flight and wipes the keys left in the pool.
+ * Accepts NULL.
+ *
+ * @param[in]   pool    The pool to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_data_key_pool_destroy(struct aws_nitro_enclaves_data_key_pool *pool);
+
+/**
+ * Starts keeping data keys ready for a key id and key spec, without issuing one. The key id and key
+ * spec stay warm for idle_timeout_ms, unless they are acquired from in the meantime.
+ *
+ * @param[in]   pool        The pool.
+ * @param[in]   key_id      The ARN or alias of the AWS KMS CMK used to encrypt the data keys.
+ * @param[in]   key_spec    The spec of the data keys.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_data_key_pool_warm(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec);
+
+/**
+ * Issues a data key. Takes a ready key from the pool if there is one, and otherwise calls
+ * aws_kms_generate_data_key_blocking directly. Either way, the pool is refilled in the background.
+ *
+ * @param[in]   pool            The pool.
+ * @param[in]   key_id          The ARN or alias of the AWS KMS CMK used to encrypt the data key.
+ * @param[in]   key_spec        The spec of the data key.
+ * @param[out]  plaintext       The plaintext data key. Should be an empty, but non-null aws_byte_buf.
+ *                              The caller wipes it with aws_byte_buf_clean_up_secure.
+ * @param[out]  ciphertext_blob The encrypted data key. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_data_key_pool_acquire(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec,
+    struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_DATA_KEY_POOL_H */
@@ -0,0 +1,125 @@
+#ifndef AWS_NITRO_ENCLAVES_DRBG_H
+#define AWS_NITRO_ENCLAVES_DRBG_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+
+/**
+ * @file
+ * An enclave-local deterministic random bit generator (HMAC_DRBG with SHA-256, NIST SP 800-90A).
+ * It is seeded from the NitroSecureModule and, optionally, from AWS KMS GenerateRandom, and is
+ * reseeded from the same sources after a number of bytes or an amount of time. Between reseeds,
+ * random bytes are produced in memory, without an attestation document or a KMS round trip.
+ */
+
+struct aws_nitro_enclaves_kms_client;
+
+/**
+ * A thread safe DRBG.
+ */
+struct aws_nitro_enclaves_drbg;
+
+/**
+ * Options of @ref aws_nitro_enclaves_drbg_new.
+ */
+struct aws_nitro_enclaves_drbg_options {
+    /**
+     * The client whose KMS GenerateRandom output is mixed into every seed, along with NSM output.
+     * If NULL, the DRBG is seeded from NSM only. The client must outlive the DRBG.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_client *kms_client;
+
+    /**
+     * Number of bytes generated before the DRBG is reseeded.
+     * Defaults to 1048576 (1 MiB) if 0.
+     *
+     * Required: No.
+     */
+    size_t reseed_bytes;
+
+    /**
+     * Time after which the DRBG is reseeded, in milliseconds.
+     * Defaults to 60000 if 0.
+     *
+     * Required: No.
+     */
+    uint64_t reseed_interval_ms;
+
+    /**
+     * Time to wait after a failed reseed before the next attempt, in milliseconds.
+     * Defaults to 1000 if 0.
+     *
+     * Required: No.
+     */
+    uint64_t reseed_retry_interval_ms;
+
+    /**
+     * Number of bytes generated since the last successful reseed after which generation fails,
+     * until a reseed succeeds.
+     * Defaults to 4 times reseed_bytes if 0, and is never lower than reseed_bytes.
+     *
+     * Required: No.
+     */
+    size_t max_bytes_without_reseed;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a DRBG and seeds it. Seeding calls NSM and, if configured, KMS, so it fails outside of an
+ * enclave.
+ *
+ * @param[in]   allocator   The allocator used for the DRBG.
+ * @param[in]   options     The DRBG options. NULL for defaults.
+ *
+ * @return                  A new DRBG or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_drbg *aws_nitro_enclaves_drbg_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_drbg_options *options);
+
+/**
+ * Destroys a DRBG and wipes its state. Accepts NULL.
+ *
+ * @param[in]   drbg    The DRBG to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_drbg_destroy(struct aws_nitro_enclaves_drbg *drbg);
+
+/**
+ * Fills the remaining capacity of a buffer with random bytes, as aws_device_random_buffer does.
+ * Reseeds the DRBG first when the reseed policy requires it; if the reseed fails, the bytes are
+ * still generated and the reseed is retried once reseed_retry_interval_ms has elapsed. Fails, without
+ * writing anything, when filling the buffer would bring the bytes generated since the last successful
+ * reseed above max_bytes_without_reseed.
+ *
+ * @param[in]   drbg    The DRBG.
+ * @param[out]  output  The buffer to fill.
+ *
+ * @return              AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_drbg_random_buffer(struct aws_nitro_enclaves_drbg *drbg, struct aws_byte_buf *output);
+
+/**
+ * Reseeds the DRBG now, from the same sources as the initial seed.
+ *
+ * @param[in]   drbg    The DRBG.
+ *
+ * @return              AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_drbg_reseed(struct aws_nitro_enclaves_drbg *drbg);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_DRBG_H */
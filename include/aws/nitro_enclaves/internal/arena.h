@@ -0,0 +1,114 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_ARENA_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_ARENA_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+
+/**
+ * A bump allocator for objects that share one lifetime, such as the temporary objects of a single
+ * KMS call. Allocations are carved out of large blocks and are only reclaimed all at once, when the
+ * arena is reset; the used memory is wiped at that point, since it may hold key material. Blocks are
+ * kept across resets, so an arena that is reused for similar work stops allocating from its parent.
+ *
+ * An arena is not thread safe.
+ */
+struct aws_nitro_enclaves_arena;
+
+/**
+ * A thread safe pool of arenas, so that concurrent callers each get their own arena.
+ */
+struct aws_nitro_enclaves_arena_pool;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates an arena.
+ *
+ * @param[in]   allocator   The allocator the arena takes its blocks from.
+ * @param[in]   block_size  The size of a block. Larger allocations get a block of their own.
+ *
+ * @return                  A new arena or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_arena *aws_nitro_enclaves_arena_new(struct aws_allocator *allocator, size_t block_size);
+
+/**
+ * Wipes and destroys an arena, along with everything allocated from it. Accepts NULL.
+ *
+ * @param[in]   arena       The arena to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_arena_destroy(struct aws_nitro_enclaves_arena *arena);
+
+/**
+ * Returns the allocator interface of an arena. Releasing memory through it is a no-op; memory is
+ * reclaimed by @ref aws_nitro_enclaves_arena_reset.
+ *
+ * @param[in]   arena       The arena.
+ *
+ * @return                  The allocator, valid for the lifetime of the arena.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_allocator *aws_nitro_enclaves_arena_allocator(struct aws_nitro_enclaves_arena *arena);
+
+/**
+ * Wipes everything allocated from an arena and makes its memory available again. If the arena
+ * needed more than one block since the previous reset, its blocks are replaced by a single block
+ * large enough for that usage.
+ *
+ * @param[in]   arena       The arena.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_arena_reset(struct aws_nitro_enclaves_arena *arena);
+
+/**
+ * Creates an arena pool.
+ *
+ * @param[in]   allocator   The allocator used for the pool and its arenas.
+ * @param[in]   block_size  The block size of the arenas.
+ * @param[in]   max_pooled  The number of released arenas kept for reuse.
+ *
+ * @return                  A new arena pool or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_arena_pool *aws_nitro_enclaves_arena_pool_new(
+    struct aws_allocator *allocator,
+    size_t block_size,
+    size_t max_pooled);
+
+/**
+ * Destroys an arena pool and the arenas it holds. Arenas taken from the pool must have been
+ * released first. Accepts NULL.
+ *
+ * @param[in]   pool        The arena pool.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_arena_pool_destroy(struct aws_nitro_enclaves_arena_pool *pool);
+
+/**
+ * Takes an empty arena from a pool, creating one if the pool is empty.
+ *
+ * @param[in]   pool        The arena pool.
+ *
+ * @return                  An arena or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_arena *aws_nitro_enclaves_arena_pool_get(struct aws_nitro_enclaves_arena_pool *pool);
+
+/**
+ * Resets an arena taken from a pool and returns it to the pool, or destroys it if the pool is full.
+ * Accepts NULL.
+ *
+ * @param[in]   arena       The arena.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_arena_release(struct aws_nitro_enclaves_arena *arena);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_ARENA_H */
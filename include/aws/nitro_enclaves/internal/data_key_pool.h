@@ -0,0 +1,35 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_DATA_KEY_POOL_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_DATA_KEY_POOL_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/data_key_pool.h>
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Computes the time a key id and key spec are left alone after consecutive failed refills: the
+ * delay doubles with every failure, up to a maximum.
+ *
+ * @param[in]   failures    The number of consecutive failed refills, at least 1.
+ *
+ * @return                  The delay, in milliseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+uint64_t aws_nitro_enclaves_data_key_pool_refill_delay_ms(size_t failures);
+
+/**
+ * Returns the number of key ids and key specs the pool currently keeps data keys for.
+ *
+ * @param[in]   pool    The pool.
+ *
+ * @return              The number of queues.
+ */
+AWS_NITRO_ENCLAVES_API
+size_t aws_nitro_enclaves_data_key_pool_queue_count(struct aws_nitro_enclaves_data_key_pool *pool);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_DATA_KEY_POOL_H */
@@ -0,0 +1,44 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_DRBG_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_DRBG_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/drbg.h>
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Appends seed material to a buffer, in place of the NSM output. Must append exactly the
+ * requested number of bytes, or fail.
+ *
+ * @param[in]   user_data   The user data given to @ref aws_nitro_enclaves_drbg_new_with_seed_source.
+ * @param[out]  seed        The buffer to append to.
+ * @param[in]   len         The number of bytes to append.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+typedef int(aws_nitro_enclaves_drbg_seed_fn)(void *user_data, struct aws_byte_buf *seed, size_t len);
+
+/**
+ * Creates a DRBG as @ref aws_nitro_enclaves_drbg_new does, but seeded from the given source
+ * instead of NSM. KMS output is still mixed in if the options name a client.
+ *
+ * @param[in]   allocator   The allocator used for the DRBG.
+ * @param[in]   options     The DRBG options. NULL for defaults.
+ * @param[in]   seed_fn     The seed source, called for the initial seed and for every reseed.
+ * @param[in]   user_data   Passed to seed_fn.
+ *
+ * @return                  A new DRBG or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_drbg *aws_nitro_enclaves_drbg_new_with_seed_source(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_drbg_options *options,
+    aws_nitro_enclaves_drbg_seed_fn *seed_fn,
+    void *user_data);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_DRBG_H */
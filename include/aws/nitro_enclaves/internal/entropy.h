@@ -0,0 +1,93 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_ENTROPY_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_ENTROPY_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/common.h>
+
+struct aws_nitro_enclaves_entropy_feeder_options;
+struct rand_pool_info;
+
+/**
+ * The random source and the kernel entropy pool the feeder works with: the NSM device and
+ * /dev/random outside of tests. Every function returns AWS_OP_SUCCESS or AWS_OP_ERR.
+ */
+struct aws_nitro_enclaves_entropy_source {
+    /* Opens the source. close is called even if this fails. */
+    int (*open)(void *user_data);
+
+    /* Closes the source. */
+    void (*close)(void *user_data);
+
+    /* Reads up to *len random bytes, as nsm_get_random does, and stores the number read in *len. */
+    int (*get_random)(void *user_data, uint8_t *buf, size_t *len);
+
+    /* Reads the entropy of the kernel pool in bits, as the RNDGETENTCNT ioctl does. */
+    int (*get_entropy_count)(void *user_data, int *bits);
+
+    /* Credits a batch to the kernel pool, as the RNDADDENTROPY ioctl does. */
+    int (*add_entropy)(void *user_data, const struct rand_pool_info *pool);
+
+    void *user_data;
+};
+
+/**
+ * The devices behind the default entropy source.
+ */
+struct aws_nitro_enclaves_entropy_devices {
+    int nsm_fd;
+    int random_fd;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Sets up the entropy source reading from NSM and crediting /dev/random.
+ *
+ * @param[out]  source      The source to set up.
+ * @param[in]   devices     Holds the devices from open to close. Must outlive the source.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_entropy_source_init_devices(
+    struct aws_nitro_enclaves_entropy_source *source,
+    struct aws_nitro_enclaves_entropy_devices *devices);
+
+/**
+ * Reads random bytes from an open source and credits them to the kernel entropy pool, in batches
+ * of one RNDADDENTROPY ioctl each.
+ *
+ * @param[in]   source      An open entropy source.
+ * @param[in]   num_bytes   The number of bytes to feed.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_entropy_feed(const struct aws_nitro_enclaves_entropy_source *source, size_t num_bytes);
+
+/**
+ * Starts the entropy feeder as aws_nitro_enclaves_library_start_entropy_feeder does, on the given
+ * source instead of NSM and /dev/random.
+ *
+ * @param[in]   options     The feeder options. NULL for defaults.
+ * @param[in]   source      The source, copied. Its user data must outlive the feeder.
+ *
+ * @return                  AWS_OP_SUCCESS if the feeder is running.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_entropy_feeder_start_with_source(
+    const struct aws_nitro_enclaves_entropy_feeder_options *options,
+    const struct aws_nitro_enclaves_entropy_source *source);
+
+/**
+ * Stops the entropy feeder thread, if it is running, and waits for it to exit.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_entropy_feeder_stop(void);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_ENTROPY_H */
@@ -0,0 +1,168 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_FUTURE_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_FUTURE_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/condition_variable.h>
+
+/**
+ * A one-shot, reference counted completion. An asynchronous operation completes the future with an
+ * error code, once; the threads waiting on it wake up and read the result.
+ */
+struct aws_nitro_enclaves_future;
+
+/**
+ * A thread safe pool of futures. Futures taken from a pool return to it when their last reference
+ * is released, so their mutex and condition variable are initialized once and reused.
+ */
+struct aws_nitro_enclaves_future_pool;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a future pool.
+ *
+ * @param[in]   allocator   The allocator used for the pool and its futures.
+ * @param[in]   max_pooled  The number of released futures kept for reuse.
+ *
+ * @return                  A new future pool or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_future_pool *aws_nitro_enclaves_future_pool_new(
+    struct aws_allocator *allocator,
+    size_t max_pooled);
+
+/**
+ * Releases the owner's reference to a pool. Futures still in use keep the pool alive until they are
+ * released. Accepts NULL.
+ *
+ * @param[in]   pool        The future pool.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_future_pool_release(struct aws_nitro_enclaves_future_pool *pool);
+
+/**
+ * Takes a pending future from a pool, creating one if the pool is empty.
+ *
+ * @param[in]   pool        The future pool.
+ *
+ * @return                  A pending future holding one reference, or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_pool_get(struct aws_nitro_enclaves_future_pool *pool);
+
+/**
+ * Creates a pending future that does not belong to a pool.
+ *
+ * @param[in]   allocator   The allocator used for the future.
+ *
+ * @return                  A pending future holding one reference, or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_new(struct aws_allocator *allocator);
+
+/**
+ * Acquires a reference to a future.
+ *
+ * @param[in]   future      The future.
+ *
+ * @return                  The future.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_acquire(struct aws_nitro_enclaves_future *future);
+
+/**
+ * Releases a reference to a future. The last release returns it to its pool or destroys it.
+ * Accepts NULL.
+ *
+ * @param[in]   future      The future.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_future_release(struct aws_nitro_enclaves_future *future);
+
+/**
+ * Completes a future and wakes up its waiters. Only the first completion is recorded.
+ *
+ * @param[in]   future      The future.
+ * @param[in]   error_code  The result, AWS_ERROR_SUCCESS on success.
+ *
+ * @return                  True if this call completed the future.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_future_complete(struct aws_nitro_enclaves_future *future, int error_code);
+
+/**
+ * Returns whether a future is complete. Does not block.
+ *
+ * @param[in]   future      The future.
+ *
+ * @return                  True once the future is complete.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_future_is_done(const struct aws_nitro_enclaves_future *future);
+
+/**
+ * Returns the result of a complete future.
+ *
+ * @param[in]   future      The future.
+ *
+ * @return                  The error code the future was completed with.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_future_get_error(const struct aws_nitro_enclaves_future *future);
+
+/**
+ * Makes a complete future pending again, so a single owner can reuse it for a new operation. Must
+ * not be called while the previous operation may still complete it.
+ *
+ * @param[in]   future      The future.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_future_reset(struct aws_nitro_enclaves_future *future);
+
+/**
+ * Wakes up the waiters of a future without completing it, so that they evaluate their predicate
+ * again.
+ *
+ * @param[in]   future      The future.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_future_notify(struct aws_nitro_enclaves_future *future);
+
+/**
+ * Waits until a future is complete or @deadline_ns passes.
+ *
+ * @param[in]   future      The future.
+ * @param[in]   deadline_ns The deadline on the high resolution clock. 0 waits indefinitely.
+ *
+ * @return                  True if the future is complete.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_future_wait(struct aws_nitro_enclaves_future *future, uint64_t deadline_ns);
+
+/**
+ * Waits until @pred holds or @deadline_ns passes. The predicate is evaluated with the future's lock
+ * held, on every completion and notification, and is safe against spurious wakeups.
+ *
+ * @param[in]   future      The future.
+ * @param[in]   deadline_ns The deadline on the high resolution clock. 0 waits indefinitely.
+ * @param[in]   pred        The condition to wait for.
+ * @param[in]   user_data   The argument of @pred.
+ *
+ * @return                  True if @pred holds.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_future_wait_pred(
+    struct aws_nitro_enclaves_future *future,
+    uint64_t deadline_ns,
+    aws_condition_predicate_fn *pred,
+    void *user_data);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_FUTURE_H */
@@ -0,0 +1,62 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_HISTOGRAM_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_HISTOGRAM_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/metrics.h>
+
+#include <aws/common/allocator.h>
+
+/**
+ * A thread safe latency histogram with log-linear buckets, in the style of HdrHistogram: each power
+ * of two is split into 16 buckets, so any recorded value is known to within 1/16 in constant memory.
+ */
+struct aws_nitro_enclaves_histogram;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates an empty histogram.
+ *
+ * @param[in]   allocator   The allocator used for the histogram.
+ *
+ * @return                  A new histogram or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_histogram *aws_nitro_enclaves_histogram_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a histogram. Accepts NULL.
+ *
+ * @param[in]   histogram   The histogram to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_histogram_destroy(struct aws_nitro_enclaves_histogram *histogram);
+
+/**
+ * Records a value. Values beyond 2^40 ns (about 18 minutes) are counted in the last bucket.
+ *
+ * @param[in]   histogram   The histogram.
+ * @param[in]   value_ns    The value, in nanoseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_histogram_record(struct aws_nitro_enclaves_histogram *histogram, uint64_t value_ns);
+
+/**
+ * Summarizes the recorded values. A percentile is reported as the upper bound of its bucket, capped
+ * at the largest recorded value.
+ *
+ * @param[in]   histogram   The histogram.
+ * @param[out]  summary     The summary, all zero if nothing was recorded.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_histogram_summarize(
+    struct aws_nitro_enclaves_histogram *histogram,
+    struct aws_nitro_enclaves_latency_summary *summary);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_HISTOGRAM_H */
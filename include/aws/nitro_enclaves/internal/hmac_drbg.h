@@ -0,0 +1,76 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_HMAC_DRBG_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_HMAC_DRBG_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/byte_buf.h>
+
+/* Length of the HMAC-SHA-256 output, which is also the length of the key and value of the state. */
+#define AWS_NITRO_ENCLAVES_HMAC_DRBG_OUTLEN 32
+
+/* Maximum number of bytes returned by a single generate call (2^19 bits). */
+#define AWS_NITRO_ENCLAVES_HMAC_DRBG_MAX_GENERATE 65536
+
+/**
+ * The working state of an HMAC_DRBG with SHA-256, as specified in NIST SP 800-90A Rev. 1, section 10.1.2.
+ * Not thread safe: callers serialize access.
+ */
+struct aws_nitro_enclaves_hmac_drbg {
+    uint8_t key[AWS_NITRO_ENCLAVES_HMAC_DRBG_OUTLEN];
+    uint8_t value[AWS_NITRO_ENCLAVES_HMAC_DRBG_OUTLEN];
+    uint64_t reseed_counter;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Instantiates the DRBG.
+ *
+ * @param[out]  drbg            The state to instantiate.
+ * @param[in]   seed_material   Entropy input, nonce and personalization string, concatenated.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_hmac_drbg_init(struct aws_nitro_enclaves_hmac_drbg *drbg, struct aws_byte_cursor seed_material);
+
+/**
+ * Reseeds the DRBG.
+ *
+ * @param[in]   drbg            The state to reseed.
+ * @param[in]   seed_material   Entropy input and additional input, concatenated.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_hmac_drbg_reseed(
+    struct aws_nitro_enclaves_hmac_drbg *drbg,
+    struct aws_byte_cursor seed_material);
+
+/**
+ * Generates pseudorandom bytes, without additional input.
+ *
+ * @param[in]   drbg    The state.
+ * @param[out]  out     Receives the bytes.
+ * @param[in]   len     The number of bytes, at most AWS_NITRO_ENCLAVES_HMAC_DRBG_MAX_GENERATE.
+ *
+ * @return              AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_hmac_drbg_generate(struct aws_nitro_enclaves_hmac_drbg *drbg, uint8_t *out, size_t len);
+
+/**
+ * Wipes the state.
+ *
+ * @param[in]   drbg    The state to wipe.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_hmac_drbg_clean_up(struct aws_nitro_enclaves_hmac_drbg *drbg);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_HMAC_DRBG_H */
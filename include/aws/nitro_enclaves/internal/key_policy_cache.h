@@ -0,0 +1,122 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_KEY_POLICY_CACHE_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_KEY_POLICY_CACHE_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/string.h>
+
+/**
+ * A thread safe cache of GetKeyPolicy and ListKeyPolicies answers, keyed by request. An answer is
+ * either a response or the error code of a failed call, which expire after different times. The
+ * cache holds a bounded number of answers: expired answers are dropped on every insert, and the
+ * answer closest to expiry makes room for a new one once the cache is full.
+ */
+struct aws_nitro_enclaves_key_policy_cache;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a key policy cache.
+ *
+ * @param[in]   allocator       The allocator used for the cache and its answers.
+ * @param[in]   ttl_ms          How long a response is reused, in milliseconds.
+ * @param[in]   negative_ttl_ms How long a failure is reused, in milliseconds.
+ * @param[in]   max_entries     The maximum number of answers held. Must be greater than 0.
+ *
+ * @return                      A new cache or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_key_policy_cache *aws_nitro_enclaves_key_policy_cache_new(
+    struct aws_allocator *allocator,
+    uint64_t ttl_ms,
+    uint64_t negative_ttl_ms,
+    size_t max_entries);
+
+/**
+ * Destroys a key policy cache and its answers. Accepts NULL.
+ *
+ * @param[in]   cache   The cache to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_key_policy_cache_destroy(struct aws_nitro_enclaves_key_policy_cache *cache);
+
+/**
+ * Looks up the answer to a request at time @now_ns.
+ *
+ * @param[in]   cache           The cache.
+ * @param[in]   cache_key       The key identifying the request.
+ * @param[in]   now_ns          The current time, in nanoseconds from a monotonic clock.
+ * @param[in]   allocator       The allocator used for the copy of the response.
+ * @param[out]  response_json   The copy of the response, if the answer is one. Should be an empty,
+ *                              but non-null aws_byte_buf.
+ * @param[out]  error_code      AWS_ERROR_SUCCESS if @response_json was set, or the error code of the
+ *                              answer or of the copy otherwise. Set if an answer was found.
+ * @param[out]  generation      The generation to store the answer with, set if no answer was found.
+ *
+ * @return                      True if an answer that has not expired was found.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_key_policy_cache_get(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    uint64_t now_ns,
+    struct aws_allocator *allocator,
+    struct aws_byte_buf *response_json,
+    int *error_code,
+    uint64_t *generation);
+
+/**
+ * Stores the answer to a request, obtained at time @now_ns. The answer is dropped if the cache was
+ * invalidated since @generation was returned by aws_nitro_enclaves_key_policy_cache_get, as the
+ * invalidation may have been meant for it.
+ *
+ * @param[in]   cache           The cache.
+ * @param[in]   cache_key       The key identifying the request.
+ * @param[in]   key_id          The key id of the request, which invalidations are matched against.
+ * @param[in]   error_code      AWS_ERROR_SUCCESS if the call succeeded, or the error it failed with.
+ * @param[in]   response_json   The response of the call. Ignored if @error_code is not AWS_ERROR_SUCCESS.
+ * @param[in]   now_ns          The time the call was made at, in nanoseconds from a monotonic clock.
+ * @param[in]   generation      The generation returned by the lookup that preceded the call.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_key_policy_cache_put(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    const struct aws_string *key_id,
+    int error_code,
+    const struct aws_byte_buf *response_json,
+    uint64_t now_ns,
+    uint64_t generation);
+
+/**
+ * Drops the answers of a key, and keeps the answers of the calls in flight from being stored.
+ *
+ * @param[in]   cache   The cache.
+ * @param[in]   key_id  The key id the answers were stored for, or NULL for all keys.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_key_policy_cache_invalidate(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *key_id);
+
+/**
+ * Returns the number of answers held by the cache, expired or not.
+ *
+ * @param[in]   cache   The cache.
+ *
+ * @return              The number of answers.
+ */
+AWS_NITRO_ENCLAVES_API
+size_t aws_nitro_enclaves_key_policy_cache_size(struct aws_nitro_enclaves_key_policy_cache *cache);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_KEY_POLICY_CACHE_H */
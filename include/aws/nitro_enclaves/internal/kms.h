@@ -0,0 +1,60 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_KMS_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_KMS_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/byte_buf.h>
+#include <aws/common/string.h>
+#include <aws/io/retry_strategy.h>
+
+struct aws_nitro_enclaves_kms_client;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Classifies the outcome of a KMS call attempt. Connection failures, HTTP 429, HTTP 400 with a
+ * ThrottlingException and HTTP 5xx are retryable; successes and any other failure are not.
+ * Attempts that timed out or were cancelled are not retried either, so that the request deadline
+ * and cancellation hold for the whole call.
+ *
+ * @param[in]   status      The HTTP status of the attempt, or AWS_OP_ERR if no response was received.
+ * @param[in]   error_code  The error the attempt failed with. Ignored unless @status is AWS_OP_ERR.
+ * @param[in]   response    The body of the response, or NULL.
+ * @param[out]  error_type  The kind of failure, set if the attempt is retryable.
+ *
+ * @return                  True if the attempt should be retried.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_kms_call_is_retryable(
+    int status,
+    int error_code,
+    const struct aws_string *response,
+    enum aws_retry_error_type *error_type);
+
+/**
+ * Calls ListKeyPolicies as aws_kms_list_key_policies_blocking does, but neither reads nor fills the
+ * key policy cache of the client. Used for page walks, whose pages are not worth keeping.
+ *
+ * @param[in]   client          The KMS client to use.
+ * @param[in]   key_id          The key whose policies are listed.
+ * @param[in]   limit           The maximum number of policy names in the page, up to 1000.
+ * @param[in]   marker          The marker of the page, or NULL for the first one.
+ * @param[out]  response_json   The raw JSON response from AWS KMS. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_kms_list_key_policies_uncached(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_KMS_H */
@@ -0,0 +1,116 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_KMS_METRICS_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_KMS_METRICS_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/metrics.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+
+/**
+ * The thread safe metrics of a KMS client: stage and call latency histograms, response counters and
+ * traffic. Optionally hands a snapshot to a callback at a fixed interval, from its own thread.
+ */
+struct aws_nitro_enclaves_kms_metrics_recorder;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a metrics recorder.
+ *
+ * @param[in]   allocator           The allocator used for the recorder.
+ * @param[in]   dump_interval_ms    Interval between two dumps, in milliseconds. 0 disables dumps.
+ * @param[in]   dump_fn             Receives the dumps. If NULL, they are logged.
+ * @param[in]   dump_user_data      The argument of @dump_fn.
+ *
+ * @return                          A new recorder or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_kms_metrics_recorder *aws_nitro_enclaves_kms_metrics_recorder_new(
+    struct aws_allocator *allocator,
+    uint64_t dump_interval_ms,
+    aws_nitro_enclaves_kms_metrics_dump_fn *dump_fn,
+    void *dump_user_data);
+
+/**
+ * Stops the dumps and destroys a recorder. Accepts NULL.
+ *
+ * @param[in]   recorder    The recorder to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_recorder_destroy(struct aws_nitro_enclaves_kms_metrics_recorder *recorder);
+
+/**
+ * Records the duration of a call stage. Accepts a NULL recorder.
+ *
+ * @param[in]   recorder    The recorder.
+ * @param[in]   stage       The stage.
+ * @param[in]   duration_ns The duration, in nanoseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_record_stage(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    enum aws_kms_stage stage,
+    uint64_t duration_ns);
+
+/**
+ * Records one request attempt. Accepts a NULL recorder.
+ *
+ * @param[in]   recorder    The recorder.
+ * @param[in]   status      The HTTP status, or 0 if no response was received.
+ * @param[in]   error_type  The KMS error type of an error response, empty otherwise.
+ * @param[in]   bytes_out   The size of the request body.
+ * @param[in]   bytes_in    The size of the response body.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_record_attempt(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    int status,
+    struct aws_byte_cursor error_type,
+    size_t bytes_out,
+    size_t bytes_in);
+
+/**
+ * Records whether an attestation document was reused from the cache. Accepts a NULL recorder.
+ *
+ * @param[in]   recorder    The recorder.
+ * @param[in]   cache_hit   Whether the cached document was reused.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_record_attestation(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    bool cache_hit);
+
+/**
+ * Records a completed call, including its retries. Accepts a NULL recorder.
+ *
+ * @param[in]   recorder    The recorder.
+ * @param[in]   operation   The KMS API called.
+ * @param[in]   success     Whether the call ended with HTTP 200.
+ * @param[in]   duration_ns The duration of the call, in nanoseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_record_call(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    enum aws_kms_operation operation,
+    bool success,
+    uint64_t duration_ns);
+
+/**
+ * Takes a snapshot of the recorded metrics.
+ *
+ * @param[in]   recorder    The recorder.
+ * @param[out]  metrics     The snapshot.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_metrics_snapshot(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    struct aws_nitro_enclaves_kms_metrics *metrics);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_KMS_METRICS_H */
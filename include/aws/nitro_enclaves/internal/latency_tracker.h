@@ -0,0 +1,67 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_LATENCY_TRACKER_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_LATENCY_TRACKER_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+
+struct aws_nitro_enclaves_latency_tracker;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a thread safe tracker of the most recent latencies of an operation.
+ *
+ * @param[in]   allocator   The allocator used for the tracker.
+ * @param[in]   capacity    The number of most recent samples kept. Must be greater than 0.
+ *
+ * @return                  A new latency tracker or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_latency_tracker *aws_nitro_enclaves_latency_tracker_new(
+    struct aws_allocator *allocator,
+    size_t capacity);
+
+/**
+ * Destroys a latency tracker. Accepts NULL.
+ *
+ * @param[in]   tracker     The latency tracker to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_latency_tracker_destroy(struct aws_nitro_enclaves_latency_tracker *tracker);
+
+/**
+ * Records a latency sample, replacing the oldest one once the tracker is full.
+ *
+ * @param[in]   tracker     The latency tracker.
+ * @param[in]   latency_ns  The observed latency, in nanoseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_latency_tracker_record(
+    struct aws_nitro_enclaves_latency_tracker *tracker,
+    uint64_t latency_ns);
+
+/**
+ * Computes a percentile of the recorded latencies, using the nearest-rank method.
+ *
+ * @param[in]   tracker     The latency tracker.
+ * @param[in]   percentile  The percentile, between 1 and 100.
+ * @param[in]   min_samples The number of samples required for a meaningful result.
+ * @param[out]  latency_ns  The latency at the given percentile.
+ *
+ * @return                  True if at least @min_samples samples were recorded and @latency_ns is set.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_latency_tracker_percentile(
+    struct aws_nitro_enclaves_latency_tracker *tracker,
+    uint32_t percentile,
+    size_t min_samples,
+    uint64_t *latency_ns);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_LATENCY_TRACKER_H */
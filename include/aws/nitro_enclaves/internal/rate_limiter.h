@@ -0,0 +1,87 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_RATE_LIMITER_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_RATE_LIMITER_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+
+struct aws_nitro_enclaves_rate_limiter;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a token bucket rate limiter. The bucket refills at @requests_per_second
+ * and holds at most @burst tokens; it starts full.
+ *
+ * @param[in]   allocator           The allocator used for the limiter.
+ * @param[in]   requests_per_second The sustained admission rate. Must be greater than 0.
+ * @param[in]   burst               The bucket size. A value of 0 is treated as 1.
+ * @param[in]   max_wait_ms         The longest a caller may be queued before it is rejected.
+ *                                  A value of 0 rejects immediately when the bucket is empty.
+ *
+ * @return                          A new rate limiter or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_rate_limiter *aws_nitro_enclaves_rate_limiter_new(
+    struct aws_allocator *allocator,
+    uint32_t requests_per_second,
+    uint32_t burst,
+    uint32_t max_wait_ms);
+
+/**
+ * Destroys a rate limiter. Accepts NULL.
+ *
+ * @param[in]   limiter     The rate limiter to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_rate_limiter_destroy(struct aws_nitro_enclaves_rate_limiter *limiter);
+
+/**
+ * Reserves one token at time @now_ns without blocking. On success the caller must
+ * wait @delay_ns before proceeding. If the wait would exceed the limiter's maximum
+ * wait, nothing is reserved and AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED is raised.
+ *
+ * This function is not thread safe; @aws_nitro_enclaves_rate_limiter_acquire is.
+ *
+ * @param[in]   limiter     The rate limiter.
+ * @param[in]   now_ns      The current time, in nanoseconds from a monotonic clock.
+ * @param[out]  delay_ns    The time the caller has to wait before using the token.
+ *
+ * @return                  AWS_OP_SUCCESS or AWS_OP_ERR.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_rate_limiter_reserve(
+    struct aws_nitro_enclaves_rate_limiter *limiter,
+    uint64_t now_ns,
+    uint64_t *delay_ns);
+
+/**
+ * Acquires one token, sleeping the calling thread until it is available.
+ * A NULL limiter admits every call.
+ *
+ * @param[in]   limiter     The rate limiter.
+ *
+ * @return                  AWS_OP_SUCCESS or AWS_OP_ERR with
+ *                          AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED raised.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_rate_limiter_acquire(struct aws_nitro_enclaves_rate_limiter *limiter);
+
+/**
+ * Takes one token if it is available right away, without blocking or queueing.
+ * A NULL limiter admits every call.
+ *
+ * @param[in]   limiter     The rate limiter.
+ *
+ * @return                  True if a token was taken.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_rate_limiter_try_acquire(struct aws_nitro_enclaves_rate_limiter *limiter);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_RATE_LIMITER_H */
@@ -0,0 +1,121 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_REST_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_REST_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/common.h>
+#include <aws/http/http.h>
+
+/**
+ * The state of a request and of its hedged copy, as seen by the caller waiting on them.
+ */
+struct aws_nitro_enclaves_rest_attempts {
+    bool is_complete;
+    /* The error of the request, if it is complete. */
+    int error_code;
+
+    /* Whether a hedged copy was sent. */
+    bool has_hedge;
+    bool is_hedge_complete;
+    /* The error of the hedged copy, if it is complete. */
+    int hedge_error_code;
+};
+
+/**
+ * Which of a request and its hedged copy the caller takes the response of.
+ */
+enum aws_nitro_enclaves_rest_winner {
+    AWS_NITRO_ENCLAVES_REST_WINNER_NONE,
+    AWS_NITRO_ENCLAVES_REST_WINNER_REQUEST,
+    AWS_NITRO_ENCLAVES_REST_WINNER_HEDGE,
+};
+
+/**
+ * What the caller does with a request and its hedged copy once it stops waiting.
+ */
+struct aws_nitro_enclaves_rest_hedge_outcome {
+    enum aws_nitro_enclaves_rest_winner winner;
+
+    /* The attempts still running, which are aborted. */
+    bool abort_request;
+    bool abort_hedge;
+
+    /*
+     * Without a winner, the error to report if every attempt failed. 0 if one of them did not
+     * complete: the caller then reports a timeout or a cancellation.
+     */
+    int error_code;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Computes the delay before a reconnection attempt, with full jitter: the delay is uniformly
+ * distributed between 0 and the exponential backoff of the attempt, capped at @max_ms.
+ *
+ * @param[in]   attempt     The number of attempts already made, 0 for the first one.
+ * @param[in]   base_ms     The backoff of the first attempt, in milliseconds.
+ * @param[in]   max_ms      The maximum backoff, in milliseconds.
+ * @param[in]   random      A uniformly distributed random value.
+ *
+ * @return                  The delay, in milliseconds.
+ */
+AWS_NITRO_ENCLAVES_API
+uint64_t aws_nitro_enclaves_rest_reconnect_delay_ms(size_t attempt, uint32_t base_ms, uint32_t max_ms, uint64_t random);
+
+/**
+ * Computes the number of requests a connection can carry at once: one on HTTP/1.1, and on HTTP/2
+ * the lower of the configured stream limit and the SETTINGS_MAX_CONCURRENT_STREAMS of the server.
+ *
+ * @param[in]   http_version    The HTTP version of the connection.
+ * @param[in]   local_max       The configured maximum number of concurrent streams.
+ * @param[in]   remote_max      The maximum number of concurrent streams advertised by the server.
+ *
+ * @return                      The number of stream slots.
+ */
+AWS_NITRO_ENCLAVES_API
+size_t aws_nitro_enclaves_rest_max_streams(enum aws_http_version http_version, uint32_t local_max, uint32_t remote_max);
+
+/**
+ * Computes when a hedged copy of a request is sent.
+ *
+ * @param[in]   now_ns          The time the request was sent, in nanoseconds.
+ * @param[in]   hedge_delay_ms  The hedge delay, in milliseconds.
+ * @param[in]   deadline_ns     The deadline of the request, in nanoseconds. 0 for none.
+ *
+ * @return                      The time the hedged copy is sent, in nanoseconds, or 0 if the
+ *                              deadline comes first and the request is not hedged.
+ */
+AWS_NITRO_ENCLAVES_API
+uint64_t aws_nitro_enclaves_rest_hedge_at_ns(uint64_t now_ns, uint32_t hedge_delay_ms, uint64_t deadline_ns);
+
+/**
+ * Tells whether the caller can stop waiting: the request completed and, if it was hedged, either
+ * attempt succeeded or both failed.
+ *
+ * @param[in]   attempts    The state of the request and of its hedged copy.
+ *
+ * @return                  true once there is nothing left to wait for.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_rest_attempts_are_done(const struct aws_nitro_enclaves_rest_attempts *attempts);
+
+/**
+ * Picks the attempt whose response is returned, the first one that succeeded, preferring the
+ * request, and the attempts to abort.
+ *
+ * @param[in]   attempts    The state of the request and of its hedged copy.
+ *
+ * @return                  The outcome.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_rest_hedge_outcome aws_nitro_enclaves_rest_hedge_outcome(
+    const struct aws_nitro_enclaves_rest_attempts *attempts);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_REST_H */
@@ -0,0 +1,89 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_SIGV4_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_SIGV4_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/auth/credentials.h>
+#include <aws/common/allocator.h>
+#include <aws/common/date_time.h>
+#include <aws/http/request_response.h>
+
+#define AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN 32
+
+struct aws_nitro_enclaves_sigv4_signer;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a SigV4 header signer for one region and service. The signer caches the derived
+ * signing key, which only changes with the date and the credentials, so signing a request
+ * costs two hashes and one HMAC instead of re-deriving the key chain.
+ *
+ * @param[in]   allocator   The allocator used for the signer.
+ * @param[in]   region      The region requests are signed for.
+ * @param[in]   service     The service requests are signed for.
+ *
+ * @return                  A new signer or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_sigv4_signer *aws_nitro_enclaves_sigv4_signer_new(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor region,
+    struct aws_byte_cursor service);
+
+/**
+ * Destroys a signer and wipes its cached signing key. Accepts NULL.
+ *
+ * @param[in]   signer      The signer to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_sigv4_signer_destroy(struct aws_nitro_enclaves_sigv4_signer *signer);
+
+/**
+ * Signs @request in place with the SigV4 header scheme. The x-amz-date, x-amz-content-sha256,
+ * x-amz-security-token (for session credentials) and authorization headers are set on the
+ * request; every other header except user-agent and HTTP/2 pseudo-headers is signed. The request
+ * path must not contain a query string. This function is thread safe.
+ *
+ * @param[in]   signer      The signer.
+ * @param[in]   credentials The credentials to sign with.
+ * @param[in]   request     The request to sign.
+ * @param[in]   payload     The request body.
+ * @param[in]   date        The signing time.
+ *
+ * @return                  AWS_OP_SUCCESS or AWS_OP_ERR.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_sigv4_signer_sign_request(
+    struct aws_nitro_enclaves_sigv4_signer *signer,
+    const struct aws_credentials *credentials,
+    struct aws_http_message *request,
+    struct aws_byte_cursor payload,
+    const struct aws_date_time *date);
+
+/**
+ * Derives the SigV4 signing key HMAC(HMAC(HMAC(HMAC("AWS4" + secret, date), region), service), "aws4_request").
+ *
+ * @param[in]   secret_access_key   The secret access key.
+ * @param[in]   date                The date, formatted as YYYYMMDD.
+ * @param[in]   region              The region.
+ * @param[in]   service             The service.
+ * @param[out]  signing_key         The derived key.
+ *
+ * @return                          AWS_OP_SUCCESS or AWS_OP_ERR.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_sigv4_derive_signing_key(
+    struct aws_byte_cursor secret_access_key,
+    struct aws_byte_cursor date,
+    struct aws_byte_cursor region,
+    struct aws_byte_cursor service,
+    uint8_t signing_key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN]);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_SIGV4_H */
@@ -0,0 +1,76 @@
+#ifndef AWS_NITRO_ENCLAVES_INTERNAL_SINGLEFLIGHT_H
+#define AWS_NITRO_ENCLAVES_INTERNAL_SINGLEFLIGHT_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+
+/**
+ * A thread safe group of calls that are coalesced by key: while a call is in flight, callers with
+ * the same key wait for it instead of making their own, and each of them gets a copy of its result.
+ * Results are wiped once the last caller has copied them.
+ */
+struct aws_nitro_enclaves_singleflight;
+
+/**
+ * Makes the call of a key.
+ *
+ * @param[in]   user_data   The argument given to aws_nitro_enclaves_singleflight_do by the caller that makes the call.
+ * @param[out]  result      The result. Should be initialized by the call, with any allocator.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR with the error raised otherwise.
+ */
+typedef int(aws_nitro_enclaves_singleflight_fn)(void *user_data, struct aws_byte_buf *result);
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a singleflight group.
+ *
+ * @param[in]   allocator   The allocator used for the group and its calls.
+ *
+ * @return                  A new group or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_singleflight *aws_nitro_enclaves_singleflight_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a singleflight group. No call may be in flight. Accepts NULL.
+ *
+ * @param[in]   group   The group.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_singleflight_destroy(struct aws_nitro_enclaves_singleflight *group);
+
+/**
+ * Makes the call of a key, or waits for the call of the same key already in flight. Either way, the
+ * caller gets its own copy of the result, or the error the call failed with.
+ *
+ * @param[in]   group               The group.
+ * @param[in]   key                 The key identifying the call.
+ * @param[in]   fn                  The call, made if none is in flight for @key.
+ * @param[in]   user_data           The argument of @fn.
+ * @param[in]   result_allocator    The allocator used for the copy of the result.
+ * @param[out]  result              The copy of the result. Should be an empty, but non-null aws_byte_buf.
+ * @param[out]  shared              If not NULL, set to true if the caller waited for another caller's call.
+ *
+ * @return                          AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_singleflight_do(
+    struct aws_nitro_enclaves_singleflight *group,
+    struct aws_byte_cursor key,
+    aws_nitro_enclaves_singleflight_fn *fn,
+    void *user_data,
+    struct aws_allocator *result_allocator,
+    struct aws_byte_buf *result,
+    bool *shared);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_INTERNAL_SINGLEFLIGHT_H */
@@ -0,0 +1,167 @@
+#ifndef AWS_NITRO_ENCLAVES_KEY_DERIVATION_H
+#define AWS_NITRO_ENCLAVES_KEY_DERIVATION_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/kms.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/string.h>
+
+/**
+ * @file
+ * Per-object keys derived locally from a single AWS KMS data key. A root key is generated with
+ * aws_kms_generate_data_key_blocking once, and any number of subkeys are derived from its plaintext
+ * with HKDF-SHA256 (RFC 5869), using a caller-chosen context (an object id, a record number, ...) as
+ * the HKDF info. A derivation record holds the wrapped root key along with the context, which is all
+ * that is needed to derive the same subkey again later.
+ */
+
+/** Maximum length of a derived key, 255 times the SHA-256 output length. */
+#define AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN (255 * 32)
+
+/**
+ * A root key: the plaintext of a data key and the ciphertext blob it is wrapped in.
+ * It can be used from several threads at once.
+ */
+struct aws_nitro_enclaves_root_key;
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a root key by calling aws_kms_generate_data_key_blocking.
+ *
+ * @param[in]   allocator   The allocator used for the root key.
+ * @param[in]   client      The AWS KMS client to use for calling the API.
+ * @param[in]   key_id      The ARN or alias of the AWS KMS CMK used to encrypt the root key.
+ * @param[in]   key_spec    The spec of the root key.
+ *
+ * @return                  A new root key or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_root_key *aws_nitro_enclaves_root_key_generate(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec);
+
+/**
+ * Restores a root key from its ciphertext blob by calling aws_kms_decrypt_blocking.
+ *
+ * @param[in]   allocator       The allocator used for the root key.
+ * @param[in]   client          The AWS KMS client to use for calling the API.
+ * @param[in]   ciphertext_blob The wrapped root key, as found in a derivation record.
+ *
+ * @return                      A new root key or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_root_key *aws_nitro_enclaves_root_key_decrypt(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_byte_cursor ciphertext_blob);
+
+/**
+ * Destroys a root key and wipes its plaintext. Accepts NULL.
+ *
+ * @param[in]   root_key    The root key to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_root_key_destroy(struct aws_nitro_enclaves_root_key *root_key);
+
+/**
+ * Gets the ciphertext blob a root key is wrapped in. The cursor is valid until the root key is destroyed.
+ *
+ * @param[in]   root_key    The root key.
+ *
+ * @return                  The ciphertext blob.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_byte_cursor aws_nitro_enclaves_root_key_get_ciphertext_blob(
+    const struct aws_nitro_enclaves_root_key *root_key);
+
+/**
+ * Derives a subkey from a root key for a context.
+ *
+ * @param[in]   root_key    The root key.
+ * @param[in]   context     The context the subkey is bound to. Distinct contexts yield independent subkeys.
+ * @param[in]   key_len     The length of the subkey, up to AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN.
+ * @param[out]  subkey      The subkey. Should be an empty, but non-null aws_byte_buf.
+ *                          The caller wipes it with aws_byte_buf_clean_up_secure.
+ * @param[out]  record      If not NULL, the derivation record of the subkey is appended to it.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_root_key_derive(
+    const struct aws_nitro_enclaves_root_key *root_key,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *subkey,
+    struct aws_byte_buf *record);
+
+/**
+ * Derives a key from key material with HKDF-SHA256, an empty salt and the context as info. This is
+ * the derivation aws_nitro_enclaves_root_key_derive applies to the plaintext of its root key.
+ *
+ * @param[in]   allocator   The allocator used for the key.
+ * @param[in]   secret      The input key material.
+ * @param[in]   context     The HKDF info.
+ * @param[in]   key_len     The length of the key, up to AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN.
+ * @param[out]  key         The key. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_derive_key(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor secret,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *key);
+
+/**
+ * Appends a derivation record to a buffer, growing it as needed. A record is a version byte, followed
+ * by the ciphertext blob, the context and the key length, each of the first two prefixed with their
+ * length, all in network byte order.
+ *
+ * @param[in]   allocator       The allocator used to grow the buffer, if it is not yet initialized.
+ * @param[in]   ciphertext_blob The wrapped root key.
+ * @param[in]   context         The context of the derivation.
+ * @param[in]   key_len         The length of the derived key.
+ * @param[out]  record          The buffer to append the record to.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_derivation_record_write(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor ciphertext_blob,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *record);
+
+/**
+ * Reads a derivation record. The output cursors point into the record. On success, the record cursor
+ * is advanced past it, so that records can be read back to back.
+ *
+ * @param[in,out]   record          The record to read.
+ * @param[out]      ciphertext_blob The wrapped root key.
+ * @param[out]      context         The context of the derivation.
+ * @param[out]      key_len         The length of the derived key.
+ *
+ * @return                          AWS_OP_SUCCESS on success, AWS_OP_ERR if the record is malformed.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_derivation_record_read(
+    struct aws_byte_cursor *record,
+    struct aws_byte_cursor *ciphertext_blob,
+    struct aws_byte_cursor *context,
+    size_t *key_len);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_KEY_DERIVATION_H */
@@ -0,0 +1,137 @@
+#ifndef AWS_NITRO_ENCLAVES_KEY_POLICY_ITERATOR_H
+#define AWS_NITRO_ENCLAVES_KEY_POLICY_ITERATOR_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/kms.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/byte_buf.h>
+#include <aws/common/string.h>
+
+/**
+ * @file
+ * Walks the key policy names of a key across ListKeyPolicies pages. A background thread fetches and
+ * parses the next page while the caller consumes the current one, following the markers of truncated
+ * pages, and stops once a bounded number of pages is waiting to be consumed. Pages bypass the key
+ * policy cache of the client, so a walk leaves nothing behind once the iterator is destroyed.
+ */
+
+/**
+ * A key policy iterator. Should be used from one thread at a time.
+ */
+struct aws_nitro_enclaves_key_policy_iterator;
+
+/**
+ * Fetches a ListKeyPolicies page, as aws_kms_list_key_policies_blocking does.
+ *
+ * @param[in]   user_data       The user_data of the iterator options.
+ * @param[in]   key_id          The key whose policies are listed.
+ * @param[in]   limit           The maximum number of policy names in the page.
+ * @param[in]   marker          The marker of the page, or NULL for the first one.
+ * @param[out]  response_json   The raw JSON response. An empty aws_byte_buf, to be initialized.
+ *
+ * @return                      AWS_OP_SUCCESS on success, AWS_OP_ERR with the error raised otherwise.
+ */
+typedef int(aws_nitro_enclaves_key_policy_iterator_list_fn)(
+    void *user_data,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json);
+
+/**
+ * Options of @ref aws_nitro_enclaves_key_policy_iterator_new.
+ */
+struct aws_nitro_enclaves_key_policy_iterator_options {
+    /**
+     * The client used to list the key policies. It must outlive the iterator.
+     *
+     * Required: Yes, unless list_key_policies is set.
+     */
+    struct aws_nitro_enclaves_kms_client *client;
+
+    /**
+     * The function fetching the pages, in place of ListKeyPolicies calls on client.
+     * Defaults to ListKeyPolicies calls on client that bypass its key policy cache if NULL.
+     *
+     * Required: No.
+     */
+    aws_nitro_enclaves_key_policy_iterator_list_fn *list_key_policies;
+
+    /**
+     * The argument of list_key_policies.
+     *
+     * Required: No.
+     */
+    void *user_data;
+
+    /**
+     * The key whose policies are listed. Copied by the iterator.
+     *
+     * Required: Yes.
+     */
+    const struct aws_string *key_id;
+
+    /**
+     * Maximum number of policy names per ListKeyPolicies page, up to 1000.
+     * Defaults to 100 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t page_size;
+
+    /**
+     * Maximum number of fetched pages waiting to be consumed. Together with the page being consumed,
+     * this bounds the memory used by the iterator.
+     * Defaults to 1 if 0.
+     *
+     * Required: No.
+     */
+    size_t max_prefetched_pages;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Creates a key policy iterator and starts fetching its first page.
+ *
+ * @param[in]   allocator   The allocator used for the iterator and its pages.
+ * @param[in]   options     The iterator options.
+ *
+ * @return                  A new iterator or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_key_policy_iterator *aws_nitro_enclaves_key_policy_iterator_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_key_policy_iterator_options *options);
+
+/**
+ * Stops the prefetching, waits for the call in flight and destroys the iterator. Accepts NULL.
+ *
+ * @param[in]   iterator    The iterator to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_key_policy_iterator_destroy(struct aws_nitro_enclaves_key_policy_iterator *iterator);
+
+/**
+ * Gets the next key policy name, waiting for its page to be fetched if needed.
+ *
+ * @param[in]   iterator    The iterator.
+ * @param[out]  policy_name The policy name. Valid until the next call or until the iterator is destroyed.
+ * @param[out]  end         Set to true, and policy_name left unset, once all policy names were returned.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR with the error of the failed page fetch otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_key_policy_iterator_next(
+    struct aws_nitro_enclaves_key_policy_iterator *iterator,
+    struct aws_byte_cursor *policy_name,
+    bool *end);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_KEY_POLICY_ITERATOR_H */
@@ -14,19 +14,32 @@
  *
  * aws_kms_decrypt_blocking(), aws_kms_generate_random_blocking() and aws_kms_generate_data_key_blocking()
  * implement the AWS KMS APIs using the enclave-specific Recipient parameters.
+ * aws_kms_encrypt_with_public_key_blocking() encrypts for an asymmetric CMK locally, with its cached public key.
+ * aws_kms_get_key_policy_blocking() and aws_kms_list_key_policies_blocking() can answer repeated calls from a cache,
+ * see enable_key_policy_cache and aws_nitro_enclaves_kms_client_invalidate_key_policies().
  */
 
 #include <aws/nitro_enclaves/attestation.h>
 #include <aws/nitro_enclaves/exports.h>
+#include <aws/nitro_enclaves/metrics.h>
 #include <aws/nitro_enclaves/rest.h>
 
 #include <aws/common/array_list.h>
 #include <aws/common/byte_buf.h>
 #include <aws/common/hash_table.h>
 #include <aws/common/linked_list.h>
+#include <aws/common/mutex.h>
 #include <aws/common/string.h>
+#include <aws/io/retry_strategy.h>
 #include <aws/io/socket.h>
 
+struct aws_nitro_enclaves_arena_pool;
+struct aws_nitro_enclaves_latency_tracker;
+struct aws_nitro_enclaves_key_policy_cache;
+struct aws_nitro_enclaves_kms_metrics_recorder;
+struct aws_nitro_enclaves_rate_limiter;
+struct aws_nitro_enclaves_singleflight;
+
 AWS_EXTERN_C_BEGIN
 
 /**
@@ -154,6 +167,66 @@ struct aws_kms_decrypt_request {
     struct aws_allocator *const allocator;
 };
 
+/**
+ * A key-value pair of an encryption context, borrowed by a request view.
+ */
+struct aws_kms_encryption_context_entry {
+    struct aws_byte_cursor key;
+    struct aws_byte_cursor value;
+};
+
+/**
+ * A decryption request made of memory borrowed from the caller for the duration of the call.
+ * Unlike @ref aws_kms_decrypt_request, filling one in allocates nothing, and it is serialized
+ * without an intermediate JSON object. Empty cursors and zero counts leave optional parameters out.
+ */
+struct aws_kms_decrypt_request_view {
+    /**
+     * Ciphertext to be decrypted. The blob includes metadata.
+     *
+     * Required: Yes.
+     */
+    struct aws_byte_cursor ciphertext_blob;
+
+    /**
+     * The name of the encryption algorithm that will be used to decrypt the ciphertext:
+     * SYMMETRIC_DEFAULT, RSAES_OAEP_SHA_1 or RSAES_OAEP_SHA_256.
+     *
+     * Required: No.
+     */
+    struct aws_byte_cursor encryption_algorithm;
+
+    /**
+     * The encryption context, as an array of encryption_context_count key-value pairs.
+     *
+     * Required: No.
+     */
+    const struct aws_kms_encryption_context_entry *encryption_context;
+    size_t encryption_context_count;
+
+    /**
+     * The grant tokens, as an array of grant_tokens_count cursors.
+     *
+     * Required: No.
+     */
+    const struct aws_byte_cursor *grant_tokens;
+    size_t grant_tokens_count;
+
+    /**
+     * The customer master key (CMK) that AWS KMS will use to decrypt the ciphertext,
+     * see @ref aws_kms_decrypt_request::key_id.
+     *
+     * Required: No.
+     */
+    struct aws_byte_cursor key_id;
+};
+
+/**
+ * A Decrypt request pre-rendered once for repeated calls with the same parameters but the ciphertext.
+ * Immutable once created, so it can be shared by threads.
+ */
+struct aws_kms_decrypt_request_template;
+
 /**
  * The decryption response.
  */
@@ -506,6 +579,39 @@ struct aws_kms_list_key_policies_request {
     struct aws_allocator *allocator;
 };
 
+/**
+ * The list key policies response.
+ */
+struct aws_kms_list_key_policies_response {
+    /**
+     * The names of the key policies of the page, as a list of aws_string pointers.
+     *
+     * Required: No.
+     */
+    struct aws_array_list policy_names;
+
+    /**
+     * When truncated is true, the value to use for the marker parameter of the next request.
+     *
+     * Required: No.
+     */
+    struct aws_string *next_marker;
+
+    /**
+     * Whether there are more policy names to list after this page.
+     *
+     * Required: No.
+     */
+    bool truncated;
+
+    /**
+     * Allocator used for memory management of associated resources.
+     *
+     * Note that this is not part of the response.
+     */
+    struct aws_allocator *const allocator;
+};
+
 /**
  * The get key policy request.
  */
@@ -532,6 +638,141 @@ struct aws_kms_get_key_policy_request {
     struct aws_allocator *allocator;
 };
 
+/**
+ * The get public key request.
+ */
+struct aws_kms_get_public_key_request {
+    /**
+     * A unique identifier for the asymmetric customer master key (CMK).
+     *
+     * Required: Yes.
+     */
+    struct aws_string *key_id;
+
+    /**
+     * Allocator used for memory management of associated resources.
+     *
+     * Note that this is not part of the request.
+     */
+    struct aws_allocator *allocator;
+};
+
+/**
+ * The get public key response.
+ */
+struct aws_kms_get_public_key_response {
+    /**
+     * The Amazon Resource Name (key ARN) of the asymmetric CMK.
+     *
+     * Required: No.
+     */
+    struct aws_string *key_id;
+
+    /**
+     * The public key, a DER-encoded X.509 SubjectPublicKeyInfo.
+     *
+     * Required: No.
+     */
+    struct aws_byte_buf public_key;
+
+    /**
+     * The permitted use of the public key, ENCRYPT_DECRYPT or SIGN_VERIFY.
+     *
+     * Required: No.
+     */
+    struct aws_string *key_usage;
+
+    /**
+     * The encryption algorithms the CMK supports, as a list of aws_string pointers.
+     * Only set for keys with a key usage of ENCRYPT_DECRYPT.
+     *
+     * Required: No.
+     */
+    struct aws_array_list encryption_algorithms;
+
+    /**
+     * Allocator used for memory management of associated resources.
+     *
+     * Note that this is not part of the response.
+     */
+    struct aws_allocator *const allocator;
+};
+
+/**
+ * Client-side rate limit of a single KMS API. Calls are admitted by a token bucket
+ * that refills at @ref requests_per_second and holds at most @ref burst tokens.
+ */
+struct aws_nitro_enclaves_kms_rate_limit {
+    /**
+     * Sustained number of calls per second. A value of 0 disables the limit.
+     *
+     * Required: No.
+     */
+    uint32_t requests_per_second;
+
+    /**
+     * Number of calls that may be issued back to back. Defaults to 1 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t burst;
+
+    /**
+     * How long a call over the limit is queued before it is rejected, in milliseconds.
+     * A value of 0 rejects calls over the limit immediately. Rejected calls fail with
+     * AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED.
+     *
+     * Required: No.
+     */
+    uint32_t max_wait_ms;
+};
+
+/**
+ * Request hedging of a single KMS API. When a call has not completed after a delay derived from a
+ * percentile of its recent latencies, a second copy is sent on another connection and the first
+ * successful response is used. Only used for APIs that are idempotent from the caller's point of view.
+ */
+struct aws_nitro_enclaves_kms_hedging {
+    /**
+     * Enables hedging for the API.
+     *
+     * Required: No.
+     */
+    bool enabled;
+
+    /**
+     * Percentile of the recent latencies after which the hedged copy is sent.
+     * Defaults to 95 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t percentile;
+
+    /**
+     * Hedge delay used until enough latencies were observed, in milliseconds.
+     * Defaults to 100 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t initial_delay_ms;
+
+    /**
+     * Lower bound of the hedge delay, in milliseconds.
+     * Defaults to 5 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t min_delay_ms;
+
+    /**
+     * Upper bound of the hedge delay, in milliseconds.
+     * Defaults to 2000 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t max_delay_ms;
+};
+
 /**
  * The KMS client configuration.
  */
@@ -584,6 +825,227 @@ struct aws_nitro_enclaves_kms_client_configuration {
      * Required: No.
      */
     const struct aws_string *host_name;
+
+    /**
+     * Strategy used to retry throttled (ThrottlingException, HTTP 429), server (HTTP 5xx) and
+     * connection errors. The client acquires a reference to it. If NULL, a standard retry strategy
+     * with a token-bucket retry budget and exponential backoff with full jitter is created, using
+     * the settings below.
+     *
+     * Required: No.
+     */
+    struct aws_retry_strategy *retry_strategy;
+
+    /**
+     * Disables retries. Every call is attempted exactly once.
+     *
+     * Required: No.
+     */
+    bool disable_retries;
+
+    /**
+     * Maximum number of retries of a single call for the default retry strategy.
+     * Defaults to 3 if 0.
+     *
+     * Required: No.
+     */
+    size_t max_retries;
+
+    /**
+     * Scale factor of the exponential backoff for the default retry strategy, in milliseconds.
+     * Defaults to 25 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t retry_backoff_scale_factor_ms;
+
+    /**
+     * Capacity of the retry budget token bucket for the default retry strategy. Retries are
+     * refused once the budget is spent, until successful calls refill it.
+     * Defaults to the aws-c-io default (500) if 0.
+     *
+     * Required: No.
+     */
+    size_t retry_initial_bucket_capacity;
+
+    /**
+     * How long an attestation document is reused across calls, in milliseconds. Retries of a call
+     * always reuse the document of the original request.
+     * Defaults to 0, generating a new document for each call.
+     *
+     * Required: No.
+     */
+    uint64_t attestation_document_ttl_ms;
+
+    /**
+     * How long a public key fetched with GetPublicKey is reused by aws_kms_get_public_key_blocking and
+     * aws_kms_encrypt_with_public_key_blocking, in milliseconds. An alias may be pointed at another key,
+     * which is picked up once the cached key expires.
+     * Defaults to 300000 (5 minutes) if 0.
+     *
+     * Required: No.
+     */
+    uint64_t public_key_cache_ttl_ms;
+
+    /**
+     * Enables the key policy cache: GetKeyPolicy and ListKeyPolicies answers are reused by the calls
+     * with the same arguments, as set by the options below. Off by default, so that every call sees
+     * the current policy unless the application opts into staleness.
+     *
+     * Required: No.
+     */
+    bool enable_key_policy_cache;
+
+    /**
+     * If the key policy cache is enabled, how long a key policy document or policy list fetched with
+     * GetKeyPolicy or ListKeyPolicies is reused by the calls with the same arguments, in milliseconds.
+     * Changes made to a policy outside of the client are picked up once the cached document expires,
+     * or right away after aws_nitro_enclaves_kms_client_invalidate_key_policies.
+     * Defaults to 60000 (1 minute) if 0.
+     *
+     * Required: No.
+     */
+    uint64_t key_policy_cache_ttl_ms;
+
+    /**
+     * If the key policy cache is enabled, how long a NotFoundException answer to GetKeyPolicy or
+     * ListKeyPolicies is reused, in milliseconds. Calls answered from the cache fail with
+     * AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND, as the call they reuse did.
+     * Defaults to 10000 (10 seconds) if 0.
+     *
+     * Required: No.
+     */
+    uint64_t key_policy_negative_cache_ttl_ms;
+
+    /**
+     * If the key policy cache is enabled, the maximum number of answers it holds. Expired answers
+     * are dropped as new ones are stored, and the answer closest to expiry makes room once it is full.
+     * Defaults to 1024 if 0.
+     *
+     * Required: No.
+     */
+    size_t key_policy_cache_max_entries;
+
+    /**
+     * Timeout of a single KMS call attempt, in milliseconds. A call that times out is retried like
+     * a connection error.
+     * Defaults to the rest client default (10000) if 0.
+     *
+     * Required: No.
+     */
+    uint32_t request_timeout_ms;
+
+    /**
+     * Bootstrap used to create connections. If NULL, the bootstrap shared by the library is used.
+     *
+     * Required: No.
+     */
+    struct aws_client_bootstrap *bootstrap;
+
+    /**
+     * TLS context used to create connections. If NULL, the TLS context shared by the library is used.
+     *
+     * Required: No.
+     */
+    struct aws_tls_ctx *tls_ctx;
+
+    /**
+     * Client-side rate limit of Decrypt calls. Each retry counts as a call.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_rate_limit decrypt_rate_limit;
+
+    /**
+     * Client-side rate limit of GenerateDataKey calls. Each retry counts as a call.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_rate_limit generate_data_key_rate_limit;
+
+    /**
+     * Client-side rate limit of GenerateRandom calls. Each retry counts as a call.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_rate_limit generate_random_rate_limit;
+
+    /**
+     * Hedging of Decrypt calls. Hedged copies count against the Decrypt rate limit and are skipped
+     * when it is reached.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_hedging decrypt_hedging;
+
+    /**
+     * Hedging of GenerateRandom calls. Hedged copies count against the GenerateRandom rate limit and
+     * are skipped when it is reached.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_kms_hedging generate_random_hedging;
+
+    /**
+     * Disables the coalescing of concurrent identical Decrypt calls. By default, a Decrypt call with the
+     * same key id, encryption algorithm, ciphertext and encryption context as a call already in flight
+     * waits for that call and gets its own copy of its plaintext, or fails with its error.
+     *
+     * Required: No.
+     */
+    bool disable_request_coalescing;
+
+    /**
+     * Allocates the temporary objects of each blocking call (request and response structures,
+     * recipient, attestation document, request and response JSON) from a per-call arena instead of
+     * the client allocator. Arenas are pooled by the client and wiped when the call returns, so
+     * steady-state calls rarely reach the allocator. Results are still allocated with the client
+     * allocator.
+     *
+     * Required: No.
+     */
+    bool enable_call_arena;
+
+    /**
+     * Size of the blocks a call arena allocates from, in bytes. An arena that outgrows its block
+     * replaces it with one large enough for the next call.
+     * Defaults to 32768 if 0.
+     *
+     * Required: No.
+     */
+    size_t call_arena_block_size;
+
+    /**
+     * Records per-stage latency histograms, per-API call counts and latencies, response counts by
+     * HTTP status and KMS error type, and request and response bytes. Read them with
+     * aws_nitro_enclaves_kms_client_get_metrics.
+     *
+     * Required: No.
+     */
+    bool enable_metrics;
+
+    /**
+     * Interval between two dumps of the metrics, in milliseconds. Only used if metrics are enabled.
+     * Defaults to 0, disabling dumps.
+     *
+     * Required: No.
+     */
+    uint32_t metrics_dump_interval_ms;
+
+    /**
+     * Receives the periodic dumps of the metrics, from a dedicated thread. If NULL, the dumps are
+     * logged at info level under AWS_LS_NITRO_ENCLAVES_METRICS.
+     *
+     * Required: No.
+     */
+    aws_nitro_enclaves_kms_metrics_dump_fn *metrics_dump_fn;
+
+    /**
+     * The argument of metrics_dump_fn.
+     *
+     * Required: No.
+     */
+    void *metrics_dump_user_data;
 };
 
 /**
@@ -598,6 +1060,50 @@ struct aws_nitro_enclaves_kms_client {
 
     /** The RSA keypair */
     struct aws_rsa_keypair *keypair;
+
+    /** The retry strategy, NULL if retries are disabled. */
+    struct aws_retry_strategy *retry_strategy;
+
+    /** Mutex protecting the cached attestation document and public keys. */
+    struct aws_mutex mutex;
+
+    /** The cached attestation document and the time it was generated at. */
+    struct aws_byte_buf attestation_document;
+    uint64_t attestation_document_timestamp_ns;
+    uint64_t attestation_document_ttl_ns;
+
+    /** The Recipient member of Decrypt requests rendered from the cached attestation document, if any. */
+    struct aws_byte_buf recipient_json;
+
+    /** The public keys fetched with GetPublicKey, by key id, and how long they are reused. */
+    struct aws_hash_table public_keys;
+    uint64_t public_key_cache_ttl_ns;
+
+    /** The answers of GetKeyPolicy and ListKeyPolicies, by request, NULL if the cache is not enabled. */
+    struct aws_nitro_enclaves_key_policy_cache *key_policy_cache;
+
+    /** The per-API rate limiters, NULL if the API is not limited. */
+    struct aws_nitro_enclaves_rate_limiter *decrypt_rate_limiter;
+    struct aws_nitro_enclaves_rate_limiter *generate_data_key_rate_limiter;
+    struct aws_nitro_enclaves_rate_limiter *generate_random_rate_limiter;
+
+    /** Second rest client hedged requests are sent on, NULL if hedging is disabled. */
+    struct aws_nitro_enclaves_rest_client *hedge_rest_client;
+
+    /** Per-API hedging settings, with defaults applied, and recent latencies. */
+    struct aws_nitro_enclaves_kms_hedging decrypt_hedging;
+    struct aws_nitro_enclaves_latency_tracker *decrypt_latency;
+    struct aws_nitro_enclaves_kms_hedging generate_random_hedging;
+    struct aws_nitro_enclaves_latency_tracker *generate_random_latency;
+
+    /** The Decrypt calls in flight, which identical calls wait for. NULL if coalescing is disabled. */
+    struct aws_nitro_enclaves_singleflight *decrypt_singleflight;
+
+    /** Pool of per-call arenas, NULL if call arenas are disabled. */
+    struct aws_nitro_enclaves_arena_pool *call_arena_pool;
+
+    /** The metrics, NULL if metrics are disabled. */
+    struct aws_nitro_enclaves_kms_metrics_recorder *metrics;
 };
 
 /**
@@ -661,6 +1167,65 @@ struct aws_kms_decrypt_request *aws_kms_decrypt_request_new(struct aws_allocator
 AWS_NITRO_ENCLAVES_API
 struct aws_string *aws_kms_decrypt_request_to_json(const struct aws_kms_decrypt_request *req);
 
+/**
+ * Serializes a KMS Decrypt Request view @ref aws_kms_decrypt_request_view to json.
+ *
+ * @param[in]   allocator   The allocator used for the json.
+ * @param[in]   view        The KMS Decrypt Request view that is to be serialized.
+ * @param[in]   recipient   The Recipient parameter, or NULL to leave it out.
+ * @param[out]  json        The serialized KMS Decrypt Request. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_decrypt_request_view_to_json(
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request_view *view,
+    const struct aws_recipient *recipient,
+    struct aws_byte_buf *json);
+
+/**
+ * Creates a Decrypt request template from a request view. The parameters of the view, but the
+ * ciphertext, are serialized once and copied by every request made from the template.
+ *
+ * @param[in]   allocator   The allocator used for the template.
+ * @param[in]   view        The parameters of the requests. Its ciphertext is ignored.
+ *
+ * @return                  A new template or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_decrypt_request_template *aws_kms_decrypt_request_template_new(
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request_view *view);
+
+/**
+ * Destroys a Decrypt request template. Accepts NULL.
+ *
+ * @param[in]   request_template    The template.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_kms_decrypt_request_template_destroy(struct aws_kms_decrypt_request_template *request_template);
+
+/**
+ * Serializes the KMS Decrypt Request of a template and a ciphertext to json. The result is the same
+ * as that of aws_kms_decrypt_request_view_to_json for the view of the template.
+ *
+ * @param[in]   request_template    The template.
+ * @param[in]   allocator           The allocator used for the json.
+ * @param[in]   ciphertext_blob     The ciphertext to be decrypted.
+ * @param[in]   recipient           The Recipient parameter, or NULL to leave it out.
+ * @param[out]  json                The serialized KMS Decrypt Request. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                          AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_decrypt_request_template_to_json(
+    const struct aws_kms_decrypt_request_template *request_template,
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor ciphertext_blob,
+    const struct aws_recipient *recipient,
+    struct aws_byte_buf *json);
+
 /**
  * Deserialized a KMS Decrypt Request @ref aws_kms_decrypt_request from json.
  *
@@ -1024,6 +1589,19 @@ struct aws_nitro_enclaves_kms_client *aws_nitro_enclaves_kms_client_new(
 AWS_NITRO_ENCLAVES_API
 void aws_nitro_enclaves_kms_client_destroy(struct aws_nitro_enclaves_kms_client *client);
 
+/**
+ * Takes a snapshot of the metrics of a KMS client.
+ *
+ * @param[in]   client     The KMS client.
+ * @param[out]  metrics    The snapshot.
+ *
+ * @return                 AWS_OP_SUCCESS on success, AWS_OP_ERR if metrics are disabled.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_kms_client_get_metrics(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_nitro_enclaves_kms_metrics *metrics);
+
 /**
  * Call [AWS KMS Decrypt API](https://docs.aws.amazon.com/kms/latest/APIReference/API_Decrypt.html).
  * This function blocks and waits for the reply.
@@ -1090,6 +1668,42 @@ int aws_kms_decrypt_blocking_from_request(
     const struct aws_kms_decrypt_request *request_structure,
     struct aws_byte_buf *plaintext);
 
+/**
+ * Call [AWS KMS Decrypt API](https://docs.aws.amazon.com/kms/latest/APIReference/API_Decrypt.html)
+ * with a request view, adding the Recipient parameter of the enclave.
+ * This function blocks and waits for the reply. Unlike aws_kms_decrypt_blocking, the call is not
+ * coalesced with identical calls in flight.
+ *
+ * @param[in]   client      The AWS KMS client to use for calling the API.
+ * @param[in]   view        The request. Its memory is only used for the duration of the call.
+ * @param[out]  plaintext   The plaintext output of the call. Should be an empty, but non-null aws_byte_buf.
+ * @return                  Returns AWS_OP_SUCCESS if the call succeeds and plaintext is populated.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_decrypt_blocking_from_view(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_decrypt_request_view *view,
+    struct aws_byte_buf *plaintext);
+
+/**
+ * Call [AWS KMS Decrypt API](https://docs.aws.amazon.com/kms/latest/APIReference/API_Decrypt.html)
+ * with a request template, adding the ciphertext and the Recipient parameter of the enclave.
+ * While attestation documents are cached, the Recipient parameter is serialized once per document.
+ * This function blocks and waits for the reply. The call is not coalesced with identical calls in flight.
+ *
+ * @param[in]   client              The AWS KMS client to use for calling the API.
+ * @param[in]   request_template    The template of the request.
+ * @param[in]   ciphertext_blob     The ciphertext to be decrypted.
+ * @param[out]  plaintext           The plaintext output of the call. Should be an empty, but non-null aws_byte_buf.
+ * @return                          Returns AWS_OP_SUCCESS if the call succeeds and plaintext is populated.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_decrypt_blocking_from_template(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_decrypt_request_template *request_template,
+    struct aws_byte_cursor ciphertext_blob,
+    struct aws_byte_buf *plaintext);
+
 /**
  * Call [AWS KMS Encrypt API](https://docs.aws.amazon.com/kms/latest/APIReference/API_Encrypt.html).
  * This function blocks and waits for the reply.
@@ -1213,7 +1827,56 @@ AWS_NITRO_ENCLAVES_API
 struct aws_string *aws_kms_list_key_policies_request_to_json(const struct aws_kms_list_key_policies_request *request);
 
 /**
- * Lists all of the key policies for the specified KMS key.
+ * Creates a new ListKeyPolicies response structure.
+ *
+ * @param[in]  allocator  The allocator to use for memory management. NULL for default.
+ *
+ * @return                A new aws_kms_list_key_policies_response structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_list_key_policies_response *aws_kms_list_key_policies_response_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a ListKeyPolicies response structure.
+ *
+ * @param[in]  response  The response structure to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_kms_list_key_policies_response_destroy(struct aws_kms_list_key_policies_response *response);
+
+/**
+ * Deserializes a ListKeyPolicies response from json. Unknown fields are ignored.
+ *
+ * @param[in]  allocator  The allocator used for managing resources. NULL for default.
+ * @param[in]  json       The serialized json ListKeyPolicies response.
+ *
+ * @return                A new aws_kms_list_key_policies_response structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_list_key_policies_response *aws_kms_list_key_policies_response_from_json(
+    struct aws_allocator *allocator,
+    const struct aws_string *json);
+
+/**
+ * Calls ListKeyPolicies with a request structure, or reuses the answer of an earlier identical call
+ * if the key policy cache is enabled, see enable_key_policy_cache.
+ *
+ * @param[in]   client              The KMS client to use.
+ * @param[in]   request_structure   The request.
+ * @param[out]  response_json       The raw JSON response from AWS KMS. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                          AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise, with
+ *                                  AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND raised if the key does not exist.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_list_key_policies_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_list_key_policies_request *request_structure,
+    struct aws_byte_buf *response_json);
+
+/**
+ * Lists all of the key policies for the specified KMS key, or reuses the answer of an earlier
+ * identical call if the key policy cache is enabled, see enable_key_policy_cache.
  * Returns the raw JSON response from AWS KMS.
  *
  * @param[in]   client        The KMS client to use.
@@ -1222,7 +1885,8 @@ struct aws_string *aws_kms_list_key_policies_request_to_json(const struct aws_km
  * @param[in]   marker        The marker from a previous request, for pagination. Can be NULL.
  * @param[out]  response_json The raw JSON response from AWS KMS. The caller is responsible for destroying this string.
  *
- * @return                    AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ * @return                    AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise, with
+ *                            AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND raised if the key does not exist.
  */
 AWS_NITRO_ENCLAVES_API
 int aws_kms_list_key_policies_blocking(
@@ -1235,13 +1899,60 @@ int aws_kms_list_key_policies_blocking(
 /**
  * Creates a new GetKeyPolicy request structure.
  *
- * @param[in]  allocator  The allocator to use for memory management.
+ * @param[in]  allocator  The allocator to use for memory management. NULL for default.
+ *
+ * @return                A new aws_kms_get_key_policy_request structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_get_key_policy_request *aws_kms_get_key_policy_request_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a GetKeyPolicy request structure.
+ *
+ * @param[in]  request  The request structure to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_kms_get_key_policy_request_destroy(struct aws_kms_get_key_policy_request *request);
+
+/**
+ * Converts a GetKeyPolicy request structure to a JSON string.
+ *
+ * @param[in]  request  The request structure to convert.
+ *
+ * @return             A new aws_string containing the JSON representation on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_string *aws_kms_get_key_policy_request_to_json(const struct aws_kms_get_key_policy_request *request);
+
+/**
+ * Calls GetKeyPolicy with a request structure, or reuses the answer of an earlier identical call
+ * if the key policy cache is enabled, see enable_key_policy_cache.
+ *
+ * @param[in]   client              The KMS client to use.
+ * @param[in]   request_structure   The request.
+ * @param[out]  response_json       The raw JSON response from AWS KMS. Should be an empty, but non-null aws_byte_buf.
+ *
+ * @return                          AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise, with
+ *                                  AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND raised if the key or policy does not exist.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_get_key_policy_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_get_key_policy_request *request_structure,
+    struct aws_byte_buf *response_json);
+
+/**
+ * Gets a key policy of the specified KMS key, or reuses the answer of an earlier identical call if
+ * the key policy cache is enabled, see enable_key_policy_cache.
+ * Returns the raw JSON response from AWS KMS.
  *
- * @param[in]  key_id     The identifier of the key to get the policy for.
- * @param[in]  policy_name The name of the policy to get.
- * @param[out] response_json The raw JSON response from AWS KMS. The caller is responsible for destroying this string.
+ * @param[in]   client        The KMS client to use.
+ * @param[in]   key_id        The identifier of the key to get the policy for.
+ * @param[in]   policy_name   The name of the policy to get.
+ * @param[out]  response_json The raw JSON response from AWS KMS. Should be an empty, but non-null aws_byte_buf.
  *
- * @return                    AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ * @return                    AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise, with
+ *                            AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND raised if the key or policy does not exist.
  */
 AWS_NITRO_ENCLAVES_API
 int aws_kms_get_key_policy_blocking(
@@ -1250,6 +1961,138 @@ int aws_kms_get_key_policy_blocking(
     const struct aws_string *policy_name,
     struct aws_byte_buf *response_json);
 
+/**
+ * Drops the cached GetKeyPolicy and ListKeyPolicies answers of a key, so that the next calls go to
+ * AWS KMS. Does nothing if the key policy cache is not enabled. Calls in flight when it is called do
+ * not cache their answer. Should be called after changing a key policy. Key ids are compared as
+ * given: invalidating a key by its ARN does not drop the answers cached for its alias.
+ *
+ * @param[in]   client  The KMS client.
+ * @param[in]   key_id  The key id the answers were cached for, or NULL for all keys.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_kms_client_invalidate_key_policies(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id);
+
+/**
+ * Creates a new GetPublicKey request structure.
+ *
+ * @param[in]  allocator  The allocator to use for memory management. NULL for default.
+ *
+ * @return                A new aws_kms_get_public_key_request structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_get_public_key_request *aws_kms_get_public_key_request_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a GetPublicKey request structure.
+ *
+ * @param[in]  request  The request structure to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_kms_get_public_key_request_destroy(struct aws_kms_get_public_key_request *request);
+
+/**
+ * Converts a GetPublicKey request structure to a JSON string.
+ *
+ * @param[in]  request  The request structure to convert.
+ *
+ * @return             A new aws_string containing the JSON representation on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_string *aws_kms_get_public_key_request_to_json(const struct aws_kms_get_public_key_request *request);
+
+/**
+ * Creates a new GetPublicKey response structure.
+ *
+ * @param[in]  allocator  The allocator to use for memory management. NULL for default.
+ *
+ * @return                A new aws_kms_get_public_key_response structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_get_public_key_response *aws_kms_get_public_key_response_new(struct aws_allocator *allocator);
+
+/**
+ * Destroys a GetPublicKey response structure.
+ *
+ * @param[in]  response  The response structure to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_kms_get_public_key_response_destroy(struct aws_kms_get_public_key_response *response);
+
+/**
+ * Deserializes a GetPublicKey response from json. Unknown fields are ignored.
+ *
+ * @param[in]  allocator  The allocator used for managing resources. NULL for default.
+ * @param[in]  json       The serialized json GetPublicKey response.
+ *
+ * @return                A new aws_kms_get_public_key_response structure on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_kms_get_public_key_response *aws_kms_get_public_key_response_from_json(
+    struct aws_allocator *allocator,
+    const struct aws_string *json);
+
+/**
+ * Call [AWS KMS GetPublicKey API](https://docs.aws.amazon.com/kms/latest/APIReference/API_GetPublicKey.html),
+ * or reuse a public key fetched by an earlier call, see public_key_cache_ttl_ms.
+ * This function blocks and waits for the reply.
+ *
+ * @param[in]   client      The AWS KMS client to use for calling the API.
+ * @param[in]   key_id      The ARN or alias of the asymmetric AWS KMS CMK.
+ * @param[out]  public_key  The DER-encoded X.509 SubjectPublicKeyInfo of the CMK. Should be an empty, but non-null
+ *                          aws_byte_buf.
+ * @return                  Returns AWS_OP_SUCCESS if the call succeeds and public_key is populated.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_get_public_key_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    struct aws_byte_buf *public_key);
+
+/**
+ * Encrypts plaintext with an RSA public key, the way AWS KMS Encrypt does for an asymmetric CMK. The
+ * ciphertext can be decrypted with aws_kms_decrypt_blocking, given the key id and the encryption algorithm.
+ *
+ * @param[in]   allocator               The allocator used for the ciphertext. NULL for default.
+ * @param[in]   public_key              The DER-encoded X.509 SubjectPublicKeyInfo of an RSA key.
+ * @param[in]   encryption_algorithm    AWS_EA_RSAES_OAEP_SHA_1 or AWS_EA_RSAES_OAEP_SHA_256.
+ * @param[in]   plaintext               The plaintext to encrypt.
+ * @param[out]  ciphertext_blob         The ciphertext. Should be an empty, but non-null aws_byte_buf.
+ * @return                              Returns AWS_OP_SUCCESS if ciphertext_blob is populated.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_encrypt_with_public_key(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor public_key,
+    enum aws_encryption_algorithm encryption_algorithm,
+    struct aws_byte_cursor plaintext,
+    struct aws_byte_buf *ciphertext_blob);
+
+/**
+ * Encrypts plaintext for an asymmetric CMK locally, with its public key, instead of calling
+ * [AWS KMS Encrypt API](https://docs.aws.amazon.com/kms/latest/APIReference/API_Encrypt.html).
+ * Only GetPublicKey is called, and only if the public key is not cached yet.
+ * This function blocks and waits for the reply.
+ *
+ * @param[in]   client                  The AWS KMS client to use for calling the API.
+ * @param[in]   key_id                  The ARN or alias of the asymmetric AWS KMS CMK.
+ * @param[in]   encryption_algorithm    AWS_EA_RSAES_OAEP_SHA_1 or AWS_EA_RSAES_OAEP_SHA_256. The CMK must
+ *                                      support it.
+ * @param[in]   plaintext               The plaintext to encrypt.
+ * @param[out]  ciphertext_blob         The ciphertext. Should be an empty, but non-null aws_byte_buf.
+ * @return                              Returns AWS_OP_SUCCESS if the call succeeds and ciphertext_blob is
+ *                                      populated.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_kms_encrypt_with_public_key_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    enum aws_encryption_algorithm encryption_algorithm,
+    const struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob);
+
 AWS_EXTERN_C_END
 
 #endif /* AWS_NITRO_ENCLAVES_KMS_H */
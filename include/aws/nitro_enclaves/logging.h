@@ -0,0 +1,78 @@
+#ifndef AWS_NITRO_ENCLAVES_LOGGING_H
+#define AWS_NITRO_ENCLAVES_LOGGING_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/allocator.h>
+#include <aws/common/logging.h>
+
+#include <stdio.h>
+
+/**
+ * @file
+ * An asynchronous logger for hot paths. Callers format their line on their own stack and copy it
+ * into a fixed ring of slots; a background thread writes the slots to the output file. Callers
+ * never block on the file: when the ring is full, the line is dropped and counted, and the count
+ * is reported by the writer thread once it catches up.
+ */
+
+/**
+ * Options of @ref aws_nitro_enclaves_logger_init_async.
+ */
+struct aws_nitro_enclaves_async_logger_options {
+    /**
+     * The file the lines are written to, e.g. stderr. The logger does not close it.
+     *
+     * Required: Yes.
+     */
+    FILE *file;
+
+    /**
+     * The most verbose level logged.
+     *
+     * Required: No.
+     */
+    enum aws_log_level level;
+
+    /**
+     * Number of lines the ring holds before new lines are dropped.
+     * Defaults to 1024 if 0.
+     *
+     * Required: No.
+     */
+    size_t capacity;
+
+    /**
+     * Maximum length of a line, including its header. Longer lines are truncated.
+     * Defaults to 512 if 0, and is capped at 4096.
+     *
+     * Required: No.
+     */
+    size_t line_size;
+};
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Initializes an asynchronous logger and starts its writer thread. Install it with aws_logger_set;
+ * aws_logger_clean_up stops the thread after the remaining lines are written.
+ *
+ * @param[out]  logger      The logger to initialize.
+ * @param[in]   allocator   The allocator used for the ring and the thread.
+ * @param[in]   options     The logger options.
+ *
+ * @return                  AWS_OP_SUCCESS on success, AWS_OP_ERR otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_logger_init_async(
+    struct aws_logger *logger,
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_async_logger_options *options);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_LOGGING_H */
@@ -0,0 +1,154 @@
+#ifndef AWS_NITRO_ENCLAVES_METRICS_H
+#define AWS_NITRO_ENCLAVES_METRICS_H
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/exports.h>
+
+#include <aws/common/common.h>
+
+#define AWS_KMS_METRICS_MAX_HTTP_STATUSES 16
+#define AWS_KMS_METRICS_MAX_ERROR_TYPES 16
+#define AWS_KMS_METRICS_ERROR_TYPE_LEN 64
+
+/**
+ * The stages of a KMS call that are timed separately.
+ */
+enum aws_kms_stage {
+    /** Producing the attestation document, or copying the cached one. */
+    AWS_KMS_STAGE_ATTESTATION,
+    /** Serializing the request to JSON. */
+    AWS_KMS_STAGE_JSON_BUILD,
+    /** Signing the request with SigV4. */
+    AWS_KMS_STAGE_SIGN,
+    /** Sending the request and receiving the response, excluding signing. */
+    AWS_KMS_STAGE_NETWORK,
+    /** Deserializing the response from JSON. */
+    AWS_KMS_STAGE_JSON_PARSE,
+    /** Parsing the CMS enveloped data of a response for the enclave. */
+    AWS_KMS_STAGE_CMS_PARSE,
+    /** Decrypting the content encryption key with the enclave RSA key. */
+    AWS_KMS_STAGE_RSA_DECRYPT,
+    /** Decrypting the CMS content with the content encryption key. */
+    AWS_KMS_STAGE_AES_DECRYPT,
+
+    AWS_KMS_STAGE_COUNT,
+};
+
+/**
+ * The KMS APIs that calls are accounted to.
+ */
+enum aws_kms_operation {
+    AWS_KMS_OPERATION_DECRYPT,
+    AWS_KMS_OPERATION_ENCRYPT,
+    AWS_KMS_OPERATION_GENERATE_DATA_KEY,
+    AWS_KMS_OPERATION_GENERATE_RANDOM,
+    AWS_KMS_OPERATION_LIST_KEY_POLICIES,
+    AWS_KMS_OPERATION_GET_KEY_POLICY,
+    AWS_KMS_OPERATION_GET_PUBLIC_KEY,
+
+    AWS_KMS_OPERATION_COUNT,
+};
+
+/**
+ * Summary of a latency distribution. Percentiles are accurate to within 1/16 of their value.
+ */
+struct aws_nitro_enclaves_latency_summary {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+};
+
+/**
+ * Calls of one KMS API, including their retries.
+ */
+struct aws_kms_operation_metrics {
+    /** Completed calls, and those that did not end with HTTP 200. */
+    uint64_t calls;
+    uint64_t errors;
+
+    /** Time spent in KMS requests, from the first attempt to the last response. */
+    struct aws_nitro_enclaves_latency_summary latency;
+};
+
+struct aws_kms_http_status_count {
+    int status;
+    uint64_t count;
+};
+
+struct aws_kms_error_type_count {
+    /** The "__type" of the KMS error response, without its namespace. */
+    char name[AWS_KMS_METRICS_ERROR_TYPE_LEN];
+    uint64_t count;
+};
+
+/**
+ * A snapshot of the metrics of a KMS client.
+ */
+struct aws_nitro_enclaves_kms_metrics {
+    struct aws_nitro_enclaves_latency_summary stages[AWS_KMS_STAGE_COUNT];
+    struct aws_kms_operation_metrics operations[AWS_KMS_OPERATION_COUNT];
+
+    /**
+     * Responses by HTTP status, for the first AWS_KMS_METRICS_MAX_HTTP_STATUSES distinct statuses seen.
+     * Attempts that got no response at all are counted in connection_errors.
+     */
+    struct aws_kms_http_status_count http_statuses[AWS_KMS_METRICS_MAX_HTTP_STATUSES];
+    size_t http_status_count;
+    uint64_t connection_errors;
+
+    /** Error responses by KMS error type, for the first AWS_KMS_METRICS_MAX_ERROR_TYPES distinct types seen. */
+    struct aws_kms_error_type_count error_types[AWS_KMS_METRICS_MAX_ERROR_TYPES];
+    size_t error_type_count;
+
+    /** Attestation documents reused from the client cache, and those that had to be generated. */
+    uint64_t attestation_cache_hits;
+    uint64_t attestation_cache_misses;
+
+    /** Request bytes sent and response bytes received, over all attempts. */
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+};
+
+/**
+ * Receives periodic snapshots of the metrics of a KMS client. Called from a dedicated thread.
+ *
+ * @param[in]   metrics     The snapshot.
+ * @param[in]   user_data   The user data given in the configuration.
+ */
+typedef void(aws_nitro_enclaves_kms_metrics_dump_fn)(
+    const struct aws_nitro_enclaves_kms_metrics *metrics,
+    void *user_data);
+
+AWS_EXTERN_C_BEGIN
+
+/**
+ * Returns the name of a KMS call stage, in snake case.
+ *
+ * @param[in]   stage       The stage.
+ *
+ * @return                  The name, or "unknown".
+ */
+AWS_NITRO_ENCLAVES_API
+const char *aws_kms_stage_name(enum aws_kms_stage stage);
+
+/**
+ * Returns the name of a KMS API, as used in its X-Amz-Target.
+ *
+ * @param[in]   operation   The KMS API.
+ *
+ * @return                  The name, or "Unknown".
+ */
+AWS_NITRO_ENCLAVES_API
+const char *aws_kms_operation_name(enum aws_kms_operation operation);
+
+AWS_EXTERN_C_END
+
+#endif /* AWS_NITRO_ENCLAVES_METRICS_H */
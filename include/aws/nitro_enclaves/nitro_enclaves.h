@@ -15,12 +15,18 @@
  * system entropy or calling into AWS KMS using attestation.
  *
  * To instantiate the library, call aws_nitro_enclaves_library_init() first.
- * To seed entropy, use aws_nitro_enclaves_library_seed_entropy().
+ * To keep the entropy pool of the system seeded, use aws_nitro_enclaves_library_start_entropy_feeder(), or
+ * aws_nitro_enclaves_library_seed_entropy() to seed it once.
  *
  * ## AWS KMS
  * To use AWS KMS functionality, create an aws_kms_client using aws_nitro_enclaves_kms_client_new(),
  * afterwards, call aws_kms_decrypt_blocking(), aws_kms_generate_random_blocking() and
  * aws_kms_generate_data_key_blocking(), depending on needs.
+ * For random bytes at high rates, use a DRBG seeded from NSM and AWS KMS, created with
+ * aws_nitro_enclaves_drbg_new(). To issue data keys without a round trip each, keep them ready in a pool
+ * created with aws_nitro_enclaves_data_key_pool_new(). To derive many per-object keys from a single data key,
+ * use aws_nitro_enclaves_root_key_generate() and aws_nitro_enclaves_root_key_derive().
+ * To walk the key policies of a key page by page, use aws_nitro_enclaves_key_policy_iterator_new().
  *
  * Additional documentation and sample can be found in the main
  * [Github repository](https://github.com/aws/aws-nitro-enclaves-sdk-c) or
@@ -31,6 +37,8 @@
 #include <aws/nitro_enclaves/exports.h>
 
 #include <aws/common/allocator.h>
+#include <aws/common/error.h>
+#include <aws/common/logging.h>
 #include <aws/common/macros.h>
 
 /**
@@ -38,6 +46,93 @@
  * Initialize the library and main enclave functionality.
  */
 
+/* Package identifier of this library in the aws-c-common error and log subject space. */
+#define AWS_C_NITRO_ENCLAVES_PACKAGE_ID 12
+
+enum aws_nitro_enclaves_errors {
+    /* A KMS call was refused by the client-side rate limiter. */
+    AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED = AWS_ERROR_ENUM_BEGIN_RANGE(AWS_C_NITRO_ENCLAVES_PACKAGE_ID),
+    /* A REST request did not complete before its deadline. */
+    AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT,
+    /* A REST request was cancelled through its cancellation token. */
+    AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED,
+    /* The NitroSecureModule or the kernel entropy pool could not be used. */
+    AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE,
+    /* AWS KMS answered that the key or key policy does not exist. */
+    AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND,
+
+    AWS_ERROR_NITRO_ENCLAVES_END_RANGE = AWS_ERROR_ENUM_END_RANGE(AWS_C_NITRO_ENCLAVES_PACKAGE_ID)
+};
+
+enum aws_nitro_enclaves_log_subject {
+    AWS_LS_NITRO_ENCLAVES_GENERAL = AWS_LOG_SUBJECT_BEGIN_RANGE(AWS_C_NITRO_ENCLAVES_PACKAGE_ID),
+    AWS_LS_NITRO_ENCLAVES_REST,
+    AWS_LS_NITRO_ENCLAVES_KMS,
+    AWS_LS_NITRO_ENCLAVES_METRICS,
+
+    AWS_LS_NITRO_ENCLAVES_LAST = AWS_LOG_SUBJECT_END_RANGE(AWS_C_NITRO_ENCLAVES_PACKAGE_ID)
+};
+
+/**
+ * Options of @ref aws_nitro_enclaves_library_init_with_options.
+ */
+struct aws_nitro_enclaves_library_options {
+    /**
+     * Maximum number of threads of the event loop group shared by the rest clients.
+     * Defaults to one thread per CPU if 0.
+     *
+     * Required: No.
+     */
+    uint16_t max_event_loop_threads;
+
+    /**
+     * Pins each event loop thread to a CPU of @ref cpu_group.
+     * Defaults to false.
+     *
+     * Required: No.
+     */
+    bool pin_event_loop_threads;
+
+    /**
+     * The CPU group (NUMA node) event loop threads are pinned to.
+     *
+     * Required: No.
+     */
+    uint16_t cpu_group;
+};
+
+/**
+ * Options of @ref aws_nitro_enclaves_library_start_entropy_feeder.
+ */
+struct aws_nitro_enclaves_entropy_feeder_options {
+    /**
+     * Number of bytes fed to the kernel when the feeder starts.
+     * Defaults to 1024 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t initial_bytes;
+
+    /**
+     * The entropy, in bits, the kernel pool is topped up to. Capped at the size of the pool.
+     * Defaults to 256 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t target_bits;
+
+    /**
+     * Interval between two checks of the kernel pool, in milliseconds.
+     * Defaults to 1000 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t check_interval_ms;
+};
+
+struct aws_client_bootstrap;
+struct aws_tls_ctx;
+
 AWS_EXTERN_C_BEGIN
 
 /**
@@ -50,7 +145,20 @@ AWS_NITRO_ENCLAVES_API
 void aws_nitro_enclaves_library_init(struct aws_allocator *allocator);
 
 /**
- * Closes the library.
+ * Initializes the library with the given options.
+ *
+ * @param[in]    allocator    Optional parameter to override default allocator. If this parameter is set to null, a
+ *                            default allocator is used instead.
+ * @param[in]    options      The library options. NULL for defaults.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_library_init_with_options(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_library_options *options);
+
+/**
+ * Closes the library. The rest and KMS clients should be destroyed first: the event loop threads
+ * they hold keep running until they are.
  */
 AWS_NITRO_ENCLAVES_API
 void aws_nitro_enclaves_library_clean_up(void);
@@ -66,6 +174,30 @@ void aws_nitro_enclaves_library_clean_up(void);
 AWS_NITRO_ENCLAVES_API
 int aws_nitro_enclaves_library_seed_entropy(uint64_t bytes);
 
+/**
+ * Starts a background thread that seeds the entropy pool of the system from the NitroSecureModule
+ * and keeps it topped up. Entropy is credited in batches through RNDADDENTROPY. The thread is
+ * stopped in aws_nitro_enclaves_library_clean_up. Starting it again has no effect.
+ *
+ * @param[in]    options    The feeder options. NULL for defaults.
+ * @return                  AWS_OP_SUCCESS if the feeder is running.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_library_start_entropy_feeder(const struct aws_nitro_enclaves_entropy_feeder_options *options);
+
+/**
+ * Waits until the entropy feeder has seeded the entropy pool of the system.
+ *
+ * @param[in]    timeout_ms The maximum time to wait, in milliseconds.
+ * @return                  AWS_OP_SUCCESS once the pool is seeded. Raises
+ *                          AWS_ERROR_COND_VARIABLE_TIMED_OUT on timeout,
+ *                          AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE if the feeder failed
+ *                          and AWS_ERROR_INVALID_STATE if it was not started or is stopped
+ *                          while waiting.
+ */
+AWS_NITRO_ENCLAVES_API
+int aws_nitro_enclaves_library_wait_for_entropy(uint64_t timeout_ms);
+
 /**
  * Returns the allocator of the library, as set by aws_nitro_enclaves_library_init.
  *
@@ -74,6 +206,27 @@ int aws_nitro_enclaves_library_seed_entropy(uint64_t bytes);
 AWS_NITRO_ENCLAVES_API
 struct aws_allocator *aws_nitro_enclaves_get_allocator(void);
 
+/**
+ * Returns the client bootstrap shared by all the rest clients that are not given one, creating it
+ * and its event loop group on first use. The bootstrap is owned by the library and released in
+ * aws_nitro_enclaves_library_clean_up; acquire it to keep a reference.
+ *
+ * @return Returns the shared client bootstrap, or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_client_bootstrap *aws_nitro_enclaves_get_client_bootstrap(void);
+
+/**
+ * Returns the TLS client context shared by all the rest clients that are not given one, creating it
+ * on first use. Sharing it avoids loading the trust store again for every client. The context is
+ * owned by the library and released in aws_nitro_enclaves_library_clean_up; acquire it to keep a
+ * reference.
+ *
+ * @return Returns the shared TLS context, or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_tls_ctx *aws_nitro_enclaves_get_tls_ctx(void);
+
 AWS_EXTERN_C_END
 
 #endif
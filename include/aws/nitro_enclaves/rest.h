@@ -13,12 +13,18 @@
 #include <aws/common/macros.h>
 #include <aws/common/mutex.h>
 #include <aws/common/string.h>
+#include <aws/common/task_scheduler.h>
 #include <aws/http/request_response.h>
+#include <aws/io/channel_bootstrap.h>
 #include <aws/io/event_loop.h>
 #include <aws/io/host_resolver.h>
 #include <aws/io/socket.h>
 #include <aws/io/tls_channel_handler.h>
 
+struct aws_nitro_enclaves_rest_cancellation_token;
+struct aws_nitro_enclaves_future_pool;
+struct aws_nitro_enclaves_sigv4_signer;
+
 struct aws_nitro_enclaves_rest_client_configuration {
     /**
      * Will default to library allocator if NULL.
@@ -67,6 +73,156 @@ struct aws_nitro_enclaves_rest_client_configuration {
      * Required: No.
      */
     const struct aws_string *host_name;
+
+    /**
+     * Maximum number of consecutive reconnection attempts made after the connection is lost, before
+     * pending requests are failed. A later request starts a new series of attempts.
+     * Defaults to 10 if 0.
+     *
+     * Required: No.
+     */
+    size_t max_reconnect_attempts;
+
+    /**
+     * Base delay of the exponential reconnection backoff, in milliseconds. The actual delay before
+     * attempt n is drawn uniformly from [0, min(base * 2^n, max)].
+     * Defaults to 100 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t reconnect_backoff_base_ms;
+
+    /**
+     * Upper bound of the reconnection backoff, in milliseconds.
+     * Defaults to 5000 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t reconnect_backoff_max_ms;
+
+    /**
+     * Default timeout of a request, in milliseconds, covering the wait for a connection, signing and
+     * the response. A request that times out fails with AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT.
+     * Defaults to 10000 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t request_timeout_ms;
+
+    /**
+     * Bootstrap used to create connections. The client acquires a reference to it. If NULL, the
+     * bootstrap shared by the library is used, see aws_nitro_enclaves_get_client_bootstrap.
+     *
+     * Required: No.
+     */
+    struct aws_client_bootstrap *bootstrap;
+
+    /**
+     * TLS context used to create connections. The client acquires a reference to it. It must offer
+     * the "h2" and "http/1.1" ALPN protocols. If NULL, the TLS context shared by the library is used,
+     * see aws_nitro_enclaves_get_tls_ctx.
+     *
+     * Required: No.
+     */
+    struct aws_tls_ctx *tls_ctx;
+
+    /**
+     * Maximum number of requests in flight on the connection when HTTP/2 is negotiated. The server's
+     * SETTINGS_MAX_CONCURRENT_STREAMS lowers it further. Requests beyond the limit wait for a stream
+     * to finish. HTTP/1.1 connections carry one request at a time.
+     * Defaults to 100 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t max_concurrent_streams;
+
+    /**
+     * HTTP/2 flow-control window advertised for each stream, in bytes.
+     * Defaults to 1048576 if 0.
+     *
+     * Required: No.
+     */
+    uint32_t http2_initial_window_size;
+};
+
+/**
+ * Stream concurrency statistics of a rest client, see @ref aws_nitro_enclaves_rest_client_get_stats.
+ */
+struct aws_nitro_enclaves_rest_client_stats {
+    /** The HTTP version negotiated on the last connection. */
+    enum aws_http_version http_version;
+
+    /** Current limit of requests in flight on the connection. */
+    size_t max_concurrent_streams;
+
+    /** Requests currently in flight, including timed out requests whose stream has not completed. */
+    size_t active_streams;
+
+    /** Highest number of requests in flight at the same time. */
+    size_t peak_active_streams;
+
+    /** Requests waiting for a connection or a free stream. */
+    size_t queued_requests;
+
+    /** Streams opened since the client was created. */
+    uint64_t total_streams;
+
+    /** Whether the client currently has an established connection. */
+    bool is_connected;
+
+    /** Consecutive failed connection attempts since the connection was lost. */
+    size_t reconnect_attempts;
+
+    /** Connections established since the client was created, including reconnections. */
+    uint64_t total_connections;
+};
+
+/**
+ * Per-request options of @ref aws_nitro_enclaves_rest_client_request_blocking_with_options.
+ */
+struct aws_nitro_enclaves_rest_request_options {
+    /**
+     * Timeout of the request, in milliseconds. Defaults to the client request timeout if 0.
+     *
+     * Required: No.
+     */
+    uint32_t timeout_ms;
+
+    /**
+     * Token through which another thread can cancel the request. A cancelled request fails with
+     * AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_rest_cancellation_token *cancellation_token;
+
+    /**
+     * Client on which a hedged copy of the request is sent if no response arrived after @ref hedge_delay_ms.
+     * The first successful response is returned and the other request is abandoned. It should connect
+     * to the same endpoint over a different connection; the client itself can be used on HTTP/2.
+     * Only set for idempotent requests. NULL disables hedging.
+     *
+     * Required: No.
+     */
+    struct aws_nitro_enclaves_rest_client *hedge_client;
+
+    /**
+     * Delay after which the hedged request is sent, in milliseconds.
+     *
+     * Required: No.
+     */
+    uint32_t hedge_delay_ms;
+
+    /**
+     * Called right before the hedged request is sent. Returning false skips hedging, for example
+     * to stay within a request budget.
+     *
+     * Required: No.
+     */
+    bool (*should_hedge)(void *user_data);
+
+    /** User data passed to @ref should_hedge. */
+    void *should_hedge_user_data;
 };
 
 /**
@@ -85,6 +241,9 @@ struct aws_nitro_enclaves_rest_client {
     /** Conditional variable required for syncing client on creation. */
     struct aws_condition_variable c_var;
 
+    /** Futures on which blocking requests wait for completion, reused across requests. */
+    struct aws_nitro_enclaves_future_pool *future_pool;
+
     /** An open connection that is used to create connection streams. */
     struct aws_http_connection *connection;
 
@@ -112,6 +271,69 @@ struct aws_nitro_enclaves_rest_client {
 
     /** The credentials provider. */
     struct aws_credentials_provider *credentials_provider;
+
+    /** Signs requests with "credentials", caching the signing key. NULL if only a provider is set. */
+    struct aws_nitro_enclaves_sigv4_signer *signer;
+
+    /** Headers sent with every request, built once: host, content-type and user-agent. */
+    struct aws_http_header request_headers[3];
+
+    /** Bootstrap kept for re-establishing the connection, and its event loop group. */
+    struct aws_event_loop_group *el_group;
+    struct aws_client_bootstrap *bootstrap;
+
+    /** Socket and TLS options kept for re-establishing the connection. */
+    struct aws_socket_options socket_options;
+    struct aws_tls_connection_options tls_connection_options;
+
+    /** The address and port the connection is made to (the endpoint, if one is configured). */
+    struct aws_string *connect_host;
+    uint16_t connect_port;
+
+    /** Reconnection policy. */
+    size_t max_reconnect_attempts;
+    uint32_t reconnect_backoff_base_ms;
+    uint32_t reconnect_backoff_max_ms;
+
+    /**
+     * Reconnection state, protected by mutex. is_connecting is set while a connection attempt is
+     * in flight or scheduled; requests issued in that window wait for its outcome.
+     */
+    bool is_connecting;
+    bool is_shutting_down;
+    bool reconnect_enabled;
+    size_t reconnect_attempts;
+
+    /** Event loop on which reconnection attempts are scheduled. */
+    struct aws_event_loop *reconnect_loop;
+    struct aws_task reconnect_task;
+    bool reconnect_task_scheduled;
+    struct aws_task cancel_reconnect_task;
+    bool cancel_reconnect_task_pending;
+
+    /** Default request timeout. */
+    uint64_t request_timeout_ns;
+
+    /**
+     * Number of requests with signing or a stream in flight, protected by mutex. Requests that timed
+     * out or were cancelled stay in flight until their stream completes.
+     */
+    size_t pending_requests;
+
+    /**
+     * Stream concurrency, protected by mutex. The limit on pending_requests is max_concurrent_streams
+     * on HTTP/2, lowered to the server's setting once received, and 1 on HTTP/1.1.
+     */
+    enum aws_http_version http_version;
+    uint32_t max_concurrent_streams;
+    uint32_t remote_max_concurrent_streams;
+    uint32_t http2_initial_window_size;
+    size_t peak_pending_requests;
+    size_t queued_requests;
+    uint64_t total_streams;
+
+    /** Connections established, protected by mutex. */
+    uint64_t total_connections;
 };
 
 /**
@@ -133,6 +355,9 @@ struct aws_nitro_enclaves_rest_response {
 
     /** The data */
     struct aws_byte_buf __data;
+
+    /** Time spent signing the request, in nanoseconds. */
+    uint64_t sign_duration_ns;
 };
 
 AWS_EXTERN_C_BEGIN
@@ -156,6 +381,19 @@ struct aws_nitro_enclaves_rest_client *aws_nitro_enclaves_rest_client_new(
 AWS_NITRO_ENCLAVES_API
 void aws_nitro_enclaves_rest_client_destroy(struct aws_nitro_enclaves_rest_client *rest_client);
 
+/**
+ * Sends a signed request over the client connection and waits for the response. If the connection
+ * was lost, the request waits until it is re-established or the reconnection attempts run out.
+ * The request fails once the client request timeout expires.
+ *
+ * @param[in]    rest_client    The REST client.
+ * @param[in]    method         The HTTP method.
+ * @param[in]    path           The request path.
+ * @param[in]    target         The value of the x-amz-target header.
+ * @param[in]    data           The request body.
+ *
+ * @return                      The response on success, NULL otherwise.
+ */
 AWS_NITRO_ENCLAVES_API
 struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_blocking(
     struct aws_nitro_enclaves_rest_client *rest_client,
@@ -164,6 +402,79 @@ struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_
     struct aws_byte_cursor target,
     struct aws_byte_cursor data);
 
+/**
+ * Same as @ref aws_nitro_enclaves_rest_client_request_blocking, with a per-request timeout,
+ * cancellation token and hedging. When the request times out, is cancelled or loses to its hedged
+ * copy after it was sent, its stream is reset (HTTP/2) or the connection is closed (HTTP/1.1), and
+ * the client reconnects.
+ *
+ * @param[in]    rest_client    The REST client.
+ * @param[in]    method         The HTTP method.
+ * @param[in]    path           The request path.
+ * @param[in]    target         The value of the x-amz-target header.
+ * @param[in]    data           The request body.
+ * @param[in]    options        The request options. NULL for defaults.
+ *
+ * @return                      The response on success, NULL otherwise.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_blocking_with_options(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_byte_cursor target,
+    struct aws_byte_cursor data,
+    const struct aws_nitro_enclaves_rest_request_options *options);
+
+/**
+ * Reads the stream concurrency statistics of a rest client.
+ *
+ * @param[in]    rest_client    The rest client.
+ * @param[out]   stats          The current statistics.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_rest_client_get_stats(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_nitro_enclaves_rest_client_stats *stats);
+
+/**
+ * Creates a cancellation token. A token can be shared by several concurrent requests.
+ *
+ * @param[in]    allocator    The allocator used for the token. NULL for default.
+ *
+ * @return                    A new cancellation token or NULL on failure.
+ */
+AWS_NITRO_ENCLAVES_API
+struct aws_nitro_enclaves_rest_cancellation_token *aws_nitro_enclaves_rest_cancellation_token_new(
+    struct aws_allocator *allocator);
+
+/**
+ * Cancels all the requests using the token, now and in the future. Can be called from any thread.
+ *
+ * @param[in]    token    The cancellation token.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_rest_cancellation_token_cancel(struct aws_nitro_enclaves_rest_cancellation_token *token);
+
+/**
+ * Returns whether the token was cancelled.
+ *
+ * @param[in]    token    The cancellation token.
+ *
+ * @return                True if @ref aws_nitro_enclaves_rest_cancellation_token_cancel was called.
+ */
+AWS_NITRO_ENCLAVES_API
+bool aws_nitro_enclaves_rest_cancellation_token_is_cancelled(
+    const struct aws_nitro_enclaves_rest_cancellation_token *token);
+
+/**
+ * Frees a cancellation token. No request may be using it.
+ *
+ * @param[in]    token    The cancellation token to destroy.
+ */
+AWS_NITRO_ENCLAVES_API
+void aws_nitro_enclaves_rest_cancellation_token_destroy(struct aws_nitro_enclaves_rest_cancellation_token *token);
+
 /**
  * Frees the resources associated with a REST response.
  *
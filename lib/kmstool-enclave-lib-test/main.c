@@ -5,6 +5,88 @@
 #include <string.h>
 #include <unistd.h>
 
+/* Exercise the caller-buffer variants: size query, kept result, and round trip */
+static void check_into_variants(void) {
+    uint8_t plaintext[256];
+    uint8_t plaintext_check[256];
+    sprintf((char *)plaintext, "test1234567890_into");
+    sprintf((char *)plaintext_check, "test1234567890_into");
+    size_t plaintext_len = strlen((char *)plaintext_check);
+
+    struct kmstool_encrypt_params params_encrypt = {
+        .plaintext = plaintext,
+        .plaintext_len = plaintext_len,
+        .kms_key_id = "",
+    };
+
+    // Querying the size writes nothing and reports the required length.
+    unsigned int ciphertext_len = 0;
+    if (kmstool_enclave_encrypt_into(&params_encrypt, NULL, 0, &ciphertext_len) != KMSTOOL_ERROR_BUFFER_TOO_SMALL ||
+        ciphertext_len == 0) {
+        fprintf(stderr, "Encryption size query failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The repeated call returns the ciphertext kept by the size query, of the reported length.
+    unsigned char *ciphertext = malloc(ciphertext_len);
+    unsigned int written_len = 0;
+    if (ciphertext == NULL ||
+        kmstool_enclave_encrypt_into(&params_encrypt, ciphertext, ciphertext_len, &written_len) != KMSTOOL_SUCCESS ||
+        written_len != ciphertext_len) {
+        fprintf(stderr, "Encryption into a buffer of the queried size failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct kmstool_decrypt_params params_decrypt = {
+        .ciphertext = ciphertext,
+        .ciphertext_len = ciphertext_len,
+        .kms_key_id = "",
+        .kms_algorithm = "SYMMETRIC_DEFAULT",
+    };
+
+    // A buffer one byte short is too small; the plaintext is not kept, the call with a large enough one decrypts again.
+    unsigned char plaintext_out[4096];
+    unsigned int plaintext_out_len = 0;
+    if (kmstool_enclave_decrypt_into(&params_decrypt, plaintext_out, plaintext_len - 1, &plaintext_out_len) !=
+            KMSTOOL_ERROR_BUFFER_TOO_SMALL ||
+        plaintext_out_len != plaintext_len) {
+        fprintf(stderr, "Decryption into a short buffer did not report the required size\n");
+        exit(EXIT_FAILURE);
+    }
+    if (kmstool_enclave_decrypt_into(&params_decrypt, plaintext_out, sizeof(plaintext_out), &plaintext_out_len) !=
+            KMSTOOL_SUCCESS ||
+        plaintext_out_len != plaintext_len || memcmp(plaintext_out, plaintext_check, plaintext_out_len) != 0) {
+        fprintf(stderr, "Decryption into a caller buffer failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The caller inputs are only borrowed.
+    if (memcmp(plaintext, plaintext_check, plaintext_len) != 0) {
+        fprintf(stderr, "Encryption wrote into the caller plaintext\n");
+        exit(EXIT_FAILURE);
+    }
+    free(ciphertext);
+
+    unsigned int document_len = 0;
+    if (kmstool_enclave_get_attestation_document_into(NULL, 0, &document_len) != KMSTOOL_ERROR_BUFFER_TOO_SMALL ||
+        document_len == 0) {
+        fprintf(stderr, "Attestation document size query failed\n");
+        exit(EXIT_FAILURE);
+    }
+    unsigned char *document = malloc(document_len);
+    unsigned int document_written_len = 0;
+    if (document == NULL ||
+        kmstool_enclave_get_attestation_document_into(document, document_len, &document_written_len) !=
+            KMSTOOL_SUCCESS ||
+        document_written_len != document_len) {
+        fprintf(stderr, "Attestation document into a buffer of the queried size failed\n");
+        exit(EXIT_FAILURE);
+    }
+    free(document);
+
+    fprintf(stderr, "caller buffer variants success\n");
+}
+
 int main(int argc, char **argv) {
     /* Mark unused parameters to avoid warnings */
     (void)argc;
@@ -104,5 +186,7 @@ int main(int argc, char **argv) {
         fprintf(stderr, "success with i: %d\n", i);
         sleep(2);
     }
+
+    check_into_variants();
     return 0;
 }
@@ -1,9 +1,14 @@
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <aws/common/clock.h>
 #include <aws/common/encoding.h>
+#include <aws/common/linked_list.h>
 #include <aws/common/logging.h>
+#include <aws/common/thread.h>
 #include <aws/nitro_enclaves/kms.h>
+#include <aws/nitro_enclaves/logging.h>
 #include <aws/nitro_enclaves/nitro_enclaves.h>
 
 #include "../kmstool_enclave_lib.h"
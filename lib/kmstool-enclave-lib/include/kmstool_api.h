@@ -7,33 +7,78 @@ int kmstool_lib_init(struct kmstool_lib_ctx *ctx, const struct kmstool_init_para
 int kmstool_lib_clean_up(struct kmstool_lib_ctx *ctx);
 int kmstool_lib_update_aws_key(struct kmstool_lib_ctx *ctx, const struct kmstool_update_aws_key_params *params);
 
+/*
+ * The _into calls write their result into a caller-supplied buffer. When it does not fit, including when out is
+ * NULL to query the size, nothing is written, the required size is stored in the length output and
+ * KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned without logging. The result is then kept in the context for the
+ * calling thread, and the same call repeated by that thread with a large enough buffer returns it without calling
+ * KMS again: an encrypt size query followed by the real call yields one ciphertext from one KMS round trip. A kept
+ * result only serves the immediate retry: it is wiped by the next _into call of the thread, after
+ * PENDING_OUTPUT_TTL_MS, and by kmstool_lib_clean_up. A decrypted plaintext is never kept: it is at most 4096
+ * bytes, and a decrypt into a buffer that is too small reports the required size and must decrypt again.
+ * The caller inputs are only borrowed and never written.
+ */
 int kmstool_lib_list_key_policies(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_list_key_policies_params *params,
     unsigned int *response_json_len,
     unsigned char **response_json_out);
 
+int kmstool_lib_list_key_policies_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_list_key_policies_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len);
+
 int kmstool_lib_get_key_policy(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_get_key_policy_params *params,
     unsigned int *response_json_len,
     unsigned char **response_json_out);
 
+int kmstool_lib_get_key_policy_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_get_key_policy_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len);
+
 int kmstool_lib_encrypt(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_encrypt_params *params,
     unsigned int *ciphertext_out_len,
     unsigned char **ciphertext_out);
 
+int kmstool_lib_encrypt_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_encrypt_params *params,
+    unsigned char *ciphertext_out,
+    unsigned int ciphertext_out_capacity,
+    unsigned int *ciphertext_out_len);
+
 int kmstool_lib_decrypt(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_decrypt_params *params,
     unsigned int *plaintext_out_len,
     unsigned char **plaintext_out);
 
+int kmstool_lib_decrypt_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_decrypt_params *params,
+    unsigned char *plaintext_out,
+    unsigned int plaintext_out_capacity,
+    unsigned int *plaintext_out_len);
+
 int kmstool_lib_get_attestation_document(
     struct kmstool_lib_ctx *ctx,
     unsigned int *response_json_len,
     unsigned char **response_json_out);
 
+int kmstool_lib_get_attestation_document_into(
+    struct kmstool_lib_ctx *ctx,
+    unsigned char *response_out,
+    unsigned int response_capacity,
+    unsigned int *response_len);
+
 #endif // KMS_TOOL_API_H
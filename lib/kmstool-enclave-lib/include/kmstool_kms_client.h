@@ -4,5 +4,6 @@
 #include "./kmstool_type.h"
 
 int kms_client_check_and_update(struct kmstool_lib_ctx *ctx);
+int kms_client_destroy(struct kmstool_lib_ctx *ctx);
 
 #endif // KMSTOOL_KMS_CLIENT_H
@@ -4,6 +4,43 @@
 /* Default parent CID for vsock communication with the parent enclave */
 #define DEFAULT_PARENT_CID "3"
 
+/* Maximum time the KMS client waits for the entropy feeder to seed the pool, in milliseconds */
+#define ENTROPY_WAIT_TIMEOUT_MS 5000
+
+/* The operations of the _into calls, which identify the call a pending output belongs to */
+enum kmstool_output_operation {
+    KMSTOOL_OUTPUT_NONE = 0,
+    KMSTOOL_OUTPUT_LIST_KEY_POLICIES,
+    KMSTOOL_OUTPUT_GET_KEY_POLICY,
+    KMSTOOL_OUTPUT_ENCRYPT,
+    KMSTOOL_OUTPUT_ATTESTATION_DOCUMENT,
+};
+
+/* Time a result that did not fit the caller buffer is kept for the repeated call, in milliseconds */
+#define PENDING_OUTPUT_TTL_MS 5000
+
+/*
+ * The result of an _into call that did not fit the caller buffer, kept for the same call with a larger one.
+ * Each thread has at most one, which its next _into call takes or wipes.
+ */
+struct kmstool_pending_output {
+    struct aws_linked_list_node node;
+
+    /* The thread that made the call, the only one the result is returned to */
+    aws_thread_id_t thread_id;
+
+    /* Monotonic time after which the result is wiped, in nanoseconds */
+    uint64_t expires_at_ns;
+
+    enum kmstool_output_operation operation;
+
+    /* The serialized parameters of the call */
+    struct aws_byte_buf params;
+
+    /* The result of the call */
+    struct aws_byte_buf result;
+};
+
 struct kmstool_lib_ctx {
     /* Allocator to use for memory allocations. */
     struct aws_allocator *allocator;
@@ -23,6 +60,13 @@ struct kmstool_lib_ctx {
     struct aws_string *aws_access_key_id;
     struct aws_string *aws_secret_access_key;
     struct aws_string *aws_session_token;
+
+    /* Set when the credentials changed since the kms client was created. */
+    bool credentials_updated;
+
+    /* Results of _into calls that did not fit the caller buffer, protected by pending_output_mutex. */
+    struct aws_mutex pending_output_mutex;
+    struct aws_linked_list pending_outputs;
 };
 
 #endif // KMSTOOL_TYPE_H
\ No newline at end of file
@@ -1,11 +1,40 @@
 #ifndef KMSTOOL_UTILS_H
 #define KMSTOOL_UTILS_H
 
-extern bool g_log_enabled;
-
 int encode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_byte_buf *text, struct aws_byte_buf *text_b64);
 int decode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_string *text_b64, struct aws_byte_buf *text);
-void log_info(const char *message);
-void log_error(const char *message);
+int output_params_init(const struct kmstool_lib_ctx *ctx, struct aws_byte_buf *params);
+int output_params_append(struct aws_byte_buf *params, const void *data, size_t len);
+int output_params_append_c_str(struct aws_byte_buf *params, const char *str);
+
+/* Serialize the parameters identifying an _into call, only done when a result is kept or may be taken */
+typedef int(kmstool_output_params_fn)(
+    const struct kmstool_lib_ctx *ctx,
+    const void *call,
+    struct aws_byte_buf *params);
+
+bool take_pending_output(
+    struct kmstool_lib_ctx *ctx,
+    enum kmstool_output_operation operation,
+    kmstool_output_params_fn *params_fn,
+    const void *call,
+    struct aws_byte_buf *result);
+int write_output(struct aws_byte_buf *result, unsigned char *out, unsigned int out_capacity, unsigned int *out_len);
+int copy_to_output(
+    struct kmstool_lib_ctx *ctx,
+    enum kmstool_output_operation operation,
+    kmstool_output_params_fn *params_fn,
+    const void *call,
+    struct aws_byte_buf *result,
+    unsigned char *out,
+    unsigned int out_capacity,
+    unsigned int *out_len);
+void drop_pending_output(struct kmstool_lib_ctx *ctx);
+void pending_output_clean_up(struct kmstool_lib_ctx *ctx);
+
+/* Log through the aws_logger installed by kmstool_lib_init. A disabled level costs a single check. */
+#define log_debug(message) AWS_LOGF_DEBUG(AWS_LS_NITRO_ENCLAVES_GENERAL, "kmstool lib: %s", (message))
+#define log_info(message) AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_GENERAL, "kmstool lib: %s", (message))
+#define log_error(message) AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_GENERAL, "kmstool lib: %s", (message))
 
 #endif // KMSTOOL_UTILS_H
@@ -76,6 +76,26 @@ API_EXPORT int kmstool_enclave_list_key_policies(
     return kmstool_lib_list_key_policies(&g_ctx, params, response_json_len, response_json_out);
 }
 
+/**
+ * @brief List key policies for a KMS key into a caller-supplied buffer
+ *
+ * Writes the response into the given buffer, or reports the required size if it does not fit.
+ *
+ * @param params Pointer to the parameters for the ListKeyPolicies operation
+ * @param response_json_out Buffer to store the raw JSON response
+ * @param response_json_capacity Size of the buffer
+ * @param response_json_len Pointer to store the length of the raw JSON response
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+API_EXPORT int kmstool_enclave_list_key_policies_into(
+    const struct kmstool_list_key_policies_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len) {
+    return kmstool_lib_list_key_policies_into(
+        &g_ctx, params, response_json_out, response_json_capacity, response_json_len);
+}
+
 /**
  * @brief Get key policy for a KMS key
  *
@@ -93,6 +113,26 @@ API_EXPORT int kmstool_enclave_get_key_policy(
     return kmstool_lib_get_key_policy(&g_ctx, params, response_json_len, response_json_out);
 }
 
+/**
+ * @brief Get key policy for a KMS key into a caller-supplied buffer
+ *
+ * Writes the response into the given buffer, or reports the required size if it does not fit.
+ *
+ * @param params Pointer to the parameters for the GetKeyPolicy operation
+ * @param response_json_out Buffer to store the raw JSON response
+ * @param response_json_capacity Size of the buffer
+ * @param response_json_len Pointer to store the length of the raw JSON response
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+API_EXPORT int kmstool_enclave_get_key_policy_into(
+    const struct kmstool_get_key_policy_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len) {
+    return kmstool_lib_get_key_policy_into(
+        &g_ctx, params, response_json_out, response_json_capacity, response_json_len);
+}
+
 /**
  * @brief Encrypt data using KMS
  *
@@ -111,6 +151,26 @@ API_EXPORT int kmstool_enclave_encrypt(
     return kmstool_lib_encrypt(&g_ctx, params, ciphertext_out_len, ciphertext_out);
 }
 
+/**
+ * @brief Encrypt data using KMS into a caller-supplied buffer
+ *
+ * Writes the encrypted data into the given buffer, or reports the required size if it does
+ * not fit.
+ *
+ * @param params Encryption parameters including plaintext data
+ * @param ciphertext_out Buffer to store the encrypted data
+ * @param ciphertext_out_capacity Size of the buffer
+ * @param ciphertext_out_len Pointer to store the length of encrypted data
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+API_EXPORT int kmstool_enclave_encrypt_into(
+    const struct kmstool_encrypt_params *params,
+    unsigned char *ciphertext_out,
+    unsigned int ciphertext_out_capacity,
+    unsigned int *ciphertext_out_len) {
+    return kmstool_lib_encrypt_into(&g_ctx, params, ciphertext_out, ciphertext_out_capacity, ciphertext_out_len);
+}
+
 /**
  * @brief Decrypt data using KMS
  *
@@ -129,6 +189,26 @@ API_EXPORT int kmstool_enclave_decrypt(
     return kmstool_lib_decrypt(&g_ctx, params, plaintext_out_len, plaintext_out);
 }
 
+/**
+ * @brief Decrypt data using KMS into a caller-supplied buffer
+ *
+ * Writes the decrypted data into the given buffer, or reports the required size if it does
+ * not fit.
+ *
+ * @param params Decryption parameters including ciphertext data
+ * @param plaintext_out Buffer to store the decrypted data
+ * @param plaintext_out_capacity Size of the buffer
+ * @param plaintext_out_len Pointer to store the length of decrypted data
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+API_EXPORT int kmstool_enclave_decrypt_into(
+    const struct kmstool_decrypt_params *params,
+    unsigned char *plaintext_out,
+    unsigned int plaintext_out_capacity,
+    unsigned int *plaintext_out_len) {
+    return kmstool_lib_decrypt_into(&g_ctx, params, plaintext_out, plaintext_out_capacity, plaintext_out_len);
+}
+
 /**
  * @brief Get attestation document for the enclave
  *
@@ -137,3 +217,15 @@ API_EXPORT int kmstool_enclave_decrypt(
 API_EXPORT int kmstool_enclave_get_attestation_document(unsigned int *response_json_len, unsigned char **response_json_out) {
     return kmstool_lib_get_attestation_document(&g_ctx, response_json_len, response_json_out);
 }
+
+/**
+ * @brief Get attestation document for the enclave into a caller-supplied buffer
+ *
+ * Writes the document into the given buffer, or reports the required size if it does not fit.
+ */
+API_EXPORT int kmstool_enclave_get_attestation_document_into(
+    unsigned char *response_out,
+    unsigned int response_capacity,
+    unsigned int *response_len) {
+    return kmstool_lib_get_attestation_document_into(&g_ctx, response_out, response_capacity, response_len);
+}
@@ -21,8 +21,9 @@ extern "C" {
  * All functions in this library return one of these values.
  */
 enum KMSTOOL_STATUS {
-    KMSTOOL_ERROR = -1,  /* Operation failed */
-    KMSTOOL_SUCCESS = 0, /* Operation succeeded */
+    KMSTOOL_ERROR_BUFFER_TOO_SMALL = -2, /* Output buffer too small, the required size was reported */
+    KMSTOOL_ERROR = -1,                  /* Operation failed */
+    KMSTOOL_SUCCESS = 0,                 /* Operation succeeded */
 };
 
 /**
@@ -34,7 +35,7 @@ enum KMSTOOL_STATUS {
  */
 struct kmstool_init_params {
     const char *aws_region;            /* AWS region for KMS operations */
-    const unsigned int enable_logging; /* Enable logging if set to 1 */
+    const unsigned int enable_logging; /* Log info and above if set to 1, errors only otherwise */
     const unsigned int proxy_port;     /* vsock port on which vsock-proxy is available in parent */
 };
 
@@ -137,6 +138,28 @@ int kmstool_enclave_list_key_policies(
     unsigned int *response_json_len,
     unsigned char **response_json_out);
 
+/**
+ * @brief List key policies for a KMS key into a caller-supplied buffer
+ *
+ * Same as kmstool_enclave_list_key_policies, but writes the response into the given buffer
+ * instead of allocating one. If the buffer is too small, nothing is written, the required size
+ * is stored in response_json_len and KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned. Passing a NULL
+ * buffer queries the size. The response is kept for the next _into call of the same thread, for
+ * a few seconds: if it is the same call with a large enough buffer, it returns the response
+ * without calling KMS again. Any other _into call wipes it.
+ *
+ * @param params Pointer to the parameters for the ListKeyPolicies operation
+ * @param response_json_out Buffer to store the raw JSON response
+ * @param response_json_capacity Size of the buffer
+ * @param response_json_len Pointer to store the length of the raw JSON response
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+int kmstool_enclave_list_key_policies_into(
+    const struct kmstool_list_key_policies_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len);
+
 /**
  * @brief Get key policy for a KMS key
  *
@@ -152,6 +175,26 @@ int kmstool_enclave_get_key_policy(
     unsigned int *response_json_len,
     unsigned char **response_json_out);
 
+/**
+ * @brief Get key policy for a KMS key into a caller-supplied buffer
+ *
+ * Same as kmstool_enclave_get_key_policy, but writes the response into the given buffer
+ * instead of allocating one. If the buffer is too small, nothing is written, the required size
+ * is stored in response_json_len and KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned. The response is
+ * kept for the same call repeated with a large enough buffer, as for kmstool_enclave_list_key_policies_into.
+ *
+ * @param params Pointer to the parameters for the GetKeyPolicy operation
+ * @param response_json_out Buffer to store the raw JSON response
+ * @param response_json_capacity Size of the buffer
+ * @param response_json_len Pointer to store the length of the raw JSON response
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+int kmstool_enclave_get_key_policy_into(
+    const struct kmstool_get_key_policy_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len);
+
 /**
  * @brief Encrypt data using KMS
  *
@@ -168,6 +211,26 @@ int kmstool_enclave_encrypt(
     unsigned int *ciphertext_out_len,
     unsigned char **ciphertext_out);
 
+/**
+ * @brief Encrypt data using KMS into a caller-supplied buffer
+ *
+ * Same as kmstool_enclave_encrypt, but writes the ciphertext into the given buffer instead of
+ * allocating one. If the buffer is too small, nothing is written, the required size is stored
+ * in ciphertext_out_len and KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned. The ciphertext is kept for
+ * the same call repeated with a large enough buffer, as for kmstool_enclave_list_key_policies_into.
+ *
+ * @param params Pointer to encryption parameters
+ * @param ciphertext_out Buffer to store the encrypted data
+ * @param ciphertext_out_capacity Size of the buffer
+ * @param ciphertext_out_len Pointer to store the length of encrypted data
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+int kmstool_enclave_encrypt_into(
+    const struct kmstool_encrypt_params *params,
+    unsigned char *ciphertext_out,
+    unsigned int ciphertext_out_capacity,
+    unsigned int *ciphertext_out_len);
+
 /**
  * @brief Decrypt data using KMS
  *
@@ -184,6 +247,27 @@ int kmstool_enclave_decrypt(
     unsigned int *plaintext_out_len,
     unsigned char **plaintext_out);
 
+/**
+ * @brief Decrypt data using KMS into a caller-supplied buffer
+ *
+ * Same as kmstool_enclave_decrypt, but writes the plaintext into the given buffer instead of
+ * allocating one. If the buffer is too small, nothing is written, the required size is stored
+ * in plaintext_out_len and KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned. KMS plaintexts are at
+ * most 4096 bytes, so a buffer of that size always fits. A plaintext that does not fit is not
+ * kept: the call with a large enough buffer decrypts again.
+ *
+ * @param params Pointer to decryption parameters
+ * @param plaintext_out Buffer to store the decrypted data
+ * @param plaintext_out_capacity Size of the buffer
+ * @param plaintext_out_len Pointer to store the length of decrypted data
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+int kmstool_enclave_decrypt_into(
+    const struct kmstool_decrypt_params *params,
+    unsigned char *plaintext_out,
+    unsigned int plaintext_out_capacity,
+    unsigned int *plaintext_out_len);
+
 /**
  * @brief Get attestation document for the enclave
  *
@@ -194,6 +278,24 @@ int kmstool_enclave_decrypt(
  */
 int kmstool_enclave_get_attestation_document(unsigned int *response_json_len, unsigned char **response_json_out);
 
+/**
+ * @brief Get attestation document for the enclave into a caller-supplied buffer
+ *
+ * Same as kmstool_enclave_get_attestation_document, but writes the document into the given
+ * buffer instead of allocating one. If the buffer is too small, nothing is written, the required
+ * size is stored in response_len and KMSTOOL_ERROR_BUFFER_TOO_SMALL is returned. The document is
+ * kept for the call repeated with a large enough buffer, as for kmstool_enclave_list_key_policies_into.
+ *
+ * @param response_out Buffer to store the attestation document
+ * @param response_capacity Size of the buffer
+ * @param response_len Pointer to store the length of the attestation document
+ * @return KMSTOOL_SUCCESS on success, KMSTOOL_ERROR_BUFFER_TOO_SMALL or KMSTOOL_ERROR on failure
+ */
+int kmstool_enclave_get_attestation_document_into(
+    unsigned char *response_out,
+    unsigned int response_capacity,
+    unsigned int *response_len);
+
 #ifdef __cplusplus
 }
 #endif
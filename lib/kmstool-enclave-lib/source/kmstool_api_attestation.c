@@ -4,7 +4,7 @@ static int get_attestation_document(
     struct kmstool_lib_ctx *ctx,
     struct aws_byte_buf *response) {
     
-    log_info("attestation document");
+    log_debug("attestation document");
 
     ssize_t rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
@@ -27,7 +27,7 @@ int kmstool_lib_get_attestation_document(
     struct kmstool_lib_ctx *ctx,
     unsigned int *response_len,
     unsigned char **response_out) {
-    log_info("get attestation document");
+    log_debug("get attestation document");
 
     ssize_t rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
@@ -45,11 +45,42 @@ int kmstool_lib_get_attestation_document(
     uint8_t *output = malloc(response_buf.len);
     if (output == NULL) {
         log_error("failed to allocate memory for attestation document output");
+        aws_byte_buf_clean_up(&response_buf);
         return KMSTOOL_ERROR;
     }
 
     memcpy(output, response_buf.buffer, response_buf.len);
     *response_out = output;
     *response_len = response_buf.len;
+    aws_byte_buf_clean_up(&response_buf);
     return KMSTOOL_SUCCESS;
 }
+
+int kmstool_lib_get_attestation_document_into(
+    struct kmstool_lib_ctx *ctx,
+    unsigned char *response_out,
+    unsigned int response_capacity,
+    unsigned int *response_len) {
+    log_debug("get attestation document");
+    *response_len = 0;
+
+    /* The call has no parameters */
+    struct aws_byte_buf response_buf = {0};
+    if (!take_pending_output(ctx, KMSTOOL_OUTPUT_ATTESTATION_DOCUMENT, NULL, NULL, &response_buf)) {
+        ssize_t rc = get_attestation_document(ctx, &response_buf);
+        if (rc != AWS_OP_SUCCESS) {
+            log_error("failed to get attestation document");
+            return KMSTOOL_ERROR;
+        }
+    }
+
+    return copy_to_output(
+        ctx,
+        KMSTOOL_OUTPUT_ATTESTATION_DOCUMENT,
+        NULL,
+        NULL,
+        &response_buf,
+        response_out,
+        response_capacity,
+        response_len);
+}
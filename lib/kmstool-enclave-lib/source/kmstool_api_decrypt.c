@@ -7,7 +7,7 @@ static int decrypt_from_kms(
     struct aws_byte_buf *plaintext) {
     ssize_t rc = AWS_OP_ERR;
 
-    log_info("decrypt from kms");
+    log_debug("decrypt from kms");
 
     rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
@@ -15,47 +15,55 @@ static int decrypt_from_kms(
         return rc;
     }
 
+    /* Borrows the caller ciphertext, which is never written */
     struct aws_byte_buf ciphertext = aws_byte_buf_from_array(params->ciphertext, params->ciphertext_len);
     struct aws_string *kms_key_id = aws_string_new_from_c_str(ctx->allocator, params->kms_key_id);
     struct aws_string *kms_algorithm = aws_string_new_from_c_str(ctx->allocator, params->kms_algorithm);
 
     /* Decrypt the data with KMS using the configured key and algorithm */
     rc = aws_kms_decrypt_blocking(ctx->kms_client, kms_key_id, kms_algorithm, &ciphertext, plaintext);
-    aws_byte_buf_clean_up_secure(&ciphertext);
     aws_string_destroy(kms_key_id);
     aws_string_destroy(kms_algorithm);
     return rc;
 }
 
-int kmstool_lib_decrypt(
+/* Validate the parameters and decrypt the given ciphertext into the plaintext buffer */
+static int decrypt_to_buf(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_decrypt_params *params,
-    unsigned int *plaintext_out_len,
-    unsigned char **plaintext_out) {
-    ssize_t rc = AWS_OP_ERR;
-
-    log_info("decrypt");
+    struct aws_byte_buf *plaintext) {
+    log_debug("decrypt");
 
     if (params->ciphertext == NULL || params->ciphertext_len == 0) {
         log_error("ciphertext should not be NULL or empty");
-        *plaintext_out = NULL;
-        *plaintext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
     if (params->kms_key_id == NULL || params->kms_algorithm == NULL) {
         log_error("kms key id or algorithm should not be NULL");
-        *plaintext_out = NULL;
-        *plaintext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
-    struct aws_byte_buf plaintext_buf = {0};
-    rc = decrypt_from_kms(ctx, params, &plaintext_buf);
+    ssize_t rc = decrypt_from_kms(ctx, params, plaintext);
     if (rc != AWS_OP_SUCCESS) {
         log_error("kms decryption failed");
-        *plaintext_out = NULL;
-        *plaintext_out_len = 0;
+        return rc;
+    }
+
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_decrypt(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_decrypt_params *params,
+    unsigned int *plaintext_out_len,
+    unsigned char **plaintext_out) {
+    *plaintext_out = NULL;
+    *plaintext_out_len = 0;
+
+    struct aws_byte_buf plaintext_buf = {0};
+    ssize_t rc = decrypt_to_buf(ctx, params, &plaintext_buf);
+    if (rc != KMSTOOL_SUCCESS) {
         return rc;
     }
 
@@ -63,8 +71,6 @@ int kmstool_lib_decrypt(
     if (output == NULL) {
         log_error("failed to allocate memory for plaintext output");
         aws_byte_buf_clean_up_secure(&plaintext_buf);
-        *plaintext_out = NULL;
-        *plaintext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
@@ -73,4 +79,28 @@ int kmstool_lib_decrypt(
     *plaintext_out_len = plaintext_buf.len;
     aws_byte_buf_clean_up_secure(&plaintext_buf);
     return KMSTOOL_SUCCESS;
-}
\ No newline at end of file
+}
+
+/*
+ * The plaintext is not kept when it does not fit: a decrypted secret does not wait on the heap for a retry that may
+ * never come. KMS plaintexts are at most 4096 bytes, so a buffer of that size always fits.
+ */
+int kmstool_lib_decrypt_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_decrypt_params *params,
+    unsigned char *plaintext_out,
+    unsigned int plaintext_out_capacity,
+    unsigned int *plaintext_out_len) {
+    *plaintext_out_len = 0;
+
+    /* Any result kept for the previous call of this thread only served its immediate retry */
+    drop_pending_output(ctx);
+
+    struct aws_byte_buf plaintext_buf = {0};
+    ssize_t rc = decrypt_to_buf(ctx, params, &plaintext_buf);
+    if (rc != KMSTOOL_SUCCESS) {
+        return rc;
+    }
+
+    return write_output(&plaintext_buf, plaintext_out, plaintext_out_capacity, plaintext_out_len);
+}
@@ -9,27 +9,25 @@ static int encrypt_from_kms(
     struct aws_byte_buf *ciphertext) {
     ssize_t rc = AWS_OP_ERR;
 
-    log_info("encrypt from kms");
+    log_debug("encrypt from kms");
 
+    /* Borrows the caller plaintext, which is never written */
     struct aws_byte_buf plaintext = aws_byte_buf_from_array(params->plaintext, params->plaintext_len);
     struct aws_string *kms_key_id = aws_string_new_from_c_str(ctx->allocator, params->kms_key_id);
 
     /* Encrypt the data with KMS using the configured key and algorithm */
     rc = aws_kms_encrypt_blocking(ctx->kms_client, kms_key_id, &plaintext, ciphertext);
-    aws_byte_buf_clean_up_secure(&plaintext);
     aws_string_destroy(kms_key_id);
     return rc;
 }
 
-int kmstool_lib_encrypt(
+/* Validate the parameters and encrypt the given plaintext into the ciphertext buffer */
+static int encrypt_to_buf(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_encrypt_params *params,
-    unsigned int *ciphertext_out_len,
-    unsigned char **ciphertext_out) {
-    ssize_t rc = AWS_OP_ERR;
-
-    log_info("encrypt");
-    rc = kms_client_check_and_update(ctx);
+    struct aws_byte_buf *ciphertext) {
+    log_debug("encrypt");
+    ssize_t rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
         log_error("kms client connection is not established");
         return rc;
@@ -37,31 +35,39 @@ int kmstool_lib_encrypt(
 
     if (params->plaintext == NULL || params->plaintext_len == 0) {
         log_error("plaintext should not be NULL or empty");
-        *ciphertext_out = NULL;
-        *ciphertext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
     if (params->kms_key_id == NULL) {
         log_error("kms key id or algorithm should not be NULL");
-        *ciphertext_out = NULL;
-        *ciphertext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
     if (params->plaintext_len > MAX_ENCRYPT_DATA_SIZE) {
         log_error("plaintext too large");
-        *ciphertext_out = NULL;
-        *ciphertext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
-    struct aws_byte_buf ciphertext_buf = {0};
-    rc = encrypt_from_kms(ctx, params, &ciphertext_buf);
+    rc = encrypt_from_kms(ctx, params, ciphertext);
     if (rc != AWS_OP_SUCCESS) {
         log_error("kms encryption failed");
-        *ciphertext_out = NULL;
-        *ciphertext_out_len = 0;
+        return rc;
+    }
+
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_encrypt(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_encrypt_params *params,
+    unsigned int *ciphertext_out_len,
+    unsigned char **ciphertext_out) {
+    *ciphertext_out = NULL;
+    *ciphertext_out_len = 0;
+
+    struct aws_byte_buf ciphertext_buf = {0};
+    ssize_t rc = encrypt_to_buf(ctx, params, &ciphertext_buf);
+    if (rc != KMSTOOL_SUCCESS) {
         return rc;
     }
 
@@ -69,8 +75,6 @@ int kmstool_lib_encrypt(
     if (output == NULL) {
         log_error("failed to allocate memory for ciphertext output");
         aws_byte_buf_clean_up_secure(&ciphertext_buf);
-        *ciphertext_out = NULL;
-        *ciphertext_out_len = 0;
         return KMSTOOL_ERROR;
     }
 
@@ -80,3 +84,49 @@ int kmstool_lib_encrypt(
     aws_byte_buf_clean_up_secure(&ciphertext_buf);
     return KMSTOOL_SUCCESS;
 }
+
+/* Serialize the parameters identifying an encrypt call */
+static int encrypt_output_params(
+    const struct kmstool_lib_ctx *ctx,
+    const void *call,
+    struct aws_byte_buf *call_params) {
+    const struct kmstool_encrypt_params *params = call;
+    if (output_params_init(ctx, call_params) != KMSTOOL_SUCCESS) {
+        return KMSTOOL_ERROR;
+    }
+
+    if (output_params_append_c_str(call_params, params->kms_key_id) != KMSTOOL_SUCCESS ||
+        output_params_append(call_params, params->plaintext, params->plaintext_len) != KMSTOOL_SUCCESS) {
+        aws_byte_buf_clean_up_secure(call_params);
+        return KMSTOOL_ERROR;
+    }
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_encrypt_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_encrypt_params *params,
+    unsigned char *ciphertext_out,
+    unsigned int ciphertext_out_capacity,
+    unsigned int *ciphertext_out_len) {
+    *ciphertext_out_len = 0;
+
+    /* A size query keeps its ciphertext, so that the repeated call returns the same one */
+    struct aws_byte_buf ciphertext_buf = {0};
+    if (!take_pending_output(ctx, KMSTOOL_OUTPUT_ENCRYPT, encrypt_output_params, params, &ciphertext_buf)) {
+        ssize_t rc = encrypt_to_buf(ctx, params, &ciphertext_buf);
+        if (rc != KMSTOOL_SUCCESS) {
+            return rc;
+        }
+    }
+
+    return copy_to_output(
+        ctx,
+        KMSTOOL_OUTPUT_ENCRYPT,
+        encrypt_output_params,
+        params,
+        &ciphertext_buf,
+        ciphertext_out,
+        ciphertext_out_capacity,
+        ciphertext_out_len);
+}
@@ -1,13 +1,25 @@
 #include "../include/kmstool_api.h"
 
+static void s_logger_clean_up(struct kmstool_lib_ctx *ctx) {
+    if (ctx->logger == NULL) {
+        return;
+    }
+
+    /* Writes out the lines still queued before the logger goes away. */
+    aws_logger_set(NULL);
+    aws_logger_clean_up(ctx->logger);
+    free(ctx->logger);
+    ctx->logger = NULL;
+}
+
 /**
  * Initialize the KMS Tool enclave library.
  *
  * This function must be called before using any KMS operations.
  * It performs the following initialization steps:
- * 1. Validates all required parameters
- * 2. Initializes AWS Nitro Enclaves library
- * 3. Sets up logging if enabled
+ * 1. Sets up logging: info and above if enabled, errors only otherwise
+ * 2. Validates all required parameters
+ * 3. Initializes AWS Nitro Enclaves library
  * 4. Creates KMS client with provided credentials
  *
  * @param ctx The KMS Tool enclave context to initialize
@@ -21,17 +33,40 @@ int kmstool_lib_init(struct kmstool_lib_ctx *ctx, const struct kmstool_init_para
         return KMSTOOL_SUCCESS;
     }
 
+    /* Initialize the logger first, so that initialization errors are reported. Lines are written to
+     * stderr from a background thread, so that KMS calls do not wait on the console. */
+    ctx->logger = malloc(sizeof(struct aws_logger));
+    if (ctx->logger == NULL) {
+        fprintf(stderr, "kmstool lib: failed to allocate memory for logger\n");
+        return KMSTOOL_ERROR;
+    }
+
+    struct aws_nitro_enclaves_async_logger_options options = {
+        .file = stderr,
+        .level = params->enable_logging == 1 ? AWS_LL_INFO : AWS_LL_ERROR,
+    };
+    if (aws_nitro_enclaves_logger_init_async(ctx->logger, aws_default_allocator(), &options) != AWS_OP_SUCCESS) {
+        fprintf(stderr, "kmstool lib: failed to initialize AWS logger\n");
+        free(ctx->logger);
+        ctx->logger = NULL;
+        return KMSTOOL_ERROR;
+    }
+    aws_logger_set(ctx->logger);
+
     if (params->aws_region == NULL) {
         log_error("aws region is not set");
+        s_logger_clean_up(ctx);
         return KMSTOOL_ERROR;
     }
 
     /* Initialize the AWS Nitro Enclaves library */
     aws_nitro_enclaves_library_init(NULL);
 
-    if (aws_nitro_enclaves_library_seed_entropy(1024) != AWS_OP_SUCCESS) {
-        log_error("failed to seed entropy for AWS Nitro Enclaves library");
+    /* Seed the entropy pool in the background; the KMS client waits for it before generating its key pair */
+    if (aws_nitro_enclaves_library_start_entropy_feeder(NULL) != AWS_OP_SUCCESS) {
+        log_error("failed to start the entropy feeder of AWS Nitro Enclaves library");
         aws_nitro_enclaves_library_clean_up();
+        s_logger_clean_up(ctx);
         return KMSTOOL_ERROR;
     }
 
@@ -39,33 +74,26 @@ int kmstool_lib_init(struct kmstool_lib_ctx *ctx, const struct kmstool_init_para
     if (ctx->allocator == NULL) {
         log_error("failed to get AWS Nitro Enclaves allocator");
         aws_nitro_enclaves_library_clean_up();
+        s_logger_clean_up(ctx);
         return KMSTOOL_ERROR;
     }
 
-    /* Initialize logger if enabled */
-    if (params->enable_logging == 1) {
-        g_log_enabled = true;
-        ctx->logger = malloc(sizeof(struct aws_logger));
-        if (ctx->logger == NULL) {
-            log_error("failed to allocate memory for logger");
-            aws_nitro_enclaves_library_clean_up();
-            return KMSTOOL_ERROR;
-        }
-
-        struct aws_logger_standard_options options = {
-            .file = stderr,
-            .level = AWS_LL_INFO,
-            .filename = NULL,
-        };
-        if (aws_logger_init_standard(ctx->logger, ctx->allocator, &options) != AWS_OP_SUCCESS) {
-            log_error("failed to initialize AWS logger");
-            free(ctx->logger);
-            ctx->logger = NULL;
-            aws_nitro_enclaves_library_clean_up();
-            return KMSTOOL_ERROR;
-        }
-        aws_logger_set(ctx->logger);
+    /* Create the shared TLS context and event loop threads up front, so the first client does not wait for them */
+    if (aws_nitro_enclaves_get_tls_ctx() == NULL || aws_nitro_enclaves_get_client_bootstrap() == NULL) {
+        log_error("failed to create the shared TLS context and client bootstrap");
+        aws_nitro_enclaves_library_clean_up();
+        s_logger_clean_up(ctx);
+        return KMSTOOL_ERROR;
+    }
+
+    if (aws_mutex_init(&ctx->pending_output_mutex) != AWS_OP_SUCCESS) {
+        log_error("failed to initialize the pending output mutex");
+        ctx->allocator = NULL;
+        aws_nitro_enclaves_library_clean_up();
+        s_logger_clean_up(ctx);
+        return KMSTOOL_ERROR;
     }
+    aws_linked_list_init(&ctx->pending_outputs);
 
     ctx->proxy_port = params->proxy_port;
     ctx->aws_region = aws_string_new_from_c_str(ctx->allocator, params->aws_region);
@@ -94,14 +122,17 @@ int kmstool_lib_clean_up(struct kmstool_lib_ctx *ctx) {
         ctx->aws_region = NULL;
     }
 
-    aws_nitro_enclaves_library_clean_up();
-
-    if (ctx->logger) {
-        free(ctx->logger);
-        ctx->logger = NULL;
+    /* Wipe the results kept for repeated _into calls, which may be plaintexts */
+    if (ctx->allocator != NULL) {
+        pending_output_clean_up(ctx);
+        aws_mutex_clean_up(&ctx->pending_output_mutex);
     }
 
-    // TODO: destroy kms client
+    /* The client holds the event loop threads of the library, so it goes first */
+    kms_client_destroy(ctx);
+
+    aws_nitro_enclaves_library_clean_up();
+    s_logger_clean_up(ctx);
 
     ctx->allocator = NULL;
     return KMSTOOL_SUCCESS;
@@ -110,8 +141,8 @@ int kmstool_lib_clean_up(struct kmstool_lib_ctx *ctx) {
 /**
  * Update AWS credentials for an initialized KMS Tool enclave.
  *
- * This function updates the AWS credentials and
- * wait for the KMS client to be updated when connection is established.
+ * This function updates the AWS credentials. The KMS client is rebuilt with
+ * the new credentials on the next KMS operation.
  *
  * @param ctx The KMS Tool enclave context
  * @param params New AWS credentials
@@ -143,5 +174,6 @@ int kmstool_lib_update_aws_key(struct kmstool_lib_ctx *ctx, const struct kmstool
     }
     ctx->aws_session_token = aws_string_new_from_c_str(ctx->allocator, params->aws_session_token);
 
+    ctx->credentials_updated = true;
     return KMSTOOL_SUCCESS;
 }
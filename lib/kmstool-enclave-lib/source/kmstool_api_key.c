@@ -6,7 +6,7 @@ int query_key_policies_from_kms(
     struct aws_byte_buf *key_policies_json) {
     ssize_t rc = AWS_OP_ERR;
 
-    log_info("querying key policies from kms");
+    log_debug("querying key policies from kms");
     
     rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
@@ -34,13 +34,13 @@ int query_key_policies_from_kms(
     return AWS_OP_SUCCESS;
 }
 
-int kmstool_lib_list_key_policies(
+/* Validate the parameters and list the key policies into the given buffer */
+static int list_key_policies(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_list_key_policies_params *params,
-    unsigned int *response_json_len,
-    unsigned char **response_json_out) {
+    struct aws_byte_buf *key_policies_json) {
 
-    log_info("listing key policies");
+    log_debug("listing key policies");
 
     if (params->key_id == NULL) {
         log_error("key_id is NULL");
@@ -52,13 +52,26 @@ int kmstool_lib_list_key_policies(
         return KMSTOOL_ERROR;
     }
 
-    struct aws_byte_buf key_policies_json = {0};
-    ssize_t rc = query_key_policies_from_kms(ctx, params, &key_policies_json);
+    ssize_t rc = query_key_policies_from_kms(ctx, params, key_policies_json);
     if (rc != AWS_OP_SUCCESS) {
         log_error("could not list key policies");
         return rc;
     }
 
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_list_key_policies(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_list_key_policies_params *params,
+    unsigned int *response_json_len,
+    unsigned char **response_json_out) {
+    struct aws_byte_buf key_policies_json = {0};
+    ssize_t rc = list_key_policies(ctx, params, &key_policies_json);
+    if (rc != KMSTOOL_SUCCESS) {
+        return rc;
+    }
+
     uint8_t *output = malloc(key_policies_json.len);
     if (output == NULL) {
         log_error("failed to allocate memory for key policies output");
@@ -76,13 +89,60 @@ int kmstool_lib_list_key_policies(
     return KMSTOOL_SUCCESS;
 }
 
+/* Serialize the parameters identifying a list key policies call */
+static int list_key_policies_output_params(
+    const struct kmstool_lib_ctx *ctx,
+    const void *call,
+    struct aws_byte_buf *call_params) {
+    const struct kmstool_list_key_policies_params *params = call;
+    if (output_params_init(ctx, call_params) != KMSTOOL_SUCCESS) {
+        return KMSTOOL_ERROR;
+    }
+
+    if (output_params_append_c_str(call_params, params->key_id) != KMSTOOL_SUCCESS ||
+        output_params_append(call_params, &params->limit, sizeof(params->limit)) != KMSTOOL_SUCCESS ||
+        output_params_append_c_str(call_params, params->marker) != KMSTOOL_SUCCESS) {
+        aws_byte_buf_clean_up(call_params);
+        return KMSTOOL_ERROR;
+    }
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_list_key_policies_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_list_key_policies_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len) {
+    *response_json_len = 0;
+
+    struct aws_byte_buf key_policies_json = {0};
+    if (!take_pending_output(
+            ctx, KMSTOOL_OUTPUT_LIST_KEY_POLICIES, list_key_policies_output_params, params, &key_policies_json)) {
+        ssize_t rc = list_key_policies(ctx, params, &key_policies_json);
+        if (rc != KMSTOOL_SUCCESS) {
+            return rc;
+        }
+    }
+
+    return copy_to_output(
+        ctx,
+        KMSTOOL_OUTPUT_LIST_KEY_POLICIES,
+        list_key_policies_output_params,
+        params,
+        &key_policies_json,
+        response_json_out,
+        response_json_capacity,
+        response_json_len);
+}
+
 int query_key_policy_from_kms(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_get_key_policy_params *params,
     struct aws_byte_buf *key_policy_json) {
     ssize_t rc = AWS_OP_ERR;
 
-    log_info("querying key policy from kms");
+    log_debug("querying key policy from kms");
 
     rc = kms_client_check_and_update(ctx);
     if (rc != KMSTOOL_SUCCESS) {
@@ -105,13 +165,13 @@ int query_key_policy_from_kms(
     return AWS_OP_SUCCESS;
 }
 
-int kmstool_lib_get_key_policy(
+/* Validate the parameters and get the key policy into the given buffer */
+static int get_key_policy(
     struct kmstool_lib_ctx *ctx,
     const struct kmstool_get_key_policy_params *params,
-    unsigned int *response_json_len,
-    unsigned char **response_json_out) {
+    struct aws_byte_buf *key_policy_json) {
 
-    log_info("getting key policy");
+    log_debug("getting key policy");
 
     if (params->key_id == NULL) {   
         log_error("key_id is NULL");
@@ -123,13 +183,26 @@ int kmstool_lib_get_key_policy(
         return KMSTOOL_ERROR;
     }
 
-    struct aws_byte_buf key_policy_json = {0};
-    ssize_t rc = query_key_policy_from_kms(ctx, params, &key_policy_json);
+    ssize_t rc = query_key_policy_from_kms(ctx, params, key_policy_json);
     if (rc != AWS_OP_SUCCESS) {
         log_error("could not get key policy");
         return rc;
     }
-    
+
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_get_key_policy(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_get_key_policy_params *params,
+    unsigned int *response_json_len,
+    unsigned char **response_json_out) {
+    struct aws_byte_buf key_policy_json = {0};
+    ssize_t rc = get_key_policy(ctx, params, &key_policy_json);
+    if (rc != KMSTOOL_SUCCESS) {
+        return rc;
+    }
+
     uint8_t *output = malloc(key_policy_json.len);
     if (output == NULL) {
         log_error("failed to allocate memory for key policy output");
@@ -145,4 +218,50 @@ int kmstool_lib_get_key_policy(
     aws_byte_buf_clean_up_secure(&key_policy_json);
 
     return KMSTOOL_SUCCESS;
-}
\ No newline at end of file
+}
+
+/* Serialize the parameters identifying a get key policy call */
+static int get_key_policy_output_params(
+    const struct kmstool_lib_ctx *ctx,
+    const void *call,
+    struct aws_byte_buf *call_params) {
+    const struct kmstool_get_key_policy_params *params = call;
+    if (output_params_init(ctx, call_params) != KMSTOOL_SUCCESS) {
+        return KMSTOOL_ERROR;
+    }
+
+    if (output_params_append_c_str(call_params, params->key_id) != KMSTOOL_SUCCESS ||
+        output_params_append_c_str(call_params, params->policy_name) != KMSTOOL_SUCCESS) {
+        aws_byte_buf_clean_up(call_params);
+        return KMSTOOL_ERROR;
+    }
+    return KMSTOOL_SUCCESS;
+}
+
+int kmstool_lib_get_key_policy_into(
+    struct kmstool_lib_ctx *ctx,
+    const struct kmstool_get_key_policy_params *params,
+    unsigned char *response_json_out,
+    unsigned int response_json_capacity,
+    unsigned int *response_json_len) {
+    *response_json_len = 0;
+
+    struct aws_byte_buf key_policy_json = {0};
+    if (!take_pending_output(
+            ctx, KMSTOOL_OUTPUT_GET_KEY_POLICY, get_key_policy_output_params, params, &key_policy_json)) {
+        ssize_t rc = get_key_policy(ctx, params, &key_policy_json);
+        if (rc != KMSTOOL_SUCCESS) {
+            return rc;
+        }
+    }
+
+    return copy_to_output(
+        ctx,
+        KMSTOOL_OUTPUT_GET_KEY_POLICY,
+        get_key_policy_output_params,
+        params,
+        &key_policy_json,
+        response_json_out,
+        response_json_capacity,
+        response_json_len);
+}
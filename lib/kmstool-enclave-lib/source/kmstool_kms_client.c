@@ -9,6 +9,11 @@ static int kms_client_init(struct kmstool_lib_ctx *ctx) {
         return AWS_OP_SUCCESS;
     }
 
+    if (aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_WAIT_TIMEOUT_MS) != AWS_OP_SUCCESS) {
+        log_error("entropy pool is not seeded");
+        return AWS_OP_ERR;
+    }
+
     /* Configure vsock endpoint for parent enclave communication */
     struct aws_socket_endpoint endpoint = {.address = DEFAULT_PARENT_CID, .port = ctx->proxy_port};
     struct aws_nitro_enclaves_kms_client_configuration configuration = {
@@ -35,7 +40,7 @@ static int kms_client_init(struct kmstool_lib_ctx *ctx) {
     return AWS_OP_SUCCESS;
 }
 
-static int kms_client_destroy(struct kmstool_lib_ctx *ctx) {
+int kms_client_destroy(struct kmstool_lib_ctx *ctx) {
     log_info("destroying kms client");
 
     if (ctx->kms_client != NULL) {
@@ -65,15 +70,17 @@ static int kms_client_update(struct kmstool_lib_ctx *ctx) {
         log_error("failed to initialize kms client");
         return KMSTOOL_ERROR;
     }
+    ctx->credentials_updated = false;
 
     return KMSTOOL_SUCCESS;
 }
 
 int kms_client_check_and_update(struct kmstool_lib_ctx *ctx) {
-    log_info("kms client check and update");
+    log_debug("kms client check and update");
 
-    if (ctx->kms_client != NULL && ctx->kms_client->rest_client->is_connected) {
-        log_info("kms client connection is established, no need to update");
+    /* The rest client reconnects on its own, so the client is only rebuilt for new credentials. */
+    if (ctx->kms_client != NULL && !ctx->credentials_updated) {
+        log_debug("kms client is up to date, no need to update");
         return KMSTOOL_SUCCESS;
     }
 
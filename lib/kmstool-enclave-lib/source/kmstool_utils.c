@@ -1,10 +1,8 @@
 #include "../include/kmstool.h"
 
-bool g_log_enabled = false;
-
 /* Encode the given text buffer to base64 and store it in text_b64 */
 int encode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_byte_buf *text, struct aws_byte_buf *text_b64) {
-    log_info("encoding text to base64");
+    log_debug("encoding text to base64");
 
     ssize_t rc = AWS_OP_ERR;
     size_t text_b64_len;
@@ -30,7 +28,7 @@ int encode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_byte_buf *tex
 
 /* Decord the given text buffer from base64 and store it in text */
 int decode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_string *text_b64, struct aws_byte_buf *text) {
-    log_info("decoding text from base64");
+    log_debug("decoding text from base64");
 
     ssize_t rc = AWS_OP_ERR;
     size_t text_len;
@@ -58,12 +56,224 @@ int decode_b64(const struct kmstool_lib_ctx *ctx, const struct aws_string *text_
     return AWS_OP_SUCCESS;
 }
 
-inline void log_info(const char *message) {
-    if (g_log_enabled) {
-        fprintf(stderr, "kmstool lib info: %s\n", message);
+/* Initialize the buffer of the serialized parameters of an _into call */
+int output_params_init(const struct kmstool_lib_ctx *ctx, struct aws_byte_buf *params) {
+    if (aws_byte_buf_init(params, ctx->allocator, 64) != AWS_OP_SUCCESS) {
+        log_error("memory allocation error");
+        return KMSTOOL_ERROR;
+    }
+    return KMSTOOL_SUCCESS;
+}
+
+/* Append a length-prefixed parameter to the serialized parameters of an _into call. NULL differs from empty. */
+int output_params_append(struct aws_byte_buf *params, const void *data, size_t len) {
+    if (len >= UINT32_MAX) {
+        log_error("parameter too large");
+        return KMSTOOL_ERROR;
+    }
+
+    uint8_t prefix[4];
+    uint32_t prefix_value = data == NULL ? UINT32_MAX : (uint32_t)len;
+    for (size_t i = 0; i < sizeof(prefix); i++) {
+        prefix[i] = (uint8_t)(prefix_value >> (24 - 8 * i));
+    }
+
+    struct aws_byte_cursor prefix_cursor = aws_byte_cursor_from_array(prefix, sizeof(prefix));
+    struct aws_byte_cursor data_cursor = aws_byte_cursor_from_array(data, data == NULL ? 0 : len);
+    if (aws_byte_buf_append_dynamic_secure(params, &prefix_cursor) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_dynamic_secure(params, &data_cursor) != AWS_OP_SUCCESS) {
+        log_error("memory allocation error");
+        return KMSTOOL_ERROR;
+    }
+    return KMSTOOL_SUCCESS;
+}
+
+/* Append a NUL-terminated string parameter, which may be NULL */
+int output_params_append_c_str(struct aws_byte_buf *params, const char *str) {
+    return output_params_append(params, str, str == NULL ? 0 : strlen(str));
+}
+
+static void s_pending_output_destroy(struct kmstool_lib_ctx *ctx, struct kmstool_pending_output *pending) {
+    aws_byte_buf_clean_up_secure(&pending->params);
+    aws_byte_buf_clean_up_secure(&pending->result);
+    aws_mem_release(ctx->allocator, pending);
+}
+
+static uint64_t s_now_ns(void) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    return now_ns;
+}
+
+/*
+ * Must be called with ctx->pending_output_mutex held. Wipes the expired results, and removes and returns the one
+ * of the calling thread, if any.
+ */
+static struct kmstool_pending_output *s_pending_output_remove_own_synced(struct kmstool_lib_ctx *ctx, uint64_t now_ns) {
+    struct kmstool_pending_output *own = NULL;
+    aws_thread_id_t thread_id = aws_thread_current_thread_id();
+
+    struct aws_linked_list_node *node = aws_linked_list_begin(&ctx->pending_outputs);
+    while (node != aws_linked_list_end(&ctx->pending_outputs)) {
+        struct kmstool_pending_output *pending = AWS_CONTAINER_OF(node, struct kmstool_pending_output, node);
+        node = aws_linked_list_next(node);
+
+        if (pending->expires_at_ns <= now_ns) {
+            aws_linked_list_remove(&pending->node);
+            s_pending_output_destroy(ctx, pending);
+        } else if (aws_thread_thread_id_equal(pending->thread_id, thread_id)) {
+            aws_linked_list_remove(&pending->node);
+            own = pending;
+        }
+    }
+    return own;
+}
+
+/* Serialize the parameters of an _into call. A call without parameters has an empty serialization. */
+static int s_output_params_build(
+    const struct kmstool_lib_ctx *ctx,
+    kmstool_output_params_fn *params_fn,
+    const void *call,
+    struct aws_byte_buf *params) {
+    AWS_ZERO_STRUCT(*params);
+    if (params_fn == NULL) {
+        return KMSTOOL_SUCCESS;
+    }
+    return params_fn(ctx, call, params);
+}
+
+/*
+ * Take the kept result of the previous call of this thread if it had the same operation and parameters and its
+ * output did not fit, so that repeating the call with a larger buffer returns that result instead of calling KMS
+ * again. A result kept for another call is wiped: it is only kept for the immediate retry.
+ * The parameters are only serialized when this thread has a kept result of the same operation.
+ */
+bool take_pending_output(
+    struct kmstool_lib_ctx *ctx,
+    enum kmstool_output_operation operation,
+    kmstool_output_params_fn *params_fn,
+    const void *call,
+    struct aws_byte_buf *result) {
+    aws_mutex_lock(&ctx->pending_output_mutex);
+    struct kmstool_pending_output *pending = s_pending_output_remove_own_synced(ctx, s_now_ns());
+    aws_mutex_unlock(&ctx->pending_output_mutex);
+
+    if (pending == NULL) {
+        return false;
+    }
+
+    bool found = false;
+    if (pending->operation == operation) {
+        struct aws_byte_buf params;
+        if (s_output_params_build(ctx, params_fn, call, &params) == KMSTOOL_SUCCESS) {
+            found = aws_byte_buf_eq(&pending->params, &params);
+            aws_byte_buf_clean_up_secure(&params);
+        }
+    }
+
+    if (found) {
+        log_debug("returning the output kept from the previous call");
+        *result = pending->result;
+        AWS_ZERO_STRUCT(pending->result);
+    }
+    s_pending_output_destroy(ctx, pending);
+    return found;
+}
+
+/*
+ * Copy the result of an _into call into the caller-supplied output, or report the required size when it does not
+ * fit. The result is wiped either way.
+ */
+int write_output(struct aws_byte_buf *result, unsigned char *out, unsigned int out_capacity, unsigned int *out_len) {
+    int rc = KMSTOOL_SUCCESS;
+
+    if (result->len > UINT_MAX) {
+        log_error("output too large");
+        *out_len = 0;
+        rc = KMSTOOL_ERROR;
+    } else if (result->len > out_capacity || (out == NULL && result->len > 0)) {
+        /* Part of the size query contract, not an error: nothing is logged. */
+        *out_len = (unsigned int)result->len;
+        rc = KMSTOOL_ERROR_BUFFER_TOO_SMALL;
+    } else {
+        *out_len = (unsigned int)result->len;
+        if (result->len > 0) {
+            memcpy(out, result->buffer, result->len);
+        }
     }
+
+    aws_byte_buf_clean_up_secure(result);
+    return rc;
 }
 
-inline void log_error(const char *message) {
-    fprintf(stderr, "kmstool lib error: %s\n", message);
-}
\ No newline at end of file
+/*
+ * Copy the result of an _into call into the caller-supplied output. When it does not fit, the required size is
+ * reported and the result is kept, replacing any other of the calling thread, for the same call repeated by that
+ * thread with a larger buffer within PENDING_OUTPUT_TTL_MS. Only then are the parameters serialized.
+ * Takes ownership of result.
+ */
+int copy_to_output(
+    struct kmstool_lib_ctx *ctx,
+    enum kmstool_output_operation operation,
+    kmstool_output_params_fn *params_fn,
+    const void *call,
+    struct aws_byte_buf *result,
+    unsigned char *out,
+    unsigned int out_capacity,
+    unsigned int *out_len) {
+    if (result->len > UINT_MAX || (result->len <= out_capacity && (out != NULL || result->len == 0))) {
+        return write_output(result, out, out_capacity, out_len);
+    }
+
+    /* Without memory to keep it, the repeated call makes the call again */
+    struct kmstool_pending_output *pending = aws_mem_calloc(ctx->allocator, 1, sizeof(*pending));
+    if (pending == NULL) {
+        return write_output(result, out, out_capacity, out_len);
+    }
+    if (s_output_params_build(ctx, params_fn, call, &pending->params) != KMSTOOL_SUCCESS) {
+        aws_mem_release(ctx->allocator, pending);
+        return write_output(result, out, out_capacity, out_len);
+    }
+
+    /* Part of the size query contract, not an error: nothing is logged. */
+    *out_len = (unsigned int)result->len;
+
+    uint64_t now_ns = s_now_ns();
+    pending->thread_id = aws_thread_current_thread_id();
+    pending->expires_at_ns =
+        now_ns + aws_timestamp_convert(PENDING_OUTPUT_TTL_MS, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    pending->operation = operation;
+    pending->result = *result;
+    AWS_ZERO_STRUCT(*result);
+
+    aws_mutex_lock(&ctx->pending_output_mutex);
+    struct kmstool_pending_output *replaced = s_pending_output_remove_own_synced(ctx, now_ns);
+    aws_linked_list_push_back(&ctx->pending_outputs, &pending->node);
+    aws_mutex_unlock(&ctx->pending_output_mutex);
+
+    if (replaced != NULL) {
+        s_pending_output_destroy(ctx, replaced);
+    }
+    return KMSTOOL_ERROR_BUFFER_TOO_SMALL;
+}
+
+/* Wipe the kept result of the calling thread, for an _into call that never keeps or takes one */
+void drop_pending_output(struct kmstool_lib_ctx *ctx) {
+    aws_mutex_lock(&ctx->pending_output_mutex);
+    struct kmstool_pending_output *pending = s_pending_output_remove_own_synced(ctx, s_now_ns());
+    aws_mutex_unlock(&ctx->pending_output_mutex);
+
+    if (pending != NULL) {
+        s_pending_output_destroy(ctx, pending);
+    }
+}
+
+/* Wipe the kept outputs of all threads */
+void pending_output_clean_up(struct kmstool_lib_ctx *ctx) {
+    aws_mutex_lock(&ctx->pending_output_mutex);
+    while (!aws_linked_list_empty(&ctx->pending_outputs)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&ctx->pending_outputs);
+        s_pending_output_destroy(ctx, AWS_CONTAINER_OF(node, struct kmstool_pending_output, node));
+    }
+    aws_mutex_unlock(&ctx->pending_output_mutex);
+}
@@ -0,0 +1,324 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/arena.h>
+
+#include <aws/common/linked_list.h>
+#include <aws/common/mutex.h>
+
+#include <string.h>
+
+/* Every allocation is aligned for any fundamental type. */
+#define ARENA_ALIGNMENT 16
+
+struct arena_block {
+    struct arena_block *next;
+    size_t capacity;
+    size_t used;
+};
+
+struct aws_nitro_enclaves_arena {
+    /* The allocator interface handed out to callers, with impl pointing back to the arena. */
+    struct aws_allocator allocator;
+    struct aws_allocator *parent;
+    size_t block_size;
+
+    /* The block allocations are made from comes first. */
+    struct arena_block *blocks;
+
+    /* The most recent allocation, which can grow in place. */
+    uint8_t *last;
+    size_t last_size;
+
+    /* The pool the arena returns to, NULL if it is not pooled. */
+    struct aws_nitro_enclaves_arena_pool *pool;
+    struct aws_linked_list_node pool_node;
+};
+
+struct aws_nitro_enclaves_arena_pool {
+    struct aws_allocator *allocator;
+    size_t block_size;
+
+    /* Released arenas, protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_linked_list arenas;
+    size_t count;
+    size_t max_pooled;
+};
+
+static size_t s_align_up(size_t size) {
+    return (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static uint8_t *s_block_data(struct arena_block *block) {
+    return (uint8_t *)block + s_align_up(sizeof(struct arena_block));
+}
+
+static struct arena_block *s_block_new(struct aws_allocator *allocator, size_t capacity) {
+    size_t header_size = s_align_up(sizeof(struct arena_block));
+    if (capacity > SIZE_MAX - header_size) {
+        aws_raise_error(AWS_ERROR_OOM);
+        return NULL;
+    }
+
+    struct arena_block *block = aws_mem_acquire(allocator, header_size + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+
+    return block;
+}
+
+static void s_block_destroy(struct aws_allocator *allocator, struct arena_block *block) {
+    aws_secure_zero(s_block_data(block), block->used);
+    aws_mem_release(allocator, block);
+}
+
+static void *s_arena_mem_acquire(struct aws_allocator *allocator, size_t size) {
+    struct aws_nitro_enclaves_arena *arena = allocator->impl;
+
+    if (size > SIZE_MAX - (ARENA_ALIGNMENT - 1)) {
+        return NULL;
+    }
+    size_t aligned_size = s_align_up(size);
+
+    struct arena_block *block = arena->blocks;
+    if (block == NULL || block->capacity - block->used < aligned_size) {
+        block = s_block_new(arena->parent, AWS_MAX(arena->block_size, aligned_size));
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    uint8_t *ptr = s_block_data(block) + block->used;
+    block->used += aligned_size;
+    arena->last = ptr;
+    arena->last_size = aligned_size;
+
+    return ptr;
+}
+
+/* Memory is reclaimed when the arena is reset. */
+static void s_arena_mem_release(struct aws_allocator *allocator, void *ptr) {
+    (void)allocator;
+    (void)ptr;
+}
+
+static void *s_arena_mem_realloc(struct aws_allocator *allocator, void *oldptr, size_t oldsize, size_t newsize) {
+    struct aws_nitro_enclaves_arena *arena = allocator->impl;
+
+    if (oldptr == NULL) {
+        return s_arena_mem_acquire(allocator, newsize);
+    }
+    if (newsize <= oldsize) {
+        return oldptr;
+    }
+
+    /* The most recent allocation grows in place while its block has room. */
+    struct arena_block *block = arena->blocks;
+    if (oldptr == arena->last && newsize <= SIZE_MAX - (ARENA_ALIGNMENT - 1)) {
+        size_t aligned_size = s_align_up(newsize);
+        size_t available = block->capacity - block->used + arena->last_size;
+        if (aligned_size <= available) {
+            block->used += aligned_size - arena->last_size;
+            arena->last_size = aligned_size;
+            return oldptr;
+        }
+    }
+
+    void *newptr = s_arena_mem_acquire(allocator, newsize);
+    if (newptr == NULL) {
+        return NULL;
+    }
+    memcpy(newptr, oldptr, oldsize);
+
+    return newptr;
+}
+
+static void *s_arena_mem_calloc(struct aws_allocator *allocator, size_t num, size_t size) {
+    if (size != 0 && num > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void *ptr = s_arena_mem_acquire(allocator, num * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, num * size);
+    }
+
+    return ptr;
+}
+
+struct aws_nitro_enclaves_arena *aws_nitro_enclaves_arena_new(struct aws_allocator *allocator, size_t block_size) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(block_size > 0);
+
+    struct aws_nitro_enclaves_arena *arena = aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->allocator.mem_acquire = s_arena_mem_acquire;
+    arena->allocator.mem_release = s_arena_mem_release;
+    arena->allocator.mem_realloc = s_arena_mem_realloc;
+    arena->allocator.mem_calloc = s_arena_mem_calloc;
+    arena->allocator.impl = arena;
+    arena->parent = allocator;
+    arena->block_size = s_align_up(block_size);
+
+    /* The first block is allocated up front, so the first use of the arena costs no allocation. */
+    arena->blocks = s_block_new(allocator, arena->block_size);
+    if (arena->blocks == NULL) {
+        aws_mem_release(allocator, arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+void aws_nitro_enclaves_arena_destroy(struct aws_nitro_enclaves_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    while (arena->blocks != NULL) {
+        struct arena_block *block = arena->blocks;
+        arena->blocks = block->next;
+        s_block_destroy(arena->parent, block);
+    }
+    aws_mem_release(arena->parent, arena);
+}
+
+struct aws_allocator *aws_nitro_enclaves_arena_allocator(struct aws_nitro_enclaves_arena *arena) {
+    AWS_PRECONDITION(arena);
+
+    return &arena->allocator;
+}
+
+void aws_nitro_enclaves_arena_reset(struct aws_nitro_enclaves_arena *arena) {
+    AWS_PRECONDITION(arena);
+
+    arena->last = NULL;
+    arena->last_size = 0;
+
+    struct arena_block *block = arena->blocks;
+    if (block == NULL || block->next == NULL) {
+        if (block != NULL) {
+            aws_secure_zero(s_block_data(block), block->used);
+            block->used = 0;
+        }
+        return;
+    }
+
+    /* Several blocks were needed: size a single block for that usage, so the next use fits in it. */
+    size_t total = 0;
+    while (arena->blocks != NULL) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        total = total > SIZE_MAX - block->used ? SIZE_MAX : total + block->used;
+        s_block_destroy(arena->parent, block);
+    }
+
+    /* On failure the arena starts without a block and allocates one on first use. */
+    arena->blocks = s_block_new(arena->parent, AWS_MAX(arena->block_size, s_align_up(total)));
+}
+
+static void s_arena_pool_push_or_destroy(struct aws_nitro_enclaves_arena *arena) {
+    struct aws_nitro_enclaves_arena_pool *pool = arena->pool;
+
+    bool pooled = false;
+    aws_mutex_lock(&pool->mutex);
+    if (pool->count < pool->max_pooled) {
+        aws_linked_list_push_back(&pool->arenas, &arena->pool_node);
+        pool->count++;
+        pooled = true;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    if (!pooled) {
+        aws_nitro_enclaves_arena_destroy(arena);
+    }
+}
+
+struct aws_nitro_enclaves_arena_pool *aws_nitro_enclaves_arena_pool_new(
+    struct aws_allocator *allocator,
+    size_t block_size,
+    size_t max_pooled) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(block_size > 0);
+
+    struct aws_nitro_enclaves_arena_pool *pool =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_arena_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->allocator = allocator;
+    pool->block_size = block_size;
+    pool->max_pooled = max_pooled;
+    if (aws_mutex_init(&pool->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+    aws_linked_list_init(&pool->arenas);
+
+    return pool;
+}
+
+void aws_nitro_enclaves_arena_pool_destroy(struct aws_nitro_enclaves_arena_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    while (!aws_linked_list_empty(&pool->arenas)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->arenas);
+        aws_nitro_enclaves_arena_destroy(AWS_CONTAINER_OF(node, struct aws_nitro_enclaves_arena, pool_node));
+    }
+    aws_mutex_clean_up(&pool->mutex);
+    aws_mem_release(pool->allocator, pool);
+}
+
+struct aws_nitro_enclaves_arena *aws_nitro_enclaves_arena_pool_get(struct aws_nitro_enclaves_arena_pool *pool) {
+    AWS_PRECONDITION(pool);
+
+    struct aws_nitro_enclaves_arena *arena = NULL;
+    aws_mutex_lock(&pool->mutex);
+    if (!aws_linked_list_empty(&pool->arenas)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->arenas);
+        arena = AWS_CONTAINER_OF(node, struct aws_nitro_enclaves_arena, pool_node);
+        pool->count--;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    if (arena == NULL) {
+        arena = aws_nitro_enclaves_arena_new(pool->allocator, pool->block_size);
+        if (arena == NULL) {
+            return NULL;
+        }
+        arena->pool = pool;
+    }
+
+    return arena;
+}
+
+void aws_nitro_enclaves_arena_release(struct aws_nitro_enclaves_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    if (arena->pool == NULL) {
+        aws_nitro_enclaves_arena_destroy(arena);
+        return;
+    }
+
+    aws_nitro_enclaves_arena_reset(arena);
+    s_arena_pool_push_or_destroy(arena);
+}
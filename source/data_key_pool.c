@@ -0,0 +1,473 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/data_key_pool.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/data_key_pool.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/logging.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+
+#include <inttypes.h>
+
+#define DEFAULT_KEYS_PER_SPEC 16
+#define DEFAULT_MAX_CONCURRENT_REFILLS 2
+#define DEFAULT_KEY_TTL_MS (5 * 60 * 1000)
+#define DEFAULT_IDLE_TIMEOUT_MS (10 * 60 * 1000)
+
+/* Interval at which idle refill threads wake up to wipe expired keys and drop idle queues. */
+#define SWEEP_INTERVAL_MS 1000
+/* Time a key id and key spec are left alone after a failed refill, doubled with every further failure. */
+#define REFILL_RETRY_DELAY_MS 1000
+#define REFILL_MAX_RETRY_DELAY_MS 60000
+
+struct data_key {
+    struct aws_linked_list_node node;
+    struct aws_byte_buf plaintext;
+    struct aws_byte_buf ciphertext_blob;
+    uint64_t expires_at_ns;
+};
+
+/* The ready keys of one key id and key spec, oldest first. */
+struct data_key_queue {
+    struct aws_linked_list_node node;
+    struct aws_string *key_id;
+    enum aws_key_spec key_spec;
+    struct aws_linked_list keys;
+    size_t count;
+    size_t in_flight;
+    uint64_t retry_at_ns;
+    size_t failures;
+    /* When the queue was last warmed or acquired from. */
+    uint64_t last_used_ns;
+};
+
+struct aws_nitro_enclaves_data_key_pool {
+    struct aws_allocator *allocator;
+    struct aws_nitro_enclaves_kms_client *client;
+    aws_nitro_enclaves_data_key_pool_generate_fn *generate_data_key;
+    void *user_data;
+    size_t keys_per_spec;
+    uint64_t key_ttl_ns;
+    uint64_t idle_timeout_ns;
+
+    struct aws_thread *threads;
+    size_t thread_count;
+
+    /* Everything below is protected by mutex. Queues are removed once idle with no refill in flight. */
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+    struct aws_linked_list queues;
+    bool stopping;
+};
+
+static uint64_t s_now_ns(void) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    return now_ns;
+}
+
+static void s_data_key_destroy(struct aws_allocator *allocator, struct data_key *key) {
+    aws_byte_buf_clean_up_secure(&key->plaintext);
+    aws_byte_buf_clean_up(&key->ciphertext_blob);
+    aws_mem_release(allocator, key);
+}
+
+static int s_kms_generate_data_key(
+    void *user_data,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec,
+    struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
+    return aws_kms_generate_data_key_blocking(user_data, key_id, key_spec, plaintext, ciphertext_blob);
+}
+
+uint64_t aws_nitro_enclaves_data_key_pool_refill_delay_ms(size_t failures) {
+    uint64_t delay_ms = REFILL_RETRY_DELAY_MS;
+    for (size_t i = 1; i < failures && delay_ms < REFILL_MAX_RETRY_DELAY_MS; ++i) {
+        delay_ms *= 2;
+    }
+
+    return AWS_MIN(delay_ms, REFILL_MAX_RETRY_DELAY_MS);
+}
+
+static struct data_key *s_data_key_generate(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec) {
+    struct data_key *key = aws_mem_calloc(pool->allocator, 1, sizeof(struct data_key));
+    if (key == NULL) {
+        return NULL;
+    }
+
+    if (pool->generate_data_key(pool->user_data, key_id, key_spec, &key->plaintext, &key->ciphertext_blob) !=
+        AWS_OP_SUCCESS) {
+        aws_mem_release(pool->allocator, key);
+        return NULL;
+    }
+    key->expires_at_ns = s_now_ns() + pool->key_ttl_ns;
+
+    return key;
+}
+
+/* Must be called with the mutex held. */
+static struct data_key_queue *s_find_queue_synced(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec) {
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&pool->queues);
+         node != aws_linked_list_end(&pool->queues);
+         node = aws_linked_list_next(node)) {
+        struct data_key_queue *queue = AWS_CONTAINER_OF(node, struct data_key_queue, node);
+        if (queue->key_spec == key_spec && aws_string_eq(queue->key_id, key_id)) {
+            return queue;
+        }
+    }
+
+    return NULL;
+}
+
+/* Must be called with the mutex held. */
+static struct data_key_queue *s_get_queue_synced(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec) {
+    struct data_key_queue *queue = s_find_queue_synced(pool, key_id, key_spec);
+    if (queue != NULL) {
+        return queue;
+    }
+
+    queue = aws_mem_calloc(pool->allocator, 1, sizeof(struct data_key_queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    queue->key_id = aws_string_new_from_string(pool->allocator, key_id);
+    if (queue->key_id == NULL) {
+        aws_mem_release(pool->allocator, queue);
+        return NULL;
+    }
+    queue->key_spec = key_spec;
+    queue->last_used_ns = s_now_ns();
+    aws_linked_list_init(&queue->keys);
+    aws_linked_list_push_back(&pool->queues, &queue->node);
+
+    return queue;
+}
+
+/* Must be called with the mutex held. Wipes the expired keys at the front of a queue. */
+static void s_expire_keys_synced(struct aws_nitro_enclaves_data_key_pool *pool, struct data_key_queue *queue) {
+    uint64_t now_ns = s_now_ns();
+    while (!aws_linked_list_empty(&queue->keys)) {
+        struct data_key *key = AWS_CONTAINER_OF(aws_linked_list_front(&queue->keys), struct data_key, node);
+        if (key->expires_at_ns > now_ns) {
+            break;
+        }
+        aws_linked_list_remove(&key->node);
+        queue->count--;
+        s_data_key_destroy(pool->allocator, key);
+    }
+}
+
+/* Must be called with the mutex held. */
+static bool s_queue_is_idle_synced(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    struct data_key_queue *queue,
+    uint64_t now_ns) {
+    return now_ns - queue->last_used_ns >= pool->idle_timeout_ns;
+}
+
+/* Wipes the keys of a queue that is no longer in the pool, and frees it. */
+static void s_queue_destroy(struct aws_nitro_enclaves_data_key_pool *pool, struct data_key_queue *queue) {
+    while (!aws_linked_list_empty(&queue->keys)) {
+        s_data_key_destroy(
+            pool->allocator, AWS_CONTAINER_OF(aws_linked_list_pop_front(&queue->keys), struct data_key, node));
+    }
+    aws_string_destroy(queue->key_id);
+    aws_mem_release(pool->allocator, queue);
+}
+
+/*
+ * Must be called with the mutex held. Wipes the expired keys of every queue, and drops the idle
+ * queues that no refill thread is using.
+ */
+static void s_sweep_synced(struct aws_nitro_enclaves_data_key_pool *pool) {
+    uint64_t now_ns = s_now_ns();
+    struct aws_linked_list_node *node = aws_linked_list_begin(&pool->queues);
+    while (node != aws_linked_list_end(&pool->queues)) {
+        struct data_key_queue *queue = AWS_CONTAINER_OF(node, struct data_key_queue, node);
+        node = aws_linked_list_next(node);
+
+        if (queue->in_flight == 0 && s_queue_is_idle_synced(pool, queue, now_ns)) {
+            aws_linked_list_remove(&queue->node);
+            s_queue_destroy(pool, queue);
+            continue;
+        }
+        s_expire_keys_synced(pool, queue);
+    }
+}
+
+/* Must be called with the mutex held. The active queue missing the most keys, or NULL if none is. */
+static struct data_key_queue *s_next_refill_queue_synced(struct aws_nitro_enclaves_data_key_pool *pool) {
+    struct data_key_queue *next = NULL;
+    size_t next_missing = 0;
+    uint64_t now_ns = s_now_ns();
+
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&pool->queues);
+         node != aws_linked_list_end(&pool->queues);
+         node = aws_linked_list_next(node)) {
+        struct data_key_queue *queue = AWS_CONTAINER_OF(node, struct data_key_queue, node);
+        size_t pending = queue->count + queue->in_flight;
+        if (pending >= pool->keys_per_spec || queue->retry_at_ns > now_ns ||
+            s_queue_is_idle_synced(pool, queue, now_ns)) {
+            continue;
+        }
+        if (pool->keys_per_spec - pending > next_missing) {
+            next = queue;
+            next_missing = pool->keys_per_spec - pending;
+        }
+    }
+
+    return next;
+}
+
+static bool s_has_work(void *arg) {
+    struct aws_nitro_enclaves_data_key_pool *pool = arg;
+    return pool->stopping || s_next_refill_queue_synced(pool) != NULL;
+}
+
+static void s_refill_thread_main(void *arg) {
+    struct aws_nitro_enclaves_data_key_pool *pool = arg;
+    int64_t sweep_interval_ns =
+        (int64_t)aws_timestamp_convert(SWEEP_INTERVAL_MS, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+
+    aws_mutex_lock(&pool->mutex);
+    while (!pool->stopping) {
+        s_sweep_synced(pool);
+
+        struct data_key_queue *queue = s_next_refill_queue_synced(pool);
+        if (queue == NULL) {
+            /* Wakes up on timeout to wipe the keys that expire and drop the queues that idle in the meantime. */
+            aws_condition_variable_wait_for_pred(&pool->c_var, &pool->mutex, sweep_interval_ns, s_has_work, pool);
+            continue;
+        }
+
+        /* The call runs without the mutex; the queue is not dropped while a refill is in flight. */
+        queue->in_flight++;
+        aws_mutex_unlock(&pool->mutex);
+        struct data_key *key = s_data_key_generate(pool, queue->key_id, queue->key_spec);
+        int error_code = key == NULL ? aws_last_error() : AWS_OP_SUCCESS;
+        aws_mutex_lock(&pool->mutex);
+        queue->in_flight--;
+
+        if (key != NULL) {
+            aws_linked_list_push_back(&queue->keys, &key->node);
+            queue->count++;
+            queue->failures = 0;
+        } else {
+            queue->failures++;
+            uint64_t delay_ms = aws_nitro_enclaves_data_key_pool_refill_delay_ms(queue->failures);
+            queue->retry_at_ns =
+                s_now_ns() + aws_timestamp_convert(delay_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+            AWS_LOGF_WARN(
+                AWS_LS_NITRO_ENCLAVES_KMS,
+                "id=%p: Data key pool refill failed, retrying in %" PRIu64 " ms: %s.",
+                (void *)pool,
+                delay_ms,
+                aws_error_debug_str(error_code));
+        }
+    }
+    aws_mutex_unlock(&pool->mutex);
+}
+
+static void s_data_key_pool_clean_up(struct aws_nitro_enclaves_data_key_pool *pool) {
+    while (!aws_linked_list_empty(&pool->queues)) {
+        s_queue_destroy(pool, AWS_CONTAINER_OF(aws_linked_list_pop_front(&pool->queues), struct data_key_queue, node));
+    }
+
+    aws_condition_variable_clean_up(&pool->c_var);
+    aws_mutex_clean_up(&pool->mutex);
+    aws_mem_release(pool->allocator, pool->threads);
+    aws_mem_release(pool->allocator, pool);
+}
+
+/* Stops and joins the first thread_count threads. */
+static void s_stop_threads(struct aws_nitro_enclaves_data_key_pool *pool, size_t thread_count) {
+    aws_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    aws_condition_variable_notify_all(&pool->c_var);
+    aws_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        aws_thread_join(&pool->threads[i]);
+        aws_thread_clean_up(&pool->threads[i]);
+    }
+}
+
+struct aws_nitro_enclaves_data_key_pool *aws_nitro_enclaves_data_key_pool_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_data_key_pool_options *options) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(options != NULL);
+
+    if (options->client == NULL && options->generate_data_key == NULL) {
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    struct aws_nitro_enclaves_data_key_pool *pool =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_data_key_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->allocator = allocator;
+    pool->client = options->client;
+    if (options->generate_data_key != NULL) {
+        pool->generate_data_key = options->generate_data_key;
+        pool->user_data = options->user_data;
+    } else {
+        pool->generate_data_key = s_kms_generate_data_key;
+        pool->user_data = options->client;
+    }
+    pool->keys_per_spec = options->keys_per_spec != 0 ? options->keys_per_spec : DEFAULT_KEYS_PER_SPEC;
+    pool->thread_count =
+        options->max_concurrent_refills != 0 ? options->max_concurrent_refills : DEFAULT_MAX_CONCURRENT_REFILLS;
+    pool->key_ttl_ns = aws_timestamp_convert(
+        options->key_ttl_ms != 0 ? options->key_ttl_ms : DEFAULT_KEY_TTL_MS,
+        AWS_TIMESTAMP_MILLIS,
+        AWS_TIMESTAMP_NANOS,
+        NULL);
+    pool->idle_timeout_ns = aws_timestamp_convert(
+        options->idle_timeout_ms != 0 ? options->idle_timeout_ms : DEFAULT_IDLE_TIMEOUT_MS,
+        AWS_TIMESTAMP_MILLIS,
+        AWS_TIMESTAMP_NANOS,
+        NULL);
+    aws_linked_list_init(&pool->queues);
+
+    if (aws_mutex_init(&pool->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+    if (aws_condition_variable_init(&pool->c_var) != AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&pool->mutex);
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+
+    pool->threads = aws_mem_calloc(allocator, pool->thread_count, sizeof(struct aws_thread));
+    if (pool->threads == NULL) {
+        s_data_key_pool_clean_up(pool);
+        return NULL;
+    }
+    for (size_t i = 0; i < pool->thread_count; ++i) {
+        if (aws_thread_init(&pool->threads[i], allocator) != AWS_OP_SUCCESS) {
+            s_stop_threads(pool, i);
+            s_data_key_pool_clean_up(pool);
+            return NULL;
+        }
+        if (aws_thread_launch(&pool->threads[i], s_refill_thread_main, pool, NULL) != AWS_OP_SUCCESS) {
+            aws_thread_clean_up(&pool->threads[i]);
+            s_stop_threads(pool, i);
+            s_data_key_pool_clean_up(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void aws_nitro_enclaves_data_key_pool_destroy(struct aws_nitro_enclaves_data_key_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    s_stop_threads(pool, pool->thread_count);
+    s_data_key_pool_clean_up(pool);
+}
+
+int aws_nitro_enclaves_data_key_pool_warm(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec) {
+    AWS_PRECONDITION(pool != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+
+    aws_mutex_lock(&pool->mutex);
+    struct data_key_queue *queue = s_get_queue_synced(pool, key_id, key_spec);
+    if (queue != NULL) {
+        queue->last_used_ns = s_now_ns();
+    }
+    aws_mutex_unlock(&pool->mutex);
+    if (queue == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    aws_condition_variable_notify_all(&pool->c_var);
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_data_key_pool_acquire(
+    struct aws_nitro_enclaves_data_key_pool *pool,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec,
+    struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
+    AWS_PRECONDITION(pool != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+    AWS_PRECONDITION(plaintext != NULL);
+    AWS_PRECONDITION(ciphertext_blob != NULL);
+
+    struct data_key *key = NULL;
+    bool refill = false;
+
+    aws_mutex_lock(&pool->mutex);
+    struct data_key_queue *queue = s_get_queue_synced(pool, key_id, key_spec);
+    if (queue != NULL) {
+        queue->last_used_ns = s_now_ns();
+        s_expire_keys_synced(pool, queue);
+        if (!aws_linked_list_empty(&queue->keys)) {
+            key = AWS_CONTAINER_OF(aws_linked_list_pop_front(&queue->keys), struct data_key, node);
+            queue->count--;
+        }
+        refill = queue->count + queue->in_flight < pool->keys_per_spec;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    if (refill) {
+        aws_condition_variable_notify_one(&pool->c_var);
+    }
+
+    if (key == NULL) {
+        /* Nothing ready: the caller pays for the round trip, as without the pool. */
+        return pool->generate_data_key(pool->user_data, key_id, key_spec, plaintext, ciphertext_blob);
+    }
+
+    /* Hand the buffers over; the caller owns and wipes them. */
+    *plaintext = key->plaintext;
+    *ciphertext_blob = key->ciphertext_blob;
+    aws_mem_release(pool->allocator, key);
+
+    return AWS_OP_SUCCESS;
+}
+
+size_t aws_nitro_enclaves_data_key_pool_queue_count(struct aws_nitro_enclaves_data_key_pool *pool) {
+    AWS_PRECONDITION(pool != NULL);
+
+    aws_mutex_lock(&pool->mutex);
+    size_t count = 0;
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&pool->queues);
+         node != aws_linked_list_end(&pool->queues);
+         node = aws_linked_list_next(node)) {
+        count++;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    return count;
+}
@@ -0,0 +1,269 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/drbg.h>
+#include <aws/nitro_enclaves/kms.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/drbg.h>
+#include <aws/nitro_enclaves/internal/hmac_drbg.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/logging.h>
+#include <aws/common/math.h>
+#include <aws/common/mutex.h>
+
+#include <nsm.h>
+
+#include <inttypes.h>
+
+#define DEFAULT_RESEED_BYTES (1024 * 1024)
+#define DEFAULT_RESEED_INTERVAL_MS 60000
+#define DEFAULT_RESEED_RETRY_INTERVAL_MS 1000
+#define DEFAULT_MAX_BYTES_FACTOR 4
+
+/* Bytes taken from each source: 256 bits of entropy input and a 128-bit nonce. */
+#define SEED_SOURCE_LEN 48
+
+struct aws_nitro_enclaves_drbg {
+    struct aws_allocator *allocator;
+    struct aws_nitro_enclaves_kms_client *kms_client;
+    aws_nitro_enclaves_drbg_seed_fn *seed_fn;
+    void *seed_user_data;
+    size_t reseed_bytes;
+    uint64_t reseed_interval_ns;
+    uint64_t reseed_retry_interval_ns;
+    size_t max_bytes_without_reseed;
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_nitro_enclaves_hmac_drbg state;
+    size_t bytes_since_reseed;
+    uint64_t reseed_at_ns;
+    /* No reseed is attempted before this time, set after a failed reseed. */
+    uint64_t retry_at_ns;
+    bool is_reseeding;
+};
+
+/* Appends len bytes, at most SEED_SOURCE_LEN, from NSM. */
+static int s_append_nsm_random(void *user_data, struct aws_byte_buf *seed, size_t len) {
+    (void)user_data;
+    AWS_FATAL_ASSERT(len <= SEED_SOURCE_LEN);
+
+    int nsm_fd = nsm_lib_init();
+    if (nsm_fd < 0) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    size_t end = seed->len + len;
+    while (seed->len < end) {
+        uint8_t buf[SEED_SOURCE_LEN];
+        size_t buf_len = end - seed->len;
+
+        /* NSM may yield fewer bytes than requested. */
+        int rc = nsm_get_random(nsm_fd, buf, &buf_len);
+        if (rc || buf_len == 0) {
+            nsm_lib_exit(nsm_fd);
+            return aws_raise_error(AWS_ERROR_INVALID_STATE);
+        }
+        aws_byte_buf_write(seed, buf, AWS_MIN(buf_len, end - seed->len));
+        aws_secure_zero(buf, sizeof(buf));
+    }
+
+    nsm_lib_exit(nsm_fd);
+    return AWS_OP_SUCCESS;
+}
+
+/* Appends SEED_SOURCE_LEN bytes from KMS GenerateRandom. */
+static int s_append_kms_random(struct aws_nitro_enclaves_kms_client *kms_client, struct aws_byte_buf *seed) {
+    struct aws_byte_buf random;
+    if (aws_kms_generate_random_blocking(kms_client, SEED_SOURCE_LEN, &random) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    bool written = random.len == SEED_SOURCE_LEN && aws_byte_buf_write_from_whole_buffer(seed, random);
+    aws_byte_buf_clean_up_secure(&random);
+
+    return written ? AWS_OP_SUCCESS : aws_raise_error(AWS_ERROR_INVALID_STATE);
+}
+
+/*
+ * Gathers the seed material: NSM (or injected seed source) output followed by KMS output. Each source alone provides the full
+ * security strength, so the seed stays sound if one of them is weak. Runs without the mutex.
+ */
+static int s_gather_seed(struct aws_nitro_enclaves_drbg *drbg, struct aws_byte_buf *seed) {
+    size_t start = seed->len;
+    if (drbg->seed_fn(drbg->seed_user_data, seed, SEED_SOURCE_LEN) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (seed->len != start + SEED_SOURCE_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+    if (drbg->kms_client != NULL && s_append_kms_random(drbg->kms_client, seed) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Must be called with the mutex held. */
+static void s_reset_reseed_policy_synced(struct aws_nitro_enclaves_drbg *drbg) {
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    drbg->bytes_since_reseed = 0;
+    drbg->reseed_at_ns = now_ns + drbg->reseed_interval_ns;
+    drbg->retry_at_ns = 0;
+}
+
+int aws_nitro_enclaves_drbg_reseed(struct aws_nitro_enclaves_drbg *drbg) {
+    AWS_PRECONDITION(drbg != NULL);
+
+    uint8_t seed_storage[2 * SEED_SOURCE_LEN];
+    struct aws_byte_buf seed = aws_byte_buf_from_empty_array(seed_storage, sizeof(seed_storage));
+
+    int rc = s_gather_seed(drbg, &seed);
+    if (rc == AWS_OP_SUCCESS) {
+        aws_mutex_lock(&drbg->mutex);
+        rc = aws_nitro_enclaves_hmac_drbg_reseed(&drbg->state, aws_byte_cursor_from_buf(&seed));
+        if (rc == AWS_OP_SUCCESS) {
+            s_reset_reseed_policy_synced(drbg);
+        }
+        aws_mutex_unlock(&drbg->mutex);
+    }
+
+    aws_secure_zero(seed_storage, sizeof(seed_storage));
+    return rc;
+}
+
+struct aws_nitro_enclaves_drbg *aws_nitro_enclaves_drbg_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_drbg_options *options) {
+    return aws_nitro_enclaves_drbg_new_with_seed_source(allocator, options, s_append_nsm_random, NULL);
+}
+
+struct aws_nitro_enclaves_drbg *aws_nitro_enclaves_drbg_new_with_seed_source(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_drbg_options *options,
+    aws_nitro_enclaves_drbg_seed_fn *seed_fn,
+    void *user_data) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(seed_fn != NULL);
+
+    struct aws_nitro_enclaves_drbg *drbg = aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_drbg));
+    if (drbg == NULL) {
+        return NULL;
+    }
+
+    drbg->allocator = allocator;
+    drbg->kms_client = options != NULL ? options->kms_client : NULL;
+    drbg->seed_fn = seed_fn;
+    drbg->seed_user_data = user_data;
+    drbg->reseed_bytes = options != NULL && options->reseed_bytes != 0 ? options->reseed_bytes : DEFAULT_RESEED_BYTES;
+    uint64_t reseed_interval_ms = options != NULL && options->reseed_interval_ms != 0 ? options->reseed_interval_ms
+                                                                                       : DEFAULT_RESEED_INTERVAL_MS;
+    drbg->reseed_interval_ns =
+        aws_timestamp_convert(reseed_interval_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    uint64_t reseed_retry_interval_ms = options != NULL && options->reseed_retry_interval_ms != 0
+                                            ? options->reseed_retry_interval_ms
+                                            : DEFAULT_RESEED_RETRY_INTERVAL_MS;
+    drbg->reseed_retry_interval_ns =
+        aws_timestamp_convert(reseed_retry_interval_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    size_t max_bytes_without_reseed = options != NULL && options->max_bytes_without_reseed != 0
+                                          ? options->max_bytes_without_reseed
+                                          : aws_mul_size_saturating(drbg->reseed_bytes, DEFAULT_MAX_BYTES_FACTOR);
+    drbg->max_bytes_without_reseed = AWS_MAX(max_bytes_without_reseed, drbg->reseed_bytes);
+
+    if (aws_mutex_init(&drbg->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, drbg);
+        return NULL;
+    }
+
+    uint8_t seed_storage[2 * SEED_SOURCE_LEN];
+    struct aws_byte_buf seed = aws_byte_buf_from_empty_array(seed_storage, sizeof(seed_storage));
+    int rc = s_gather_seed(drbg, &seed);
+    if (rc == AWS_OP_SUCCESS) {
+        rc = aws_nitro_enclaves_hmac_drbg_init(&drbg->state, aws_byte_cursor_from_buf(&seed));
+    }
+    aws_secure_zero(seed_storage, sizeof(seed_storage));
+    if (rc != AWS_OP_SUCCESS) {
+        aws_nitro_enclaves_drbg_destroy(drbg);
+        return NULL;
+    }
+    s_reset_reseed_policy_synced(drbg);
+
+    return drbg;
+}
+
+void aws_nitro_enclaves_drbg_destroy(struct aws_nitro_enclaves_drbg *drbg) {
+    if (drbg == NULL) {
+        return;
+    }
+
+    aws_nitro_enclaves_hmac_drbg_clean_up(&drbg->state);
+    aws_mutex_clean_up(&drbg->mutex);
+    aws_mem_release(drbg->allocator, drbg);
+}
+
+int aws_nitro_enclaves_drbg_random_buffer(struct aws_nitro_enclaves_drbg *drbg, struct aws_byte_buf *output) {
+    AWS_PRECONDITION(drbg != NULL);
+    AWS_PRECONDITION(aws_byte_buf_is_valid(output));
+
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+
+    /* A single caller reseeds; the others keep generating from the current state in the meantime. */
+    aws_mutex_lock(&drbg->mutex);
+    bool reseed = !drbg->is_reseeding && now_ns >= drbg->retry_at_ns &&
+                  (drbg->bytes_since_reseed >= drbg->reseed_bytes || now_ns >= drbg->reseed_at_ns);
+    if (reseed) {
+        drbg->is_reseeding = true;
+    }
+    aws_mutex_unlock(&drbg->mutex);
+
+    if (reseed) {
+        bool reseeded = aws_nitro_enclaves_drbg_reseed(drbg) == AWS_OP_SUCCESS;
+        if (!reseeded) {
+            AWS_LOGF_WARN(
+                AWS_LS_NITRO_ENCLAVES_GENERAL,
+                "id=%p: DRBG reseed failed, retrying in %" PRIu64 " ms: %s.",
+                (void *)drbg,
+                aws_timestamp_convert(
+                    drbg->reseed_retry_interval_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL),
+                aws_error_debug_str(aws_last_error()));
+        }
+        aws_mutex_lock(&drbg->mutex);
+        drbg->is_reseeding = false;
+        if (!reseeded) {
+            drbg->retry_at_ns = now_ns + drbg->reseed_retry_interval_ns;
+        }
+        aws_mutex_unlock(&drbg->mutex);
+    }
+
+    int rc = AWS_OP_SUCCESS;
+    aws_mutex_lock(&drbg->mutex);
+    /* The whole request counts against the cap, so that no single call generates past it. */
+    size_t requested = output->capacity - output->len;
+    if (aws_add_size_saturating(drbg->bytes_since_reseed, requested) > drbg->max_bytes_without_reseed) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_GENERAL,
+            "id=%p: DRBG generated %zu bytes without a successful reseed, refusing to generate %zu more.",
+            (void *)drbg,
+            drbg->bytes_since_reseed,
+            requested);
+        rc = aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+    while (rc == AWS_OP_SUCCESS && output->len < output->capacity) {
+        size_t len = AWS_MIN(output->capacity - output->len, AWS_NITRO_ENCLAVES_HMAC_DRBG_MAX_GENERATE);
+        rc = aws_nitro_enclaves_hmac_drbg_generate(&drbg->state, output->buffer + output->len, len);
+        if (rc != AWS_OP_SUCCESS) {
+            break;
+        }
+        output->len += len;
+        drbg->bytes_since_reseed += len;
+    }
+    aws_mutex_unlock(&drbg->mutex);
+
+    return rc;
+}
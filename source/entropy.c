@@ -0,0 +1,341 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/entropy.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/logging.h>
+#include <aws/common/math.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+#include <aws/common/zero.h>
+
+#include <fcntl.h>
+#include <linux/random.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <nsm.h>
+
+/* Maximum number of bytes NSM random response returns. */
+#define NSM_RANDOM_REQ_SIZE (256)
+
+/* Maximum number of bytes credited by one RNDADDENTROPY ioctl. */
+#define ENTROPY_BATCH_SIZE (1024)
+
+/* Maximum number of batches fed in one check, in case the kernel credits less than it is given. */
+#define MAX_FEEDS_PER_CHECK (4)
+
+#define DEFAULT_INITIAL_BYTES (1024)
+#define DEFAULT_TARGET_BITS (256)
+#define DEFAULT_CHECK_INTERVAL_MS (1000)
+
+#define POOL_SIZE_PATH "/proc/sys/kernel/random/poolsize"
+
+static int s_devices_open(void *user_data) {
+    struct aws_nitro_enclaves_entropy_devices *devices = user_data;
+    devices->nsm_fd = nsm_lib_init();
+    devices->random_fd = open("/dev/random", O_WRONLY);
+    return devices->nsm_fd < 0 || devices->random_fd < 0 ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+static void s_devices_close(void *user_data) {
+    struct aws_nitro_enclaves_entropy_devices *devices = user_data;
+    if (devices->random_fd >= 0) {
+        close(devices->random_fd);
+    }
+    if (devices->nsm_fd >= 0) {
+        nsm_lib_exit(devices->nsm_fd);
+    }
+    devices->nsm_fd = -1;
+    devices->random_fd = -1;
+}
+
+static int s_devices_get_random(void *user_data, uint8_t *buf, size_t *len) {
+    struct aws_nitro_enclaves_entropy_devices *devices = user_data;
+    return nsm_get_random(devices->nsm_fd, buf, len) ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+static int s_devices_get_entropy_count(void *user_data, int *bits) {
+    struct aws_nitro_enclaves_entropy_devices *devices = user_data;
+    return ioctl(devices->random_fd, RNDGETENTCNT, bits) < 0 ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+static int s_devices_add_entropy(void *user_data, const struct rand_pool_info *pool) {
+    struct aws_nitro_enclaves_entropy_devices *devices = user_data;
+    return ioctl(devices->random_fd, RNDADDENTROPY, pool) < 0 ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+void aws_nitro_enclaves_entropy_source_init_devices(
+    struct aws_nitro_enclaves_entropy_source *source,
+    struct aws_nitro_enclaves_entropy_devices *devices) {
+    /* The devices are only written by open and close: a running feeder keeps its own. */
+    source->open = s_devices_open;
+    source->close = s_devices_close;
+    source->get_random = s_devices_get_random;
+    source->get_entropy_count = s_devices_get_entropy_count;
+    source->add_entropy = s_devices_add_entropy;
+    source->user_data = devices;
+}
+
+int aws_nitro_enclaves_entropy_feed(const struct aws_nitro_enclaves_entropy_source *source, size_t num_bytes) {
+    /* struct rand_pool_info followed by its buffer, aligned for the __u32 array it ends with. */
+    uint32_t storage[(sizeof(struct rand_pool_info) + ENTROPY_BATCH_SIZE) / sizeof(uint32_t)];
+    struct rand_pool_info *pool = (struct rand_pool_info *)storage;
+    uint8_t *batch = (uint8_t *)pool->buf;
+    int rc = AWS_OP_SUCCESS;
+
+    size_t count = 0;
+    while (count < num_bytes) {
+        size_t batch_len = AWS_MIN(num_bytes - count, ENTROPY_BATCH_SIZE);
+
+        /* Yields up to 256 bytes per request. */
+        size_t filled = 0;
+        while (filled < batch_len) {
+            size_t len = AWS_MIN(batch_len - filled, NSM_RANDOM_REQ_SIZE);
+            if (source->get_random(source->user_data, batch + filled, &len) != AWS_OP_SUCCESS || len == 0) {
+                /* NSM fails, or starts yielding zero entropy. */
+                rc = aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE);
+                goto finalize;
+            }
+            filled += len;
+        }
+
+        pool->entropy_count = (int)(batch_len * 8);
+        pool->buf_size = (int)batch_len;
+        if (source->add_entropy(source->user_data, pool) != AWS_OP_SUCCESS) {
+            rc = aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE);
+            goto finalize;
+        }
+        count += batch_len;
+    }
+
+finalize:
+    aws_secure_zero(storage, sizeof(storage));
+    return rc;
+}
+
+int aws_nitro_enclaves_library_seed_entropy(uint64_t num_bytes) {
+    struct aws_nitro_enclaves_entropy_devices devices;
+    struct aws_nitro_enclaves_entropy_source source;
+    aws_nitro_enclaves_entropy_source_init_devices(&source, &devices);
+
+    int rc = aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE);
+    if (source.open(source.user_data) == AWS_OP_SUCCESS) {
+        rc = aws_nitro_enclaves_entropy_feed(&source, (size_t)num_bytes);
+    }
+    source.close(source.user_data);
+
+    return rc;
+}
+
+/* The feeder is owned by the library, like the shared client bootstrap. */
+static struct aws_mutex s_feeder_mutex = AWS_MUTEX_INIT;
+static struct aws_condition_variable s_feeder_c_var = AWS_CONDITION_VARIABLE_INIT;
+static struct aws_thread s_feeder_thread;
+static struct aws_nitro_enclaves_entropy_feeder_options s_feeder_options;
+static struct aws_nitro_enclaves_entropy_source s_feeder_source;
+static struct aws_nitro_enclaves_entropy_devices s_feeder_devices;
+/* Protected by s_feeder_mutex. */
+static bool s_feeder_started = false;
+static bool s_feeder_stopping = false;
+static bool s_feeder_ready = false;
+static int s_feeder_error = AWS_OP_SUCCESS;
+
+static bool s_is_stopping(void *arg) {
+    (void)arg;
+    return s_feeder_stopping;
+}
+
+/* Stopping releases the waiters at once, without waiting for the thread to exit. */
+static bool s_is_ready_or_failed(void *arg) {
+    (void)arg;
+    return s_feeder_ready || s_feeder_error != AWS_OP_SUCCESS || !s_feeder_started || s_feeder_stopping;
+}
+
+/* The size of the kernel pool in bits, or 0 if unknown. */
+static uint32_t s_pool_size_bits(void) {
+    unsigned int pool_size = 0;
+    FILE *file = fopen(POOL_SIZE_PATH, "r");
+    if (file != NULL) {
+        if (fscanf(file, "%u", &pool_size) != 1) {
+            pool_size = 0;
+        }
+        fclose(file);
+    }
+    return pool_size;
+}
+
+/* Tops the kernel pool up to target_bits, feeding at least min_bytes. */
+static int s_top_up(const struct aws_nitro_enclaves_entropy_source *source, uint32_t target_bits, size_t min_bytes) {
+    for (size_t i = 0; i < MAX_FEEDS_PER_CHECK; ++i) {
+        int available_bits = 0;
+        if (source->get_entropy_count(source->user_data, &available_bits) != AWS_OP_SUCCESS) {
+            return aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE);
+        }
+
+        size_t missing_bytes = 0;
+        if (available_bits >= 0 && (uint32_t)available_bits < target_bits) {
+            missing_bytes = (target_bits - (uint32_t)available_bits + 7) / 8;
+        }
+        size_t num_bytes = AWS_MAX(missing_bytes, min_bytes);
+        if (num_bytes == 0) {
+            break;
+        }
+        if (aws_nitro_enclaves_entropy_feed(source, num_bytes) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        min_bytes = 0;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static void s_feeder_thread_main(void *arg) {
+    (void)arg;
+
+    const struct aws_nitro_enclaves_entropy_source *source = &s_feeder_source;
+    int error_code = AWS_OP_SUCCESS;
+    if (source->open(source->user_data) != AWS_OP_SUCCESS) {
+        error_code = AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE;
+    }
+
+    uint32_t target_bits = s_feeder_options.target_bits;
+    uint32_t pool_size_bits = s_pool_size_bits();
+    if (pool_size_bits != 0) {
+        target_bits = AWS_MIN(target_bits, pool_size_bits);
+    }
+    int64_t check_interval_ns = (int64_t)aws_timestamp_convert(
+        s_feeder_options.check_interval_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    size_t min_bytes = s_feeder_options.initial_bytes;
+
+    aws_mutex_lock(&s_feeder_mutex);
+    while (!s_feeder_stopping && error_code == AWS_OP_SUCCESS) {
+        aws_mutex_unlock(&s_feeder_mutex);
+        if (s_top_up(source, target_bits, min_bytes) != AWS_OP_SUCCESS) {
+            error_code = aws_last_error();
+        }
+        min_bytes = 0;
+        aws_mutex_lock(&s_feeder_mutex);
+
+        if (error_code == AWS_OP_SUCCESS && !s_feeder_ready) {
+            s_feeder_ready = true;
+            aws_condition_variable_notify_all(&s_feeder_c_var);
+        }
+        if (error_code == AWS_OP_SUCCESS) {
+            aws_condition_variable_wait_for_pred(
+                &s_feeder_c_var, &s_feeder_mutex, check_interval_ns, s_is_stopping, NULL);
+        }
+    }
+    if (error_code != AWS_OP_SUCCESS) {
+        s_feeder_error = error_code;
+        aws_condition_variable_notify_all(&s_feeder_c_var);
+    }
+    aws_mutex_unlock(&s_feeder_mutex);
+
+    if (error_code != AWS_OP_SUCCESS) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_GENERAL, "Entropy feeder stopped: %s.", aws_error_debug_str(error_code));
+    }
+
+    source->close(source->user_data);
+}
+
+int aws_nitro_enclaves_library_start_entropy_feeder(const struct aws_nitro_enclaves_entropy_feeder_options *options) {
+    struct aws_nitro_enclaves_entropy_source source;
+    aws_nitro_enclaves_entropy_source_init_devices(&source, &s_feeder_devices);
+    return aws_nitro_enclaves_entropy_feeder_start_with_source(options, &source);
+}
+
+int aws_nitro_enclaves_entropy_feeder_start_with_source(
+    const struct aws_nitro_enclaves_entropy_feeder_options *options,
+    const struct aws_nitro_enclaves_entropy_source *source) {
+    struct aws_allocator *allocator = aws_nitro_enclaves_get_allocator();
+    int rc = AWS_OP_SUCCESS;
+
+    aws_mutex_lock(&s_feeder_mutex);
+    if (s_feeder_started) {
+        goto finalize;
+    }
+
+    if (options != NULL) {
+        s_feeder_options = *options;
+    } else {
+        AWS_ZERO_STRUCT(s_feeder_options);
+    }
+    if (s_feeder_options.initial_bytes == 0) {
+        s_feeder_options.initial_bytes = DEFAULT_INITIAL_BYTES;
+    }
+    if (s_feeder_options.target_bits == 0) {
+        s_feeder_options.target_bits = DEFAULT_TARGET_BITS;
+    }
+    if (s_feeder_options.check_interval_ms == 0) {
+        s_feeder_options.check_interval_ms = DEFAULT_CHECK_INTERVAL_MS;
+    }
+    s_feeder_source = *source;
+
+    s_feeder_stopping = false;
+    s_feeder_ready = false;
+    s_feeder_error = AWS_OP_SUCCESS;
+    if (aws_thread_init(&s_feeder_thread, allocator) != AWS_OP_SUCCESS) {
+        rc = AWS_OP_ERR;
+        goto finalize;
+    }
+    if (aws_thread_launch(&s_feeder_thread, s_feeder_thread_main, NULL, NULL) != AWS_OP_SUCCESS) {
+        aws_thread_clean_up(&s_feeder_thread);
+        rc = AWS_OP_ERR;
+        goto finalize;
+    }
+    s_feeder_started = true;
+
+finalize:
+    aws_mutex_unlock(&s_feeder_mutex);
+    return rc;
+}
+
+int aws_nitro_enclaves_library_wait_for_entropy(uint64_t timeout_ms) {
+    int64_t timeout_ns = (int64_t)aws_timestamp_convert(timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    int rc = AWS_OP_SUCCESS;
+
+    aws_mutex_lock(&s_feeder_mutex);
+    if (!s_feeder_started) {
+        rc = aws_raise_error(AWS_ERROR_INVALID_STATE);
+        goto finalize;
+    }
+
+    /* Raises AWS_ERROR_COND_VARIABLE_TIMED_OUT on timeout. */
+    rc = aws_condition_variable_wait_for_pred(
+        &s_feeder_c_var, &s_feeder_mutex, timeout_ns, s_is_ready_or_failed, NULL);
+    if (rc == AWS_OP_SUCCESS && !s_feeder_ready) {
+        rc = aws_raise_error(s_feeder_error != AWS_OP_SUCCESS ? s_feeder_error : AWS_ERROR_INVALID_STATE);
+    }
+
+finalize:
+    aws_mutex_unlock(&s_feeder_mutex);
+    return rc;
+}
+
+void aws_nitro_enclaves_entropy_feeder_stop(void) {
+    aws_mutex_lock(&s_feeder_mutex);
+    if (!s_feeder_started) {
+        aws_mutex_unlock(&s_feeder_mutex);
+        return;
+    }
+    s_feeder_stopping = true;
+    aws_condition_variable_notify_all(&s_feeder_c_var);
+    aws_mutex_unlock(&s_feeder_mutex);
+
+    aws_thread_join(&s_feeder_thread);
+    aws_thread_clean_up(&s_feeder_thread);
+
+    aws_mutex_lock(&s_feeder_mutex);
+    s_feeder_started = false;
+    /* Releases callers still waiting for readiness. */
+    aws_condition_variable_notify_all(&s_feeder_c_var);
+    aws_mutex_unlock(&s_feeder_mutex);
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/future.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/clock.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/mutex.h>
+#include <aws/common/ref_count.h>
+
+struct aws_nitro_enclaves_future {
+    struct aws_allocator *allocator;
+
+    /* The pool the future returns to, NULL if it is not pooled. Each future in use holds a pool reference. */
+    struct aws_nitro_enclaves_future_pool *pool;
+    struct aws_linked_list_node pool_node;
+
+    struct aws_atomic_var ref_count;
+
+    /* error_code is written once, before done is set, so it can be read without the lock once done. */
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+    struct aws_atomic_var done;
+    int error_code;
+};
+
+struct aws_nitro_enclaves_future_pool {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+
+    /* Released futures, protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_linked_list futures;
+    size_t count;
+    size_t max_pooled;
+};
+
+static void s_future_destroy(struct aws_nitro_enclaves_future *future) {
+    aws_condition_variable_clean_up(&future->c_var);
+    aws_mutex_clean_up(&future->mutex);
+    aws_mem_release(future->allocator, future);
+}
+
+static void s_future_reset(struct aws_nitro_enclaves_future *future) {
+    future->error_code = AWS_ERROR_SUCCESS;
+    aws_atomic_store_int(&future->done, 0);
+    aws_atomic_store_int(&future->ref_count, 1);
+}
+
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_new(struct aws_allocator *allocator) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_future *future =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_future));
+    if (future == NULL) {
+        return NULL;
+    }
+
+    future->allocator = allocator;
+    if (aws_mutex_init(&future->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, future);
+        return NULL;
+    }
+    if (aws_condition_variable_init(&future->c_var) != AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&future->mutex);
+        aws_mem_release(allocator, future);
+        return NULL;
+    }
+    s_future_reset(future);
+
+    return future;
+}
+
+static void s_future_pool_destroy(void *arg) {
+    struct aws_nitro_enclaves_future_pool *pool = arg;
+
+    while (!aws_linked_list_empty(&pool->futures)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->futures);
+        s_future_destroy(AWS_CONTAINER_OF(node, struct aws_nitro_enclaves_future, pool_node));
+    }
+    aws_mutex_clean_up(&pool->mutex);
+    aws_mem_release(pool->allocator, pool);
+}
+
+struct aws_nitro_enclaves_future_pool *aws_nitro_enclaves_future_pool_new(
+    struct aws_allocator *allocator,
+    size_t max_pooled) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_future_pool *pool =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_future_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->allocator = allocator;
+    pool->max_pooled = max_pooled;
+    if (aws_mutex_init(&pool->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, pool);
+        return NULL;
+    }
+    aws_linked_list_init(&pool->futures);
+    aws_ref_count_init(&pool->ref_count, pool, s_future_pool_destroy);
+
+    return pool;
+}
+
+void aws_nitro_enclaves_future_pool_release(struct aws_nitro_enclaves_future_pool *pool) {
+    if (pool != NULL) {
+        aws_ref_count_release(&pool->ref_count);
+    }
+}
+
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_pool_get(struct aws_nitro_enclaves_future_pool *pool) {
+    AWS_PRECONDITION(pool);
+
+    struct aws_nitro_enclaves_future *future = NULL;
+    aws_mutex_lock(&pool->mutex);
+    if (!aws_linked_list_empty(&pool->futures)) {
+        struct aws_linked_list_node *node = aws_linked_list_pop_front(&pool->futures);
+        future = AWS_CONTAINER_OF(node, struct aws_nitro_enclaves_future, pool_node);
+        pool->count--;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    if (future == NULL) {
+        future = aws_nitro_enclaves_future_new(pool->allocator);
+        if (future == NULL) {
+            return NULL;
+        }
+    }
+
+    future->pool = pool;
+    aws_ref_count_acquire(&pool->ref_count);
+
+    return future;
+}
+
+struct aws_nitro_enclaves_future *aws_nitro_enclaves_future_acquire(struct aws_nitro_enclaves_future *future) {
+    AWS_PRECONDITION(future);
+
+    aws_atomic_fetch_add(&future->ref_count, 1);
+    return future;
+}
+
+void aws_nitro_enclaves_future_release(struct aws_nitro_enclaves_future *future) {
+    if (future == NULL || aws_atomic_fetch_sub(&future->ref_count, 1) != 1) {
+        return;
+    }
+
+    struct aws_nitro_enclaves_future_pool *pool = future->pool;
+    if (pool == NULL) {
+        s_future_destroy(future);
+        return;
+    }
+
+    s_future_reset(future);
+    future->pool = NULL;
+
+    bool pooled = false;
+    aws_mutex_lock(&pool->mutex);
+    if (pool->count < pool->max_pooled) {
+        aws_linked_list_push_back(&pool->futures, &future->pool_node);
+        pool->count++;
+        pooled = true;
+    }
+    aws_mutex_unlock(&pool->mutex);
+
+    if (!pooled) {
+        s_future_destroy(future);
+    }
+    aws_ref_count_release(&pool->ref_count);
+}
+
+bool aws_nitro_enclaves_future_complete(struct aws_nitro_enclaves_future *future, int error_code) {
+    AWS_PRECONDITION(future);
+
+    bool completed = false;
+    aws_mutex_lock(&future->mutex);
+    if (aws_atomic_load_int(&future->done) == 0) {
+        future->error_code = error_code;
+        aws_atomic_store_int(&future->done, 1);
+        completed = true;
+    }
+    aws_condition_variable_notify_all(&future->c_var);
+    aws_mutex_unlock(&future->mutex);
+
+    return completed;
+}
+
+bool aws_nitro_enclaves_future_is_done(const struct aws_nitro_enclaves_future *future) {
+    AWS_PRECONDITION(future);
+
+    return aws_atomic_load_int(&future->done) != 0;
+}
+
+int aws_nitro_enclaves_future_get_error(const struct aws_nitro_enclaves_future *future) {
+    AWS_PRECONDITION(aws_nitro_enclaves_future_is_done(future));
+
+    return future->error_code;
+}
+
+void aws_nitro_enclaves_future_reset(struct aws_nitro_enclaves_future *future) {
+    AWS_PRECONDITION(future);
+
+    aws_mutex_lock(&future->mutex);
+    future->error_code = AWS_ERROR_SUCCESS;
+    aws_atomic_store_int(&future->done, 0);
+    aws_mutex_unlock(&future->mutex);
+}
+
+void aws_nitro_enclaves_future_notify(struct aws_nitro_enclaves_future *future) {
+    AWS_PRECONDITION(future);
+
+    aws_mutex_lock(&future->mutex);
+    aws_condition_variable_notify_all(&future->c_var);
+    aws_mutex_unlock(&future->mutex);
+}
+
+static bool s_future_is_done(void *arg) {
+    return aws_nitro_enclaves_future_is_done(arg);
+}
+
+bool aws_nitro_enclaves_future_wait(struct aws_nitro_enclaves_future *future, uint64_t deadline_ns) {
+    return aws_nitro_enclaves_future_wait_pred(future, deadline_ns, s_future_is_done, future);
+}
+
+bool aws_nitro_enclaves_future_wait_pred(
+    struct aws_nitro_enclaves_future *future,
+    uint64_t deadline_ns,
+    aws_condition_predicate_fn *pred,
+    void *user_data) {
+    AWS_PRECONDITION(future);
+    AWS_PRECONDITION(pred);
+
+    aws_mutex_lock(&future->mutex);
+    if (deadline_ns == 0) {
+        aws_condition_variable_wait_pred(&future->c_var, &future->mutex, pred, user_data);
+    } else {
+        uint64_t now = 0;
+        aws_high_res_clock_get_ticks(&now);
+        if (now < deadline_ns) {
+            aws_condition_variable_wait_for_pred(
+                &future->c_var, &future->mutex, (int64_t)(deadline_ns - now), pred, user_data);
+        }
+    }
+    bool result = pred(user_data);
+    aws_mutex_unlock(&future->mutex);
+
+    return result;
+}
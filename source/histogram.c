@@ -0,0 +1,125 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/histogram.h>
+
+#include <aws/common/math.h>
+#include <aws/common/mutex.h>
+
+/* Each power of two is split into 2^HISTOGRAM_SUB_BITS buckets; values below twice that are exact. */
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BIT 40
+#define HISTOGRAM_MAX_VALUE ((UINT64_C(1) << (HISTOGRAM_MAX_BIT + 1)) - 1)
+#define HISTOGRAM_BUCKET_COUNT ((HISTOGRAM_MAX_BIT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_COUNT)
+
+struct aws_nitro_enclaves_histogram {
+    struct aws_allocator *allocator;
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    uint64_t buckets[HISTOGRAM_BUCKET_COUNT];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+static size_t s_bucket_index(uint64_t value) {
+    if (value < 2 * HISTOGRAM_SUB_COUNT) {
+        return (size_t)value;
+    }
+
+    size_t exponent = (size_t)(63 - aws_clz_u64(value)) - HISTOGRAM_SUB_BITS;
+    return (exponent + 1) * HISTOGRAM_SUB_COUNT + (size_t)((value >> exponent) - HISTOGRAM_SUB_COUNT);
+}
+
+/* The largest value counted in a bucket. */
+static uint64_t s_bucket_upper_bound(size_t index) {
+    if (index < 2 * HISTOGRAM_SUB_COUNT) {
+        return index;
+    }
+
+    size_t exponent = index / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t mantissa = index % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT;
+    return ((mantissa + 1) << exponent) - 1;
+}
+
+struct aws_nitro_enclaves_histogram *aws_nitro_enclaves_histogram_new(struct aws_allocator *allocator) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_histogram *histogram =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_histogram));
+    if (histogram == NULL) {
+        return NULL;
+    }
+
+    histogram->allocator = allocator;
+    if (aws_mutex_init(&histogram->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, histogram);
+        return NULL;
+    }
+
+    return histogram;
+}
+
+void aws_nitro_enclaves_histogram_destroy(struct aws_nitro_enclaves_histogram *histogram) {
+    if (histogram == NULL) {
+        return;
+    }
+
+    aws_mutex_clean_up(&histogram->mutex);
+    aws_mem_release(histogram->allocator, histogram);
+}
+
+void aws_nitro_enclaves_histogram_record(struct aws_nitro_enclaves_histogram *histogram, uint64_t value_ns) {
+    AWS_PRECONDITION(histogram != NULL);
+
+    size_t index = s_bucket_index(AWS_MIN(value_ns, HISTOGRAM_MAX_VALUE));
+
+    aws_mutex_lock(&histogram->mutex);
+    histogram->buckets[index]++;
+    if (histogram->count == 0 || value_ns < histogram->min) {
+        histogram->min = value_ns;
+    }
+    if (value_ns > histogram->max) {
+        histogram->max = value_ns;
+    }
+    histogram->count++;
+    histogram->sum += value_ns;
+    aws_mutex_unlock(&histogram->mutex);
+}
+
+void aws_nitro_enclaves_histogram_summarize(
+    struct aws_nitro_enclaves_histogram *histogram,
+    struct aws_nitro_enclaves_latency_summary *summary) {
+    AWS_PRECONDITION(histogram != NULL);
+    AWS_PRECONDITION(summary != NULL);
+
+    /* Per mille, in the order of the summary fields. */
+    static const uint64_t s_percentiles[] = {500, 900, 990, 999};
+    uint64_t *values[] = {&summary->p50_ns, &summary->p90_ns, &summary->p99_ns, &summary->p999_ns};
+
+    AWS_ZERO_STRUCT(*summary);
+
+    aws_mutex_lock(&histogram->mutex);
+    summary->count = histogram->count;
+    summary->sum_ns = histogram->sum;
+    summary->min_ns = histogram->min;
+    summary->max_ns = histogram->max;
+
+    /* Nearest rank: the smallest bucket such that at least the percentile of the values are in it or below. */
+    uint64_t cumulative = 0;
+    size_t percentile = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT && percentile < AWS_ARRAY_SIZE(s_percentiles); ++i) {
+        cumulative += histogram->buckets[i];
+        while (percentile < AWS_ARRAY_SIZE(s_percentiles) &&
+               cumulative * 1000 >= histogram->count * s_percentiles[percentile] && cumulative > 0) {
+            *values[percentile] = AWS_MIN(s_bucket_upper_bound(i), histogram->max);
+            percentile++;
+        }
+    }
+    aws_mutex_unlock(&histogram->mutex);
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/hmac_drbg.h>
+
+#include <aws/common/math.h>
+#include <aws/common/zero.h>
+
+#include <openssl/digest.h>
+#include <openssl/hmac.h>
+
+#include <string.h>
+
+/* Past this many generate calls without a reseed, SP 800-90A requires one. */
+#define HMAC_DRBG_RESEED_INTERVAL (UINT64_C(1) << 48)
+
+/* Computes HMAC(key, value || separator || data), skipping the separator if it is negative. */
+static int s_hmac(
+    const struct aws_nitro_enclaves_hmac_drbg *drbg,
+    int separator,
+    struct aws_byte_cursor data,
+    uint8_t out[AWS_NITRO_ENCLAVES_HMAC_DRBG_OUTLEN]) {
+    HMAC_CTX ctx;
+    HMAC_CTX_init(&ctx);
+
+    uint8_t separator_byte = (uint8_t)separator;
+    unsigned int out_len = 0;
+    int rc = HMAC_Init_ex(&ctx, drbg->key, sizeof(drbg->key), EVP_sha256(), NULL) &&
+             HMAC_Update(&ctx, drbg->value, sizeof(drbg->value)) &&
+             (separator < 0 || HMAC_Update(&ctx, &separator_byte, 1)) &&
+             (data.len == 0 || HMAC_Update(&ctx, data.ptr, data.len)) && HMAC_Final(&ctx, out, &out_len) &&
+             out_len == AWS_NITRO_ENCLAVES_HMAC_DRBG_OUTLEN;
+    HMAC_CTX_cleanup(&ctx);
+
+    return rc ? AWS_OP_SUCCESS : aws_raise_error(AWS_ERROR_UNKNOWN);
+}
+
+/* HMAC_DRBG_Update, SP 800-90A section 10.1.2.2. */
+static int s_update(struct aws_nitro_enclaves_hmac_drbg *drbg, struct aws_byte_cursor provided_data) {
+    struct aws_byte_cursor empty = {0};
+
+    for (int separator = 0; separator <= 1; ++separator) {
+        if (s_hmac(drbg, separator, provided_data, drbg->key) != AWS_OP_SUCCESS ||
+            s_hmac(drbg, -1, empty, drbg->value) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        if (provided_data.len == 0) {
+            break;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_hmac_drbg_init(struct aws_nitro_enclaves_hmac_drbg *drbg, struct aws_byte_cursor seed_material) {
+    AWS_PRECONDITION(drbg != NULL);
+
+    memset(drbg->key, 0x00, sizeof(drbg->key));
+    memset(drbg->value, 0x01, sizeof(drbg->value));
+    drbg->reseed_counter = 1;
+
+    return s_update(drbg, seed_material);
+}
+
+int aws_nitro_enclaves_hmac_drbg_reseed(
+    struct aws_nitro_enclaves_hmac_drbg *drbg,
+    struct aws_byte_cursor seed_material) {
+    AWS_PRECONDITION(drbg != NULL);
+
+    if (s_update(drbg, seed_material) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    drbg->reseed_counter = 1;
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_hmac_drbg_generate(struct aws_nitro_enclaves_hmac_drbg *drbg, uint8_t *out, size_t len) {
+    AWS_PRECONDITION(drbg != NULL);
+    AWS_PRECONDITION(out != NULL || len == 0);
+
+    if (len > AWS_NITRO_ENCLAVES_HMAC_DRBG_MAX_GENERATE) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    if (drbg->reseed_counter > HMAC_DRBG_RESEED_INTERVAL) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    struct aws_byte_cursor empty = {0};
+    size_t written = 0;
+    while (written < len) {
+        if (s_hmac(drbg, -1, empty, drbg->value) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        size_t chunk = AWS_MIN(len - written, sizeof(drbg->value));
+        memcpy(out + written, drbg->value, chunk);
+        written += chunk;
+    }
+
+    if (s_update(drbg, empty) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    drbg->reseed_counter++;
+
+    return AWS_OP_SUCCESS;
+}
+
+void aws_nitro_enclaves_hmac_drbg_clean_up(struct aws_nitro_enclaves_hmac_drbg *drbg) {
+    AWS_PRECONDITION(drbg != NULL);
+
+    aws_secure_zero(drbg, sizeof(*drbg));
+}
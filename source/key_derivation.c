@@ -0,0 +1,218 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/key_derivation.h>
+
+#include <openssl/digest.h>
+#include <openssl/hkdf.h>
+
+#define DERIVATION_RECORD_VERSION 1
+
+struct aws_nitro_enclaves_root_key {
+    struct aws_allocator *allocator;
+    struct aws_byte_buf plaintext;
+    struct aws_byte_buf ciphertext_blob;
+};
+
+struct aws_nitro_enclaves_root_key *aws_nitro_enclaves_root_key_generate(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+
+    struct aws_nitro_enclaves_root_key *root_key =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_root_key));
+    if (root_key == NULL) {
+        return NULL;
+    }
+    root_key->allocator = allocator;
+
+    if (aws_kms_generate_data_key_blocking(
+            client, key_id, key_spec, &root_key->plaintext, &root_key->ciphertext_blob) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, root_key);
+        return NULL;
+    }
+
+    return root_key;
+}
+
+struct aws_nitro_enclaves_root_key *aws_nitro_enclaves_root_key_decrypt(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_byte_cursor ciphertext_blob) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(client != NULL);
+
+    struct aws_nitro_enclaves_root_key *root_key =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_root_key));
+    if (root_key == NULL) {
+        return NULL;
+    }
+    root_key->allocator = allocator;
+
+    if (aws_byte_buf_init_copy_from_cursor(&root_key->ciphertext_blob, allocator, ciphertext_blob) !=
+        AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    /* The ciphertext blob of a symmetric key names its key id. */
+    if (aws_kms_decrypt_blocking(client, NULL, NULL, &root_key->ciphertext_blob, &root_key->plaintext) !=
+        AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+
+    return root_key;
+
+err_clean:
+    aws_byte_buf_clean_up(&root_key->ciphertext_blob);
+    aws_mem_release(allocator, root_key);
+    return NULL;
+}
+
+void aws_nitro_enclaves_root_key_destroy(struct aws_nitro_enclaves_root_key *root_key) {
+    if (root_key == NULL) {
+        return;
+    }
+
+    aws_byte_buf_clean_up_secure(&root_key->plaintext);
+    aws_byte_buf_clean_up(&root_key->ciphertext_blob);
+    aws_mem_release(root_key->allocator, root_key);
+}
+
+struct aws_byte_cursor aws_nitro_enclaves_root_key_get_ciphertext_blob(
+    const struct aws_nitro_enclaves_root_key *root_key) {
+    AWS_PRECONDITION(root_key != NULL);
+
+    return aws_byte_cursor_from_buf(&root_key->ciphertext_blob);
+}
+
+int aws_nitro_enclaves_derive_key(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor secret,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *key) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(key != NULL);
+
+    if (secret.len == 0 || key_len == 0 || key_len > AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    if (aws_byte_buf_init(key, allocator, key_len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (HKDF(key->buffer, key_len, EVP_sha256(), secret.ptr, secret.len, NULL, 0, context.ptr, context.len) != 1) {
+        aws_byte_buf_clean_up_secure(key);
+        return aws_raise_error(AWS_ERROR_UNKNOWN);
+    }
+    key->len = key_len;
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_root_key_derive(
+    const struct aws_nitro_enclaves_root_key *root_key,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *subkey,
+    struct aws_byte_buf *record) {
+    AWS_PRECONDITION(root_key != NULL);
+    AWS_PRECONDITION(subkey != NULL);
+
+    if (aws_nitro_enclaves_derive_key(
+            root_key->allocator, aws_byte_cursor_from_buf(&root_key->plaintext), context, key_len, subkey) !=
+        AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    if (record != NULL && aws_nitro_enclaves_derivation_record_write(
+                              root_key->allocator,
+                              aws_byte_cursor_from_buf(&root_key->ciphertext_blob),
+                              context,
+                              key_len,
+                              record) != AWS_OP_SUCCESS) {
+        aws_byte_buf_clean_up_secure(subkey);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_derivation_record_write(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor ciphertext_blob,
+    struct aws_byte_cursor context,
+    size_t key_len,
+    struct aws_byte_buf *record) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(record != NULL);
+
+    if (ciphertext_blob.len == 0 || ciphertext_blob.len > UINT16_MAX || context.len > UINT16_MAX || key_len == 0 ||
+        key_len > AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    size_t record_len = 1 + 2 + ciphertext_blob.len + 2 + context.len + 2;
+    if (record->allocator == NULL) {
+        if (aws_byte_buf_init(record, allocator, record_len) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    } else if (aws_byte_buf_reserve_relative(record, record_len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    /* Cannot fail after the reservation. */
+    aws_byte_buf_write_u8(record, DERIVATION_RECORD_VERSION);
+    aws_byte_buf_write_be16(record, (uint16_t)ciphertext_blob.len);
+    aws_byte_buf_write_from_whole_cursor(record, ciphertext_blob);
+    aws_byte_buf_write_be16(record, (uint16_t)context.len);
+    aws_byte_buf_write_from_whole_cursor(record, context);
+    aws_byte_buf_write_be16(record, (uint16_t)key_len);
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_derivation_record_read(
+    struct aws_byte_cursor *record,
+    struct aws_byte_cursor *ciphertext_blob,
+    struct aws_byte_cursor *context,
+    size_t *key_len) {
+    AWS_PRECONDITION(aws_byte_cursor_is_valid(record));
+    AWS_PRECONDITION(ciphertext_blob != NULL);
+    AWS_PRECONDITION(context != NULL);
+    AWS_PRECONDITION(key_len != NULL);
+
+    /* Reads from a copy, so that the record is left as is if it is malformed. */
+    struct aws_byte_cursor cursor = *record;
+    uint8_t version = 0;
+    uint16_t blob_len = 0;
+    uint16_t context_len = 0;
+    uint16_t len = 0;
+
+    if (!aws_byte_cursor_read_u8(&cursor, &version) || version != DERIVATION_RECORD_VERSION ||
+        !aws_byte_cursor_read_be16(&cursor, &blob_len) || blob_len == 0 || cursor.len < blob_len) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    struct aws_byte_cursor blob = aws_byte_cursor_advance(&cursor, blob_len);
+
+    if (!aws_byte_cursor_read_be16(&cursor, &context_len) || cursor.len < context_len) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    struct aws_byte_cursor info = aws_byte_cursor_advance(&cursor, context_len);
+
+    if (!aws_byte_cursor_read_be16(&cursor, &len) || len == 0 || len > AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    *ciphertext_blob = blob;
+    *context = info;
+    *key_len = len;
+    *record = cursor;
+
+    return AWS_OP_SUCCESS;
+}
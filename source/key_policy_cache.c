@@ -0,0 +1,255 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/key_policy_cache.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/hash_table.h>
+#include <aws/common/mutex.h>
+
+/**
+ * The answer of a GetKeyPolicy or ListKeyPolicies call, keyed by request. A failure is stored as its
+ * error code, without a response.
+ */
+struct key_policy_entry {
+    struct aws_allocator *allocator;
+    struct aws_string *cache_key;
+    /* The key id of the request, as given, which invalidations are matched against. */
+    struct aws_string *key_id;
+    struct aws_byte_buf response_json;
+    int error_code;
+    uint64_t expires_at_ns;
+};
+
+struct aws_nitro_enclaves_key_policy_cache {
+    struct aws_allocator *allocator;
+    uint64_t ttl_ns;
+    uint64_t negative_ttl_ns;
+    size_t max_entries;
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_hash_table entries;
+    /* Bumped by every invalidation, so that the answers of calls in flight across it are not stored. */
+    uint64_t generation;
+};
+
+static void s_entry_destroy(void *value) {
+    struct key_policy_entry *entry = value;
+    if (entry == NULL) {
+        return;
+    }
+
+    aws_byte_buf_clean_up(&entry->response_json);
+    aws_string_destroy(entry->key_id);
+    aws_string_destroy(entry->cache_key);
+    aws_mem_release(entry->allocator, entry);
+}
+
+static struct key_policy_entry *s_entry_new(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    const struct aws_string *key_id,
+    int error_code,
+    const struct aws_byte_buf *response_json,
+    uint64_t now_ns) {
+    struct key_policy_entry *entry = aws_mem_calloc(cache->allocator, 1, sizeof(struct key_policy_entry));
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->allocator = cache->allocator;
+    entry->error_code = error_code;
+    entry->expires_at_ns = now_ns + (error_code == AWS_ERROR_SUCCESS ? cache->ttl_ns : cache->negative_ttl_ns);
+
+    entry->cache_key = aws_string_new_from_string(cache->allocator, cache_key);
+    if (entry->cache_key == NULL) {
+        goto err_clean;
+    }
+    entry->key_id = aws_string_new_from_string(cache->allocator, key_id);
+    if (entry->key_id == NULL) {
+        goto err_clean;
+    }
+    if (error_code == AWS_ERROR_SUCCESS &&
+        aws_byte_buf_init_copy(&entry->response_json, cache->allocator, response_json) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+
+    return entry;
+
+err_clean:
+    s_entry_destroy(entry);
+    return NULL;
+}
+
+struct aws_nitro_enclaves_key_policy_cache *aws_nitro_enclaves_key_policy_cache_new(
+    struct aws_allocator *allocator,
+    uint64_t ttl_ms,
+    uint64_t negative_ttl_ms,
+    size_t max_entries) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(max_entries > 0);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_key_policy_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->allocator = allocator;
+    cache->ttl_ns = aws_timestamp_convert(ttl_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    cache->negative_ttl_ns = aws_timestamp_convert(negative_ttl_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    cache->max_entries = max_entries;
+
+    if (aws_mutex_init(&cache->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, cache);
+        return NULL;
+    }
+    /* The entries own their cache key, which is the key of the table. */
+    if (aws_hash_table_init(
+            &cache->entries, allocator, 8, aws_hash_string, aws_hash_callback_string_eq, NULL, s_entry_destroy) !=
+        AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&cache->mutex);
+        aws_mem_release(allocator, cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void aws_nitro_enclaves_key_policy_cache_destroy(struct aws_nitro_enclaves_key_policy_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    aws_hash_table_clean_up(&cache->entries);
+    aws_mutex_clean_up(&cache->mutex);
+    aws_mem_release(cache->allocator, cache);
+}
+
+bool aws_nitro_enclaves_key_policy_cache_get(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    uint64_t now_ns,
+    struct aws_allocator *allocator,
+    struct aws_byte_buf *response_json,
+    int *error_code,
+    uint64_t *generation) {
+    AWS_PRECONDITION(cache != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(cache_key));
+    AWS_PRECONDITION(error_code != NULL);
+    AWS_PRECONDITION(generation != NULL);
+
+    bool found = false;
+    struct aws_hash_element *elem = NULL;
+    aws_mutex_lock(&cache->mutex);
+    aws_hash_table_find(&cache->entries, cache_key, &elem);
+    if (elem != NULL && ((struct key_policy_entry *)elem->value)->expires_at_ns > now_ns) {
+        const struct key_policy_entry *entry = elem->value;
+        found = true;
+        *error_code = entry->error_code;
+        if (entry->error_code == AWS_ERROR_SUCCESS &&
+            aws_byte_buf_init_copy(response_json, allocator, &entry->response_json) != AWS_OP_SUCCESS) {
+            *error_code = aws_last_error();
+        }
+    } else {
+        *generation = cache->generation;
+    }
+    aws_mutex_unlock(&cache->mutex);
+
+    return found;
+}
+
+static int s_entry_expire(void *context, struct aws_hash_element *elem) {
+    const uint64_t *now_ns = context;
+    const struct key_policy_entry *entry = elem->value;
+
+    if (entry->expires_at_ns <= *now_ns) {
+        return AWS_COMMON_HASH_TABLE_ITER_CONTINUE | AWS_COMMON_HASH_TABLE_ITER_DELETE;
+    }
+    return AWS_COMMON_HASH_TABLE_ITER_CONTINUE;
+}
+
+static int s_entry_find_oldest(void *context, struct aws_hash_element *elem) {
+    struct key_policy_entry **oldest = context;
+    struct key_policy_entry *entry = elem->value;
+
+    if (*oldest == NULL || entry->expires_at_ns < (*oldest)->expires_at_ns) {
+        *oldest = entry;
+    }
+    return AWS_COMMON_HASH_TABLE_ITER_CONTINUE;
+}
+
+int aws_nitro_enclaves_key_policy_cache_put(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    const struct aws_string *key_id,
+    int error_code,
+    const struct aws_byte_buf *response_json,
+    uint64_t now_ns,
+    uint64_t generation) {
+    AWS_PRECONDITION(cache != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(cache_key));
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+
+    struct key_policy_entry *entry = s_entry_new(cache, cache_key, key_id, error_code, response_json, now_ns);
+    if (entry == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    int rc = AWS_OP_SUCCESS;
+    aws_mutex_lock(&cache->mutex);
+    if (generation != cache->generation) {
+        goto finalize;
+    }
+
+    aws_hash_table_foreach(&cache->entries, s_entry_expire, &now_ns);
+    struct aws_hash_element *elem = NULL;
+    aws_hash_table_find(&cache->entries, cache_key, &elem);
+    if (elem == NULL && aws_hash_table_get_entry_count(&cache->entries) >= cache->max_entries) {
+        struct key_policy_entry *oldest = NULL;
+        aws_hash_table_foreach(&cache->entries, s_entry_find_oldest, &oldest);
+        aws_hash_table_remove(&cache->entries, oldest->cache_key, NULL, NULL);
+    }
+
+    rc = aws_hash_table_put(&cache->entries, entry->cache_key, entry, NULL);
+    if (rc == AWS_OP_SUCCESS) {
+        entry = NULL;
+    }
+
+finalize:
+    aws_mutex_unlock(&cache->mutex);
+    s_entry_destroy(entry);
+    return rc;
+}
+
+static int s_entry_invalidate(void *context, struct aws_hash_element *elem) {
+    const struct aws_string *key_id = context;
+    const struct key_policy_entry *entry = elem->value;
+
+    if (key_id == NULL || aws_string_eq(entry->key_id, key_id)) {
+        return AWS_COMMON_HASH_TABLE_ITER_CONTINUE | AWS_COMMON_HASH_TABLE_ITER_DELETE;
+    }
+    return AWS_COMMON_HASH_TABLE_ITER_CONTINUE;
+}
+
+void aws_nitro_enclaves_key_policy_cache_invalidate(
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *key_id) {
+    AWS_PRECONDITION(cache != NULL);
+
+    aws_mutex_lock(&cache->mutex);
+    cache->generation++;
+    aws_hash_table_foreach(&cache->entries, s_entry_invalidate, (void *)key_id);
+    aws_mutex_unlock(&cache->mutex);
+}
+
+size_t aws_nitro_enclaves_key_policy_cache_size(struct aws_nitro_enclaves_key_policy_cache *cache) {
+    AWS_PRECONDITION(cache != NULL);
+
+    aws_mutex_lock(&cache->mutex);
+    size_t size = aws_hash_table_get_entry_count(&cache->entries);
+    aws_mutex_unlock(&cache->mutex);
+
+    return size;
+}
@@ -0,0 +1,300 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/key_policy_iterator.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/kms.h>
+
+#include <aws/common/condition_variable.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/logging.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+
+#define DEFAULT_PAGE_SIZE 100
+#define MAX_PAGE_SIZE 1000
+#define DEFAULT_MAX_PREFETCHED_PAGES 1
+
+struct key_policy_page {
+    struct aws_linked_list_node node;
+    struct aws_kms_list_key_policies_response *response;
+};
+
+struct aws_nitro_enclaves_key_policy_iterator {
+    struct aws_allocator *allocator;
+    aws_nitro_enclaves_key_policy_iterator_list_fn *list_key_policies;
+    void *user_data;
+    struct aws_string *key_id;
+    uint32_t page_size;
+    size_t max_prefetched_pages;
+
+    struct aws_thread thread;
+
+    /* The page being consumed and the position in it, only used by the caller. */
+    struct key_policy_page *current;
+    size_t position;
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+    struct aws_linked_list pages;
+    size_t page_count;
+    /* Set once the last page was fetched, or a fetch failed with error_code. */
+    bool finished;
+    int error_code;
+    bool stopping;
+};
+
+static void s_page_destroy(struct aws_allocator *allocator, struct key_policy_page *page) {
+    if (page == NULL) {
+        return;
+    }
+
+    aws_kms_list_key_policies_response_destroy(page->response);
+    aws_mem_release(allocator, page);
+}
+
+/* Pages are only read once, so they are not worth keeping in the key policy cache of the client. */
+static int s_kms_list_key_policies(
+    void *user_data,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json) {
+    return aws_nitro_enclaves_kms_list_key_policies_uncached(user_data, key_id, limit, marker, response_json);
+}
+
+/* A page without policy names has no list at all. */
+static size_t s_page_length(const struct key_policy_page *page) {
+    if (!aws_array_list_is_valid(&page->response->policy_names)) {
+        return 0;
+    }
+    return aws_array_list_length(&page->response->policy_names);
+}
+
+/* Calls ListKeyPolicies and parses its answer. Runs without the mutex. */
+static struct key_policy_page *s_page_fetch(
+    struct aws_nitro_enclaves_key_policy_iterator *iterator,
+    const struct aws_string *marker) {
+    struct key_policy_page *page = aws_mem_calloc(iterator->allocator, 1, sizeof(struct key_policy_page));
+    if (page == NULL) {
+        return NULL;
+    }
+
+    struct aws_byte_buf response_json = {0};
+    int limit = (int)iterator->page_size;
+    if (iterator->list_key_policies(iterator->user_data, iterator->key_id, limit, marker, &response_json) !=
+        AWS_OP_SUCCESS) {
+        aws_mem_release(iterator->allocator, page);
+        return NULL;
+    }
+
+    struct aws_string *json = aws_string_new_from_buf(iterator->allocator, &response_json);
+    aws_byte_buf_clean_up(&response_json);
+    if (json == NULL) {
+        aws_mem_release(iterator->allocator, page);
+        return NULL;
+    }
+
+    page->response = aws_kms_list_key_policies_response_from_json(iterator->allocator, json);
+    aws_string_destroy(json);
+    if (page->response == NULL) {
+        aws_mem_release(iterator->allocator, page);
+        return NULL;
+    }
+
+    return page;
+}
+
+static bool s_can_prefetch(void *arg) {
+    struct aws_nitro_enclaves_key_policy_iterator *iterator = arg;
+    return iterator->stopping || iterator->page_count < iterator->max_prefetched_pages;
+}
+
+static void s_prefetch_thread_main(void *arg) {
+    struct aws_nitro_enclaves_key_policy_iterator *iterator = arg;
+    struct aws_string *marker = NULL;
+
+    aws_mutex_lock(&iterator->mutex);
+    while (!iterator->stopping && !iterator->finished) {
+        if (iterator->page_count >= iterator->max_prefetched_pages) {
+            aws_condition_variable_wait_pred(&iterator->c_var, &iterator->mutex, s_can_prefetch, iterator);
+            continue;
+        }
+
+        aws_mutex_unlock(&iterator->mutex);
+        aws_reset_error();
+        struct key_policy_page *page = s_page_fetch(iterator, marker);
+        int error_code = page == NULL ? aws_last_error() : AWS_ERROR_SUCCESS;
+        aws_string_destroy(marker);
+        marker = NULL;
+        aws_mutex_lock(&iterator->mutex);
+
+        if (page == NULL) {
+            iterator->error_code = error_code != AWS_ERROR_SUCCESS ? error_code : AWS_ERROR_UNKNOWN;
+            iterator->finished = true;
+            AWS_LOGF_WARN(
+                AWS_LS_NITRO_ENCLAVES_KMS,
+                "id=%p: Key policy page fetch failed: %s.",
+                (void *)iterator,
+                aws_error_debug_str(iterator->error_code));
+        } else {
+            /* The marker of the next page moves from the page to the thread. */
+            if (page->response->truncated && page->response->next_marker != NULL) {
+                marker = page->response->next_marker;
+                page->response->next_marker = NULL;
+            } else {
+                iterator->finished = true;
+            }
+            aws_linked_list_push_back(&iterator->pages, &page->node);
+            iterator->page_count++;
+        }
+        aws_condition_variable_notify_all(&iterator->c_var);
+    }
+    aws_mutex_unlock(&iterator->mutex);
+
+    aws_string_destroy(marker);
+}
+
+static void s_key_policy_iterator_clean_up(struct aws_nitro_enclaves_key_policy_iterator *iterator) {
+    while (!aws_linked_list_empty(&iterator->pages)) {
+        s_page_destroy(
+            iterator->allocator,
+            AWS_CONTAINER_OF(aws_linked_list_pop_front(&iterator->pages), struct key_policy_page, node));
+    }
+    s_page_destroy(iterator->allocator, iterator->current);
+
+    aws_condition_variable_clean_up(&iterator->c_var);
+    aws_mutex_clean_up(&iterator->mutex);
+    aws_string_destroy(iterator->key_id);
+    aws_mem_release(iterator->allocator, iterator);
+}
+
+struct aws_nitro_enclaves_key_policy_iterator *aws_nitro_enclaves_key_policy_iterator_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_key_policy_iterator_options *options) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(options != NULL);
+
+    if ((options->client == NULL && options->list_key_policies == NULL) || !aws_string_is_valid(options->key_id) ||
+        options->page_size > MAX_PAGE_SIZE) {
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        return NULL;
+    }
+
+    struct aws_nitro_enclaves_key_policy_iterator *iterator =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_key_policy_iterator));
+    if (iterator == NULL) {
+        return NULL;
+    }
+
+    iterator->allocator = allocator;
+    if (options->list_key_policies != NULL) {
+        iterator->list_key_policies = options->list_key_policies;
+        iterator->user_data = options->user_data;
+    } else {
+        iterator->list_key_policies = s_kms_list_key_policies;
+        iterator->user_data = options->client;
+    }
+    iterator->page_size = options->page_size != 0 ? options->page_size : DEFAULT_PAGE_SIZE;
+    iterator->max_prefetched_pages =
+        options->max_prefetched_pages != 0 ? options->max_prefetched_pages : DEFAULT_MAX_PREFETCHED_PAGES;
+    aws_linked_list_init(&iterator->pages);
+
+    iterator->key_id = aws_string_new_from_string(allocator, options->key_id);
+    if (iterator->key_id == NULL) {
+        aws_mem_release(allocator, iterator);
+        return NULL;
+    }
+    if (aws_mutex_init(&iterator->mutex) != AWS_OP_SUCCESS) {
+        aws_string_destroy(iterator->key_id);
+        aws_mem_release(allocator, iterator);
+        return NULL;
+    }
+    if (aws_condition_variable_init(&iterator->c_var) != AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&iterator->mutex);
+        aws_string_destroy(iterator->key_id);
+        aws_mem_release(allocator, iterator);
+        return NULL;
+    }
+
+    if (aws_thread_init(&iterator->thread, allocator) != AWS_OP_SUCCESS) {
+        s_key_policy_iterator_clean_up(iterator);
+        return NULL;
+    }
+    if (aws_thread_launch(&iterator->thread, s_prefetch_thread_main, iterator, NULL) != AWS_OP_SUCCESS) {
+        aws_thread_clean_up(&iterator->thread);
+        s_key_policy_iterator_clean_up(iterator);
+        return NULL;
+    }
+
+    return iterator;
+}
+
+void aws_nitro_enclaves_key_policy_iterator_destroy(struct aws_nitro_enclaves_key_policy_iterator *iterator) {
+    if (iterator == NULL) {
+        return;
+    }
+
+    aws_mutex_lock(&iterator->mutex);
+    iterator->stopping = true;
+    aws_condition_variable_notify_all(&iterator->c_var);
+    aws_mutex_unlock(&iterator->mutex);
+
+    aws_thread_join(&iterator->thread);
+    aws_thread_clean_up(&iterator->thread);
+    s_key_policy_iterator_clean_up(iterator);
+}
+
+static bool s_has_page(void *arg) {
+    struct aws_nitro_enclaves_key_policy_iterator *iterator = arg;
+    return iterator->finished || !aws_linked_list_empty(&iterator->pages);
+}
+
+int aws_nitro_enclaves_key_policy_iterator_next(
+    struct aws_nitro_enclaves_key_policy_iterator *iterator,
+    struct aws_byte_cursor *policy_name,
+    bool *end) {
+    AWS_PRECONDITION(iterator != NULL);
+    AWS_PRECONDITION(policy_name != NULL);
+    AWS_PRECONDITION(end != NULL);
+
+    /* Pages may be empty, so several can be skipped before a name is found. */
+    while (iterator->current == NULL || iterator->position == s_page_length(iterator->current)) {
+        s_page_destroy(iterator->allocator, iterator->current);
+        iterator->current = NULL;
+        iterator->position = 0;
+
+        aws_mutex_lock(&iterator->mutex);
+        aws_condition_variable_wait_pred(&iterator->c_var, &iterator->mutex, s_has_page, iterator);
+        if (aws_linked_list_empty(&iterator->pages)) {
+            int error_code = iterator->error_code;
+            aws_mutex_unlock(&iterator->mutex);
+
+            if (error_code != AWS_ERROR_SUCCESS) {
+                return aws_raise_error(error_code);
+            }
+            *end = true;
+            return AWS_OP_SUCCESS;
+        }
+        iterator->current =
+            AWS_CONTAINER_OF(aws_linked_list_pop_front(&iterator->pages), struct key_policy_page, node);
+        iterator->page_count--;
+        /* Makes room for the next page. */
+        aws_condition_variable_notify_all(&iterator->c_var);
+        aws_mutex_unlock(&iterator->mutex);
+    }
+
+    struct aws_string *name = NULL;
+    AWS_FATAL_ASSERT(
+        aws_array_list_get_at(&iterator->current->response->policy_names, &name, iterator->position) ==
+        AWS_OP_SUCCESS);
+    iterator->position++;
+
+    *policy_name = aws_byte_cursor_from_string(name);
+    *end = false;
+    return AWS_OP_SUCCESS;
+}
@@ -3,12 +3,26 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/common/clock.h>
 #include <aws/common/encoding.h>
+#include <aws/common/logging.h>
+#include <aws/io/retry_strategy.h>
 #include <aws/io/stream.h>
+#include <aws/nitro_enclaves/internal/arena.h>
 #include <aws/nitro_enclaves/internal/cms.h>
+#include <aws/nitro_enclaves/internal/future.h>
+#include <aws/nitro_enclaves/internal/key_policy_cache.h>
+#include <aws/nitro_enclaves/internal/kms.h>
+#include <aws/nitro_enclaves/internal/kms_metrics.h>
+#include <aws/nitro_enclaves/internal/latency_tracker.h>
+#include <aws/nitro_enclaves/internal/rate_limiter.h>
+#include <aws/nitro_enclaves/internal/singleflight.h>
 #include <aws/nitro_enclaves/kms.h>
 #include <aws/nitro_enclaves/nitro_enclaves.h>
 #include <json-c/json.h>
+#include <openssl/bytestring.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
 
 /**
  * AWS KMS Request / Response JSON key values.
@@ -28,6 +42,11 @@
 #define KMS_NUMBER_OF_BYTES "NumberOfBytes"
 #define KMS_KEY_SPEC "KeySpec"
 #define KMS_CUSTOM_KEY_STORE_ID "CustomKeyStoreId"
+#define KMS_KEY_USAGE "KeyUsage"
+#define KMS_ENCRYPTION_ALGORITHMS "EncryptionAlgorithms"
+#define KMS_POLICY_NAMES "PolicyNames"
+#define KMS_NEXT_MARKER "NextMarker"
+#define KMS_TRUNCATED "Truncated"
 
 /**
  * Helper macro for safe comparing a C string with a C string literal.
@@ -742,6 +761,322 @@ clean_up:
     return NULL;
 }
 
+/* Appends a JSON string, quoted and escaped, growing the buffer as needed. */
+static int s_json_append_string(struct aws_byte_buf *json, struct aws_byte_cursor value) {
+    static const char s_hex[] = "0123456789abcdef";
+
+    if (aws_byte_buf_append_byte_dynamic(json, '"') != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    /* Copies runs of characters that need no escaping at once. */
+    struct aws_byte_cursor run = {.ptr = value.ptr, .len = 0};
+    for (size_t i = 0; i < value.len; ++i) {
+        uint8_t c = value.ptr[i];
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            run.len++;
+            continue;
+        }
+
+        uint8_t escaped[6] = {'\\', c};
+        struct aws_byte_cursor escape = aws_byte_cursor_from_array(escaped, 2);
+        if (c < 0x20) {
+            escaped[1] = 'u';
+            escaped[2] = '0';
+            escaped[3] = '0';
+            escaped[4] = (uint8_t)s_hex[c >> 4];
+            escaped[5] = (uint8_t)s_hex[c & 0xf];
+            escape.len = 6;
+        }
+        if (aws_byte_buf_append_dynamic(json, &run) != AWS_OP_SUCCESS ||
+            aws_byte_buf_append_dynamic(json, &escape) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        run.ptr = value.ptr + i + 1;
+        run.len = 0;
+    }
+
+    if (aws_byte_buf_append_dynamic(json, &run) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    return aws_byte_buf_append_byte_dynamic(json, '"');
+}
+
+/* Appends the base64 encoding of data as a JSON string, growing the buffer as needed. */
+static int s_json_append_base64(struct aws_byte_buf *json, struct aws_byte_cursor data) {
+    size_t encoded_len = 0;
+    if (aws_base64_compute_encoded_len(data.len, &encoded_len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (aws_byte_buf_reserve_relative(json, encoded_len + 2) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    aws_byte_buf_write_u8(json, '"');
+    if (aws_base64_encode(&data, json) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    return aws_byte_buf_append_byte_dynamic(json, '"');
+}
+
+/* Appends the name of an object member, preceded by a comma. */
+static int s_json_append_member_name(struct aws_byte_buf *json, const char *name) {
+    if (aws_byte_buf_append_byte_dynamic(json, ',') != AWS_OP_SUCCESS ||
+        s_json_append_string(json, aws_byte_cursor_from_c_str(name)) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    return aws_byte_buf_append_byte_dynamic(json, ':');
+}
+
+static bool s_is_encryption_algorithm_name(struct aws_byte_cursor name) {
+    return aws_byte_cursor_eq_c_str(&name, aws_string_c_str(s_ea_symmetric_default)) ||
+           aws_byte_cursor_eq_c_str(&name, aws_string_c_str(s_ea_rsaes_oaep_sha_1)) ||
+           aws_byte_cursor_eq_c_str(&name, aws_string_c_str(s_ea_rsaes_oaep_sha_256));
+}
+
+/*
+ * The members of a Decrypt request view are written in a fixed order, with the ciphertext first: the request
+ * is this prefix, the base64 ciphertext, then everything written by s_kms_decrypt_request_view_write_tail.
+ */
+static const char s_kms_decrypt_request_view_prefix[] = "{\"" KMS_CIPHERTEXT_BLOB "\":";
+
+/* Room left for the Recipient member of a request, which is mostly the base64 attestation document. */
+#define KMS_RECIPIENT_JSON_CAPACITY 8192
+
+/* Writes the members of a Decrypt request view that follow the ciphertext, up to the Recipient. */
+static int s_kms_decrypt_request_view_write_members(
+    struct aws_byte_buf *json,
+    const struct aws_kms_decrypt_request_view *view) {
+    if (view->encryption_algorithm.len != 0) {
+        if (!s_is_encryption_algorithm_name(view->encryption_algorithm)) {
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+        if (s_json_append_member_name(json, KMS_ENCRYPTION_ALGORITHM) != AWS_OP_SUCCESS ||
+            s_json_append_string(json, view->encryption_algorithm) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (view->encryption_context_count != 0) {
+        if (s_json_append_member_name(json, KMS_ENCRYPTION_CONTEXT) != AWS_OP_SUCCESS ||
+            aws_byte_buf_append_byte_dynamic(json, '{') != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        for (size_t i = 0; i < view->encryption_context_count; ++i) {
+            const struct aws_kms_encryption_context_entry *entry = &view->encryption_context[i];
+            if ((i != 0 && aws_byte_buf_append_byte_dynamic(json, ',') != AWS_OP_SUCCESS) ||
+                s_json_append_string(json, entry->key) != AWS_OP_SUCCESS ||
+                aws_byte_buf_append_byte_dynamic(json, ':') != AWS_OP_SUCCESS ||
+                s_json_append_string(json, entry->value) != AWS_OP_SUCCESS) {
+                return AWS_OP_ERR;
+            }
+        }
+        if (aws_byte_buf_append_byte_dynamic(json, '}') != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (view->grant_tokens_count != 0) {
+        if (s_json_append_member_name(json, KMS_GRANT_TOKENS) != AWS_OP_SUCCESS ||
+            aws_byte_buf_append_byte_dynamic(json, '[') != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        for (size_t i = 0; i < view->grant_tokens_count; ++i) {
+            if ((i != 0 && aws_byte_buf_append_byte_dynamic(json, ',') != AWS_OP_SUCCESS) ||
+                s_json_append_string(json, view->grant_tokens[i]) != AWS_OP_SUCCESS) {
+                return AWS_OP_ERR;
+            }
+        }
+        if (aws_byte_buf_append_byte_dynamic(json, ']') != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    if (view->key_id.len != 0) {
+        if (s_json_append_member_name(json, KMS_KEY_ID) != AWS_OP_SUCCESS ||
+            s_json_append_string(json, view->key_id) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Writes the Recipient member of a Decrypt request, which is the last one. */
+static int s_kms_decrypt_request_write_recipient(struct aws_byte_buf *json, const struct aws_recipient *recipient) {
+    const struct aws_string *kea = s_aws_key_encryption_algorithm_to_aws_string(recipient->key_encryption_algorithm);
+    if (kea == NULL || recipient->attestation_document.buffer == NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    if (s_json_append_member_name(json, KMS_RECIPIENT) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_byte_dynamic(json, '{') != AWS_OP_SUCCESS ||
+        s_json_append_string(json, aws_byte_cursor_from_c_str(KMS_KEY_ENCRYPTION_ALGORITHM)) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_byte_dynamic(json, ':') != AWS_OP_SUCCESS ||
+        s_json_append_string(json, aws_byte_cursor_from_string(kea)) != AWS_OP_SUCCESS ||
+        s_json_append_member_name(json, KMS_ATTESTATION_DOCUMENT) != AWS_OP_SUCCESS ||
+        s_json_append_base64(json, aws_byte_cursor_from_buf(&recipient->attestation_document)) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_byte_dynamic(json, '}') != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/* Writes the members of a Decrypt request view that follow the ciphertext, and the closing brace. */
+static int s_kms_decrypt_request_view_write_tail(
+    struct aws_byte_buf *json,
+    const struct aws_kms_decrypt_request_view *view,
+    const struct aws_recipient *recipient) {
+    if (s_kms_decrypt_request_view_write_members(json, view) != AWS_OP_SUCCESS ||
+        (recipient != NULL && s_kms_decrypt_request_write_recipient(json, recipient) != AWS_OP_SUCCESS)) {
+        return AWS_OP_ERR;
+    }
+
+    return aws_byte_buf_append_byte_dynamic(json, '}');
+}
+
+int aws_kms_decrypt_request_view_to_json(
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request_view *view,
+    const struct aws_recipient *recipient,
+    struct aws_byte_buf *json) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(view != NULL);
+    AWS_PRECONDITION(json != NULL);
+
+    /* Required parameter. */
+    if (view->ciphertext_blob.len == 0) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    /* Sized for the base64 blobs, which make up most of the request, so that it rarely grows. */
+    size_t capacity = sizeof(s_kms_decrypt_request_view_prefix) + view->ciphertext_blob.len * 4 / 3 + 256;
+    if (recipient != NULL) {
+        capacity += recipient->attestation_document.len * 4 / 3;
+    }
+    if (aws_byte_buf_init(json, allocator, capacity) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    struct aws_byte_cursor prefix = aws_byte_cursor_from_c_str(s_kms_decrypt_request_view_prefix);
+    if (aws_byte_buf_append_dynamic(json, &prefix) != AWS_OP_SUCCESS ||
+        s_json_append_base64(json, view->ciphertext_blob) != AWS_OP_SUCCESS ||
+        s_kms_decrypt_request_view_write_tail(json, view, recipient) != AWS_OP_SUCCESS) {
+        aws_byte_buf_clean_up(json);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+struct aws_kms_decrypt_request_template {
+    struct aws_allocator *allocator;
+
+    /* The members following the ciphertext, up to the Recipient, rendered once. */
+    struct aws_byte_buf members;
+};
+
+struct aws_kms_decrypt_request_template *aws_kms_decrypt_request_template_new(
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request_view *view) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(view != NULL);
+
+    struct aws_kms_decrypt_request_template *request_template =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_decrypt_request_template));
+    if (request_template == NULL) {
+        return NULL;
+    }
+    request_template->allocator = allocator;
+
+    if (aws_byte_buf_init(&request_template->members, allocator, 256) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    if (s_kms_decrypt_request_view_write_members(&request_template->members, view) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+
+    return request_template;
+
+err_clean:
+    aws_byte_buf_clean_up(&request_template->members);
+    aws_mem_release(allocator, request_template);
+    return NULL;
+}
+
+void aws_kms_decrypt_request_template_destroy(struct aws_kms_decrypt_request_template *request_template) {
+    if (request_template == NULL) {
+        return;
+    }
+
+    aws_byte_buf_clean_up(&request_template->members);
+    aws_mem_release(request_template->allocator, request_template);
+}
+
+/*
+ * Starts a Decrypt request from a template: everything but the Recipient and the closing brace.
+ * The buffer is sized for extra_capacity more bytes.
+ */
+static int s_kms_decrypt_request_template_write_head(
+    const struct aws_kms_decrypt_request_template *request_template,
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor ciphertext_blob,
+    size_t extra_capacity,
+    struct aws_byte_buf *json) {
+    /* Required parameter. */
+    if (ciphertext_blob.len == 0) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    size_t encoded_len = 0;
+    if (aws_base64_compute_encoded_len(ciphertext_blob.len, &encoded_len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    size_t capacity = sizeof(s_kms_decrypt_request_view_prefix) + encoded_len + 2 + request_template->members.len + 1;
+    if (aws_add_size_checked(capacity, extra_capacity, &capacity) != AWS_OP_SUCCESS ||
+        aws_byte_buf_init(json, allocator, capacity) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    struct aws_byte_cursor prefix = aws_byte_cursor_from_c_str(s_kms_decrypt_request_view_prefix);
+    struct aws_byte_cursor members = aws_byte_cursor_from_buf(&request_template->members);
+    if (aws_byte_buf_append_dynamic(json, &prefix) != AWS_OP_SUCCESS ||
+        s_json_append_base64(json, ciphertext_blob) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_dynamic(json, &members) != AWS_OP_SUCCESS) {
+        aws_byte_buf_clean_up(json);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_kms_decrypt_request_template_to_json(
+    const struct aws_kms_decrypt_request_template *request_template,
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor ciphertext_blob,
+    const struct aws_recipient *recipient,
+    struct aws_byte_buf *json) {
+    AWS_PRECONDITION(request_template != NULL);
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(json != NULL);
+
+    size_t extra_capacity = 0;
+    if (recipient != NULL) {
+        extra_capacity = recipient->attestation_document.len * 4 / 3 + 128;
+    }
+    if (s_kms_decrypt_request_template_write_head(request_template, allocator, ciphertext_blob, extra_capacity, json) !=
+        AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if ((recipient != NULL && s_kms_decrypt_request_write_recipient(json, recipient) != AWS_OP_SUCCESS) ||
+        aws_byte_buf_append_byte_dynamic(json, '}') != AWS_OP_SUCCESS) {
+        aws_byte_buf_clean_up(json);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 struct aws_kms_decrypt_request *aws_kms_decrypt_request_from_json(
     struct aws_allocator *allocator,
     const struct aws_string *json) {
@@ -2418,6 +2753,52 @@ void aws_kms_generate_random_response_destroy(struct aws_kms_generate_random_res
 
 AWS_STATIC_STRING_FROM_LITERAL(s_kms_string, "kms");
 
+#define KMS_DEFAULT_MAX_RETRIES 3
+#define KMS_DEFAULT_RETRY_BACKOFF_SCALE_FACTOR_MS 25
+
+#define KMS_DEFAULT_HEDGE_PERCENTILE 95
+#define KMS_DEFAULT_HEDGE_INITIAL_DELAY_MS 100
+#define KMS_DEFAULT_HEDGE_MIN_DELAY_MS 5
+#define KMS_DEFAULT_HEDGE_MAX_DELAY_MS 2000
+/* Number of recent latencies the hedge delay is derived from, and how many are needed first. */
+#define KMS_HEDGE_LATENCY_SAMPLES 128
+#define KMS_HEDGE_MIN_LATENCY_SAMPLES 20
+
+#define KMS_DEFAULT_CALL_ARENA_BLOCK_SIZE 32768
+/* Number of idle call arenas kept, which bounds the memory held for concurrent callers. */
+#define KMS_CALL_ARENA_POOL_SIZE 16
+
+#define KMS_DEFAULT_PUBLIC_KEY_CACHE_TTL_MS (5 * 60 * 1000)
+#define KMS_DEFAULT_KEY_POLICY_CACHE_TTL_MS (60 * 1000)
+#define KMS_DEFAULT_KEY_POLICY_NEGATIVE_CACHE_TTL_MS (10 * 1000)
+#define KMS_DEFAULT_KEY_POLICY_CACHE_MAX_ENTRIES 1024
+
+/**
+ * A public key fetched with GetPublicKey and cached by the client, by key id. The parsed key is
+ * shared with the encryptions in flight, which hold their own reference.
+ */
+struct kms_public_key {
+    struct aws_allocator *allocator;
+    struct aws_string *key_id;
+    struct aws_byte_buf public_key;
+    EVP_PKEY *pkey;
+    /* Bit (1 << algorithm) is set for every enum aws_encryption_algorithm the key supports. */
+    uint32_t encryption_algorithms;
+    uint64_t expires_at_ns;
+};
+
+static void s_kms_public_key_destroy(void *value) {
+    struct kms_public_key *entry = value;
+    if (entry == NULL) {
+        return;
+    }
+
+    EVP_PKEY_free(entry->pkey);
+    aws_byte_buf_clean_up(&entry->public_key);
+    aws_string_destroy(entry->key_id);
+    aws_mem_release(entry->allocator, entry);
+}
+
 struct aws_nitro_enclaves_kms_client_configuration *aws_nitro_enclaves_kms_client_config_default(
     struct aws_string *region,
     struct aws_socket_endpoint *endpoint,
@@ -2478,6 +2859,62 @@ void aws_nitro_enclaves_kms_client_config_destroy(struct aws_nitro_enclaves_kms_
     aws_mem_release(config->allocator, config);
 }
 
+/**
+ * Creates the rate limiter for a single KMS API. Leaves @limiter NULL if the API is not limited.
+ */
+static int s_kms_rate_limiter_new(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_kms_rate_limit *rate_limit,
+    struct aws_nitro_enclaves_rate_limiter **limiter) {
+    *limiter = NULL;
+    if (rate_limit->requests_per_second == 0) {
+        return AWS_OP_SUCCESS;
+    }
+
+    *limiter = aws_nitro_enclaves_rate_limiter_new(
+        allocator, rate_limit->requests_per_second, rate_limit->burst, rate_limit->max_wait_ms);
+    if (*limiter == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/**
+ * Applies the defaults to the hedging settings of a single KMS API and creates its latency tracker.
+ */
+static int s_kms_hedging_init(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_kms_hedging *configuration,
+    struct aws_nitro_enclaves_kms_hedging *hedging,
+    struct aws_nitro_enclaves_latency_tracker **latency) {
+    AWS_ZERO_STRUCT(*hedging);
+    *latency = NULL;
+    if (!configuration->enabled) {
+        return AWS_OP_SUCCESS;
+    }
+
+    hedging->enabled = true;
+    hedging->percentile = configuration->percentile != 0 ? AWS_MIN(configuration->percentile, 100)
+                                                         : KMS_DEFAULT_HEDGE_PERCENTILE;
+    hedging->initial_delay_ms =
+        configuration->initial_delay_ms != 0 ? configuration->initial_delay_ms : KMS_DEFAULT_HEDGE_INITIAL_DELAY_MS;
+    hedging->min_delay_ms =
+        configuration->min_delay_ms != 0 ? configuration->min_delay_ms : KMS_DEFAULT_HEDGE_MIN_DELAY_MS;
+    hedging->max_delay_ms =
+        configuration->max_delay_ms != 0 ? configuration->max_delay_ms : KMS_DEFAULT_HEDGE_MAX_DELAY_MS;
+    if (hedging->max_delay_ms < hedging->min_delay_ms) {
+        hedging->max_delay_ms = hedging->min_delay_ms;
+    }
+
+    *latency = aws_nitro_enclaves_latency_tracker_new(allocator, KMS_HEDGE_LATENCY_SAMPLES);
+    if (*latency == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 struct aws_nitro_enclaves_kms_client *aws_nitro_enclaves_kms_client_new(
     struct aws_nitro_enclaves_kms_client_configuration *configuration) {
     struct aws_allocator *allocator =
@@ -2499,6 +2936,9 @@ struct aws_nitro_enclaves_kms_client *aws_nitro_enclaves_kms_client_new(
         .credentials = configuration->credentials,
         .credentials_provider = configuration->credentials_provider,
         .host_name = configuration->host_name,
+        .request_timeout_ms = configuration->request_timeout_ms,
+        .bootstrap = configuration->bootstrap,
+        .tls_ctx = configuration->tls_ctx,
     };
 
     if (configuration->endpoint != NULL) {
@@ -2514,12 +2954,157 @@ struct aws_nitro_enclaves_kms_client *aws_nitro_enclaves_kms_client_new(
 
     client->keypair = aws_attestation_rsa_keypair_new(allocator, AWS_RSA_2048);
     if (client->keypair == NULL) {
-        aws_nitro_enclaves_rest_client_destroy(client->rest_client);
-        aws_mem_release(allocator, client);
-        return NULL;
+        goto err_clean;
+    }
+
+    if (configuration->retry_strategy != NULL) {
+        aws_retry_strategy_acquire(configuration->retry_strategy);
+        client->retry_strategy = configuration->retry_strategy;
+    } else if (!configuration->disable_retries) {
+        struct aws_standard_retry_options retry_options = {
+            .backoff_retry_options =
+                {
+                    .el_group = client->rest_client->el_group,
+                    .max_retries = configuration->max_retries != 0 ? configuration->max_retries
+                                                                   : KMS_DEFAULT_MAX_RETRIES,
+                    .backoff_scale_factor_ms = configuration->retry_backoff_scale_factor_ms != 0
+                                                   ? configuration->retry_backoff_scale_factor_ms
+                                                   : KMS_DEFAULT_RETRY_BACKOFF_SCALE_FACTOR_MS,
+                    .jitter_mode = AWS_EXPONENTIAL_BACKOFF_JITTER_FULL,
+                },
+            .initial_bucket_capacity = configuration->retry_initial_bucket_capacity,
+        };
+        client->retry_strategy = aws_retry_strategy_new_standard(allocator, &retry_options);
+        if (client->retry_strategy == NULL) {
+            goto err_clean;
+        }
+    }
+
+    if (aws_mutex_init(&client->mutex) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    client->attestation_document_ttl_ns = aws_timestamp_convert(
+        configuration->attestation_document_ttl_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+
+    /* The entries own their key id, which is the key of the table. */
+    if (aws_hash_table_init(
+            &client->public_keys,
+            allocator,
+            8,
+            aws_hash_string,
+            aws_hash_callback_string_eq,
+            NULL,
+            s_kms_public_key_destroy) != AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&client->mutex);
+        goto err_clean;
+    }
+    client->public_key_cache_ttl_ns = aws_timestamp_convert(
+        configuration->public_key_cache_ttl_ms != 0 ? configuration->public_key_cache_ttl_ms
+                                                    : KMS_DEFAULT_PUBLIC_KEY_CACHE_TTL_MS,
+        AWS_TIMESTAMP_MILLIS,
+        AWS_TIMESTAMP_NANOS,
+        NULL);
+
+    if (configuration->enable_key_policy_cache) {
+        client->key_policy_cache = aws_nitro_enclaves_key_policy_cache_new(
+            allocator,
+            configuration->key_policy_cache_ttl_ms != 0 ? configuration->key_policy_cache_ttl_ms
+                                                        : KMS_DEFAULT_KEY_POLICY_CACHE_TTL_MS,
+            configuration->key_policy_negative_cache_ttl_ms != 0 ? configuration->key_policy_negative_cache_ttl_ms
+                                                                 : KMS_DEFAULT_KEY_POLICY_NEGATIVE_CACHE_TTL_MS,
+            configuration->key_policy_cache_max_entries != 0 ? configuration->key_policy_cache_max_entries
+                                                             : KMS_DEFAULT_KEY_POLICY_CACHE_MAX_ENTRIES);
+        if (client->key_policy_cache == NULL) {
+            aws_mutex_clean_up(&client->mutex);
+            goto err_clean;
+        }
+    }
+
+    if (s_kms_rate_limiter_new(allocator, &configuration->decrypt_rate_limit, &client->decrypt_rate_limiter) !=
+            AWS_OP_SUCCESS ||
+        s_kms_rate_limiter_new(
+            allocator, &configuration->generate_data_key_rate_limit, &client->generate_data_key_rate_limiter) !=
+            AWS_OP_SUCCESS ||
+        s_kms_rate_limiter_new(
+            allocator, &configuration->generate_random_rate_limit, &client->generate_random_rate_limiter) !=
+            AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&client->mutex);
+        goto err_clean;
+    }
+
+    if (s_kms_hedging_init(
+            allocator, &configuration->decrypt_hedging, &client->decrypt_hedging, &client->decrypt_latency) !=
+            AWS_OP_SUCCESS ||
+        s_kms_hedging_init(
+            allocator,
+            &configuration->generate_random_hedging,
+            &client->generate_random_hedging,
+            &client->generate_random_latency) != AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&client->mutex);
+        goto err_clean;
+    }
+
+    /* Hedged requests go over their own connection, so they do not queue behind a slow response. */
+    if (client->decrypt_hedging.enabled || client->generate_random_hedging.enabled) {
+        client->hedge_rest_client = aws_nitro_enclaves_rest_client_new(&rest_configuration);
+        if (client->hedge_rest_client == NULL) {
+            aws_mutex_clean_up(&client->mutex);
+            goto err_clean;
+        }
+    }
+
+    if (configuration->enable_call_arena) {
+        size_t block_size = configuration->call_arena_block_size != 0 ? configuration->call_arena_block_size
+                                                                      : KMS_DEFAULT_CALL_ARENA_BLOCK_SIZE;
+        client->call_arena_pool = aws_nitro_enclaves_arena_pool_new(allocator, block_size, KMS_CALL_ARENA_POOL_SIZE);
+        if (client->call_arena_pool == NULL) {
+            aws_mutex_clean_up(&client->mutex);
+            goto err_clean;
+        }
+    }
+
+    if (configuration->enable_metrics) {
+        client->metrics = aws_nitro_enclaves_kms_metrics_recorder_new(
+            allocator,
+            configuration->metrics_dump_interval_ms,
+            configuration->metrics_dump_fn,
+            configuration->metrics_dump_user_data);
+        if (client->metrics == NULL) {
+            aws_mutex_clean_up(&client->mutex);
+            goto err_clean;
+        }
+    }
+
+    if (!configuration->disable_request_coalescing) {
+        client->decrypt_singleflight = aws_nitro_enclaves_singleflight_new(allocator);
+        if (client->decrypt_singleflight == NULL) {
+            aws_mutex_clean_up(&client->mutex);
+            goto err_clean;
+        }
     }
 
     return client;
+
+err_clean:
+    aws_nitro_enclaves_kms_metrics_recorder_destroy(client->metrics);
+    aws_hash_table_clean_up(&client->public_keys);
+    aws_nitro_enclaves_key_policy_cache_destroy(client->key_policy_cache);
+    aws_nitro_enclaves_arena_pool_destroy(client->call_arena_pool);
+    if (client->hedge_rest_client != NULL) {
+        aws_nitro_enclaves_rest_client_destroy(client->hedge_rest_client);
+    }
+    aws_nitro_enclaves_latency_tracker_destroy(client->decrypt_latency);
+    aws_nitro_enclaves_latency_tracker_destroy(client->generate_random_latency);
+    aws_nitro_enclaves_rate_limiter_destroy(client->decrypt_rate_limiter);
+    aws_nitro_enclaves_rate_limiter_destroy(client->generate_data_key_rate_limiter);
+    aws_nitro_enclaves_rate_limiter_destroy(client->generate_random_rate_limiter);
+    if (client->retry_strategy != NULL) {
+        aws_retry_strategy_release(client->retry_strategy);
+    }
+    aws_attestation_rsa_keypair_destroy(client->keypair);
+    aws_nitro_enclaves_rest_client_destroy(client->rest_client);
+    aws_mem_release(allocator, client);
+    return NULL;
 }
 
 void aws_nitro_enclaves_kms_client_destroy(struct aws_nitro_enclaves_kms_client *client) {
@@ -2527,62 +3112,567 @@ void aws_nitro_enclaves_kms_client_destroy(struct aws_nitro_enclaves_kms_client
         return;
     }
 
+    aws_nitro_enclaves_singleflight_destroy(client->decrypt_singleflight);
+    aws_nitro_enclaves_kms_metrics_recorder_destroy(client->metrics);
+    if (client->hedge_rest_client != NULL) {
+        aws_nitro_enclaves_rest_client_destroy(client->hedge_rest_client);
+    }
+    aws_nitro_enclaves_latency_tracker_destroy(client->decrypt_latency);
+    aws_nitro_enclaves_latency_tracker_destroy(client->generate_random_latency);
+    aws_nitro_enclaves_rate_limiter_destroy(client->decrypt_rate_limiter);
+    aws_nitro_enclaves_rate_limiter_destroy(client->generate_data_key_rate_limiter);
+    aws_nitro_enclaves_rate_limiter_destroy(client->generate_random_rate_limiter);
+    aws_nitro_enclaves_arena_pool_destroy(client->call_arena_pool);
+    aws_byte_buf_clean_up(&client->attestation_document);
+    aws_byte_buf_clean_up(&client->recipient_json);
+    aws_hash_table_clean_up(&client->public_keys);
+    aws_nitro_enclaves_key_policy_cache_destroy(client->key_policy_cache);
+    aws_mutex_clean_up(&client->mutex);
+    if (client->retry_strategy != NULL) {
+        aws_retry_strategy_release(client->retry_strategy);
+    }
     aws_attestation_rsa_keypair_destroy(client->keypair);
     aws_nitro_enclaves_rest_client_destroy(client->rest_client);
     aws_mem_release(client->allocator, client);
 }
 
-static int s_aws_nitro_enclaves_kms_client_call_blocking(
+int aws_nitro_enclaves_kms_client_get_metrics(
     struct aws_nitro_enclaves_kms_client *client,
-    struct aws_byte_cursor target,
-    struct aws_string *request,
-    struct aws_string **response) {
-    *response = NULL;
+    struct aws_nitro_enclaves_kms_metrics *metrics) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(metrics != NULL);
 
-    struct aws_nitro_enclaves_rest_response *rest_response = aws_nitro_enclaves_rest_client_request_blocking(
-        client->rest_client,
-        aws_http_method_post,
-        aws_byte_cursor_from_c_str("/"),
-        target,
-        aws_byte_cursor_from_string(request));
-    if (rest_response == NULL) {
-        return AWS_OP_ERR;
+    if (client->metrics == NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
     }
 
-    struct aws_input_stream *request_stream = aws_http_message_get_body_stream(rest_response->response);
-    struct aws_byte_buf response_data;
-    int64_t length;
-    aws_input_stream_get_length(request_stream, &length);
+    aws_nitro_enclaves_kms_metrics_snapshot(client->metrics, metrics);
+    return AWS_OP_SUCCESS;
+}
 
-    aws_byte_buf_init(&response_data, client->allocator, length);
-    aws_input_stream_read(request_stream, &response_data);
-    *response = aws_string_new_from_array(client->allocator, response_data.buffer, response_data.len);
-    aws_byte_buf_clean_up(&response_data);
+/* The start time of a stage, only read from the clock if metrics are enabled. */
+static uint64_t s_kms_metrics_start(const struct aws_nitro_enclaves_kms_client *client) {
+    uint64_t now_ns = 0;
+    if (client->metrics != NULL) {
+        aws_high_res_clock_get_ticks(&now_ns);
+    }
+    return now_ns;
+}
 
-    int status = AWS_OP_SUCCESS;
-    aws_http_message_get_response_status(rest_response->response, &status);
-    aws_nitro_enclaves_rest_response_destroy(rest_response);
+static void s_kms_metrics_stage_end(
+    const struct aws_nitro_enclaves_kms_client *client,
+    enum aws_kms_stage stage,
+    uint64_t start_ns) {
+    if (client->metrics == NULL) {
+        return;
+    }
 
-    return status;
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    aws_nitro_enclaves_kms_metrics_record_stage(client->metrics, stage, now_ns - start_ns);
 }
 
-static int s_decrypt_ciphertext_for_recipient(
-    struct aws_allocator *allocator,
-    struct aws_byte_buf *ciphertext_for_recipient,
-    struct aws_rsa_keypair *keypair,
-    struct aws_byte_buf *plaintext) {
-    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
-    AWS_PRECONDITION(aws_byte_buf_is_valid(ciphertext_for_recipient));
-    AWS_PRECONDITION(keypair != NULL);
-
-    struct aws_byte_buf encrypted_symm_key, decrypted_symm_key, iv, ciphertext_out;
+/**
+ * Replaces the cached attestation document if it is older than the configured TTL, dropping the
+ * Recipient member rendered from it. Must be called with the client mutex held.
+ */
+static int s_kms_client_refresh_attestation_document_synced(
+    struct aws_nitro_enclaves_kms_client *client,
+    uint64_t now,
+    bool *cache_hit) {
+    *cache_hit = client->attestation_document.len != 0 &&
+                 now - client->attestation_document_timestamp_ns < client->attestation_document_ttl_ns;
+    if (*cache_hit) {
+        return AWS_OP_SUCCESS;
+    }
+
+    aws_byte_buf_clean_up(&client->attestation_document);
+    aws_byte_buf_clean_up(&client->recipient_json);
+    client->attestation_document_timestamp_ns = now;
+    return aws_attestation_request(client->allocator, client->keypair, &client->attestation_document);
+}
+
+/**
+ * Produces an attestation document for the client keypair, reusing the cached one while it is
+ * younger than the configured TTL.
+ */
+static int s_kms_client_new_attestation_document(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    struct aws_byte_buf *attestation_document) {
+    if (client->attestation_document_ttl_ns == 0) {
+        aws_nitro_enclaves_kms_metrics_record_attestation(client->metrics, false);
+        return aws_attestation_request(allocator, client->keypair, attestation_document);
+    }
+
+    uint64_t now = 0;
+    if (aws_high_res_clock_get_ticks(&now) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    bool cache_hit = false;
+    aws_mutex_lock(&client->mutex);
+    int rc = s_kms_client_refresh_attestation_document_synced(client, now, &cache_hit);
+    if (rc == AWS_OP_SUCCESS) {
+        rc = aws_byte_buf_init_copy(attestation_document, allocator, &client->attestation_document);
+    }
+    aws_mutex_unlock(&client->mutex);
+
+    aws_nitro_enclaves_kms_metrics_record_attestation(client->metrics, cache_hit);
+
+    return rc;
+}
+
+static int s_kms_client_attestation_document(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    struct aws_byte_buf *attestation_document) {
+    uint64_t start_ns = s_kms_metrics_start(client);
+    int rc = s_kms_client_new_attestation_document(client, allocator, attestation_document);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_ATTESTATION, start_ns);
+
+    return rc;
+}
+
+/**
+ * Appends the Recipient member of the client to a Decrypt request. While attestation documents are
+ * cached, the member is rendered once per document and copied afterwards.
+ */
+static int s_kms_client_append_recipient(struct aws_nitro_enclaves_kms_client *client, struct aws_byte_buf *json) {
+    if (client->attestation_document_ttl_ns == 0) {
+        struct aws_recipient *recipient = aws_recipient_new(client->allocator);
+        if (recipient == NULL) {
+            return AWS_OP_ERR;
+        }
+        recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
+        int rc = s_kms_client_attestation_document(client, client->allocator, &recipient->attestation_document);
+        if (rc == AWS_OP_SUCCESS) {
+            rc = s_kms_decrypt_request_write_recipient(json, recipient);
+        }
+        aws_recipient_destroy(recipient);
+        return rc;
+    }
+
+    uint64_t start_ns = s_kms_metrics_start(client);
+    uint64_t now = 0;
+    if (aws_high_res_clock_get_ticks(&now) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    bool cache_hit = false;
+    aws_mutex_lock(&client->mutex);
+    int rc = s_kms_client_refresh_attestation_document_synced(client, now, &cache_hit);
+    if (rc == AWS_OP_SUCCESS && client->recipient_json.len == 0) {
+        struct aws_recipient recipient = {
+            .key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256,
+            .attestation_document = client->attestation_document,
+        };
+        aws_byte_buf_clean_up(&client->recipient_json);
+        rc = aws_byte_buf_init(
+            &client->recipient_json, client->allocator, client->attestation_document.len * 4 / 3 + 128);
+        if (rc == AWS_OP_SUCCESS) {
+            rc = s_kms_decrypt_request_write_recipient(&client->recipient_json, &recipient);
+        }
+        if (rc != AWS_OP_SUCCESS) {
+            aws_byte_buf_clean_up(&client->recipient_json);
+        }
+    }
+    if (rc == AWS_OP_SUCCESS) {
+        struct aws_byte_cursor member = aws_byte_cursor_from_buf(&client->recipient_json);
+        rc = aws_byte_buf_append_dynamic(json, &member);
+    }
+    aws_mutex_unlock(&client->mutex);
+
+    aws_nitro_enclaves_kms_metrics_record_attestation(client->metrics, cache_hit);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_ATTESTATION, start_ns);
+
+    return rc;
+}
+
+/**
+ * The allocator of the temporary objects of one blocking call: an arena taken from the client pool,
+ * or the client allocator if call arenas are disabled or no arena could be obtained.
+ */
+struct kms_call_scope {
+    struct aws_nitro_enclaves_arena *arena;
+    struct aws_allocator *allocator;
+};
+
+static void s_kms_call_scope_begin(struct aws_nitro_enclaves_kms_client *client, struct kms_call_scope *scope) {
+    scope->arena = NULL;
+    if (client->call_arena_pool != NULL) {
+        scope->arena = aws_nitro_enclaves_arena_pool_get(client->call_arena_pool);
+    }
+    scope->allocator = scope->arena != NULL ? aws_nitro_enclaves_arena_allocator(scope->arena) : client->allocator;
+}
+
+/* Wipes and recycles the call arena. Every object allocated from the scope must be destroyed first. */
+static void s_kms_call_scope_end(struct kms_call_scope *scope) {
+    aws_nitro_enclaves_arena_release(scope->arena);
+    scope->arena = NULL;
+}
+
+/**
+ * Client-side policies applied to the calls of a single KMS API. NULL members disable the policy.
+ */
+struct kms_call_policy {
+    struct aws_nitro_enclaves_rate_limiter *rate_limiter;
+    const struct aws_nitro_enclaves_kms_hedging *hedging;
+    struct aws_nitro_enclaves_latency_tracker *latency;
+};
+
+/* Hedged copies are only sent while the API is within its rate limit. */
+static bool s_kms_should_hedge(void *user_data) {
+    return aws_nitro_enclaves_rate_limiter_try_acquire(user_data);
+}
+
+/**
+ * The hedge delay of an API: the configured percentile of its recent latencies, within bounds.
+ */
+static uint32_t s_kms_hedge_delay_ms(const struct kms_call_policy *policy) {
+    const struct aws_nitro_enclaves_kms_hedging *hedging = policy->hedging;
+
+    uint64_t latency_ns = 0;
+    if (!aws_nitro_enclaves_latency_tracker_percentile(
+            policy->latency, hedging->percentile, KMS_HEDGE_MIN_LATENCY_SAMPLES, &latency_ns)) {
+        return hedging->initial_delay_ms;
+    }
+
+    uint64_t delay_ms = aws_timestamp_convert(latency_ns, AWS_TIMESTAMP_NANOS, AWS_TIMESTAMP_MILLIS, NULL) + 1;
+    delay_ms = AWS_MAX(delay_ms, (uint64_t)hedging->min_delay_ms);
+    delay_ms = AWS_MIN(delay_ms, (uint64_t)hedging->max_delay_ms);
+
+    return (uint32_t)delay_ms;
+}
+
+/**
+ * Returns the "__type" member of a parsed KMS error response without its namespace, as in
+ * "ThrottlingException" for "com.amazonaws.kms#ThrottlingException", or NULL if there is none.
+ */
+static const char *s_kms_error_type(struct json_object *obj) {
+    struct json_object *type = json_object_object_get(obj, "__type");
+    if (type == NULL || !json_object_is_type(type, json_type_string)) {
+        return NULL;
+    }
+
+    const char *type_str = json_object_get_string(type);
+    const char *separator = strrchr(type_str, '#');
+    return separator != NULL ? separator + 1 : type_str;
+}
+
+/* Records a request attempt, with the error type of an error response. */
+static void s_kms_metrics_record_attempt(
+    const struct aws_nitro_enclaves_kms_client *client,
+    int status,
+    const struct aws_string *request,
+    const struct aws_string *response) {
+    struct aws_byte_cursor error_type;
+    AWS_ZERO_STRUCT(error_type);
+
+    struct json_object *obj = NULL;
+    if (status != 200 && response != NULL) {
+        obj = s_json_object_from_string(response);
+        const char *type = obj != NULL ? s_kms_error_type(obj) : NULL;
+        if (type != NULL) {
+            error_type = aws_byte_cursor_from_c_str(type);
+        }
+    }
+
+    aws_nitro_enclaves_kms_metrics_record_attempt(
+        client->metrics, status, error_type, request->len, response != NULL ? response->len : 0);
+    if (obj != NULL) {
+        json_object_put(obj);
+    }
+}
+
+static int s_aws_nitro_enclaves_kms_client_call_once(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct kms_call_policy *policy,
+    struct aws_byte_cursor target,
+    struct aws_string *request,
+    struct aws_string **response) {
+    *response = NULL;
+
+    struct aws_nitro_enclaves_rest_request_options options;
+    AWS_ZERO_STRUCT(options);
+    bool hedged = policy != NULL && policy->hedging != NULL && policy->hedging->enabled &&
+                  client->hedge_rest_client != NULL;
+    if (hedged) {
+        options.hedge_client = client->hedge_rest_client;
+        options.hedge_delay_ms = s_kms_hedge_delay_ms(policy);
+        options.should_hedge = s_kms_should_hedge;
+        options.should_hedge_user_data = policy->rate_limiter;
+    }
+
+    uint64_t start_ns = 0;
+    aws_high_res_clock_get_ticks(&start_ns);
+
+    struct aws_nitro_enclaves_rest_response *rest_response =
+        aws_nitro_enclaves_rest_client_request_blocking_with_options(
+            client->rest_client,
+            aws_http_method_post,
+            aws_byte_cursor_from_c_str("/"),
+            target,
+            aws_byte_cursor_from_string(request),
+            &options);
+    if (rest_response == NULL) {
+        if (client->metrics != NULL) {
+            s_kms_metrics_record_attempt(client, AWS_OP_ERR, request, NULL);
+        }
+        return AWS_OP_ERR;
+    }
+
+    struct aws_input_stream *request_stream = aws_http_message_get_body_stream(rest_response->response);
+    struct aws_byte_buf response_data;
+    int64_t length;
+    aws_input_stream_get_length(request_stream, &length);
+
+    aws_byte_buf_init(&response_data, allocator, length);
+    aws_input_stream_read(request_stream, &response_data);
+    *response = aws_string_new_from_array(allocator, response_data.buffer, response_data.len);
+    aws_byte_buf_clean_up(&response_data);
+
+    int status = AWS_OP_SUCCESS;
+    aws_http_message_get_response_status(rest_response->response, &status);
+    uint64_t sign_ns = rest_response->sign_duration_ns;
+    aws_nitro_enclaves_rest_response_destroy(rest_response);
+
+    uint64_t end_ns = 0;
+    aws_high_res_clock_get_ticks(&end_ns);
+    if (hedged && status == 200) {
+        aws_nitro_enclaves_latency_tracker_record(policy->latency, end_ns - start_ns);
+    }
+
+    if (client->metrics != NULL) {
+        /* The request is signed within the rest client call; the rest of it is spent on the network. */
+        uint64_t network_ns = end_ns - start_ns;
+        aws_nitro_enclaves_kms_metrics_record_stage(client->metrics, AWS_KMS_STAGE_SIGN, sign_ns);
+        aws_nitro_enclaves_kms_metrics_record_stage(
+            client->metrics, AWS_KMS_STAGE_NETWORK, network_ns > sign_ns ? network_ns - sign_ns : 0);
+        s_kms_metrics_record_attempt(client, status, request, *response);
+    }
+
+    return status;
+}
+
+/**
+ * Checks the "__type" member of a KMS error response against an exception name. The type may be
+ * qualified with a namespace, as in "com.amazonaws.kms#ThrottlingException".
+ */
+static bool s_is_kms_exception(const struct aws_string *response, const char *exception) {
+    if (response == NULL) {
+        return false;
+    }
+
+    struct json_object *obj = s_json_object_from_string(response);
+    if (obj == NULL) {
+        return false;
+    }
+
+    const char *type = s_kms_error_type(obj);
+    bool matches = type != NULL && strcmp(type, exception) == 0;
+    json_object_put(obj);
+
+    return matches;
+}
+
+bool aws_nitro_enclaves_kms_call_is_retryable(
+    int status,
+    int error_code,
+    const struct aws_string *response,
+    enum aws_retry_error_type *error_type) {
+    if (status == AWS_OP_ERR) {
+        /* The deadline or the cancellation of the request also covers its retries. */
+        if (error_code == AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT ||
+            error_code == AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED) {
+            return false;
+        }
+        /* No response at all: the connection failed or was lost. */
+        *error_type = AWS_RETRY_ERROR_TYPE_TRANSIENT;
+        return true;
+    }
+
+    if (status == 429 || (status == 400 && s_is_kms_exception(response, "ThrottlingException"))) {
+        *error_type = AWS_RETRY_ERROR_TYPE_THROTTLING;
+        return true;
+    }
+
+    if (status >= 500 && status < 600) {
+        *error_type = AWS_RETRY_ERROR_TYPE_SERVER_ERROR;
+        return true;
+    }
+
+    return false;
+}
+
+struct kms_retry_ctx {
+    /* Completed by the retry strategy callbacks, and reused for every wait of the call. */
+    struct aws_nitro_enclaves_future *future;
+    struct aws_retry_token *token;
+};
+
+static void s_kms_retry_ctx_signal(struct kms_retry_ctx *ctx, int error_code) {
+    aws_nitro_enclaves_future_complete(ctx->future, error_code);
+}
+
+static int s_kms_retry_ctx_wait(struct kms_retry_ctx *ctx) {
+    aws_nitro_enclaves_future_wait(ctx->future, 0);
+    int error_code = aws_nitro_enclaves_future_get_error(ctx->future);
+    aws_nitro_enclaves_future_reset(ctx->future);
+
+    return error_code == AWS_ERROR_SUCCESS ? AWS_OP_SUCCESS : aws_raise_error(error_code);
+}
+
+static void s_on_retry_token_acquired(
+    struct aws_retry_strategy *retry_strategy,
+    int error_code,
+    struct aws_retry_token *token,
+    void *user_data) {
+    (void)retry_strategy;
+    struct kms_retry_ctx *ctx = user_data;
+    ctx->token = token;
+    s_kms_retry_ctx_signal(ctx, error_code);
+}
+
+static void s_on_retry_ready(struct aws_retry_token *token, int error_code, void *user_data) {
+    (void)token;
+    s_kms_retry_ctx_signal(user_data, error_code);
+}
+
+/**
+ * Performs a KMS call, retrying throttled and transient failures according to the client retry
+ * strategy. The same serialized request, including its attestation document, is sent on every
+ * attempt.
+ *
+ * Every attempt, including retries, is first admitted by the rate limiter of @policy, if set.
+ * A call refused by the rate limiter is not retried. Attempts are hedged if @policy enables it.
+ *
+ * @return The HTTP status of the last attempt, or AWS_OP_ERR if no response was received.
+ */
+static int s_aws_nitro_enclaves_kms_client_call_with_retries(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct kms_call_policy *policy,
+    struct aws_byte_cursor target,
+    struct aws_string *request,
+    struct aws_string **response) {
+    struct aws_nitro_enclaves_rate_limiter *rate_limiter = policy != NULL ? policy->rate_limiter : NULL;
+    if (client->retry_strategy == NULL) {
+        *response = NULL;
+        if (aws_nitro_enclaves_rate_limiter_acquire(rate_limiter) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        return s_aws_nitro_enclaves_kms_client_call_once(client, allocator, policy, target, request, response);
+    }
+
+    struct kms_retry_ctx ctx;
+    AWS_ZERO_STRUCT(ctx);
+    ctx.future = aws_nitro_enclaves_future_pool_get(client->rest_client->future_pool);
+    if (ctx.future == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    int status = AWS_OP_ERR;
+    *response = NULL;
+
+    /* The retry budget is shared by all calls to the same endpoint. */
+    struct aws_byte_cursor partition = aws_byte_cursor_from_string(client->rest_client->host_name);
+    if (aws_retry_strategy_acquire_retry_token(
+            client->retry_strategy, &partition, s_on_retry_token_acquired, &ctx, 0) != AWS_OP_SUCCESS ||
+        s_kms_retry_ctx_wait(&ctx) != AWS_OP_SUCCESS) {
+        /* Without a token the call is still made, just never retried. */
+        if (aws_nitro_enclaves_rate_limiter_acquire(rate_limiter) == AWS_OP_SUCCESS) {
+            status = s_aws_nitro_enclaves_kms_client_call_once(client, allocator, policy, target, request, response);
+        }
+        goto finalize;
+    }
+
+    while (true) {
+        if (aws_nitro_enclaves_rate_limiter_acquire(rate_limiter) != AWS_OP_SUCCESS) {
+            status = AWS_OP_ERR;
+            break;
+        }
+
+        status = s_aws_nitro_enclaves_kms_client_call_once(client, allocator, policy, target, request, response);
+
+        enum aws_retry_error_type error_type = AWS_RETRY_ERROR_TYPE_CLIENT_ERROR;
+        if (!aws_nitro_enclaves_kms_call_is_retryable(status, aws_last_error(), *response, &error_type)) {
+            if (status == 200) {
+                aws_retry_token_record_success(ctx.token);
+            }
+            break;
+        }
+
+        /* Fails once the retry budget or the maximum number of retries is exhausted. */
+        if (aws_retry_strategy_schedule_retry(ctx.token, error_type, s_on_retry_ready, &ctx) != AWS_OP_SUCCESS) {
+            break;
+        }
+        if (s_kms_retry_ctx_wait(&ctx) != AWS_OP_SUCCESS) {
+            break;
+        }
+
+        AWS_LOGF_WARN(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Retrying KMS call after status %d.", (void *)client, status);
+        aws_string_destroy(*response);
+        *response = NULL;
+    }
+
+finalize:
+    if (ctx.token != NULL) {
+        aws_retry_token_release(ctx.token);
+    }
+    aws_nitro_enclaves_future_release(ctx.future);
+
+    return status;
+}
+
+/**
+ * Performs a KMS call with retries, accounting it to @operation in the client metrics.
+ *
+ * @return The HTTP status of the last attempt, or AWS_OP_ERR if no response was received.
+ */
+static int s_aws_nitro_enclaves_kms_client_call_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct kms_call_policy *policy,
+    enum aws_kms_operation operation,
+    struct aws_byte_cursor target,
+    struct aws_string *request,
+    struct aws_string **response) {
+    uint64_t start_ns = s_kms_metrics_start(client);
+    int status =
+        s_aws_nitro_enclaves_kms_client_call_with_retries(client, allocator, policy, target, request, response);
+
+    if (client->metrics != NULL) {
+        uint64_t end_ns = 0;
+        aws_high_res_clock_get_ticks(&end_ns);
+        aws_nitro_enclaves_kms_metrics_record_call(client->metrics, operation, status == 200, end_ns - start_ns);
+    }
+
+    return status;
+}
+
+/* Decrypts a ciphertext KMS encrypted for the client keypair. The plaintext uses the client allocator. */
+static int s_decrypt_ciphertext_for_recipient(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_byte_buf *ciphertext_for_recipient,
+    struct aws_byte_buf *plaintext) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(aws_byte_buf_is_valid(ciphertext_for_recipient));
+    AWS_PRECONDITION(client->keypair != NULL);
+
+    struct aws_byte_buf encrypted_symm_key, decrypted_symm_key, iv, ciphertext_out;
+    uint64_t start_ns = s_kms_metrics_start(client);
     int rc = aws_cms_parse_enveloped_data(ciphertext_for_recipient, &encrypted_symm_key, &iv, &ciphertext_out);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_CMS_PARSE, start_ns);
     if (rc != AWS_OP_SUCCESS) {
-        fprintf(stderr, "Cannot parse CMS enveloped data.\n");
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Cannot parse CMS enveloped data.", (void *)client);
         return AWS_OP_ERR;
     }
 
-    rc = aws_attestation_rsa_decrypt(allocator, keypair, &encrypted_symm_key, &decrypted_symm_key);
+    start_ns = s_kms_metrics_start(client);
+    rc = aws_attestation_rsa_decrypt(client->allocator, client->keypair, &encrypted_symm_key, &decrypted_symm_key);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_RSA_DECRYPT, start_ns);
     if (rc != AWS_OP_SUCCESS) {
         aws_byte_buf_clean_up(&encrypted_symm_key);
         aws_byte_buf_clean_up(&iv);
@@ -2590,9 +3680,11 @@ static int s_decrypt_ciphertext_for_recipient(
         return rc;
     }
 
+    start_ns = s_kms_metrics_start(client);
     rc = aws_cms_cipher_decrypt(&ciphertext_out, &decrypted_symm_key, &iv, plaintext);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_AES_DECRYPT, start_ns);
     if (rc != AWS_OP_SUCCESS) {
-        fprintf(stderr, "Cannot decrypt CMS encrypted content\n");
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Cannot decrypt CMS encrypted content.", (void *)client);
         return rc;
     }
 
@@ -2614,37 +3706,86 @@ static struct aws_byte_cursor kms_target_list_key_policies =
     AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("TrentService.ListKeyPolicies");
 static struct aws_byte_cursor kms_target_get_key_policy =
     AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("TrentService.GetKeyPolicy");
+static struct aws_byte_cursor kms_target_get_public_key =
+    AWS_BYTE_CUR_INIT_FROM_STRING_LITERAL("TrentService.GetPublicKey");
 
-static struct aws_kms_decrypt_response *s_kms_get_decrypt_response_from_request(
+/* Calls Decrypt with a serialized request. */
+static struct aws_kms_decrypt_response *s_kms_get_decrypt_response_from_json(
     struct aws_nitro_enclaves_kms_client *client,
-    const struct aws_kms_decrypt_request *request_structure) {
-    AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(request_structure != NULL);
+    struct aws_allocator *allocator,
+    struct aws_string *request) {
     struct aws_string *response = NULL;
-    struct aws_string *request = NULL;
     struct aws_kms_decrypt_response *response_structure = NULL;
     int rc = 0;
 
-    request = aws_kms_decrypt_request_to_json(request_structure);
-    if (request == NULL) {
-        goto finalize;
-    }
-
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_decrypt, request, &response);
+    struct kms_call_policy policy = {
+        .rate_limiter = client->decrypt_rate_limiter,
+        .hedging = &client->decrypt_hedging,
+        .latency = client->decrypt_latency,
+    };
+    rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client, allocator, &policy, AWS_KMS_OPERATION_DECRYPT, kms_target_decrypt, request, &response);
     if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for Decrypt: %d.",
+            (void *)client,
+            rc);
         goto finalize;
     }
 
-    response_structure = aws_kms_decrypt_response_from_json(client->allocator, response);
+    uint64_t start_ns = s_kms_metrics_start(client);
+    response_structure = aws_kms_decrypt_response_from_json(allocator, response);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_PARSE, start_ns);
 
 finalize:
-    aws_string_destroy(request);
     aws_string_destroy(response);
 
     return response_structure;
 }
 
+static struct aws_kms_decrypt_response *s_kms_get_decrypt_response_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request *request_structure) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(request_structure != NULL);
+
+    uint64_t start_ns = s_kms_metrics_start(client);
+    struct aws_string *request = aws_kms_decrypt_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (request == NULL) {
+        return NULL;
+    }
+
+    struct aws_kms_decrypt_response *response_structure =
+        s_kms_get_decrypt_response_from_json(client, allocator, request);
+    aws_string_destroy(request);
+
+    return response_structure;
+}
+
+/* The plaintext is allocated with the client allocator, everything else of the call with @allocator. */
+static int s_kms_decrypt_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct aws_kms_decrypt_request *request_structure,
+    struct aws_byte_buf *plaintext) {
+    struct aws_kms_decrypt_response *response_structure = NULL;
+    int rc = AWS_OP_ERR;
+
+    response_structure = s_kms_get_decrypt_response_from_request(client, allocator, request_structure);
+    if (response_structure == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not read Decrypt response from KMS.", (void *)client);
+    } else {
+        rc = s_decrypt_ciphertext_for_recipient(client, &response_structure->ciphertext_for_recipient, plaintext);
+    }
+
+    aws_kms_decrypt_response_destroy(response_structure);
+
+    return rc;
+}
+
 int aws_kms_decrypt_blocking(
     struct aws_nitro_enclaves_kms_client *client,
     const struct aws_string *key_id,
@@ -2655,29 +3796,29 @@ int aws_kms_decrypt_blocking(
         client, key_id, encryption_algorithm, ciphertext, NULL, plaintext);
 }
 
-int aws_kms_decrypt_blocking_with_context(
+static int s_kms_decrypt_blocking_with_context(
     struct aws_nitro_enclaves_kms_client *client,
     const struct aws_string *key_id,
     const struct aws_string *encryption_algorithm,
     const struct aws_byte_buf *ciphertext,
     const struct aws_string *encryption_context,
     struct aws_byte_buf *plaintext) {
-    AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(ciphertext != NULL);
-    AWS_PRECONDITION(plaintext != NULL);
-
     struct aws_kms_decrypt_request *request_structure = NULL;
     int rc = 0;
 
-    request_structure = aws_kms_decrypt_request_new(client->allocator);
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    request_structure = aws_kms_decrypt_request_new(scope.allocator);
     if (request_structure == NULL) {
+        s_kms_call_scope_end(&scope);
         return AWS_OP_ERR;
     }
 
-    aws_byte_buf_init_copy(&request_structure->ciphertext_blob, client->allocator, ciphertext);
+    aws_byte_buf_init_copy(&request_structure->ciphertext_blob, scope.allocator, ciphertext);
 
     if (key_id != NULL) {
-        request_structure->key_id = aws_string_clone_or_reuse(client->allocator, key_id);
+        request_structure->key_id = aws_string_clone_or_reuse(scope.allocator, key_id);
         if (aws_string_compare(encryption_algorithm, s_ea_symmetric_default) == 0) {
             request_structure->encryption_algorithm = AWS_EA_SYMMETRIC_DEFAULT;
         } else if (aws_string_compare(encryption_algorithm, s_ea_rsaes_oaep_sha_1) == 0) {
@@ -2685,17 +3826,17 @@ int aws_kms_decrypt_blocking_with_context(
         } else if (aws_string_compare(encryption_algorithm, s_ea_rsaes_oaep_sha_256) == 0) {
             request_structure->encryption_algorithm = AWS_EA_RSAES_OAEP_SHA_256;
         } else {
-            fprintf(stderr, "Invalid encryption algorithm\n");
+            AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Invalid encryption algorithm.", (void *)client);
             goto err_clean;
         }
     }
 
-    request_structure->recipient = aws_recipient_new(client->allocator);
+    request_structure->recipient = aws_recipient_new(scope.allocator);
     if (request_structure->recipient == NULL) {
         goto err_clean;
     }
-    rc = aws_attestation_request(
-        client->allocator, client->keypair, &request_structure->recipient->attestation_document);
+    rc = s_kms_client_attestation_document(
+        client, scope.allocator, &request_structure->recipient->attestation_document);
     if (rc != AWS_OP_SUCCESS) {
         goto err_clean;
     }
@@ -2703,23 +3844,116 @@ int aws_kms_decrypt_blocking_with_context(
 
     if (encryption_context) {
         struct json_object *context_json = s_json_object_from_string(encryption_context);
-        rc = s_aws_hash_table_from_json(client->allocator, context_json, &request_structure->encryption_context);
+        rc = s_aws_hash_table_from_json(scope.allocator, context_json, &request_structure->encryption_context);
         json_object_put(context_json);
         if (rc != AWS_OP_SUCCESS) {
             goto err_clean;
         }
     }
 
-    rc = aws_kms_decrypt_blocking_from_request(client, request_structure, plaintext);
+    rc = s_kms_decrypt_from_request(client, scope.allocator, request_structure, plaintext);
 
     aws_kms_decrypt_request_destroy(request_structure);
+    s_kms_call_scope_end(&scope);
     return rc;
 
 err_clean:
     aws_kms_decrypt_request_destroy(request_structure);
+    s_kms_call_scope_end(&scope);
     return AWS_OP_ERR;
 }
 
+/* The arguments of a Decrypt call that identical calls wait for. */
+struct kms_decrypt_args {
+    struct aws_nitro_enclaves_kms_client *client;
+    const struct aws_string *key_id;
+    const struct aws_string *encryption_algorithm;
+    const struct aws_byte_buf *ciphertext;
+    const struct aws_string *encryption_context;
+};
+
+static int s_kms_decrypt_call(void *user_data, struct aws_byte_buf *plaintext) {
+    struct kms_decrypt_args *args = user_data;
+    return s_kms_decrypt_blocking_with_context(
+        args->client, args->key_id, args->encryption_algorithm, args->ciphertext, args->encryption_context, plaintext);
+}
+
+/**
+ * Builds the key Decrypt calls are coalesced by: every argument that goes into the request, each
+ * prefixed with its length. Encryption contexts are compared as given, not as parsed.
+ */
+static int s_kms_decrypt_coalescing_key(
+    struct aws_allocator *allocator,
+    const struct kms_decrypt_args *args,
+    struct aws_byte_buf *key) {
+    struct aws_byte_cursor empty = {0};
+    struct aws_byte_cursor fields[] = {
+        args->key_id != NULL ? aws_byte_cursor_from_string(args->key_id) : empty,
+        args->encryption_algorithm != NULL ? aws_byte_cursor_from_string(args->encryption_algorithm) : empty,
+        aws_byte_cursor_from_buf(args->ciphertext),
+        args->encryption_context != NULL ? aws_byte_cursor_from_string(args->encryption_context) : empty,
+    };
+
+    size_t key_len = 0;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(fields); ++i) {
+        key_len += sizeof(uint32_t) + fields[i].len;
+    }
+    if (aws_byte_buf_init(key, allocator, key_len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(fields); ++i) {
+        aws_byte_buf_write_be32(key, (uint32_t)fields[i].len);
+        aws_byte_buf_write_from_whole_cursor(key, fields[i]);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_kms_decrypt_blocking_with_context(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    const struct aws_string *encryption_algorithm,
+    const struct aws_byte_buf *ciphertext,
+    const struct aws_string *encryption_context,
+    struct aws_byte_buf *plaintext) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(ciphertext != NULL);
+    AWS_PRECONDITION(plaintext != NULL);
+
+    if (client->decrypt_singleflight == NULL) {
+        return s_kms_decrypt_blocking_with_context(
+            client, key_id, encryption_algorithm, ciphertext, encryption_context, plaintext);
+    }
+
+    struct kms_decrypt_args args = {
+        .client = client,
+        .key_id = key_id,
+        .encryption_algorithm = encryption_algorithm,
+        .ciphertext = ciphertext,
+        .encryption_context = encryption_context,
+    };
+    struct aws_byte_buf key;
+    if (s_kms_decrypt_coalescing_key(client->allocator, &args, &key) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    bool shared = false;
+    int rc = aws_nitro_enclaves_singleflight_do(
+        client->decrypt_singleflight,
+        aws_byte_cursor_from_buf(&key),
+        s_kms_decrypt_call,
+        &args,
+        client->allocator,
+        plaintext,
+        &shared);
+    if (shared) {
+        AWS_LOGF_DEBUG(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Decrypt call coalesced with one in flight.", (void *)client);
+    }
+    aws_byte_buf_clean_up(&key);
+
+    return rc;
+}
+
 int aws_kms_decrypt_blocking_from_request(
     struct aws_nitro_enclaves_kms_client *client,
     const struct aws_kms_decrypt_request *request_structure,
@@ -2728,24 +3962,113 @@ int aws_kms_decrypt_blocking_from_request(
     AWS_PRECONDITION(request_structure != NULL);
     AWS_PRECONDITION(plaintext != NULL);
 
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_decrypt_from_request(client, scope.allocator, request_structure, plaintext);
+    s_kms_call_scope_end(&scope);
+
+    return rc;
+}
+
+int aws_kms_decrypt_blocking_from_view(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_decrypt_request_view *view,
+    struct aws_byte_buf *plaintext) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(view != NULL);
+    AWS_PRECONDITION(plaintext != NULL);
+
+    struct aws_recipient *recipient = NULL;
+    struct aws_byte_buf json = {0};
+    struct aws_string *request = NULL;
     struct aws_kms_decrypt_response *response_structure = NULL;
     int rc = AWS_OP_ERR;
 
-    response_structure = s_kms_get_decrypt_response_from_request(client, request_structure);
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    recipient = aws_recipient_new(scope.allocator);
+    if (recipient == NULL) {
+        goto finalize;
+    }
+    if (s_kms_client_attestation_document(client, scope.allocator, &recipient->attestation_document) !=
+        AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+    recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
+
+    uint64_t start_ns = s_kms_metrics_start(client);
+    if (aws_kms_decrypt_request_view_to_json(scope.allocator, view, recipient, &json) == AWS_OP_SUCCESS) {
+        request = aws_string_new_from_buf(scope.allocator, &json);
+    }
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (request == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Failed to convert Decrypt request to json.", (void *)client);
+        goto finalize;
+    }
+
+    response_structure = s_kms_get_decrypt_response_from_json(client, scope.allocator, request);
     if (response_structure == NULL) {
-        fprintf(stderr, "Could not read response from KMS\n");
-    } else {
-        rc = s_decrypt_ciphertext_for_recipient(
-            client->allocator, &response_structure->ciphertext_for_recipient, client->keypair, plaintext);
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not read Decrypt response from KMS.", (void *)client);
+        goto finalize;
     }
+    rc = s_decrypt_ciphertext_for_recipient(client, &response_structure->ciphertext_for_recipient, plaintext);
 
+finalize:
     aws_kms_decrypt_response_destroy(response_structure);
+    aws_string_destroy(request);
+    aws_byte_buf_clean_up(&json);
+    aws_recipient_destroy(recipient);
+    s_kms_call_scope_end(&scope);
+    return rc;
+}
+
+int aws_kms_decrypt_blocking_from_template(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_decrypt_request_template *request_template,
+    struct aws_byte_cursor ciphertext_blob,
+    struct aws_byte_buf *plaintext) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(request_template != NULL);
+    AWS_PRECONDITION(plaintext != NULL);
+
+    struct aws_byte_buf json = {0};
+    struct aws_string *request = NULL;
+    struct aws_kms_decrypt_response *response_structure = NULL;
+    int rc = AWS_OP_ERR;
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    uint64_t start_ns = s_kms_metrics_start(client);
+    int head_rc = s_kms_decrypt_request_template_write_head(
+        request_template, scope.allocator, ciphertext_blob, KMS_RECIPIENT_JSON_CAPACITY, &json);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (head_rc != AWS_OP_SUCCESS || s_kms_client_append_recipient(client, &json) != AWS_OP_SUCCESS ||
+        aws_byte_buf_append_byte_dynamic(&json, '}') != AWS_OP_SUCCESS ||
+        (request = aws_string_new_from_buf(scope.allocator, &json)) == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Failed to convert Decrypt request to json.", (void *)client);
+        goto finalize;
+    }
+
+    response_structure = s_kms_get_decrypt_response_from_json(client, scope.allocator, request);
+    if (response_structure == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not read Decrypt response from KMS.", (void *)client);
+        goto finalize;
+    }
+    rc = s_decrypt_ciphertext_for_recipient(client, &response_structure->ciphertext_for_recipient, plaintext);
 
+finalize:
+    aws_kms_decrypt_response_destroy(response_structure);
+    aws_string_destroy(request);
+    aws_byte_buf_clean_up(&json);
+    s_kms_call_scope_end(&scope);
     return rc;
 }
 
 static struct aws_kms_encrypt_response *s_kms_get_encrypt_response_from_request(
     struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
     const struct aws_kms_encrypt_request *request_structure) {
     AWS_PRECONDITION(client != NULL);
     AWS_PRECONDITION(request_structure != NULL);
@@ -2754,18 +4077,27 @@ static struct aws_kms_encrypt_response *s_kms_get_encrypt_response_from_request(
     struct aws_kms_encrypt_response *response_structure = NULL;
     int rc = 0;
 
+    uint64_t start_ns = s_kms_metrics_start(client);
     request = aws_kms_encrypt_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
     if (request == NULL) {
         goto finalize;
     }
 
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_encrypt, request, &response);
+    rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client, allocator, NULL, AWS_KMS_OPERATION_ENCRYPT, kms_target_encrypt, request, &response);
     if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for Encrypt: %d.",
+            (void *)client,
+            rc);
         goto finalize;
     }
 
-    response_structure = aws_kms_encrypt_response_from_json(client->allocator, response);
+    start_ns = s_kms_metrics_start(client);
+    response_structure = aws_kms_encrypt_response_from_json(allocator, response);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_PARSE, start_ns);
 
 finalize:
     aws_string_destroy(request);
@@ -2774,6 +4106,27 @@ finalize:
     return response_structure;
 }
 
+/* The ciphertext is allocated with the client allocator, everything else of the call with @allocator. */
+static int s_kms_encrypt_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct aws_kms_encrypt_request *request_structure,
+    struct aws_byte_buf *ciphertext_blob) {
+    struct aws_kms_encrypt_response *response_structure = NULL;
+    int rc = AWS_OP_ERR;
+
+    response_structure = s_kms_get_encrypt_response_from_request(client, allocator, request_structure);
+    if (response_structure == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not read Encrypt response from KMS.", (void *)client);
+    } else {
+        rc = aws_byte_buf_init_copy(ciphertext_blob, client->allocator, &response_structure->ciphertext_blob);
+    }
+
+    aws_kms_encrypt_response_destroy(response_structure);
+
+    return rc;
+}
+
 int aws_kms_encrypt_blocking(
     struct aws_nitro_enclaves_kms_client *client,
     const struct aws_string *key_id,
@@ -2798,25 +4151,30 @@ int aws_kms_encrypt_blocking_with_context(
     struct aws_kms_encrypt_request *request_structure = NULL;
     int rc = AWS_OP_SUCCESS;
 
-    request_structure = aws_kms_encrypt_request_new(client->allocator);
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    request_structure = aws_kms_encrypt_request_new(scope.allocator);
     if (request_structure == NULL) {
+        s_kms_call_scope_end(&scope);
         return AWS_OP_ERR;
     }
 
-    aws_byte_buf_init_copy(&request_structure->plaintext, client->allocator, plaintext);
-    request_structure->key_id = aws_string_clone_or_reuse(client->allocator, key_id);
+    aws_byte_buf_init_copy(&request_structure->plaintext, scope.allocator, plaintext);
+    request_structure->key_id = aws_string_clone_or_reuse(scope.allocator, key_id);
 
     if (encryption_context) {
         struct json_object *context_json = s_json_object_from_string(encryption_context);
-        rc = s_aws_hash_table_from_json(client->allocator, context_json, &request_structure->encryption_context);
+        rc = s_aws_hash_table_from_json(scope.allocator, context_json, &request_structure->encryption_context);
         json_object_put(context_json);
     }
 
     if (rc == AWS_OP_SUCCESS) {
-        rc = aws_kms_encrypt_blocking_from_request(client, request_structure, ciphertext_blob);
+        rc = s_kms_encrypt_from_request(client, scope.allocator, request_structure, ciphertext_blob);
     }
 
     aws_kms_encrypt_request_destroy(request_structure);
+    s_kms_call_scope_end(&scope);
 
     return rc;
 }
@@ -2829,17 +4187,10 @@ int aws_kms_encrypt_blocking_from_request(
     AWS_PRECONDITION(request_structure != NULL);
     AWS_PRECONDITION(ciphertext_blob != NULL);
 
-    struct aws_kms_encrypt_response *response_structure = NULL;
-    int rc = AWS_OP_ERR;
-
-    response_structure = s_kms_get_encrypt_response_from_request(client, request_structure);
-    if (response_structure == NULL) {
-        fprintf(stderr, "Could not read response from KMS\n");
-    } else {
-        rc = aws_byte_buf_init_copy(ciphertext_blob, client->allocator, &response_structure->ciphertext_blob);
-    }
-
-    aws_kms_encrypt_response_destroy(response_structure);
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_encrypt_from_request(client, scope.allocator, request_structure, ciphertext_blob);
+    s_kms_call_scope_end(&scope);
 
     return rc;
 }
@@ -2862,50 +4213,73 @@ int aws_kms_generate_data_key_blocking(
     struct aws_kms_generate_data_key_request *request_structure = NULL;
     int rc = 0;
 
-    request_structure = aws_kms_generate_data_key_request_new(client->allocator);
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    request_structure = aws_kms_generate_data_key_request_new(scope.allocator);
     if (request_structure == NULL) {
+        s_kms_call_scope_end(&scope);
         return AWS_OP_ERR;
     }
 
-    request_structure->key_id = aws_string_clone_or_reuse(client->allocator, key_id);
+    request_structure->key_id = aws_string_clone_or_reuse(scope.allocator, key_id);
     request_structure->key_spec = key_spec;
 
-    request_structure->recipient = aws_recipient_new(client->allocator);
+    request_structure->recipient = aws_recipient_new(scope.allocator);
     if (request_structure->recipient == NULL) {
         goto err_clean;
     }
-    rc = aws_attestation_request(
-        client->allocator, client->keypair, &request_structure->recipient->attestation_document);
+    rc = s_kms_client_attestation_document(
+        client, scope.allocator, &request_structure->recipient->attestation_document);
     if (rc != AWS_OP_SUCCESS) {
         goto err_clean;
     }
     request_structure->recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
 
+    uint64_t start_ns = s_kms_metrics_start(client);
     request = aws_kms_generate_data_key_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
     if (request == NULL) {
         goto err_clean;
     }
 
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_generate_data_key, request, &response);
+    struct kms_call_policy policy = {.rate_limiter = client->generate_data_key_rate_limiter};
+    rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client,
+        scope.allocator,
+        &policy,
+        AWS_KMS_OPERATION_GENERATE_DATA_KEY,
+        kms_target_generate_data_key,
+        request,
+        &response);
     if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for GenerateDataKey: %d.",
+            (void *)client,
+            rc);
         goto err_clean;
     }
 
-    response_structure = aws_kms_generate_data_key_response_from_json(client->allocator, response);
+    start_ns = s_kms_metrics_start(client);
+    response_structure = aws_kms_generate_data_key_response_from_json(scope.allocator, response);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_PARSE, start_ns);
     if (response_structure == NULL) {
-        fprintf(stderr, "Could not read response from KMS: %d\n", rc);
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Could not read GenerateDataKey response from KMS.",
+            (void *)client);
         goto err_clean;
     }
 
-    rc = s_decrypt_ciphertext_for_recipient(
-        client->allocator, &response_structure->ciphertext_for_recipient, client->keypair, plaintext);
+    rc = s_decrypt_ciphertext_for_recipient(client, &response_structure->ciphertext_for_recipient, plaintext);
 
     aws_byte_buf_init_copy(ciphertext_blob, client->allocator, &response_structure->ciphertext_blob);
     aws_kms_generate_data_key_request_destroy(request_structure);
     aws_kms_generate_data_key_response_destroy(response_structure);
     aws_string_destroy(request);
     aws_string_destroy(response);
+    s_kms_call_scope_end(&scope);
 
     return rc;
 err_clean:
@@ -2913,356 +4287,1150 @@ err_clean:
     aws_kms_generate_data_key_response_destroy(response_structure);
     aws_string_destroy(request);
     aws_string_destroy(response);
+    s_kms_call_scope_end(&scope);
+    return AWS_OP_ERR;
+}
+
+int aws_kms_generate_random_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    uint32_t number_of_bytes,
+    struct aws_byte_buf *plaintext /* TODO: err_reason */) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(number_of_bytes > 0);
+    AWS_PRECONDITION(plaintext != NULL);
+
+    struct aws_string *response = NULL;
+    struct aws_string *request = NULL;
+    struct aws_kms_generate_random_response *response_structure = NULL;
+    struct aws_kms_generate_random_request *request_structure = NULL;
+    int rc = 0;
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    request_structure = aws_kms_generate_random_request_new(scope.allocator);
+    if (request_structure == NULL) {
+        s_kms_call_scope_end(&scope);
+        return AWS_OP_ERR;
+    }
+
+    request_structure->number_of_bytes = number_of_bytes;
+
+    request_structure->recipient = aws_recipient_new(scope.allocator);
+    if (request_structure->recipient == NULL) {
+        goto err_clean;
+    }
+    rc = s_kms_client_attestation_document(
+        client, scope.allocator, &request_structure->recipient->attestation_document);
+    if (rc != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    request_structure->recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
+
+    uint64_t start_ns = s_kms_metrics_start(client);
+    request = aws_kms_generate_random_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (request == NULL) {
+        goto err_clean;
+    }
+
+    struct kms_call_policy policy = {
+        .rate_limiter = client->generate_random_rate_limiter,
+        .hedging = &client->generate_random_hedging,
+        .latency = client->generate_random_latency,
+    };
+    rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client,
+        scope.allocator,
+        &policy,
+        AWS_KMS_OPERATION_GENERATE_RANDOM,
+        kms_target_generate_random,
+        request,
+        &response);
+    if (rc != 200) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for GenerateRandom: %d.",
+            (void *)client,
+            rc);
+        goto err_clean;
+    }
+
+    start_ns = s_kms_metrics_start(client);
+    response_structure = aws_kms_generate_random_response_from_json(scope.allocator, response);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_PARSE, start_ns);
+    if (response_structure == NULL) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Could not read GenerateRandom response from KMS.",
+            (void *)client);
+        goto err_clean;
+    }
+
+    rc = s_decrypt_ciphertext_for_recipient(client, &response_structure->ciphertext_for_recipient, plaintext);
+
+    aws_kms_generate_random_request_destroy(request_structure);
+    aws_kms_generate_random_response_destroy(response_structure);
+    aws_string_destroy(request);
+    aws_string_destroy(response);
+    s_kms_call_scope_end(&scope);
+
+    return rc;
+err_clean:
+    aws_kms_generate_random_request_destroy(request_structure);
+    aws_kms_generate_random_response_destroy(response_structure);
+    aws_string_destroy(request);
+    aws_string_destroy(response);
+    s_kms_call_scope_end(&scope);
     return AWS_OP_ERR;
 }
 
-int aws_kms_generate_random_blocking(
+/*
+ * Calls GetKeyPolicy or ListKeyPolicies. The response is allocated with the client allocator, everything else of
+ * the call with @allocator.
+ */
+static int s_kms_key_policy_call(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    enum aws_kms_operation operation,
+    struct aws_byte_cursor target,
+    struct aws_string *request,
+    struct aws_byte_buf *response_json) {
+    struct aws_string *response = NULL;
+
+    int rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client, allocator, NULL, operation, target, request, &response);
+    if (rc != 200) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for %s: %d.",
+            (void *)client,
+            aws_kms_operation_name(operation),
+            rc);
+        bool not_found = s_is_kms_exception(response, "NotFoundException");
+        aws_string_destroy(response);
+        return not_found ? aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND) : AWS_OP_ERR;
+    }
+
+    rc = aws_byte_buf_init_copy_from_cursor(response_json, client->allocator, aws_byte_cursor_from_string(response));
+    aws_string_destroy(response);
+    return rc;
+}
+
+/*
+ * Calls GetKeyPolicy or ListKeyPolicies, or reuses the answer of an earlier call with the same request if the key
+ * policy cache is enabled. Successful answers and NotFoundException failures are cached, other failures are not.
+ */
+static int s_kms_key_policy_call_cached(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    enum aws_kms_operation operation,
+    struct aws_byte_cursor target,
+    const struct aws_string *key_id,
+    struct aws_string *request,
+    struct aws_byte_buf *response_json) {
+    if (client->key_policy_cache == NULL) {
+        return s_kms_key_policy_call(client, allocator, operation, target, request, response_json);
+    }
+
+    uint64_t now_ns = 0;
+    if (aws_high_res_clock_get_ticks(&now_ns) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    /* Requests are built with a fixed member order, so identical calls have identical JSON. */
+    struct aws_byte_cursor operation_name = aws_byte_cursor_from_c_str(aws_kms_operation_name(operation));
+    struct aws_byte_buf cache_key_buf;
+    if (aws_byte_buf_init(&cache_key_buf, allocator, operation_name.len + 1 + request->len) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    aws_byte_buf_write_from_whole_cursor(&cache_key_buf, operation_name);
+    aws_byte_buf_write_u8(&cache_key_buf, ' ');
+    aws_byte_buf_write_from_whole_cursor(&cache_key_buf, aws_byte_cursor_from_string(request));
+    struct aws_string *cache_key = aws_string_new_from_array(allocator, cache_key_buf.buffer, cache_key_buf.len);
+    aws_byte_buf_clean_up(&cache_key_buf);
+    if (cache_key == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    int error_code = AWS_ERROR_SUCCESS;
+    uint64_t generation = 0;
+    if (aws_nitro_enclaves_key_policy_cache_get(
+            client->key_policy_cache, cache_key, now_ns, client->allocator, response_json, &error_code, &generation)) {
+        aws_string_destroy(cache_key);
+        return error_code == AWS_ERROR_SUCCESS ? AWS_OP_SUCCESS : aws_raise_error(error_code);
+    }
+
+    int rc = s_kms_key_policy_call(client, allocator, operation, target, request, response_json);
+    error_code = rc == AWS_OP_SUCCESS ? AWS_ERROR_SUCCESS : aws_last_error();
+    if (error_code == AWS_ERROR_SUCCESS || error_code == AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND) {
+        /* Failing to cache the answer does not fail the call. */
+        aws_nitro_enclaves_key_policy_cache_put(
+            client->key_policy_cache, cache_key, key_id, error_code, response_json, now_ns, generation);
+    }
+    aws_string_destroy(cache_key);
+
+    return rc == AWS_OP_SUCCESS ? AWS_OP_SUCCESS : aws_raise_error(error_code);
+}
+
+void aws_nitro_enclaves_kms_client_invalidate_key_policies(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id) {
+    AWS_PRECONDITION(client != NULL);
+
+    if (client->key_policy_cache != NULL) {
+        aws_nitro_enclaves_key_policy_cache_invalidate(client->key_policy_cache, key_id);
+    }
+}
+
+struct aws_kms_list_key_policies_request *aws_kms_list_key_policies_request_new(struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    struct aws_kms_list_key_policies_request *request =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_list_key_policies_request));
+    if (request == NULL) {
+        return NULL;
+    }
+
+    request->allocator = allocator;
+    return request;
+}
+
+void aws_kms_list_key_policies_request_destroy(struct aws_kms_list_key_policies_request *request) {
+    if (request == NULL) {
+        return;
+    }
+
+    if (request->key_id != NULL) {
+        aws_string_destroy(request->key_id);
+    }
+    if (request->marker != NULL) {
+        aws_string_destroy(request->marker);
+    }
+
+    aws_mem_release(request->allocator, request);
+    request = NULL;
+}
+
+struct aws_string *aws_kms_list_key_policies_request_to_json(const struct aws_kms_list_key_policies_request *request) {
+    AWS_PRECONDITION(request);
+    AWS_PRECONDITION(aws_allocator_is_valid(request->allocator));
+    AWS_PRECONDITION(aws_string_is_valid(request->key_id));
+
+    struct json_object *obj = json_object_new_object();
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    /* Required parameter */
+    if (s_string_to_json(obj, KMS_KEY_ID, aws_string_c_str(request->key_id)) != AWS_OP_SUCCESS) {
+        goto clean_up;
+    }
+
+    /* Optional parameters */
+    if (request->limit > 0) {
+        if (s_int_to_json(obj, "Limit", request->limit) != AWS_OP_SUCCESS) {
+            goto clean_up;
+        }
+    }
+
+    if (request->marker != NULL) {
+        if (s_string_to_json(obj, "Marker", aws_string_c_str(request->marker)) != AWS_OP_SUCCESS) {
+            goto clean_up;
+        }
+    }
+
+    struct aws_string *json = s_aws_string_from_json(request->allocator, obj);
+    if (json == NULL) {
+        goto clean_up;
+    }
+
+    json_object_put(obj);
+    return json;
+
+clean_up:
+    json_object_put(obj);
+    return NULL;
+}
+
+struct aws_kms_list_key_policies_response *aws_kms_list_key_policies_response_new(struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_kms_list_key_policies_response *response =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_list_key_policies_response));
+    if (response == NULL) {
+        return NULL;
+    }
+
+    /* Ensure allocator constness for customer usage. Utilize the @ref aws_string pattern. */
+    *(struct aws_allocator **)(&response->allocator) = allocator;
+
+    return response;
+}
+
+void aws_kms_list_key_policies_response_destroy(struct aws_kms_list_key_policies_response *response) {
+    if (response == NULL) {
+        return;
+    }
+    AWS_PRECONDITION(aws_allocator_is_valid(response->allocator));
+
+    if (aws_array_list_is_valid(&response->policy_names)) {
+        for (size_t i = 0; i < aws_array_list_length(&response->policy_names); i++) {
+            struct aws_string *elem = NULL;
+            AWS_FATAL_ASSERT(aws_array_list_get_at(&response->policy_names, &elem, i) == AWS_OP_SUCCESS);
+
+            aws_string_destroy(elem);
+        }
+
+        aws_array_list_clean_up(&response->policy_names);
+    }
+
+    if (aws_string_is_valid(response->next_marker)) {
+        aws_string_destroy(response->next_marker);
+    }
+
+    aws_mem_release(response->allocator, response);
+}
+
+struct aws_kms_list_key_policies_response *aws_kms_list_key_policies_response_from_json(
+    struct aws_allocator *allocator,
+    const struct aws_string *json) {
+
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(aws_string_is_valid(json));
+
+    struct json_object *obj = s_json_object_from_string(json);
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    struct aws_kms_list_key_policies_response *response = aws_kms_list_key_policies_response_new(allocator);
+    if (response == NULL) {
+        json_object_put(obj);
+        return NULL;
+    }
+
+    struct json_object_iterator it_end = json_object_iter_end(obj);
+    for (struct json_object_iterator it = json_object_iter_begin(obj); !json_object_iter_equal(&it, &it_end);
+         json_object_iter_next(&it)) {
+        const char *key = json_object_iter_peek_name(&it);
+        struct json_object *value = json_object_iter_peek_value(&it);
+        int value_type = json_object_get_type(value);
+
+        if (AWS_SAFE_COMPARE(key, KMS_POLICY_NAMES)) {
+            if (value_type != json_type_array) {
+                goto clean_up;
+            }
+            if (s_aws_array_list_from_json(allocator, value, &response->policy_names) != AWS_OP_SUCCESS) {
+                goto clean_up;
+            }
+            continue;
+        }
+
+        if (AWS_SAFE_COMPARE(key, KMS_NEXT_MARKER)) {
+            if (value_type != json_type_string) {
+                goto clean_up;
+            }
+            response->next_marker = s_aws_string_from_json(allocator, value);
+            if (response->next_marker == NULL) {
+                goto clean_up;
+            }
+            continue;
+        }
+
+        if (AWS_SAFE_COMPARE(key, KMS_TRUNCATED)) {
+            if (value_type != json_type_boolean) {
+                goto clean_up;
+            }
+            response->truncated = json_object_get_boolean(value);
+            continue;
+        }
+    }
+
+    json_object_put(obj);
+
+    return response;
+
+clean_up:
+    json_object_put(obj);
+    aws_kms_list_key_policies_response_destroy(response);
+
+    return NULL;
+}
+
+/* The response is allocated with the client allocator, everything else of the call with @allocator. */
+/* Calls ListKeyPolicies, through the key policy cache of the client unless @bypass_cache is set. */
+static int s_kms_list_key_policies_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct aws_kms_list_key_policies_request *request_structure,
+    bool bypass_cache,
+    struct aws_byte_buf *response_json) {
+    uint64_t start_ns = s_kms_metrics_start(client);
+    struct aws_string *request = aws_kms_list_key_policies_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (request == NULL) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Failed to convert ListKeyPolicies request to json.",
+            (void *)client);
+        return AWS_OP_ERR;
+    }
+
+    int rc = AWS_OP_ERR;
+    if (bypass_cache) {
+        rc = s_kms_key_policy_call(
+            client,
+            allocator,
+            AWS_KMS_OPERATION_LIST_KEY_POLICIES,
+            kms_target_list_key_policies,
+            request,
+            response_json);
+    } else {
+        rc = s_kms_key_policy_call_cached(
+            client,
+            allocator,
+            AWS_KMS_OPERATION_LIST_KEY_POLICIES,
+            kms_target_list_key_policies,
+            request_structure->key_id,
+            request,
+            response_json);
+    }
+    aws_string_destroy(request);
+
+    return rc;
+}
+
+int aws_kms_list_key_policies_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_list_key_policies_request *request_structure,
+    struct aws_byte_buf *response_json) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(request_structure != NULL);
+    AWS_PRECONDITION(response_json != NULL);
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_list_key_policies_from_request(client, scope.allocator, request_structure, false, response_json);
+    s_kms_call_scope_end(&scope);
+
+    return rc;
+}
+
+static int s_kms_list_key_policies_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    bool bypass_cache,
+    struct aws_byte_buf *response_json) {
+    if (limit < 0 || limit > 1000) {
+        return AWS_OP_ERR;
+    }
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    int rc = AWS_OP_ERR;
+    struct aws_kms_list_key_policies_request *request = aws_kms_list_key_policies_request_new(scope.allocator);
+    if (request == NULL) {
+        goto finalize;
+    }
+
+    request->key_id = aws_string_clone_or_reuse(scope.allocator, key_id);
+    if (request->key_id == NULL) {
+        goto finalize;
+    }
+
+    request->limit = limit;
+    if (marker != NULL) {
+        request->marker = aws_string_clone_or_reuse(scope.allocator, marker);
+        if (request->marker == NULL) {
+            goto finalize;
+        }
+    }
+
+    rc = s_kms_list_key_policies_from_request(client, scope.allocator, request, bypass_cache, response_json);
+
+finalize:
+    aws_kms_list_key_policies_request_destroy(request);
+    s_kms_call_scope_end(&scope);
+    return rc;
+}
+
+int aws_kms_list_key_policies_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(key_id != NULL);
+    AWS_PRECONDITION(response_json != NULL);
+
+    return s_kms_list_key_policies_blocking(client, key_id, limit, marker, false, response_json);
+}
+
+int aws_nitro_enclaves_kms_list_key_policies_uncached(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(key_id != NULL);
+    AWS_PRECONDITION(response_json != NULL);
+
+    return s_kms_list_key_policies_blocking(client, key_id, limit, marker, true, response_json);
+}
+
+struct aws_kms_get_key_policy_request *aws_kms_get_key_policy_request_new(struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    struct aws_kms_get_key_policy_request *request =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_get_key_policy_request));
+    if (request == NULL) {
+        return NULL;
+    }
+
+    request->allocator = allocator;
+    return request;
+}
+
+struct aws_string *aws_kms_get_key_policy_request_to_json(const struct aws_kms_get_key_policy_request *request) {
+    AWS_PRECONDITION(request);
+    AWS_PRECONDITION(aws_allocator_is_valid(request->allocator));
+    AWS_PRECONDITION(aws_string_is_valid(request->key_id));
+    AWS_PRECONDITION(aws_string_is_valid(request->policy_name));
+    
+    struct json_object *obj = json_object_new_object();
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    if (s_string_to_json(obj, KMS_KEY_ID, aws_string_c_str(request->key_id)) != AWS_OP_SUCCESS) {
+        goto clean_up;
+    }
+
+    if (s_string_to_json(obj, KMS_POLICY_NAME, aws_string_c_str(request->policy_name)) != AWS_OP_SUCCESS) {
+        goto clean_up;
+    }
+
+    struct aws_string *json = s_aws_string_from_json(request->allocator, obj);
+    if (json == NULL) {
+        goto clean_up;
+    }
+    
+    json_object_put(obj);
+    return json;
+
+clean_up:
+    json_object_put(obj);
+    return NULL;
+}
+
+void aws_kms_get_key_policy_request_destroy(struct aws_kms_get_key_policy_request *request) {
+    if (request == NULL) {
+        return;
+    }
+
+    if (request->key_id != NULL) {
+        aws_string_destroy(request->key_id);    
+    }
+
+    if (request->policy_name != NULL) {
+        aws_string_destroy(request->policy_name);
+    }
+
+    aws_mem_release(request->allocator, request);
+    request = NULL;
+}
+
+/* The response is allocated with the client allocator, everything else of the call with @allocator. */
+static int s_kms_get_key_policy_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
+    const struct aws_kms_get_key_policy_request *request_structure,
+    struct aws_byte_buf *response_json) {
+    uint64_t start_ns = s_kms_metrics_start(client);
+    struct aws_string *request = aws_kms_get_key_policy_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
+    if (request == NULL) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Failed to convert GetKeyPolicy request to json.",
+            (void *)client);
+        return AWS_OP_ERR;
+    }
+
+    int rc = s_kms_key_policy_call_cached(
+        client,
+        allocator,
+        AWS_KMS_OPERATION_GET_KEY_POLICY,
+        kms_target_get_key_policy,
+        request_structure->key_id,
+        request,
+        response_json);
+    aws_string_destroy(request);
+
+    return rc;
+}
+
+
+int aws_kms_get_key_policy_from_request(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_kms_get_key_policy_request *request_structure,
+    struct aws_byte_buf *response_json) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(request_structure != NULL);
+    AWS_PRECONDITION(response_json != NULL);
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_get_key_policy_from_request(client, scope.allocator, request_structure, response_json);
+    s_kms_call_scope_end(&scope);
+
+    return rc;
+}
+
+int aws_kms_get_key_policy_blocking(
+    struct aws_nitro_enclaves_kms_client *client,
+    const struct aws_string *key_id,
+    const struct aws_string *policy_name,
+    struct aws_byte_buf *response_json) {
+    AWS_PRECONDITION(client != NULL);
+    AWS_PRECONDITION(key_id != NULL);
+    AWS_PRECONDITION(policy_name != NULL);
+    AWS_PRECONDITION(response_json != NULL);
+
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+
+    int rc = AWS_OP_ERR;
+    struct aws_kms_get_key_policy_request *request = aws_kms_get_key_policy_request_new(scope.allocator);
+    if (request == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Failed to allocate GetKeyPolicy request.", (void *)client);
+        goto finalize;
+    }
+
+    request->key_id = aws_string_clone_or_reuse(scope.allocator, key_id);
+    if (request->key_id == NULL) {
+        goto finalize;
+    }
+
+    request->policy_name = aws_string_clone_or_reuse(scope.allocator, policy_name);
+    if (request->policy_name == NULL) {
+        goto finalize;
+    }
+
+    rc = s_kms_get_key_policy_from_request(client, scope.allocator, request, response_json);
+
+finalize:
+    aws_kms_get_key_policy_request_destroy(request);
+    s_kms_call_scope_end(&scope);
+    return rc;
+}
+struct aws_kms_get_public_key_request *aws_kms_get_public_key_request_new(struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    struct aws_kms_get_public_key_request *request =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_get_public_key_request));
+    if (request == NULL) {
+        return NULL;
+    }
+
+    request->allocator = allocator;
+    return request;
+}
+
+void aws_kms_get_public_key_request_destroy(struct aws_kms_get_public_key_request *request) {
+    if (request == NULL) {
+        return;
+    }
+
+    if (request->key_id != NULL) {
+        aws_string_destroy(request->key_id);
+    }
+
+    aws_mem_release(request->allocator, request);
+}
+
+struct aws_string *aws_kms_get_public_key_request_to_json(const struct aws_kms_get_public_key_request *request) {
+    AWS_PRECONDITION(request);
+    AWS_PRECONDITION(aws_allocator_is_valid(request->allocator));
+    AWS_PRECONDITION(aws_string_is_valid(request->key_id));
+
+    struct json_object *obj = json_object_new_object();
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    if (s_string_to_json(obj, KMS_KEY_ID, aws_string_c_str(request->key_id)) != AWS_OP_SUCCESS) {
+        goto clean_up;
+    }
+
+    struct aws_string *json = s_aws_string_from_json(request->allocator, obj);
+    if (json == NULL) {
+        goto clean_up;
+    }
+
+    json_object_put(obj);
+    return json;
+
+clean_up:
+    json_object_put(obj);
+    return NULL;
+}
+
+struct aws_kms_get_public_key_response *aws_kms_get_public_key_response_new(struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_kms_get_public_key_response *response =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_get_public_key_response));
+    if (response == NULL) {
+        return NULL;
+    }
+
+    /* Ensure allocator constness for customer usage. Utilize the @ref aws_string pattern. */
+    *(struct aws_allocator **)(&response->allocator) = allocator;
+
+    return response;
+}
+
+void aws_kms_get_public_key_response_destroy(struct aws_kms_get_public_key_response *response) {
+    if (response == NULL) {
+        return;
+    }
+    AWS_PRECONDITION(aws_allocator_is_valid(response->allocator));
+
+    if (aws_string_is_valid(response->key_id)) {
+        aws_string_destroy(response->key_id);
+    }
+
+    if (aws_byte_buf_is_valid(&response->public_key)) {
+        aws_byte_buf_clean_up(&response->public_key);
+    }
+
+    if (aws_string_is_valid(response->key_usage)) {
+        aws_string_destroy(response->key_usage);
+    }
+
+    if (aws_array_list_is_valid(&response->encryption_algorithms)) {
+        for (size_t i = 0; i < aws_array_list_length(&response->encryption_algorithms); i++) {
+            struct aws_string *elem = NULL;
+            AWS_FATAL_ASSERT(aws_array_list_get_at(&response->encryption_algorithms, &elem, i) == AWS_OP_SUCCESS);
+
+            aws_string_destroy(elem);
+        }
+
+        aws_array_list_clean_up(&response->encryption_algorithms);
+    }
+
+    aws_mem_release(response->allocator, response);
+}
+
+struct aws_kms_get_public_key_response *aws_kms_get_public_key_response_from_json(
+    struct aws_allocator *allocator,
+    const struct aws_string *json) {
+
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(aws_string_is_valid(json));
+
+    struct json_object *obj = s_json_object_from_string(json);
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    struct aws_kms_get_public_key_response *response = aws_kms_get_public_key_response_new(allocator);
+    if (response == NULL) {
+        json_object_put(obj);
+        return NULL;
+    }
+
+    struct json_object_iterator it_end = json_object_iter_end(obj);
+    for (struct json_object_iterator it = json_object_iter_begin(obj); !json_object_iter_equal(&it, &it_end);
+         json_object_iter_next(&it)) {
+        const char *key = json_object_iter_peek_name(&it);
+        struct json_object *value = json_object_iter_peek_value(&it);
+        int value_type = json_object_get_type(value);
+
+        if (AWS_SAFE_COMPARE(key, KMS_KEY_ID)) {
+            if (value_type != json_type_string) {
+                goto clean_up;
+            }
+            response->key_id = s_aws_string_from_json(allocator, value);
+            if (response->key_id == NULL) {
+                goto clean_up;
+            }
+            continue;
+        }
+
+        if (AWS_SAFE_COMPARE(key, KMS_PUBLIC_KEY)) {
+            if (value_type != json_type_string) {
+                goto clean_up;
+            }
+            if (s_aws_byte_buf_from_base64_json(allocator, value, &response->public_key) != AWS_OP_SUCCESS) {
+                goto clean_up;
+            }
+            continue;
+        }
+
+        if (AWS_SAFE_COMPARE(key, KMS_KEY_USAGE)) {
+            if (value_type != json_type_string) {
+                goto clean_up;
+            }
+            response->key_usage = s_aws_string_from_json(allocator, value);
+            if (response->key_usage == NULL) {
+                goto clean_up;
+            }
+            continue;
+        }
+
+        if (AWS_SAFE_COMPARE(key, KMS_ENCRYPTION_ALGORITHMS)) {
+            if (value_type != json_type_array) {
+                goto clean_up;
+            }
+            if (s_aws_array_list_from_json(allocator, value, &response->encryption_algorithms) != AWS_OP_SUCCESS) {
+                goto clean_up;
+            }
+            continue;
+        }
+    }
+
+    json_object_put(obj);
+
+    return response;
+
+clean_up:
+    json_object_put(obj);
+    aws_kms_get_public_key_response_destroy(response);
+
+    return NULL;
+}
+
+/* Calls GetPublicKey. The cache entry is allocated with the client allocator, everything else with @allocator. */
+static struct kms_public_key *s_kms_public_key_fetch(
     struct aws_nitro_enclaves_kms_client *client,
-    uint32_t number_of_bytes,
-    struct aws_byte_buf *plaintext /* TODO: err_reason */) {
-    AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(number_of_bytes > 0);
-    AWS_PRECONDITION(plaintext != NULL);
-
-    struct aws_string *response = NULL;
+    struct aws_allocator *allocator,
+    const struct aws_string *key_id) {
+    struct aws_kms_get_public_key_request *request_structure = NULL;
+    struct aws_kms_get_public_key_response *response_structure = NULL;
     struct aws_string *request = NULL;
-    struct aws_kms_generate_random_response *response_structure = NULL;
-    struct aws_kms_generate_random_request *request_structure = NULL;
-    int rc = 0;
+    struct aws_string *response = NULL;
+    struct kms_public_key *entry = NULL;
 
-    request_structure = aws_kms_generate_random_request_new(client->allocator);
+    request_structure = aws_kms_get_public_key_request_new(allocator);
     if (request_structure == NULL) {
-        return AWS_OP_ERR;
-    }
-
-    request_structure->number_of_bytes = number_of_bytes;
-
-    request_structure->recipient = aws_recipient_new(client->allocator);
-    if (request_structure->recipient == NULL) {
         goto err_clean;
     }
-    rc = aws_attestation_request(
-        client->allocator, client->keypair, &request_structure->recipient->attestation_document);
-    if (rc != AWS_OP_SUCCESS) {
+    request_structure->key_id = aws_string_clone_or_reuse(allocator, key_id);
+    if (request_structure->key_id == NULL) {
         goto err_clean;
     }
-    request_structure->recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
 
-    request = aws_kms_generate_random_request_to_json(request_structure);
+    uint64_t start_ns = s_kms_metrics_start(client);
+    request = aws_kms_get_public_key_request_to_json(request_structure);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_BUILD, start_ns);
     if (request == NULL) {
         goto err_clean;
     }
 
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_generate_random, request, &response);
+    int rc = s_aws_nitro_enclaves_kms_client_call_blocking(
+        client, allocator, NULL, AWS_KMS_OPERATION_GET_PUBLIC_KEY, kms_target_get_public_key, request, &response);
     if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Got non-200 answer from KMS for GetPublicKey: %d.",
+            (void *)client,
+            rc);
         goto err_clean;
     }
 
-    response_structure = aws_kms_generate_random_response_from_json(client->allocator, response);
-    if (response_structure == NULL) {
-        fprintf(stderr, "Could not read response from KMS: %d\n", rc);
+    start_ns = s_kms_metrics_start(client);
+    response_structure = aws_kms_get_public_key_response_from_json(allocator, response);
+    s_kms_metrics_stage_end(client, AWS_KMS_STAGE_JSON_PARSE, start_ns);
+    if (response_structure == NULL || response_structure->public_key.len == 0) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not read GetPublicKey response from KMS.", (void *)client);
         goto err_clean;
     }
 
-    rc = s_decrypt_ciphertext_for_recipient(
-        client->allocator, &response_structure->ciphertext_for_recipient, client->keypair, plaintext);
-
-    aws_kms_generate_random_request_destroy(request_structure);
-    aws_kms_generate_random_response_destroy(response_structure);
-    aws_string_destroy(request);
-    aws_string_destroy(response);
-
-    return rc;
-err_clean:
-    aws_kms_generate_random_request_destroy(request_structure);
-    aws_kms_generate_random_response_destroy(response_structure);
-    aws_string_destroy(request);
-    aws_string_destroy(response);
-    return AWS_OP_ERR;
-}
-
-struct aws_kms_list_key_policies_request *aws_kms_list_key_policies_request_new(struct aws_allocator *allocator) {
-    if (allocator == NULL) {
-        allocator = aws_nitro_enclaves_get_allocator();
-    }
-
-    struct aws_kms_list_key_policies_request *request =
-        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_list_key_policies_request));
-    if (request == NULL) {
-        return NULL;
-    }
-
-    request->allocator = allocator;
-    return request;
-}
-
-void aws_kms_list_key_policies_request_destroy(struct aws_kms_list_key_policies_request *request) {
-    if (request == NULL) {
-        return;
-    }
-
-    if (request->key_id != NULL) {
-        aws_string_destroy(request->key_id);
-    }
-    if (request->marker != NULL) {
-        aws_string_destroy(request->marker);
+    entry = aws_mem_calloc(client->allocator, 1, sizeof(struct kms_public_key));
+    if (entry == NULL) {
+        goto err_clean;
     }
+    entry->allocator = client->allocator;
 
-    aws_mem_release(request->allocator, request);
-    request = NULL;
-}
-
-struct aws_string *aws_kms_list_key_policies_request_to_json(const struct aws_kms_list_key_policies_request *request) {
-    AWS_PRECONDITION(request);
-    AWS_PRECONDITION(aws_allocator_is_valid(request->allocator));
-    AWS_PRECONDITION(aws_string_is_valid(request->key_id));
-
-    struct json_object *obj = json_object_new_object();
-    if (obj == NULL) {
-        return NULL;
+    /* Cached under the key id it was requested with, which may be an alias. */
+    entry->key_id = aws_string_new_from_string(client->allocator, key_id);
+    if (entry->key_id == NULL ||
+        aws_byte_buf_init_copy(&entry->public_key, client->allocator, &response_structure->public_key) !=
+            AWS_OP_SUCCESS) {
+        goto err_clean;
     }
 
-    /* Required parameter */
-    if (s_string_to_json(obj, KMS_KEY_ID, aws_string_c_str(request->key_id)) != AWS_OP_SUCCESS) {
-        goto clean_up;
+    CBS cbs;
+    CBS_init(&cbs, entry->public_key.buffer, entry->public_key.len);
+    entry->pkey = EVP_parse_public_key(&cbs);
+    if (entry->pkey == NULL) {
+        AWS_LOGF_ERROR(AWS_LS_NITRO_ENCLAVES_KMS, "id=%p: Could not parse public key from KMS.", (void *)client);
+        aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        goto err_clean;
     }
 
-    /* Optional parameters */
-    if (request->limit > 0) {
-        if (s_int_to_json(obj, "Limit", request->limit) != AWS_OP_SUCCESS) {
-            goto clean_up;
+    if (aws_array_list_is_valid(&response_structure->encryption_algorithms)) {
+        for (size_t i = 0; i < aws_array_list_length(&response_structure->encryption_algorithms); i++) {
+            struct aws_string *elem = NULL;
+            enum aws_encryption_algorithm encryption_algorithm = AWS_EA_UNINITIALIZED;
+            AWS_FATAL_ASSERT(
+                aws_array_list_get_at(&response_structure->encryption_algorithms, &elem, i) == AWS_OP_SUCCESS);
+            /* Algorithms this SDK does not know about are skipped. */
+            if (s_aws_encryption_algorithm_from_aws_string(elem, &encryption_algorithm)) {
+                entry->encryption_algorithms |= 1u << encryption_algorithm;
+            }
         }
     }
 
-    if (request->marker != NULL) {
-        if (s_string_to_json(obj, "Marker", aws_string_c_str(request->marker)) != AWS_OP_SUCCESS) {
-            goto clean_up;
-        }
-    }
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    entry->expires_at_ns = now_ns + client->public_key_cache_ttl_ns;
 
-    struct aws_string *json = s_aws_string_from_json(request->allocator, obj);
-    if (json == NULL) {
-        goto clean_up;
-    }
+    goto finalize;
 
-    json_object_put(obj);
-    return json;
+err_clean:
+    s_kms_public_key_destroy(entry);
+    entry = NULL;
 
-clean_up:
-    json_object_put(obj);
-    return NULL;
+finalize:
+    aws_kms_get_public_key_request_destroy(request_structure);
+    aws_kms_get_public_key_response_destroy(response_structure);
+    aws_string_destroy(request);
+    aws_string_destroy(response);
+
+    return entry;
 }
 
-int aws_kms_list_key_policies_from_request(
+/*
+ * Must be called with the client mutex held. Gives the caller a reference to the parsed key, which it releases
+ * with EVP_PKEY_free, and a copy of the DER encoding allocated with the client allocator, if requested.
+ */
+static int s_kms_public_key_copy_out_synced(
     struct aws_nitro_enclaves_kms_client *client,
-    const struct aws_kms_list_key_policies_request *request_structure,
-    struct aws_byte_buf *response_json) {
-    AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(request_structure != NULL);
-    AWS_PRECONDITION(response_json != NULL);
-
-    struct aws_string *response = NULL;
-    struct aws_string *request = NULL;
-    int rc = 0;
-
-    request = aws_kms_list_key_policies_request_to_json(request_structure);
-    if (request == NULL) {
-        fprintf(stderr, "Failed to convert request to json\n");
+    const struct kms_public_key *entry,
+    EVP_PKEY **pkey,
+    uint32_t *encryption_algorithms,
+    struct aws_byte_buf *public_key) {
+    if (public_key != NULL && aws_byte_buf_init_copy(public_key, client->allocator, &entry->public_key) !=
+                                  AWS_OP_SUCCESS) {
         return AWS_OP_ERR;
     }
-
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_list_key_policies, request, &response);
-    aws_string_destroy(request);
-    request = NULL;
-
-    if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
-        if (response != NULL) {
-            aws_string_destroy(response);
-            response = NULL;
-        }
-        return AWS_OP_ERR;
+    if (pkey != NULL) {
+        EVP_PKEY_up_ref(entry->pkey);
+        *pkey = entry->pkey;
+    }
+    if (encryption_algorithms != NULL) {
+        *encryption_algorithms = entry->encryption_algorithms;
     }
 
-    const struct aws_byte_cursor cursor = aws_byte_cursor_from_string(response);
-    aws_byte_buf_init_copy_from_cursor(response_json, client->allocator, cursor);
-    aws_string_destroy(response);
-    response = NULL;
     return AWS_OP_SUCCESS;
 }
 
-int aws_kms_list_key_policies_blocking(
+/* Looks a public key up in the client cache, calling GetPublicKey if it is missing or expired. */
+static int s_kms_public_key_acquire(
     struct aws_nitro_enclaves_kms_client *client,
+    struct aws_allocator *allocator,
     const struct aws_string *key_id,
-    int limit,
-    const struct aws_string *marker,
-    struct aws_byte_buf *response_json) {
-    AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(key_id != NULL);
-    AWS_PRECONDITION(response_json != NULL);
-
-    if (limit < 0 || limit > 1000) {
+    EVP_PKEY **pkey,
+    uint32_t *encryption_algorithms,
+    struct aws_byte_buf *public_key) {
+    uint64_t now_ns = 0;
+    if (aws_high_res_clock_get_ticks(&now_ns) != AWS_OP_SUCCESS) {
         return AWS_OP_ERR;
     }
 
-    struct aws_kms_list_key_policies_request *request = aws_kms_list_key_policies_request_new(client->allocator);
-    if (request == NULL) {
-        return AWS_OP_ERR;
+    int rc = AWS_OP_SUCCESS;
+    struct aws_hash_element *elem = NULL;
+    aws_mutex_lock(&client->mutex);
+    aws_hash_table_find(&client->public_keys, key_id, &elem);
+    if (elem != NULL && ((struct kms_public_key *)elem->value)->expires_at_ns > now_ns) {
+        rc = s_kms_public_key_copy_out_synced(client, elem->value, pkey, encryption_algorithms, public_key);
+        aws_mutex_unlock(&client->mutex);
+        return rc;
     }
+    aws_mutex_unlock(&client->mutex);
 
-    request->key_id = aws_string_clone_or_reuse(client->allocator, key_id);
-    if (request->key_id == NULL) {
-        aws_kms_list_key_policies_request_destroy(request);
+    /* Concurrent misses on the same key id each fetch it; the last one to finish stays cached. */
+    struct kms_public_key *entry = s_kms_public_key_fetch(client, allocator, key_id);
+    if (entry == NULL) {
         return AWS_OP_ERR;
     }
 
-    request->limit = limit;
-    if (marker != NULL) {
-        request->marker = aws_string_clone_or_reuse(client->allocator, marker);
-        if (request->marker == NULL) {
-            aws_kms_list_key_policies_request_destroy(request);
-            return AWS_OP_ERR;
-        }
+    aws_mutex_lock(&client->mutex);
+    rc = s_kms_public_key_copy_out_synced(client, entry, pkey, encryption_algorithms, public_key);
+    /* Replaces, and destroys, the expired entry. Failing to cache the key does not fail the call. */
+    if (aws_hash_table_put(&client->public_keys, entry->key_id, entry, NULL) != AWS_OP_SUCCESS) {
+        s_kms_public_key_destroy(entry);
     }
+    aws_mutex_unlock(&client->mutex);
 
-    int rc = aws_kms_list_key_policies_from_request(client, request, response_json);
-    aws_kms_list_key_policies_request_destroy(request);
     return rc;
 }
 
-struct aws_kms_get_key_policy_request *aws_kms_get_key_policy_request_new(struct aws_allocator *allocator) {
-    if (allocator == NULL) {
-        allocator = aws_nitro_enclaves_get_allocator();
+/* RSAES-OAEP with the same hash for OAEP and MGF1, as AWS KMS uses for asymmetric CMKs. */
+static int s_rsa_oaep_encrypt(
+    struct aws_allocator *allocator,
+    EVP_PKEY *pkey,
+    enum aws_encryption_algorithm encryption_algorithm,
+    struct aws_byte_cursor plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
+    const EVP_MD *md = NULL;
+    switch (encryption_algorithm) {
+        case AWS_EA_RSAES_OAEP_SHA_1:
+            md = EVP_sha1();
+            break;
+        case AWS_EA_RSAES_OAEP_SHA_256:
+            md = EVP_sha256();
+            break;
+        default:
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
-
-    struct aws_kms_get_key_policy_request *request =
-        aws_mem_calloc(allocator, 1, sizeof(struct aws_kms_get_key_policy_request));
-    if (request == NULL) {
-        return NULL;
+    if (EVP_PKEY_id(pkey) != EVP_PKEY_RSA) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    request->allocator = allocator;
-    return request;
-}
-
-struct aws_string *aws_kms_get_key_policy_request_to_json(const struct aws_kms_get_key_policy_request *request) {
-    AWS_PRECONDITION(request);
-    AWS_PRECONDITION(aws_allocator_is_valid(request->allocator));
-    AWS_PRECONDITION(aws_string_is_valid(request->key_id));
-    AWS_PRECONDITION(aws_string_is_valid(request->policy_name));
-    
-    struct json_object *obj = json_object_new_object();
-    if (obj == NULL) {
-        return NULL;
+    EVP_PKEY_CTX *pkey_ctx = EVP_PKEY_CTX_new(pkey, NULL);
+    if (pkey_ctx == NULL) {
+        return aws_raise_error(AWS_ERROR_OOM);
     }
 
-    if (s_string_to_json(obj, KMS_KEY_ID, aws_string_c_str(request->key_id)) != AWS_OP_SUCCESS) {
-        goto clean_up;
+    if (EVP_PKEY_encrypt_init(pkey_ctx) != 1 || EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_OAEP_PADDING) != 1 ||
+        EVP_PKEY_CTX_set_rsa_oaep_md(pkey_ctx, md) != 1 || EVP_PKEY_CTX_set_rsa_mgf1_md(pkey_ctx, md) != 1) {
+        EVP_PKEY_CTX_free(pkey_ctx);
+        return aws_raise_error(AWS_ERROR_UNKNOWN);
     }
 
-    if (s_string_to_json(obj, KMS_POLICY_NAME, aws_string_c_str(request->policy_name)) != AWS_OP_SUCCESS) {
-        goto clean_up;
+    /* The ciphertext is as long as the modulus. */
+    size_t ciphertext_len = EVP_PKEY_size(pkey);
+    if (aws_byte_buf_init(ciphertext_blob, allocator, ciphertext_len) != AWS_OP_SUCCESS) {
+        EVP_PKEY_CTX_free(pkey_ctx);
+        return AWS_OP_ERR;
     }
 
-    struct aws_string *json = s_aws_string_from_json(request->allocator, obj);
-    if (json == NULL) {
-        goto clean_up;
+    /* Fails if the plaintext is too long for the key and hash. */
+    if (EVP_PKEY_encrypt(pkey_ctx, ciphertext_blob->buffer, &ciphertext_len, plaintext.ptr, plaintext.len) != 1) {
+        EVP_PKEY_CTX_free(pkey_ctx);
+        aws_byte_buf_clean_up(ciphertext_blob);
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
-    
-    json_object_put(obj);
-    return json;
+    ciphertext_blob->len = ciphertext_len;
 
-clean_up:
-    json_object_put(obj);
-    return NULL;
+    EVP_PKEY_CTX_free(pkey_ctx);
+
+    return AWS_OP_SUCCESS;
 }
 
-void aws_kms_get_key_policy_request_destroy(struct aws_kms_get_key_policy_request *request) {
-    if (request == NULL) {
-        return;
-    }
+int aws_kms_encrypt_with_public_key(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor public_key,
+    enum aws_encryption_algorithm encryption_algorithm,
+    struct aws_byte_cursor plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
+    AWS_PRECONDITION(ciphertext_blob != NULL);
 
-    if (request->key_id != NULL) {
-        aws_string_destroy(request->key_id);    
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
     }
 
-    if (request->policy_name != NULL) {
-        aws_string_destroy(request->policy_name);
+    CBS cbs;
+    CBS_init(&cbs, public_key.ptr, public_key.len);
+    EVP_PKEY *pkey = EVP_parse_public_key(&cbs);
+    if (pkey == NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    aws_mem_release(request->allocator, request);
-    request = NULL;
+    int rc = s_rsa_oaep_encrypt(allocator, pkey, encryption_algorithm, plaintext, ciphertext_blob);
+    EVP_PKEY_free(pkey);
+
+    return rc;
 }
 
-int aws_kms_get_key_policy_from_request(
+int aws_kms_get_public_key_blocking(
     struct aws_nitro_enclaves_kms_client *client,
-    const struct aws_kms_get_key_policy_request *request_structure,
-    struct aws_byte_buf *response_json) {
+    const struct aws_string *key_id,
+    struct aws_byte_buf *public_key) {
     AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(request_structure != NULL);
-    AWS_PRECONDITION(response_json != NULL);
-
-    struct aws_string *response = NULL;
-    struct aws_string *request = NULL;
-    int rc = 0;
-
-    request = aws_kms_get_key_policy_request_to_json(request_structure);
-    if (request == NULL) {
-        fprintf(stderr, "Failed to convert request to json\n");
-        return AWS_OP_ERR;
-    }
-
-    rc = s_aws_nitro_enclaves_kms_client_call_blocking(client, kms_target_get_key_policy, request, &response);
-    aws_string_destroy(request);
-    request = NULL;
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+    AWS_PRECONDITION(public_key != NULL);
 
-    if (rc != 200) {
-        fprintf(stderr, "Got non-200 answer from KMS: %d\n", rc);
-        if (response != NULL) {
-            aws_string_destroy(response);
-            response = NULL;
-        }
-        return AWS_OP_ERR;
-    }
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_public_key_acquire(client, scope.allocator, key_id, NULL, NULL, public_key);
+    s_kms_call_scope_end(&scope);
 
-    const struct aws_byte_cursor cursor = aws_byte_cursor_from_string(response);
-    aws_byte_buf_init_copy_from_cursor(response_json, client->allocator, cursor);
-    aws_string_destroy(response);
-    response = NULL;
-    return AWS_OP_SUCCESS;
+    return rc;
 }
 
-
-int aws_kms_get_key_policy_blocking(
+int aws_kms_encrypt_with_public_key_blocking(
     struct aws_nitro_enclaves_kms_client *client,
     const struct aws_string *key_id,
-    const struct aws_string *policy_name,
-    struct aws_byte_buf *response_json) {
+    enum aws_encryption_algorithm encryption_algorithm,
+    const struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
     AWS_PRECONDITION(client != NULL);
-    AWS_PRECONDITION(key_id != NULL);
-    AWS_PRECONDITION(policy_name != NULL);
-    AWS_PRECONDITION(response_json != NULL);
+    AWS_PRECONDITION(aws_string_is_valid(key_id));
+    AWS_PRECONDITION(plaintext != NULL);
+    AWS_PRECONDITION(ciphertext_blob != NULL);
 
-    struct aws_kms_get_key_policy_request *request = aws_kms_get_key_policy_request_new(client->allocator);
-    if (request == NULL) {
-        fprintf(stderr, "Failed to convert request to json\n");
-        return AWS_OP_ERR;
+    if (encryption_algorithm != AWS_EA_RSAES_OAEP_SHA_1 && encryption_algorithm != AWS_EA_RSAES_OAEP_SHA_256) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    request->key_id = aws_string_clone_or_reuse(client->allocator, key_id);
-    if (request->key_id == NULL) {
-        aws_kms_get_key_policy_request_destroy(request);
+    EVP_PKEY *pkey = NULL;
+    uint32_t encryption_algorithms = 0;
+    struct kms_call_scope scope;
+    s_kms_call_scope_begin(client, &scope);
+    int rc = s_kms_public_key_acquire(client, scope.allocator, key_id, &pkey, &encryption_algorithms, NULL);
+    s_kms_call_scope_end(&scope);
+    if (rc != AWS_OP_SUCCESS) {
         return AWS_OP_ERR;
     }
 
-    request->policy_name = aws_string_clone_or_reuse(client->allocator, policy_name);
-    if (request->policy_name == NULL) {
-        aws_kms_get_key_policy_request_destroy(request);
-        return AWS_OP_ERR;
+    if ((encryption_algorithms & (1u << encryption_algorithm)) == 0) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_KMS,
+            "id=%p: Key %s does not support encryption algorithm %s.",
+            (void *)client,
+            aws_string_c_str(key_id),
+            aws_string_c_str(s_aws_encryption_algorithm_to_aws_string(encryption_algorithm)));
+        EVP_PKEY_free(pkey);
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
     }
 
-    int rc = aws_kms_get_key_policy_from_request(client, request, response_json);
-    aws_kms_get_key_policy_request_destroy(request);
+    rc = s_rsa_oaep_encrypt(
+        client->allocator, pkey, encryption_algorithm, aws_byte_cursor_from_buf(plaintext), ciphertext_blob);
+    EVP_PKEY_free(pkey);
+
     return rc;
-}
\ No newline at end of file
+}
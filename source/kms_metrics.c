@@ -0,0 +1,408 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/histogram.h>
+#include <aws/nitro_enclaves/internal/kms_metrics.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/logging.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+struct aws_nitro_enclaves_kms_metrics_recorder {
+    struct aws_allocator *allocator;
+
+    struct aws_nitro_enclaves_histogram *stages[AWS_KMS_STAGE_COUNT];
+    struct aws_nitro_enclaves_histogram *operations[AWS_KMS_OPERATION_COUNT];
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    uint64_t calls[AWS_KMS_OPERATION_COUNT];
+    uint64_t errors[AWS_KMS_OPERATION_COUNT];
+    struct aws_kms_http_status_count http_statuses[AWS_KMS_METRICS_MAX_HTTP_STATUSES];
+    size_t http_status_count;
+    uint64_t connection_errors;
+    struct aws_kms_error_type_count error_types[AWS_KMS_METRICS_MAX_ERROR_TYPES];
+    size_t error_type_count;
+    uint64_t attestation_cache_hits;
+    uint64_t attestation_cache_misses;
+    uint64_t bytes_out;
+    uint64_t bytes_in;
+
+    /* Periodic dumps. The thread is only started if dump_interval_ms is not 0. */
+    uint64_t dump_interval_ms;
+    aws_nitro_enclaves_kms_metrics_dump_fn *dump_fn;
+    void *dump_user_data;
+    struct aws_thread dump_thread;
+    struct aws_condition_variable c_var;
+    bool stopping;
+};
+
+const char *aws_kms_stage_name(enum aws_kms_stage stage) {
+    switch (stage) {
+        case AWS_KMS_STAGE_ATTESTATION:
+            return "attestation";
+        case AWS_KMS_STAGE_JSON_BUILD:
+            return "json_build";
+        case AWS_KMS_STAGE_SIGN:
+            return "sign";
+        case AWS_KMS_STAGE_NETWORK:
+            return "network";
+        case AWS_KMS_STAGE_JSON_PARSE:
+            return "json_parse";
+        case AWS_KMS_STAGE_CMS_PARSE:
+            return "cms_parse";
+        case AWS_KMS_STAGE_RSA_DECRYPT:
+            return "rsa_decrypt";
+        case AWS_KMS_STAGE_AES_DECRYPT:
+            return "aes_decrypt";
+        default:
+            return "unknown";
+    }
+}
+
+const char *aws_kms_operation_name(enum aws_kms_operation operation) {
+    switch (operation) {
+        case AWS_KMS_OPERATION_DECRYPT:
+            return "Decrypt";
+        case AWS_KMS_OPERATION_ENCRYPT:
+            return "Encrypt";
+        case AWS_KMS_OPERATION_GENERATE_DATA_KEY:
+            return "GenerateDataKey";
+        case AWS_KMS_OPERATION_GENERATE_RANDOM:
+            return "GenerateRandom";
+        case AWS_KMS_OPERATION_LIST_KEY_POLICIES:
+            return "ListKeyPolicies";
+        case AWS_KMS_OPERATION_GET_KEY_POLICY:
+            return "GetKeyPolicy";
+        case AWS_KMS_OPERATION_GET_PUBLIC_KEY:
+            return "GetPublicKey";
+        default:
+            return "Unknown";
+    }
+}
+
+static void s_print_summary(const char *name, const struct aws_nitro_enclaves_latency_summary *summary) {
+    if (summary->count == 0) {
+        return;
+    }
+
+    AWS_LOGF_INFO(
+        AWS_LS_NITRO_ENCLAVES_METRICS,
+        "%s count=%" PRIu64 " avg=%" PRIu64 "us p50=%" PRIu64 "us p90=%" PRIu64 "us p99=%" PRIu64 "us p99.9=%" PRIu64
+        "us max=%" PRIu64 "us",
+        name,
+        summary->count,
+        summary->sum_ns / summary->count / 1000,
+        summary->p50_ns / 1000,
+        summary->p90_ns / 1000,
+        summary->p99_ns / 1000,
+        summary->p999_ns / 1000,
+        summary->max_ns / 1000);
+}
+
+static bool s_is_metrics_logging_enabled(void) {
+    struct aws_logger *logger = aws_logger_get();
+    return logger != NULL && logger->vtable->get_log_level(logger, AWS_LS_NITRO_ENCLAVES_METRICS) >= AWS_LL_INFO;
+}
+
+/* The dump used when no callback is configured. */
+static void s_print_metrics(const struct aws_nitro_enclaves_kms_metrics *metrics) {
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        const struct aws_kms_operation_metrics *operation = &metrics->operations[i];
+        if (operation->calls == 0) {
+            continue;
+        }
+        AWS_LOGF_INFO(
+            AWS_LS_NITRO_ENCLAVES_METRICS,
+            "%s calls=%" PRIu64 " errors=%" PRIu64,
+            aws_kms_operation_name((enum aws_kms_operation)i),
+            operation->calls,
+            operation->errors);
+        s_print_summary(aws_kms_operation_name((enum aws_kms_operation)i), &operation->latency);
+    }
+    for (size_t i = 0; i < AWS_KMS_STAGE_COUNT; ++i) {
+        s_print_summary(aws_kms_stage_name((enum aws_kms_stage)i), &metrics->stages[i]);
+    }
+    for (size_t i = 0; i < metrics->http_status_count; ++i) {
+        AWS_LOGF_INFO(
+            AWS_LS_NITRO_ENCLAVES_METRICS,
+            "http_%d=%" PRIu64,
+            metrics->http_statuses[i].status,
+            metrics->http_statuses[i].count);
+    }
+    for (size_t i = 0; i < metrics->error_type_count; ++i) {
+        AWS_LOGF_INFO(
+            AWS_LS_NITRO_ENCLAVES_METRICS, "%s=%" PRIu64, metrics->error_types[i].name, metrics->error_types[i].count);
+    }
+    AWS_LOGF_INFO(
+        AWS_LS_NITRO_ENCLAVES_METRICS,
+        "connection_errors=%" PRIu64 " attestation_cache_hits=%" PRIu64 " attestation_cache_misses=%" PRIu64
+        " bytes_out=%" PRIu64 " bytes_in=%" PRIu64,
+        metrics->connection_errors,
+        metrics->attestation_cache_hits,
+        metrics->attestation_cache_misses,
+        metrics->bytes_out,
+        metrics->bytes_in);
+}
+
+static bool s_is_stopping(void *user_data) {
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder = user_data;
+    return recorder->stopping;
+}
+
+static void s_dump_thread_main(void *user_data) {
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder = user_data;
+    int64_t interval_ns =
+        (int64_t)aws_timestamp_convert(recorder->dump_interval_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+
+    struct aws_nitro_enclaves_kms_metrics metrics;
+    aws_mutex_lock(&recorder->mutex);
+    while (!recorder->stopping) {
+        aws_condition_variable_wait_for_pred(&recorder->c_var, &recorder->mutex, interval_ns, s_is_stopping, recorder);
+        if (recorder->stopping) {
+            break;
+        }
+
+        /* The snapshot takes the mutex, and the callback must not run under it. */
+        aws_mutex_unlock(&recorder->mutex);
+        if (recorder->dump_fn != NULL) {
+            aws_nitro_enclaves_kms_metrics_snapshot(recorder, &metrics);
+            recorder->dump_fn(&metrics, recorder->dump_user_data);
+        } else if (s_is_metrics_logging_enabled()) {
+            aws_nitro_enclaves_kms_metrics_snapshot(recorder, &metrics);
+            s_print_metrics(&metrics);
+        }
+        aws_mutex_lock(&recorder->mutex);
+    }
+    aws_mutex_unlock(&recorder->mutex);
+}
+
+static void s_recorder_clean_up(struct aws_nitro_enclaves_kms_metrics_recorder *recorder) {
+    for (size_t i = 0; i < AWS_KMS_STAGE_COUNT; ++i) {
+        aws_nitro_enclaves_histogram_destroy(recorder->stages[i]);
+    }
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        aws_nitro_enclaves_histogram_destroy(recorder->operations[i]);
+    }
+    aws_mem_release(recorder->allocator, recorder);
+}
+
+struct aws_nitro_enclaves_kms_metrics_recorder *aws_nitro_enclaves_kms_metrics_recorder_new(
+    struct aws_allocator *allocator,
+    uint64_t dump_interval_ms,
+    aws_nitro_enclaves_kms_metrics_dump_fn *dump_fn,
+    void *dump_user_data) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_kms_metrics_recorder));
+    if (recorder == NULL) {
+        return NULL;
+    }
+
+    recorder->allocator = allocator;
+    recorder->dump_interval_ms = dump_interval_ms;
+    recorder->dump_fn = dump_fn;
+    recorder->dump_user_data = dump_user_data;
+
+    for (size_t i = 0; i < AWS_KMS_STAGE_COUNT; ++i) {
+        recorder->stages[i] = aws_nitro_enclaves_histogram_new(allocator);
+        if (recorder->stages[i] == NULL) {
+            goto err_clean;
+        }
+    }
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        recorder->operations[i] = aws_nitro_enclaves_histogram_new(allocator);
+        if (recorder->operations[i] == NULL) {
+            goto err_clean;
+        }
+    }
+
+    if (aws_mutex_init(&recorder->mutex) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    if (aws_condition_variable_init(&recorder->c_var) != AWS_OP_SUCCESS) {
+        goto err_clean_mutex;
+    }
+
+    if (dump_interval_ms != 0) {
+        if (aws_thread_init(&recorder->dump_thread, allocator) != AWS_OP_SUCCESS) {
+            goto err_clean_c_var;
+        }
+        if (aws_thread_launch(&recorder->dump_thread, s_dump_thread_main, recorder, NULL) != AWS_OP_SUCCESS) {
+            aws_thread_clean_up(&recorder->dump_thread);
+            goto err_clean_c_var;
+        }
+    }
+
+    return recorder;
+
+err_clean_c_var:
+    aws_condition_variable_clean_up(&recorder->c_var);
+err_clean_mutex:
+    aws_mutex_clean_up(&recorder->mutex);
+err_clean:
+    s_recorder_clean_up(recorder);
+    return NULL;
+}
+
+void aws_nitro_enclaves_kms_metrics_recorder_destroy(struct aws_nitro_enclaves_kms_metrics_recorder *recorder) {
+    if (recorder == NULL) {
+        return;
+    }
+
+    if (recorder->dump_interval_ms != 0) {
+        aws_mutex_lock(&recorder->mutex);
+        recorder->stopping = true;
+        aws_condition_variable_notify_all(&recorder->c_var);
+        aws_mutex_unlock(&recorder->mutex);
+
+        aws_thread_join(&recorder->dump_thread);
+        aws_thread_clean_up(&recorder->dump_thread);
+    }
+
+    aws_condition_variable_clean_up(&recorder->c_var);
+    aws_mutex_clean_up(&recorder->mutex);
+    s_recorder_clean_up(recorder);
+}
+
+void aws_nitro_enclaves_kms_metrics_record_stage(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    enum aws_kms_stage stage,
+    uint64_t duration_ns) {
+    AWS_PRECONDITION(stage < AWS_KMS_STAGE_COUNT);
+
+    if (recorder == NULL) {
+        return;
+    }
+
+    aws_nitro_enclaves_histogram_record(recorder->stages[stage], duration_ns);
+}
+
+void aws_nitro_enclaves_kms_metrics_record_attempt(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    int status,
+    struct aws_byte_cursor error_type,
+    size_t bytes_out,
+    size_t bytes_in) {
+    if (recorder == NULL) {
+        return;
+    }
+
+    aws_mutex_lock(&recorder->mutex);
+    recorder->bytes_out += bytes_out;
+    recorder->bytes_in += bytes_in;
+
+    if (status <= 0) {
+        recorder->connection_errors++;
+    } else {
+        size_t i = 0;
+        while (i < recorder->http_status_count && recorder->http_statuses[i].status != status) {
+            i++;
+        }
+        if (i == recorder->http_status_count && i < AWS_KMS_METRICS_MAX_HTTP_STATUSES) {
+            recorder->http_statuses[i].status = status;
+            recorder->http_status_count++;
+        }
+        if (i < recorder->http_status_count) {
+            recorder->http_statuses[i].count++;
+        }
+    }
+
+    if (error_type.len > 0) {
+        /* Longer names are truncated, and compared as truncated. */
+        size_t len = AWS_MIN(error_type.len, AWS_KMS_METRICS_ERROR_TYPE_LEN - 1);
+        struct aws_byte_cursor name = aws_byte_cursor_from_array(error_type.ptr, len);
+
+        size_t i = 0;
+        while (i < recorder->error_type_count && !aws_byte_cursor_eq_c_str(&name, recorder->error_types[i].name)) {
+            i++;
+        }
+        if (i == recorder->error_type_count && i < AWS_KMS_METRICS_MAX_ERROR_TYPES) {
+            memcpy(recorder->error_types[i].name, name.ptr, len);
+            recorder->error_types[i].name[len] = '\0';
+            recorder->error_type_count++;
+        }
+        if (i < recorder->error_type_count) {
+            recorder->error_types[i].count++;
+        }
+    }
+    aws_mutex_unlock(&recorder->mutex);
+}
+
+void aws_nitro_enclaves_kms_metrics_record_attestation(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    bool cache_hit) {
+    if (recorder == NULL) {
+        return;
+    }
+
+    aws_mutex_lock(&recorder->mutex);
+    if (cache_hit) {
+        recorder->attestation_cache_hits++;
+    } else {
+        recorder->attestation_cache_misses++;
+    }
+    aws_mutex_unlock(&recorder->mutex);
+}
+
+void aws_nitro_enclaves_kms_metrics_record_call(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    enum aws_kms_operation operation,
+    bool success,
+    uint64_t duration_ns) {
+    AWS_PRECONDITION(operation < AWS_KMS_OPERATION_COUNT);
+
+    if (recorder == NULL) {
+        return;
+    }
+
+    aws_nitro_enclaves_histogram_record(recorder->operations[operation], duration_ns);
+
+    aws_mutex_lock(&recorder->mutex);
+    recorder->calls[operation]++;
+    if (!success) {
+        recorder->errors[operation]++;
+    }
+    aws_mutex_unlock(&recorder->mutex);
+}
+
+void aws_nitro_enclaves_kms_metrics_snapshot(
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder,
+    struct aws_nitro_enclaves_kms_metrics *metrics) {
+    AWS_PRECONDITION(recorder != NULL);
+    AWS_PRECONDITION(metrics != NULL);
+
+    AWS_ZERO_STRUCT(*metrics);
+
+    for (size_t i = 0; i < AWS_KMS_STAGE_COUNT; ++i) {
+        aws_nitro_enclaves_histogram_summarize(recorder->stages[i], &metrics->stages[i]);
+    }
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        aws_nitro_enclaves_histogram_summarize(recorder->operations[i], &metrics->operations[i].latency);
+    }
+
+    aws_mutex_lock(&recorder->mutex);
+    for (size_t i = 0; i < AWS_KMS_OPERATION_COUNT; ++i) {
+        metrics->operations[i].calls = recorder->calls[i];
+        metrics->operations[i].errors = recorder->errors[i];
+    }
+    memcpy(metrics->http_statuses, recorder->http_statuses, sizeof(metrics->http_statuses));
+    metrics->http_status_count = recorder->http_status_count;
+    metrics->connection_errors = recorder->connection_errors;
+    memcpy(metrics->error_types, recorder->error_types, sizeof(metrics->error_types));
+    metrics->error_type_count = recorder->error_type_count;
+    metrics->attestation_cache_hits = recorder->attestation_cache_hits;
+    metrics->attestation_cache_misses = recorder->attestation_cache_misses;
+    metrics->bytes_out = recorder->bytes_out;
+    metrics->bytes_in = recorder->bytes_in;
+    aws_mutex_unlock(&recorder->mutex);
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/latency_tracker.h>
+
+#include <aws/common/mutex.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct aws_nitro_enclaves_latency_tracker {
+    struct aws_allocator *allocator;
+    struct aws_mutex mutex;
+
+    /* Ring buffer of the most recent samples. */
+    uint64_t *samples;
+    size_t capacity;
+    size_t count;
+    size_t next;
+
+    /* Scratch space for sorting, protected by mutex. */
+    uint64_t *sorted;
+};
+
+struct aws_nitro_enclaves_latency_tracker *aws_nitro_enclaves_latency_tracker_new(
+    struct aws_allocator *allocator,
+    size_t capacity) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(capacity > 0);
+
+    struct aws_nitro_enclaves_latency_tracker *tracker =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_latency_tracker));
+    if (tracker == NULL) {
+        return NULL;
+    }
+
+    tracker->allocator = allocator;
+    tracker->capacity = capacity;
+    tracker->samples = aws_mem_calloc(allocator, capacity, sizeof(uint64_t));
+    tracker->sorted = aws_mem_calloc(allocator, capacity, sizeof(uint64_t));
+    if (tracker->samples == NULL || tracker->sorted == NULL) {
+        goto err_clean;
+    }
+
+    if (aws_mutex_init(&tracker->mutex) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+
+    return tracker;
+err_clean:
+    aws_mem_release(allocator, tracker->samples);
+    aws_mem_release(allocator, tracker->sorted);
+    aws_mem_release(allocator, tracker);
+    return NULL;
+}
+
+void aws_nitro_enclaves_latency_tracker_destroy(struct aws_nitro_enclaves_latency_tracker *tracker) {
+    if (tracker == NULL) {
+        return;
+    }
+
+    aws_mutex_clean_up(&tracker->mutex);
+    aws_mem_release(tracker->allocator, tracker->samples);
+    aws_mem_release(tracker->allocator, tracker->sorted);
+    aws_mem_release(tracker->allocator, tracker);
+}
+
+void aws_nitro_enclaves_latency_tracker_record(
+    struct aws_nitro_enclaves_latency_tracker *tracker,
+    uint64_t latency_ns) {
+    AWS_PRECONDITION(tracker != NULL);
+
+    aws_mutex_lock(&tracker->mutex);
+    tracker->samples[tracker->next] = latency_ns;
+    tracker->next = (tracker->next + 1) % tracker->capacity;
+    if (tracker->count < tracker->capacity) {
+        tracker->count++;
+    }
+    aws_mutex_unlock(&tracker->mutex);
+}
+
+static int s_compare_u64(const void *a, const void *b) {
+    uint64_t lhs = *(const uint64_t *)a;
+    uint64_t rhs = *(const uint64_t *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+bool aws_nitro_enclaves_latency_tracker_percentile(
+    struct aws_nitro_enclaves_latency_tracker *tracker,
+    uint32_t percentile,
+    size_t min_samples,
+    uint64_t *latency_ns) {
+    AWS_PRECONDITION(tracker != NULL);
+    AWS_PRECONDITION(percentile > 0 && percentile <= 100);
+    AWS_PRECONDITION(latency_ns != NULL);
+
+    bool found = false;
+
+    aws_mutex_lock(&tracker->mutex);
+    size_t count = tracker->count;
+    if (count > 0 && count >= min_samples) {
+        memcpy(tracker->sorted, tracker->samples, count * sizeof(uint64_t));
+        qsort(tracker->sorted, count, sizeof(uint64_t), s_compare_u64);
+
+        /* Nearest rank: the smallest sample such that at least percentile% of the samples are <= it. */
+        size_t rank = (count * percentile + 99) / 100;
+        *latency_ns = tracker->sorted[rank - 1];
+        found = true;
+    }
+    aws_mutex_unlock(&tracker->mutex);
+
+    return found;
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/logging.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/condition_variable.h>
+#include <aws/common/date_time.h>
+#include <aws/common/math.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define DEFAULT_CAPACITY 1024
+#define DEFAULT_LINE_SIZE 512
+/* Lines are formatted on the caller's stack, so their size is bounded. */
+#define MAX_LINE_SIZE 4096
+
+struct async_logger {
+    struct aws_allocator *allocator;
+    FILE *file;
+    struct aws_atomic_var level;
+    size_t capacity;
+    size_t line_size;
+    /* capacity slots of line_size bytes, and the length of the line in each slot. */
+    char *slots;
+    size_t *lengths;
+    struct aws_thread writer_thread;
+
+    /* Everything below is protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+    size_t head;
+    size_t count;
+    uint64_t dropped;
+    bool stopping;
+};
+
+static int s_async_logger_log(
+    struct aws_logger *logger,
+    enum aws_log_level log_level,
+    aws_log_subject_t subject,
+    const char *format,
+    ...) {
+    struct async_logger *impl = logger->p_impl;
+
+    const char *level_string = NULL;
+    if (aws_log_level_to_string(log_level, &level_string) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    uint8_t timestamp[AWS_DATE_TIME_STR_MAX_LEN];
+    struct aws_byte_buf timestamp_buf = aws_byte_buf_from_empty_array(timestamp, sizeof(timestamp));
+    struct aws_date_time now;
+    aws_date_time_init_now(&now);
+    aws_date_time_to_utc_time_str(&now, AWS_DATE_FORMAT_ISO_8601, &timestamp_buf);
+
+    char thread_id[AWS_THREAD_ID_T_REPR_BUFSZ];
+    aws_thread_id_t_to_string(aws_thread_current_thread_id(), thread_id, sizeof(thread_id));
+
+    /* One byte is kept for the newline, which replaces the terminator. */
+    char line[MAX_LINE_SIZE];
+    int header_len = snprintf(
+        line,
+        impl->line_size,
+        "[%s] [%.*s] [%s] [%s] - ",
+        level_string,
+        (int)timestamp_buf.len,
+        (const char *)timestamp_buf.buffer,
+        thread_id,
+        aws_log_subject_name(subject));
+    if (header_len < 0) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+    size_t len = AWS_MIN((size_t)header_len, impl->line_size - 1);
+
+    va_list args;
+    va_start(args, format);
+    int message_len = vsnprintf(line + len, impl->line_size - len, format, args);
+    va_end(args);
+    if (message_len > 0) {
+        len = AWS_MIN(len + (size_t)message_len, impl->line_size - 1);
+    }
+    line[len++] = '\n';
+
+    aws_mutex_lock(&impl->mutex);
+    if (impl->count == impl->capacity) {
+        impl->dropped++;
+        aws_mutex_unlock(&impl->mutex);
+        return AWS_OP_SUCCESS;
+    }
+    size_t slot = (impl->head + impl->count) % impl->capacity;
+    memcpy(impl->slots + slot * impl->line_size, line, len);
+    impl->lengths[slot] = len;
+    bool was_empty = impl->count++ == 0;
+    aws_mutex_unlock(&impl->mutex);
+
+    /* A non-empty ring means the writer is busy and will look at the ring again. */
+    if (was_empty) {
+        aws_condition_variable_notify_one(&impl->c_var);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static enum aws_log_level s_async_logger_get_log_level(struct aws_logger *logger, aws_log_subject_t subject) {
+    (void)subject;
+    struct async_logger *impl = logger->p_impl;
+    return (enum aws_log_level)aws_atomic_load_int(&impl->level);
+}
+
+static int s_async_logger_set_log_level(struct aws_logger *logger, enum aws_log_level level) {
+    struct async_logger *impl = logger->p_impl;
+    aws_atomic_store_int(&impl->level, (size_t)level);
+    return AWS_OP_SUCCESS;
+}
+
+static bool s_has_work(void *user_data) {
+    struct async_logger *impl = user_data;
+    return impl->count > 0 || impl->stopping;
+}
+
+static void s_writer_thread_main(void *user_data) {
+    struct async_logger *impl = user_data;
+
+    aws_mutex_lock(&impl->mutex);
+    while (true) {
+        aws_condition_variable_wait_pred(&impl->c_var, &impl->mutex, s_has_work, impl);
+        if (impl->count == 0) {
+            /* Stopping, and everything is written. */
+            break;
+        }
+
+        /* The slots stay taken until head moves, so they are written without holding the mutex. */
+        size_t head = impl->head;
+        size_t count = impl->count;
+        uint64_t dropped = impl->dropped;
+        impl->dropped = 0;
+        aws_mutex_unlock(&impl->mutex);
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t slot = (head + i) % impl->capacity;
+            fwrite(impl->slots + slot * impl->line_size, 1, impl->lengths[slot], impl->file);
+        }
+        if (dropped > 0) {
+            fprintf(impl->file, "[WARN] - %" PRIu64 " log lines dropped: the log ring was full.\n", dropped);
+        }
+        fflush(impl->file);
+
+        aws_mutex_lock(&impl->mutex);
+        impl->head = (head + count) % impl->capacity;
+        impl->count -= count;
+    }
+    aws_mutex_unlock(&impl->mutex);
+}
+
+static void s_async_logger_destroy(struct async_logger *impl) {
+    aws_condition_variable_clean_up(&impl->c_var);
+    aws_mutex_clean_up(&impl->mutex);
+    aws_mem_release(impl->allocator, impl->lengths);
+    aws_mem_release(impl->allocator, impl->slots);
+    aws_mem_release(impl->allocator, impl);
+}
+
+static void s_async_logger_clean_up(struct aws_logger *logger) {
+    struct async_logger *impl = logger->p_impl;
+
+    aws_mutex_lock(&impl->mutex);
+    impl->stopping = true;
+    aws_mutex_unlock(&impl->mutex);
+    aws_condition_variable_notify_one(&impl->c_var);
+
+    aws_thread_join(&impl->writer_thread);
+    aws_thread_clean_up(&impl->writer_thread);
+    s_async_logger_destroy(impl);
+
+    AWS_ZERO_STRUCT(*logger);
+}
+
+static struct aws_logger_vtable s_async_logger_vtable = {
+    .log = s_async_logger_log,
+    .get_log_level = s_async_logger_get_log_level,
+    .clean_up = s_async_logger_clean_up,
+    .set_log_level = s_async_logger_set_log_level,
+};
+
+int aws_nitro_enclaves_logger_init_async(
+    struct aws_logger *logger,
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_async_logger_options *options) {
+    AWS_PRECONDITION(logger != NULL);
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(options != NULL);
+
+    if (options->file == NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    struct async_logger *impl = aws_mem_calloc(allocator, 1, sizeof(struct async_logger));
+    if (impl == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    impl->allocator = allocator;
+    impl->file = options->file;
+    aws_atomic_init_int(&impl->level, (size_t)options->level);
+    impl->capacity = options->capacity != 0 ? options->capacity : DEFAULT_CAPACITY;
+    impl->line_size = AWS_MIN(options->line_size != 0 ? options->line_size : DEFAULT_LINE_SIZE, MAX_LINE_SIZE);
+
+    impl->slots = aws_mem_calloc(allocator, impl->capacity, impl->line_size);
+    if (impl->slots == NULL) {
+        goto err_clean;
+    }
+    impl->lengths = aws_mem_calloc(allocator, impl->capacity, sizeof(size_t));
+    if (impl->lengths == NULL) {
+        goto err_clean_slots;
+    }
+
+    if (aws_mutex_init(&impl->mutex) != AWS_OP_SUCCESS) {
+        goto err_clean_lengths;
+    }
+    if (aws_condition_variable_init(&impl->c_var) != AWS_OP_SUCCESS) {
+        goto err_clean_mutex;
+    }
+
+    if (aws_thread_init(&impl->writer_thread, allocator) != AWS_OP_SUCCESS) {
+        goto err_clean_c_var;
+    }
+    if (aws_thread_launch(&impl->writer_thread, s_writer_thread_main, impl, NULL) != AWS_OP_SUCCESS) {
+        aws_thread_clean_up(&impl->writer_thread);
+        goto err_clean_c_var;
+    }
+
+    logger->vtable = &s_async_logger_vtable;
+    logger->allocator = allocator;
+    logger->p_impl = impl;
+
+    return AWS_OP_SUCCESS;
+
+err_clean_c_var:
+    aws_condition_variable_clean_up(&impl->c_var);
+err_clean_mutex:
+    aws_mutex_clean_up(&impl->mutex);
+err_clean_lengths:
+    aws_mem_release(allocator, impl->lengths);
+err_clean_slots:
+    aws_mem_release(allocator, impl->slots);
+err_clean:
+    aws_mem_release(allocator, impl);
+    return AWS_OP_ERR;
+}
@@ -4,23 +4,76 @@
  */
 #include <aws/nitro_enclaves/nitro_enclaves.h>
 
+#include <aws/nitro_enclaves/internal/entropy.h>
+
 #include <aws/auth/auth.h>
 #include <aws/common/allocator.h>
+#include <aws/common/mutex.h>
 #include <aws/http/http.h>
+#include <aws/io/channel_bootstrap.h>
+#include <aws/io/event_loop.h>
+#include <aws/io/host_resolver.h>
+#include <aws/io/tls_channel_handler.h>
 
-#include <fcntl.h>
-#include <linux/random.h>
 #include <stdlib.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
-
-#include <nsm.h>
 
-/* Maximum number of bytes NSM random response returns. */
-#define NSM_RANDOM_REQ_SIZE (256)
+/* ALPN protocols offered by the shared TLS context. */
+#define ALPN_STRING "h2;http/1.1"
+
+#define AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(C, ES) AWS_DEFINE_ERROR_INFO(C, ES, "aws-nitro-enclaves-sdk-c")
+
+/* clang-format off */
+static struct aws_error_info s_errors[] = {
+    AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(
+        AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED,
+        "The KMS call exceeds the client-side rate limit."),
+    AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(
+        AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT,
+        "The REST request did not complete before its deadline."),
+    AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(
+        AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED,
+        "The REST request was cancelled."),
+    AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(
+        AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE,
+        "The NitroSecureModule or the kernel entropy pool could not be used."),
+    AWS_DEFINE_ERROR_INFO_NITRO_ENCLAVES(
+        AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND,
+        "The AWS KMS key or key policy does not exist."),
+};
+/* clang-format on */
+
+static struct aws_error_info_list s_error_list = {
+    .error_list = s_errors,
+    .count = AWS_ARRAY_SIZE(s_errors),
+};
+
+/* clang-format off */
+static struct aws_log_subject_info s_log_subject_infos[] = {
+    DEFINE_LOG_SUBJECT_INFO(AWS_LS_NITRO_ENCLAVES_GENERAL, "nitro-enclaves", "Subject for general SDK logging."),
+    DEFINE_LOG_SUBJECT_INFO(AWS_LS_NITRO_ENCLAVES_REST, "nitro-enclaves-rest", "Subject for the REST client."),
+    DEFINE_LOG_SUBJECT_INFO(AWS_LS_NITRO_ENCLAVES_KMS, "nitro-enclaves-kms", "Subject for the KMS client."),
+    DEFINE_LOG_SUBJECT_INFO(AWS_LS_NITRO_ENCLAVES_METRICS, "nitro-enclaves-metrics", "Subject for KMS metrics dumps."),
+};
+/* clang-format on */
+
+static struct aws_log_subject_info_list s_log_subject_list = {
+    .subject_list = s_log_subject_infos,
+    .count = AWS_ARRAY_SIZE(s_log_subject_infos),
+};
 
 static bool s_library_initialized = false;
 static struct aws_allocator *s_aws_ne_allocator = NULL;
+static struct aws_nitro_enclaves_library_options s_library_options;
+
+/* Event loop group and bootstrap shared by the rest clients, created on first use. */
+static struct aws_mutex s_bootstrap_mutex = AWS_MUTEX_INIT;
+static struct aws_event_loop_group *s_el_group = NULL;
+static struct aws_host_resolver *s_host_resolver = NULL;
+static struct aws_client_bootstrap *s_client_bootstrap = NULL;
+
+/* TLS context shared by the rest clients, created on first use. */
+static struct aws_mutex s_tls_ctx_mutex = AWS_MUTEX_INIT;
+static struct aws_tls_ctx *s_tls_ctx = NULL;
 
 struct aws_allocator *aws_nitro_enclaves_get_allocator() {
     AWS_FATAL_ASSERT(s_library_initialized == true);
@@ -28,11 +81,97 @@ struct aws_allocator *aws_nitro_enclaves_get_allocator() {
     return s_aws_ne_allocator;
 }
 
+static void s_release_client_bootstrap(void) {
+    aws_client_bootstrap_release(s_client_bootstrap);
+    aws_host_resolver_release(s_host_resolver);
+    aws_event_loop_group_release(s_el_group);
+    s_client_bootstrap = NULL;
+    s_host_resolver = NULL;
+    s_el_group = NULL;
+}
+
+struct aws_client_bootstrap *aws_nitro_enclaves_get_client_bootstrap(void) {
+    AWS_FATAL_ASSERT(s_library_initialized == true);
+
+    aws_mutex_lock(&s_bootstrap_mutex);
+    if (s_client_bootstrap != NULL) {
+        goto finalize;
+    }
+
+    if (s_library_options.pin_event_loop_threads) {
+        s_el_group = aws_event_loop_group_new_default_pinned_to_cpu_group(
+            s_aws_ne_allocator, s_library_options.max_event_loop_threads, s_library_options.cpu_group, NULL);
+    } else {
+        s_el_group =
+            aws_event_loop_group_new_default(s_aws_ne_allocator, s_library_options.max_event_loop_threads, NULL);
+    }
+    if (s_el_group == NULL) {
+        goto err_clean;
+    }
+
+    struct aws_host_resolver_default_options resolver_options = {
+        .el_group = s_el_group,
+        .max_entries = 8,
+    };
+    s_host_resolver = aws_host_resolver_new_default(s_aws_ne_allocator, &resolver_options);
+    if (s_host_resolver == NULL) {
+        goto err_clean;
+    }
+
+    struct aws_client_bootstrap_options bootstrap_options = {
+        .event_loop_group = s_el_group,
+        .host_resolver = s_host_resolver,
+    };
+    s_client_bootstrap = aws_client_bootstrap_new(s_aws_ne_allocator, &bootstrap_options);
+    if (s_client_bootstrap == NULL) {
+        goto err_clean;
+    }
+
+    goto finalize;
+err_clean:
+    s_release_client_bootstrap();
+finalize:
+    aws_mutex_unlock(&s_bootstrap_mutex);
+    return s_client_bootstrap;
+}
+
+struct aws_tls_ctx *aws_nitro_enclaves_get_tls_ctx(void) {
+    AWS_FATAL_ASSERT(s_library_initialized == true);
+
+    aws_mutex_lock(&s_tls_ctx_mutex);
+    if (s_tls_ctx == NULL) {
+        struct aws_tls_ctx_options tls_ctx_options;
+        AWS_ZERO_STRUCT(tls_ctx_options);
+
+        aws_tls_ctx_options_init_default_client(&tls_ctx_options, s_aws_ne_allocator);
+        if (aws_tls_ctx_options_set_alpn_list(&tls_ctx_options, ALPN_STRING) == AWS_OP_SUCCESS) {
+            s_tls_ctx = aws_tls_client_ctx_new(s_aws_ne_allocator, &tls_ctx_options);
+        }
+        /* tls_ctx_options are copied, so the strucure can be cleaned up at this point */
+        aws_tls_ctx_options_clean_up(&tls_ctx_options);
+    }
+    aws_mutex_unlock(&s_tls_ctx_mutex);
+
+    return s_tls_ctx;
+}
+
 void aws_nitro_enclaves_library_init(struct aws_allocator *allocator) {
+    aws_nitro_enclaves_library_init_with_options(allocator, NULL);
+}
+
+void aws_nitro_enclaves_library_init_with_options(
+    struct aws_allocator *allocator,
+    const struct aws_nitro_enclaves_library_options *options) {
     if (s_library_initialized) {
         return;
     }
 
+    if (options != NULL) {
+        s_library_options = *options;
+    } else {
+        AWS_ZERO_STRUCT(s_library_options);
+    }
+
     if (allocator == NULL) {
         s_aws_ne_allocator = aws_default_allocator();
     } else {
@@ -45,6 +184,8 @@ void aws_nitro_enclaves_library_init(struct aws_allocator *allocator) {
 
     aws_auth_library_init(s_aws_ne_allocator);
     aws_http_library_init(s_aws_ne_allocator);
+    aws_register_error_info(&s_error_list);
+    aws_register_log_subject_info_list(&s_log_subject_list);
     /* TODO: Initialize NSM */
 }
 
@@ -54,57 +195,19 @@ void aws_nitro_enclaves_library_clean_up(void) {
     }
     s_library_initialized = false;
 
-    aws_auth_library_clean_up();
-    aws_http_library_clean_up();
-}
-
-int aws_nitro_enclaves_library_seed_entropy(uint64_t num_bytes) {
-
-    int nsm_fd = nsm_lib_init();
-    if (nsm_fd < 0) {
-        return AWS_OP_ERR;
-    }
-
-    int dev_fd = open("/dev/random", O_WRONLY);
-    if (dev_fd < 0) {
-        nsm_lib_exit(nsm_fd);
-        return AWS_OP_ERR;
-    }
-
-    uint64_t count = 0;
-
-    while (count != num_bytes) {
-        uint8_t buf[NSM_RANDOM_REQ_SIZE];
-        size_t buf_len = sizeof(buf) > (num_bytes - count) ? (num_bytes - count) : sizeof(buf);
-
-        /* Yields up to 256 bytes */
-        int rc = nsm_get_random(nsm_fd, buf, &buf_len);
-        if (rc)
-            goto err;
-
-        if (buf_len == 0) {
-            /* NSM starts yielding zero entropy */
-            goto err;
-        }
+    aws_nitro_enclaves_entropy_feeder_stop();
 
-        if ((ssize_t)buf_len != write(dev_fd, buf, buf_len))
-            goto err;
+    aws_mutex_lock(&s_tls_ctx_mutex);
+    aws_tls_ctx_release(s_tls_ctx);
+    s_tls_ctx = NULL;
+    aws_mutex_unlock(&s_tls_ctx_mutex);
 
-        int bits = buf_len * 8;
-        rc = ioctl(dev_fd, RNDADDTOENTCNT, &bits);
-        if (rc < 0)
-            goto err;
+    aws_mutex_lock(&s_bootstrap_mutex);
+    s_release_client_bootstrap();
+    aws_mutex_unlock(&s_bootstrap_mutex);
 
-        count += buf_len;
-    }
-
-    close(dev_fd);
-    nsm_lib_exit(nsm_fd);
-
-    return AWS_OP_SUCCESS;
-err:
-    close(dev_fd);
-    nsm_lib_exit(nsm_fd);
-
-    return AWS_OP_ERR;
+    aws_unregister_log_subject_info_list(&s_log_subject_list);
+    aws_unregister_error_info(&s_error_list);
+    aws_auth_library_clean_up();
+    aws_http_library_clean_up();
 }
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/rate_limiter.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+
+/*
+ * Token bucket expressed as a generic cell rate algorithm: instead of counting
+ * tokens, the limiter tracks the theoretical arrival time (TAT) of the next
+ * request. A request arriving at t is admitted once t >= TAT - tolerance, where
+ * the tolerance is the time needed to refill (burst - 1) tokens.
+ */
+struct aws_nitro_enclaves_rate_limiter {
+    struct aws_allocator *allocator;
+    struct aws_mutex mutex;
+
+    uint64_t emission_interval_ns;
+    uint64_t tolerance_ns;
+    uint64_t max_wait_ns;
+    uint64_t theoretical_arrival_ns;
+};
+
+struct aws_nitro_enclaves_rate_limiter *aws_nitro_enclaves_rate_limiter_new(
+    struct aws_allocator *allocator,
+    uint32_t requests_per_second,
+    uint32_t burst,
+    uint32_t max_wait_ms) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+    AWS_PRECONDITION(requests_per_second > 0);
+
+    struct aws_nitro_enclaves_rate_limiter *limiter =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_rate_limiter));
+    if (limiter == NULL) {
+        return NULL;
+    }
+
+    if (aws_mutex_init(&limiter->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, limiter);
+        return NULL;
+    }
+
+    if (burst == 0) {
+        burst = 1;
+    }
+
+    limiter->allocator = allocator;
+    limiter->emission_interval_ns = AWS_TIMESTAMP_NANOS / requests_per_second;
+    limiter->tolerance_ns = limiter->emission_interval_ns * (burst - 1);
+    limiter->max_wait_ns = aws_timestamp_convert(max_wait_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    limiter->theoretical_arrival_ns = 0;
+
+    return limiter;
+}
+
+void aws_nitro_enclaves_rate_limiter_destroy(struct aws_nitro_enclaves_rate_limiter *limiter) {
+    if (limiter == NULL) {
+        return;
+    }
+
+    aws_mutex_clean_up(&limiter->mutex);
+    aws_mem_release(limiter->allocator, limiter);
+}
+
+static int s_reserve(
+    struct aws_nitro_enclaves_rate_limiter *limiter,
+    uint64_t now_ns,
+    uint64_t max_wait_ns,
+    uint64_t *delay_ns) {
+    uint64_t tat = limiter->theoretical_arrival_ns > now_ns ? limiter->theoretical_arrival_ns : now_ns;
+    uint64_t allowed_at = tat > limiter->tolerance_ns ? tat - limiter->tolerance_ns : 0;
+    uint64_t delay = allowed_at > now_ns ? allowed_at - now_ns : 0;
+
+    if (delay > max_wait_ns) {
+        return aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED);
+    }
+
+    limiter->theoretical_arrival_ns = tat + limiter->emission_interval_ns;
+    *delay_ns = delay;
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_rate_limiter_reserve(
+    struct aws_nitro_enclaves_rate_limiter *limiter,
+    uint64_t now_ns,
+    uint64_t *delay_ns) {
+    AWS_PRECONDITION(limiter != NULL);
+    AWS_PRECONDITION(delay_ns != NULL);
+
+    return s_reserve(limiter, now_ns, limiter->max_wait_ns, delay_ns);
+}
+
+int aws_nitro_enclaves_rate_limiter_acquire(struct aws_nitro_enclaves_rate_limiter *limiter) {
+    if (limiter == NULL) {
+        return AWS_OP_SUCCESS;
+    }
+
+    uint64_t now_ns = 0;
+    uint64_t delay_ns = 0;
+    if (aws_high_res_clock_get_ticks(&now_ns) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    aws_mutex_lock(&limiter->mutex);
+    int rc = aws_nitro_enclaves_rate_limiter_reserve(limiter, now_ns, &delay_ns);
+    aws_mutex_unlock(&limiter->mutex);
+
+    if (rc != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    if (delay_ns > 0) {
+        aws_thread_current_sleep(delay_ns);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+bool aws_nitro_enclaves_rate_limiter_try_acquire(struct aws_nitro_enclaves_rate_limiter *limiter) {
+    if (limiter == NULL) {
+        return true;
+    }
+
+    uint64_t now_ns = 0;
+    uint64_t delay_ns = 0;
+    if (aws_high_res_clock_get_ticks(&now_ns) != AWS_OP_SUCCESS) {
+        return false;
+    }
+
+    aws_mutex_lock(&limiter->mutex);
+    int rc = s_reserve(limiter, now_ns, 0, &delay_ns);
+    aws_mutex_unlock(&limiter->mutex);
+
+    return rc == AWS_OP_SUCCESS;
+}
@@ -6,11 +6,22 @@
 #include <aws/nitro_enclaves/nitro_enclaves.h>
 #include <aws/nitro_enclaves/rest.h>
 
+#include <aws/nitro_enclaves/internal/future.h>
+#include <aws/nitro_enclaves/internal/rest.h>
+#include <aws/nitro_enclaves/internal/sigv4.h>
+
 #include <aws/auth/credentials.h>
 #include <aws/auth/signable.h>
 #include <aws/auth/signing.h>
 #include <aws/auth/signing_result.h>
 #include <aws/common/assert.h>
+#include <aws/common/atomics.h>
+#include <aws/common/clock.h>
+#include <aws/common/device_random.h>
+#include <aws/common/linked_list.h>
+#include <aws/common/logging.h>
+#include <aws/common/math.h>
+#include <aws/common/ref_count.h>
 #include <aws/http/connection.h>
 #include <aws/http/request_response.h>
 #include <aws/io/channel_bootstrap.h>
@@ -19,48 +30,295 @@
 
 #include <inttypes.h>
 
-#define ALPN_STRING "h2;http/1.1"
 #define CONNECT_TIMEOUT_MS 3000UL
 
+#define REST_DEFAULT_MAX_RECONNECT_ATTEMPTS 10
+#define REST_DEFAULT_RECONNECT_BACKOFF_BASE_MS 100
+#define REST_DEFAULT_RECONNECT_BACKOFF_MAX_MS 5000
+#define REST_DEFAULT_REQUEST_TIMEOUT_MS 10000
+#define REST_DEFAULT_MAX_CONCURRENT_STREAMS 100
+#define REST_DEFAULT_HTTP2_INITIAL_WINDOW_SIZE 1048576
+#define REST_FUTURE_POOL_SIZE 64
+
 #define USER_AGENT_NAME "aws-nitro_enclaves-sdk-c"
 #ifndef VERSION
 #    define VERSION "unknown"
 #endif
 
+static int s_connect(struct aws_nitro_enclaves_rest_client *rest_client);
+
+uint64_t aws_nitro_enclaves_rest_reconnect_delay_ms(
+    size_t attempt,
+    uint32_t base_ms,
+    uint32_t max_ms,
+    uint64_t random) {
+    size_t shift = AWS_MIN(attempt, (size_t)20);
+    uint64_t backoff_ms = (uint64_t)base_ms << shift;
+    if (backoff_ms > max_ms) {
+        backoff_ms = max_ms;
+    }
+
+    return random % (backoff_ms + 1);
+}
+
+uint64_t aws_nitro_enclaves_rest_hedge_at_ns(uint64_t now_ns, uint32_t hedge_delay_ms, uint64_t deadline_ns) {
+    uint64_t hedge_at_ns = aws_add_u64_saturating(
+        now_ns, aws_timestamp_convert(hedge_delay_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+    if (deadline_ns != 0 && hedge_at_ns >= deadline_ns) {
+        return 0;
+    }
+
+    return hedge_at_ns;
+}
+
+bool aws_nitro_enclaves_rest_attempts_are_done(const struct aws_nitro_enclaves_rest_attempts *attempts) {
+    if (!attempts->has_hedge) {
+        return attempts->is_complete;
+    }
+
+    /* With a hedged copy, wait for the first success or for both to fail. */
+    return (attempts->is_complete && attempts->error_code == AWS_OP_SUCCESS) ||
+           (attempts->is_hedge_complete && attempts->hedge_error_code == AWS_OP_SUCCESS) ||
+           (attempts->is_complete && attempts->is_hedge_complete);
+}
+
+struct aws_nitro_enclaves_rest_hedge_outcome aws_nitro_enclaves_rest_hedge_outcome(
+    const struct aws_nitro_enclaves_rest_attempts *attempts) {
+    struct aws_nitro_enclaves_rest_hedge_outcome outcome;
+    AWS_ZERO_STRUCT(outcome);
+
+    bool is_hedge_complete = attempts->has_hedge && attempts->is_hedge_complete;
+    if (attempts->is_complete && attempts->error_code == AWS_OP_SUCCESS) {
+        outcome.winner = AWS_NITRO_ENCLAVES_REST_WINNER_REQUEST;
+    } else if (is_hedge_complete && attempts->hedge_error_code == AWS_OP_SUCCESS) {
+        outcome.winner = AWS_NITRO_ENCLAVES_REST_WINNER_HEDGE;
+    }
+
+    /* Stop whatever is still running. */
+    outcome.abort_request = !attempts->is_complete;
+    outcome.abort_hedge = attempts->has_hedge && !attempts->is_hedge_complete;
+
+    if (outcome.winner == AWS_NITRO_ENCLAVES_REST_WINNER_NONE && attempts->is_complete &&
+        (!attempts->has_hedge || is_hedge_complete)) {
+        outcome.error_code = attempts->error_code != AWS_OP_SUCCESS ? attempts->error_code : attempts->hedge_error_code;
+    }
+
+    return outcome;
+}
+
+/* Must be called with rest_client->mutex held. */
+static void s_schedule_reconnect_synced(struct aws_nitro_enclaves_rest_client *rest_client) {
+    uint64_t random = 0;
+    aws_device_random_u64(&random);
+    uint64_t delay_ms = aws_nitro_enclaves_rest_reconnect_delay_ms(
+        rest_client->reconnect_attempts,
+        rest_client->reconnect_backoff_base_ms,
+        rest_client->reconnect_backoff_max_ms,
+        random);
+
+    uint64_t now = 0;
+    aws_event_loop_current_clock_time(rest_client->reconnect_loop, &now);
+
+    rest_client->reconnect_attempts++;
+    rest_client->is_connecting = true;
+    rest_client->reconnect_task_scheduled = true;
+    aws_event_loop_schedule_task_future(
+        rest_client->reconnect_loop,
+        &rest_client->reconnect_task,
+        now + aws_timestamp_convert(delay_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+}
+
+/* Must be called with rest_client->mutex held. Schedules another attempt unless the budget is spent. */
+static void s_retry_connect_synced(struct aws_nitro_enclaves_rest_client *rest_client) {
+    if (rest_client->reconnect_enabled && !rest_client->is_shutting_down &&
+        rest_client->reconnect_attempts < rest_client->max_reconnect_attempts) {
+        s_schedule_reconnect_synced(rest_client);
+    } else {
+        rest_client->is_connecting = false;
+    }
+}
+
+static void s_reconnect_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    struct aws_nitro_enclaves_rest_client *rest_client = arg;
+
+    aws_mutex_lock(&rest_client->mutex);
+    rest_client->reconnect_task_scheduled = false;
+    bool should_connect = status == AWS_TASK_STATUS_RUN_READY && !rest_client->is_shutting_down;
+    size_t attempt = rest_client->reconnect_attempts;
+    if (!should_connect) {
+        rest_client->is_connecting = false;
+        aws_condition_variable_notify_all(&rest_client->c_var);
+    }
+    aws_mutex_unlock(&rest_client->mutex);
+
+    if (!should_connect) {
+        return;
+    }
+
+    AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_REST, "id=%p: Reconnecting (attempt %zu).", (void *)rest_client, attempt);
+    if (s_connect(rest_client) != AWS_OP_SUCCESS) {
+        AWS_LOGF_WARN(
+            AWS_LS_NITRO_ENCLAVES_REST,
+            "id=%p: Reconnect failed with error %s.",
+            (void *)rest_client,
+            aws_error_debug_str(aws_last_error()));
+
+        aws_mutex_lock(&rest_client->mutex);
+        s_retry_connect_synced(rest_client);
+        aws_condition_variable_notify_all(&rest_client->c_var);
+        aws_mutex_unlock(&rest_client->mutex);
+    }
+}
+
+/* Runs on the reconnect event loop, so it cannot race with s_reconnect_task. */
+static void s_cancel_reconnect_task(struct aws_task *task, void *arg, enum aws_task_status status) {
+    (void)task;
+    (void)status;
+    struct aws_nitro_enclaves_rest_client *rest_client = arg;
+
+    aws_mutex_lock(&rest_client->mutex);
+    bool scheduled = rest_client->reconnect_task_scheduled;
+    aws_mutex_unlock(&rest_client->mutex);
+
+    if (scheduled) {
+        /* Runs s_reconnect_task synchronously with AWS_TASK_STATUS_CANCELED. */
+        aws_event_loop_cancel_task(rest_client->reconnect_loop, &rest_client->reconnect_task);
+    }
+
+    aws_mutex_lock(&rest_client->mutex);
+    rest_client->cancel_reconnect_task_pending = false;
+    aws_condition_variable_notify_all(&rest_client->c_var);
+    aws_mutex_unlock(&rest_client->mutex);
+}
+
 static void s_on_client_connection_setup(struct aws_http_connection *connection, int error_code, void *user_data) {
     struct aws_nitro_enclaves_rest_client *rest_client = user_data;
+    bool close_connection = false;
 
-    /* TODO: Proper logging. */
-    if (error_code) {
-        fprintf(stderr, "Connection failed with error %s\n", aws_error_debug_str(error_code));
-    } else if (error_code == 0 && connection != NULL) {
-        fprintf(stderr, "Connected.\n");
+    aws_mutex_lock(&rest_client->mutex);
 
-        /* A valid connection context. */
-        aws_mutex_lock(&rest_client->mutex);
+    if (error_code == AWS_OP_SUCCESS && connection != NULL) {
+        AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_REST, "id=%p: Connected.", (void *)rest_client);
+
+        /* A valid connection context. The connection is released in the shutdown callback. */
         rest_client->connection = connection;
+        rest_client->http_version = aws_http_connection_get_version(connection);
+        /* No limit applies until the server sends its settings. */
+        rest_client->remote_max_concurrent_streams = UINT32_MAX;
         rest_client->is_connected = true;
-        aws_mutex_unlock(&rest_client->mutex);
+        rest_client->is_connecting = false;
+        rest_client->reconnect_attempts = 0;
+        rest_client->total_connections++;
+        close_connection = rest_client->is_shutting_down;
+    } else {
+        AWS_LOGF_WARN(
+            AWS_LS_NITRO_ENCLAVES_REST,
+            "id=%p: Connection failed with error %s.",
+            (void *)rest_client,
+            aws_error_debug_str(error_code));
+        s_retry_connect_synced(rest_client);
     }
 
     /* Notify waiting client on the connection outcome. */
     aws_condition_variable_notify_all(&rest_client->c_var);
+    aws_mutex_unlock(&rest_client->mutex);
+
+    if (close_connection) {
+        aws_http_connection_close(connection);
+    }
 }
 
 static void s_on_client_connection_shutdown(struct aws_http_connection *connection, int error_code, void *user_data) {
     struct aws_nitro_enclaves_rest_client *rest_client = user_data;
 
-    fprintf(stderr, "Disconnected.\n");
     if (error_code) {
-        fprintf(stderr, "Connection failed with error %s\n", aws_error_debug_str(error_code));
+        AWS_LOGF_WARN(
+            AWS_LS_NITRO_ENCLAVES_REST,
+            "id=%p: Disconnected with error %s.",
+            (void *)rest_client,
+            aws_error_debug_str(error_code));
+    } else {
+        AWS_LOGF_INFO(AWS_LS_NITRO_ENCLAVES_REST, "id=%p: Disconnected.", (void *)rest_client);
     }
 
-    /* Clean up the connection */
-    if (rest_client->connection != NULL && rest_client->connection == connection) {
-        aws_http_connection_release(rest_client->connection); // Release the connection memory
+    aws_mutex_lock(&rest_client->mutex);
+    if (rest_client->connection == connection) {
         rest_client->connection = NULL;
         rest_client->is_connected = false;
     }
+
+    /* Reconnect in the background, so that the next request does not find the client disconnected. */
+    if (rest_client->reconnect_enabled && !rest_client->is_shutting_down && !rest_client->is_connecting) {
+        rest_client->reconnect_attempts = 0;
+        s_schedule_reconnect_synced(rest_client);
+    }
+    aws_condition_variable_notify_all(&rest_client->c_var);
+    aws_mutex_unlock(&rest_client->mutex);
+
+    /* Clean up the connection */
+    aws_http_connection_release(connection);
+}
+
+static void s_on_remote_settings_change(
+    struct aws_http_connection *http2_connection,
+    const struct aws_http2_setting *settings_array,
+    size_t num_settings,
+    void *user_data) {
+    struct aws_nitro_enclaves_rest_client *rest_client = user_data;
+
+    aws_mutex_lock(&rest_client->mutex);
+    if (rest_client->connection == http2_connection) {
+        for (size_t i = 0; i < num_settings; i++) {
+            if (settings_array[i].id == AWS_HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS) {
+                rest_client->remote_max_concurrent_streams = settings_array[i].value;
+            }
+        }
+    }
+    /* A higher limit frees streams for queued requests. */
+    aws_condition_variable_notify_all(&rest_client->c_var);
+    aws_mutex_unlock(&rest_client->mutex);
+}
+
+static int s_connect(struct aws_nitro_enclaves_rest_client *rest_client) {
+    /* The server never pushes to a KMS client; responses are small enough to fit the stream window. */
+    struct aws_http2_setting initial_settings[] = {
+        {.id = AWS_HTTP2_SETTINGS_ENABLE_PUSH, .value = 0},
+        {.id = AWS_HTTP2_SETTINGS_INITIAL_WINDOW_SIZE, .value = rest_client->http2_initial_window_size},
+    };
+    struct aws_http2_connection_options http2_options = {
+        .initial_settings_array = initial_settings,
+        .num_initial_settings = AWS_ARRAY_SIZE(initial_settings),
+        .on_remote_settings_change = s_on_remote_settings_change,
+    };
+
+    struct aws_http_client_connection_options http_client_options = {
+        .self_size = sizeof(struct aws_http_client_connection_options),
+        .socket_options = &rest_client->socket_options,
+        .allocator = rest_client->allocator,
+        .port = rest_client->connect_port,
+        .host_name = aws_byte_cursor_from_string(rest_client->connect_host),
+        .bootstrap = rest_client->bootstrap,
+        .initial_window_size = SIZE_MAX,
+        .tls_options = &rest_client->tls_connection_options,
+        .user_data = rest_client,
+        .on_setup = s_on_client_connection_setup,
+        .on_shutdown = s_on_client_connection_shutdown,
+        .http2_options = &http2_options,
+    };
+
+    return aws_http_client_connect(&http_client_options);
+}
+
+static bool s_is_connect_done(void *ctx) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx;
+    return rest_client->connection != NULL || !rest_client->is_connecting || rest_client->is_shutting_down;
+}
+
+static bool s_is_idle(void *ctx) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx;
+    return rest_client->connection == NULL && !rest_client->is_connecting &&
+           !rest_client->cancel_reconnect_task_pending && rest_client->pending_requests == 0;
 }
 
 struct aws_nitro_enclaves_rest_client *aws_nitro_enclaves_rest_client_new(
@@ -73,13 +331,8 @@ struct aws_nitro_enclaves_rest_client *aws_nitro_enclaves_rest_client_new(
         configuration->allocator != NULL ? configuration->allocator : aws_nitro_enclaves_get_allocator();
     AWS_PRECONDITION(aws_allocator_is_valid(allocator));
 
-    struct aws_event_loop_group *el_group = NULL;
-    struct aws_client_bootstrap *bootstrap = NULL;
-    struct aws_host_resolver *host_resolver = NULL;
-    struct aws_tls_connection_options tls_connection_options;
     char host_name_str[256];
     struct aws_byte_cursor host_name;
-    AWS_ZERO_STRUCT(tls_connection_options);
 
     struct aws_nitro_enclaves_rest_client *rest_client =
         aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_rest_client));
@@ -120,126 +373,151 @@ struct aws_nitro_enclaves_rest_client *aws_nitro_enclaves_rest_client_new(
     rest_client->credentials = configuration->credentials;
     rest_client->credentials_provider = configuration->credentials_provider;
 
-    if (aws_mutex_init(&rest_client->mutex) != AWS_OP_SUCCESS ||
-        aws_condition_variable_init(&rest_client->c_var) != AWS_OP_SUCCESS) {
-        goto err_clean;
+    /* Static credentials are signed locally so the signing key is derived once per day. */
+    if (rest_client->credentials != NULL) {
+        rest_client->signer = aws_nitro_enclaves_sigv4_signer_new(
+            rest_client->allocator,
+            aws_byte_cursor_from_string(rest_client->region),
+            aws_byte_cursor_from_string(rest_client->service));
+        if (rest_client->signer == NULL) {
+            goto err_clean;
+        }
     }
 
-    struct aws_tls_ctx_options tls_ctx_options;
-    AWS_ZERO_STRUCT(tls_ctx_options);
+    rest_client->request_headers[0] = (struct aws_http_header){
+        .name = aws_byte_cursor_from_c_str("host"),
+        .value = aws_byte_cursor_from_string(rest_client->host_name),
+    };
+    rest_client->request_headers[1] = (struct aws_http_header){
+        .name = aws_byte_cursor_from_c_str("content-type"),
+        .value = aws_byte_cursor_from_c_str("application/x-amz-json-1.1"),
+    };
+    rest_client->request_headers[2] = (struct aws_http_header){
+        .name = aws_byte_cursor_from_c_str("user-agent"),
+        .value = aws_byte_cursor_from_c_str(USER_AGENT_NAME "/" VERSION),
+    };
 
-    aws_tls_ctx_options_init_default_client(&tls_ctx_options, rest_client->allocator);
-    if (aws_tls_ctx_options_set_alpn_list(&tls_ctx_options, ALPN_STRING) != AWS_OP_SUCCESS) {
-        /* TODO: aws_raise */
-        goto err_clean;
-    }
+    rest_client->max_reconnect_attempts = configuration->max_reconnect_attempts != 0
+                                              ? configuration->max_reconnect_attempts
+                                              : REST_DEFAULT_MAX_RECONNECT_ATTEMPTS;
+    rest_client->reconnect_backoff_base_ms = configuration->reconnect_backoff_base_ms != 0
+                                                 ? configuration->reconnect_backoff_base_ms
+                                                 : REST_DEFAULT_RECONNECT_BACKOFF_BASE_MS;
+    rest_client->reconnect_backoff_max_ms = configuration->reconnect_backoff_max_ms != 0
+                                                ? configuration->reconnect_backoff_max_ms
+                                                : REST_DEFAULT_RECONNECT_BACKOFF_MAX_MS;
+    rest_client->request_timeout_ns = aws_timestamp_convert(
+        configuration->request_timeout_ms != 0 ? configuration->request_timeout_ms : REST_DEFAULT_REQUEST_TIMEOUT_MS,
+        AWS_TIMESTAMP_MILLIS,
+        AWS_TIMESTAMP_NANOS,
+        NULL);
+
+    rest_client->max_concurrent_streams = configuration->max_concurrent_streams != 0
+                                              ? configuration->max_concurrent_streams
+                                              : REST_DEFAULT_MAX_CONCURRENT_STREAMS;
+    rest_client->http2_initial_window_size = configuration->http2_initial_window_size != 0
+                                                 ? configuration->http2_initial_window_size
+                                                 : REST_DEFAULT_HTTP2_INITIAL_WINDOW_SIZE;
 
-    rest_client->tls_ctx = aws_tls_client_ctx_new(rest_client->allocator, &tls_ctx_options);
-    if (rest_client->tls_ctx == NULL) {
-        /* TODO: aws_raise */
+    if (aws_mutex_init(&rest_client->mutex) != AWS_OP_SUCCESS ||
+        aws_condition_variable_init(&rest_client->c_var) != AWS_OP_SUCCESS) {
         goto err_clean;
     }
-    /* tls_ctx_options are copied, so the strucure can be cleaned up at this point */
-    aws_tls_ctx_options_clean_up(&tls_ctx_options);
 
-    aws_tls_connection_options_init_from_ctx(&tls_connection_options, rest_client->tls_ctx);
-    if (aws_tls_connection_options_set_server_name(&tls_connection_options, rest_client->allocator, &host_name)) {
-        // TODO: aws_raise
+    rest_client->future_pool = aws_nitro_enclaves_future_pool_new(rest_client->allocator, REST_FUTURE_POOL_SIZE);
+    if (rest_client->future_pool == NULL) {
         goto err_clean;
     }
 
-    /* TODO: Should the el_group be set by the caller instead? */
-    el_group = aws_event_loop_group_new_default(rest_client->allocator, 0, NULL);
-    if (el_group == NULL) {
-        /* TODO: aws_raise */
-        goto err_clean;
+    /* Clients share the TLS context rather than loading the trust store for each of them. */
+    struct aws_tls_ctx *tls_ctx = configuration->tls_ctx;
+    if (tls_ctx == NULL) {
+        tls_ctx = aws_nitro_enclaves_get_tls_ctx();
+        if (tls_ctx == NULL) {
+            goto err_clean;
+        }
     }
+    rest_client->tls_ctx = aws_tls_ctx_acquire(tls_ctx);
 
-    /* TODO: Resolver should not be needed when using endpoints */
-    struct aws_host_resolver_default_options resolver_options = {
-        .el_group = el_group,
-        .max_entries = 8,
-    };
-    host_resolver = aws_host_resolver_new_default(rest_client->allocator, &resolver_options);
-    if (host_resolver == NULL) {
-        /* TODO: aws_raise */
+    aws_tls_connection_options_init_from_ctx(&rest_client->tls_connection_options, rest_client->tls_ctx);
+    if (aws_tls_connection_options_set_server_name(
+            &rest_client->tls_connection_options, rest_client->allocator, &host_name)) {
+        // TODO: aws_raise
         goto err_clean;
     }
 
-    struct aws_client_bootstrap_options bootstrap_options = {
-        .event_loop_group = el_group,
-        .host_resolver = host_resolver,
-    };
-
-    bootstrap = aws_client_bootstrap_new(rest_client->allocator, &bootstrap_options);
+    /* Clients share the event loop threads and host resolver rather than starting their own. */
+    struct aws_client_bootstrap *bootstrap = configuration->bootstrap;
     if (bootstrap == NULL) {
-        /* TODO: aws_raise */
-        goto err_clean;
+        bootstrap = aws_nitro_enclaves_get_client_bootstrap();
+        if (bootstrap == NULL) {
+            goto err_clean;
+        }
     }
+    rest_client->bootstrap = aws_client_bootstrap_acquire(bootstrap);
+    rest_client->el_group = aws_event_loop_group_acquire(bootstrap->event_loop_group);
 
-    struct aws_socket_options socket_options = {
-        .type = AWS_SOCKET_STREAM,
-        .connect_timeout_ms = CONNECT_TIMEOUT_MS,
-        .keep_alive_timeout_sec = 0,
-        .keepalive = false,
-        .keep_alive_interval_sec = 0,
-    };
-
-    struct aws_http_client_connection_options http_client_options = {
-        .self_size = sizeof(struct aws_http_client_connection_options),
-        .socket_options = &socket_options,
-        .allocator = rest_client->allocator,
-        .port = 443,
-        .host_name = host_name,
-        .bootstrap = bootstrap,
-        .initial_window_size = SIZE_MAX,
-        .tls_options = &tls_connection_options,
-        .user_data = rest_client,
-        .on_setup = s_on_client_connection_setup,
-        .on_shutdown = s_on_client_connection_shutdown,
-    };
+    rest_client->socket_options.type = AWS_SOCKET_STREAM;
+    rest_client->socket_options.connect_timeout_ms = CONNECT_TIMEOUT_MS;
+    rest_client->socket_options.keep_alive_timeout_sec = 0;
+    rest_client->socket_options.keepalive = false;
+    rest_client->socket_options.keep_alive_interval_sec = 0;
+    rest_client->connect_port = 443;
 
     if (configuration->endpoint) {
-        socket_options.domain = configuration->domain;
-        http_client_options.port = configuration->endpoint->port;
-        http_client_options.host_name = aws_byte_cursor_from_c_str(configuration->endpoint->address);
+        rest_client->socket_options.domain = configuration->domain;
+        rest_client->connect_port = configuration->endpoint->port;
+        rest_client->connect_host = aws_string_new_from_c_str(rest_client->allocator, configuration->endpoint->address);
+    } else {
+        rest_client->connect_host = aws_string_new_from_string(rest_client->allocator, rest_client->host_name);
+    }
+    if (rest_client->connect_host == NULL) {
+        goto err_clean;
     }
 
-    if (aws_http_client_connect(&http_client_options) != AWS_OP_SUCCESS) {
+    rest_client->reconnect_loop = aws_event_loop_group_get_next_loop(rest_client->el_group);
+    aws_task_init(&rest_client->reconnect_task, s_reconnect_task, rest_client, "rest_client_reconnect");
+    aws_task_init(
+        &rest_client->cancel_reconnect_task, s_cancel_reconnect_task, rest_client, "rest_client_cancel_reconnect");
+
+    /* The first connection is attempted once; reconnection only applies to established clients. */
+    rest_client->is_connecting = true;
+    if (s_connect(rest_client) != AWS_OP_SUCCESS) {
         /* TODO: aws_raise */
+        rest_client->is_connecting = false;
         goto err_clean;
     }
 
     aws_mutex_lock(&rest_client->mutex);
-    aws_condition_variable_wait(&rest_client->c_var, &rest_client->mutex);
+    aws_condition_variable_wait_pred(&rest_client->c_var, &rest_client->mutex, s_is_connect_done, rest_client);
+    bool connected = rest_client->connection != NULL;
+    rest_client->reconnect_enabled = connected;
     aws_mutex_unlock(&rest_client->mutex);
 
-    if (rest_client->connection == NULL) {
+    if (!connected) {
         /* TODO: aws_raise */
         goto err_clean;
     }
 
-    /* No longer required in this context */
-    aws_tls_connection_options_clean_up(&tls_connection_options);
-    aws_host_resolver_release(host_resolver);
-    aws_event_loop_group_release(el_group);
-    aws_client_bootstrap_release(bootstrap);
     return rest_client;
 err_clean:
-    if (rest_client->connection != NULL) {
-        aws_http_connection_release(rest_client->connection);
-    }
-
-    aws_tls_connection_options_clean_up(&tls_connection_options);
+    aws_tls_connection_options_clean_up(&rest_client->tls_connection_options);
     aws_tls_ctx_release(rest_client->tls_ctx);
 
-    aws_host_resolver_release(host_resolver);
-    aws_event_loop_group_release(el_group);
-    aws_client_bootstrap_release(bootstrap);
+    aws_client_bootstrap_release(rest_client->bootstrap);
+    aws_event_loop_group_release(rest_client->el_group);
 
     aws_mutex_clean_up(&rest_client->mutex);
     aws_condition_variable_clean_up(&rest_client->c_var);
+    aws_nitro_enclaves_future_pool_release(rest_client->future_pool);
+
+    aws_credentials_release(rest_client->credentials);
+    aws_credentials_provider_release(rest_client->credentials_provider);
+    aws_nitro_enclaves_sigv4_signer_destroy(rest_client->signer);
 
+    aws_string_destroy(rest_client->connect_host);
+    aws_string_destroy(rest_client->service);
+    aws_string_destroy(rest_client->region);
     aws_string_destroy(rest_client->host_name);
 
     aws_mem_release(rest_client->allocator, rest_client);
@@ -248,38 +526,202 @@ err_clean:
 
 void aws_nitro_enclaves_rest_client_destroy(struct aws_nitro_enclaves_rest_client *rest_client) {
     AWS_PRECONDITION(rest_client);
+
+    /* Stop reconnecting, close the connection and wait for all the callbacks referencing the client. */
+    aws_mutex_lock(&rest_client->mutex);
+    rest_client->is_shutting_down = true;
+    if (rest_client->reconnect_task_scheduled) {
+        rest_client->cancel_reconnect_task_pending = true;
+        aws_event_loop_schedule_task_now(rest_client->reconnect_loop, &rest_client->cancel_reconnect_task);
+    }
     if (rest_client->connection != NULL) {
-        aws_http_connection_release(rest_client->connection);
-        rest_client->connection = NULL;
+        aws_http_connection_close(rest_client->connection);
     }
+    aws_condition_variable_wait_pred(&rest_client->c_var, &rest_client->mutex, s_is_idle, rest_client);
+    aws_mutex_unlock(&rest_client->mutex);
+
+    aws_tls_connection_options_clean_up(&rest_client->tls_connection_options);
     aws_tls_ctx_release(rest_client->tls_ctx);
+    aws_client_bootstrap_release(rest_client->bootstrap);
+    aws_event_loop_group_release(rest_client->el_group);
     aws_mutex_clean_up(&rest_client->mutex);
     aws_condition_variable_clean_up(&rest_client->c_var);
+    aws_nitro_enclaves_future_pool_release(rest_client->future_pool);
+    aws_string_destroy(rest_client->connect_host);
     aws_string_destroy(rest_client->service);
     aws_string_destroy(rest_client->region);
     aws_string_destroy(rest_client->host_name);
     aws_credentials_release(rest_client->credentials);
     aws_credentials_provider_release(rest_client->credentials_provider);
+    aws_nitro_enclaves_sigv4_signer_destroy(rest_client->signer);
     aws_mem_release(rest_client->allocator, rest_client);
 }
 
+struct aws_nitro_enclaves_rest_cancellation_token {
+    struct aws_allocator *allocator;
+
+    /* Set once, read without the lock by waiting requests. */
+    struct aws_atomic_var cancelled;
+
+    /* Requests currently waiting on the token, protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_linked_list requests;
+};
+
+/**
+ * State of a single request. It is shared by the calling thread and the signing and stream
+ * callbacks, which may outlive the call if the request times out or is cancelled, so it is
+ * reference counted.
+ */
 struct request_ctx {
+    struct aws_allocator *allocator;
+    struct aws_ref_count ref_count;
+
     struct aws_nitro_enclaves_rest_client *rest_client;
 
     struct aws_nitro_enclaves_rest_response *response;
 
     struct aws_http_message *request;
+    struct aws_signable *sign_request;
+    uint64_t sign_start_ns;
+
+    /* The request body is copied, since the stream may read it after the caller gave up. */
+    struct aws_byte_buf request_body;
+    struct aws_byte_cursor request_body_cursor;
     struct aws_input_stream *request_data_stream;
 
-    /* Track request status */
+    /* Only accessed from the stream callbacks */
     bool response_code_written;
-    int error_code;
 
-    /* For synchronization */
-    struct aws_condition_variable c_var;
-    struct aws_mutex mutex;
+    /* Completed by the callbacks with the request status; the caller waits on it. */
+    struct aws_nitro_enclaves_future *future;
+
+    /* The active stream and its connection, and whether the caller gave up. Protected by rest_client->mutex. */
+    struct aws_http_stream *stream;
+    struct aws_http_connection *connection;
+    bool is_abandoned;
+
+    struct aws_nitro_enclaves_rest_cancellation_token *cancellation_token;
+    struct aws_linked_list_node cancellation_node;
+
+    /*
+     * Hedging. The caller waits on the original request, which references its hedged copy. The copy holds
+     * a reference to the original as its waiter, and wakes up the waiter's future when it completes.
+     */
+    struct request_ctx *hedge;
+    struct request_ctx *waiter;
 };
 
+static bool s_is_cancelled(const struct aws_nitro_enclaves_rest_cancellation_token *token) {
+    return token != NULL && aws_atomic_load_int(&token->cancelled) != 0;
+}
+
+/**
+ * Waits on @c_var until @pred holds or @deadline_ns passes. A deadline of 0 waits indefinitely.
+ * Must be called with @mutex held.
+ */
+static int s_wait_until(
+    struct aws_condition_variable *c_var,
+    struct aws_mutex *mutex,
+    uint64_t deadline_ns,
+    aws_condition_predicate_fn *pred,
+    void *pred_ctx) {
+    if (deadline_ns == 0) {
+        return aws_condition_variable_wait_pred(c_var, mutex, pred, pred_ctx);
+    }
+
+    uint64_t now = 0;
+    aws_high_res_clock_get_ticks(&now);
+    if (now < deadline_ns) {
+        aws_condition_variable_wait_for_pred(c_var, mutex, (int64_t)(deadline_ns - now), pred, pred_ctx);
+    }
+
+    if (!pred(pred_ctx)) {
+        return aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+size_t aws_nitro_enclaves_rest_max_streams(
+    enum aws_http_version http_version,
+    uint32_t local_max,
+    uint32_t remote_max) {
+    if (http_version != AWS_HTTP_VERSION_2) {
+        return 1;
+    }
+    return AWS_MIN(local_max, remote_max);
+}
+
+/* Must be called with rest_client->mutex held. */
+static size_t s_max_streams_synced(const struct aws_nitro_enclaves_rest_client *rest_client) {
+    return aws_nitro_enclaves_rest_max_streams(
+        rest_client->http_version, rest_client->max_concurrent_streams, rest_client->remote_max_concurrent_streams);
+}
+
+/* Must be called with rest_client->mutex held. */
+static bool s_has_stream_slot_synced(const struct aws_nitro_enclaves_rest_client *rest_client) {
+    return rest_client->pending_requests < s_max_streams_synced(rest_client);
+}
+
+/*
+ * Must be called with rest_client->mutex held. The slot is released by s_request_ctx_on_async_done
+ * once the request no longer uses the connection.
+ */
+static void s_take_stream_slot_synced(struct aws_nitro_enclaves_rest_client *rest_client) {
+    rest_client->pending_requests++;
+    rest_client->peak_pending_requests = AWS_MAX(rest_client->peak_pending_requests, rest_client->pending_requests);
+}
+
+static bool s_is_stream_ready_or_cancelled(void *arg) {
+    struct request_ctx *ctx = arg;
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+    if (s_is_cancelled(ctx->cancellation_token)) {
+        return true;
+    }
+    if (rest_client->connection == NULL) {
+        return s_is_connect_done(rest_client);
+    }
+    return s_has_stream_slot_synced(rest_client);
+}
+
+/**
+ * Waits until the client has a connection with a free stream and takes the stream, starting a new
+ * series of reconnection attempts if the previous one gave up. Requests issued while reconnecting or
+ * beyond the stream limit queue up here.
+ */
+static int s_wait_for_stream(struct request_ctx *ctx, uint64_t deadline_ns) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+
+    aws_mutex_lock(&rest_client->mutex);
+    if (rest_client->connection == NULL && !rest_client->is_connecting && !rest_client->is_shutting_down) {
+        rest_client->reconnect_attempts = 0;
+        s_schedule_reconnect_synced(rest_client);
+    }
+    rest_client->queued_requests++;
+    int rc = s_wait_until(&rest_client->c_var, &rest_client->mutex, deadline_ns, s_is_stream_ready_or_cancelled, ctx);
+    rest_client->queued_requests--;
+    /* Decided once under the lock, so that a slot is only taken when the request goes on with it. */
+    bool cancelled = s_is_cancelled(ctx->cancellation_token);
+    bool connected = rest_client->connection != NULL;
+    if (rc == AWS_OP_SUCCESS && connected && !cancelled) {
+        s_take_stream_slot_synced(rest_client);
+    }
+    aws_mutex_unlock(&rest_client->mutex);
+
+    if (cancelled) {
+        return aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED);
+    }
+    if (rc != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (!connected) {
+        return aws_raise_error(AWS_ERROR_HTTP_CONNECTION_CLOSED);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
 static int s_on_incoming_headers_fn(
     struct aws_http_stream *stream,
     enum aws_http_header_block header_block,
@@ -321,11 +763,34 @@ static int s_on_incoming_header_block_done_fn(
     return AWS_OP_SUCCESS;
 }
 
+/* Wakes up the caller waiting on the request. */
+static void s_request_ctx_complete(struct request_ctx *ctx, int error_code) {
+    aws_nitro_enclaves_future_complete(ctx->future, error_code);
+    if (ctx->waiter != NULL) {
+        aws_nitro_enclaves_future_notify(ctx->waiter->future);
+    }
+}
+
+/* Called once the callbacks are done with the request and the client. */
+static void s_request_ctx_on_async_done(struct request_ctx *ctx) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+
+    aws_mutex_lock(&rest_client->mutex);
+    rest_client->pending_requests--;
+    aws_condition_variable_notify_all(&rest_client->c_var);
+    aws_mutex_unlock(&rest_client->mutex);
+
+    aws_ref_count_release(&ctx->ref_count);
+}
+
 static void s_on_stream_complete_fn(struct aws_http_stream *stream, int error_code, void *user_data) {
-    (void)error_code;
     struct request_ctx *ctx = user_data;
+
+    aws_mutex_lock(&ctx->rest_client->mutex);
+    ctx->stream = NULL;
+    ctx->connection = NULL;
+    aws_mutex_unlock(&ctx->rest_client->mutex);
     aws_http_stream_release(stream);
-    ctx->error_code = error_code;
 
     if (error_code == AWS_OP_SUCCESS) {
         ctx->response->__cursor = aws_byte_cursor_from_buf(&ctx->response->__data);
@@ -334,7 +799,8 @@ static void s_on_stream_complete_fn(struct aws_http_stream *stream, int error_co
             aws_input_stream_new_from_cursor(ctx->response->allocator, &ctx->response->__cursor));
     }
 
-    aws_condition_variable_notify_all(&ctx->c_var);
+    s_request_ctx_complete(ctx, error_code);
+    s_request_ctx_on_async_done(ctx);
 }
 
 static int s_on_incoming_body_fn(struct aws_http_stream *stream, const struct aws_byte_cursor *data, void *user_data) {
@@ -345,26 +811,38 @@ static int s_on_incoming_body_fn(struct aws_http_stream *stream, const struct aw
     return aws_byte_buf_append_dynamic(&ctx->response->__data, data);
 }
 
-static struct aws_http_message *s_make_request(
+static struct aws_http_message *s_make_http2_request(
     struct aws_nitro_enclaves_rest_client *rest_client,
     struct aws_byte_cursor method,
-    struct aws_byte_cursor path,
-    struct aws_byte_cursor target,
-    struct aws_input_stream *request_data_stream) {
-
-    struct aws_http_message *request = aws_http_message_new_request(rest_client->allocator);
+    struct aws_byte_cursor path) {
+    struct aws_http_message *request = aws_http2_message_new_request(rest_client->allocator);
+    if (request == NULL) {
+        return NULL;
+    }
 
-    struct aws_http_header host_header = {
-        .name = aws_byte_cursor_from_c_str("host"), .value = aws_byte_cursor_from_string(rest_client->host_name)};
-    aws_http_message_add_header(request, host_header);
+    /* Pseudo-headers precede the regular headers. The host header is kept, equal to :authority, for signing. */
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    if (aws_http2_headers_set_request_method(headers, method) != AWS_OP_SUCCESS ||
+        aws_http2_headers_set_request_scheme(headers, aws_byte_cursor_from_c_str("https")) != AWS_OP_SUCCESS ||
+        aws_http2_headers_set_request_authority(headers, aws_byte_cursor_from_string(rest_client->host_name)) !=
+            AWS_OP_SUCCESS ||
+        aws_http2_headers_set_request_path(headers, path) != AWS_OP_SUCCESS) {
+        aws_http_message_destroy(request);
+        return NULL;
+    }
 
-    struct aws_http_header content_type = {
-        .name = aws_byte_cursor_from_c_str("content-type"),
-        .value = aws_byte_cursor_from_c_str("application/x-amz-json-1.1")};
-    aws_http_message_add_header(request, content_type);
+    return request;
+}
 
-    struct aws_http_header target_header = {.name = aws_byte_cursor_from_c_str("x-amz-target"), .value = target};
-    aws_http_message_add_header(request, target_header);
+static struct aws_http_message *s_make_http1_request(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_input_stream *request_data_stream) {
+    struct aws_http_message *request = aws_http_message_new_request(rest_client->allocator);
+    if (request == NULL) {
+        return NULL;
+    }
 
     aws_http_message_set_request_method(request, method);
     aws_http_message_set_request_path(request, path);
@@ -374,32 +852,54 @@ static struct aws_http_message *s_make_request(
     AWS_ZERO_ARRAY(content_length_str);
 
     aws_input_stream_get_length(request_data_stream, &content_length);
-    sprintf(content_length_str, "%" PRIi64, content_length);
+    snprintf(content_length_str, sizeof(content_length_str), "%" PRIi64, content_length);
 
     struct aws_http_header content_length_header = {
         .name = aws_byte_cursor_from_c_str("content-length"), .value = aws_byte_cursor_from_c_str(content_length_str)};
     aws_http_message_add_header(request, content_length_header);
 
-    struct aws_http_header user_agent_header = {
-        .name = aws_byte_cursor_from_c_str("user-agent"),
-        .value = aws_byte_cursor_from_c_str(USER_AGENT_NAME "/" VERSION),
-    };
-    aws_http_message_add_header(request, user_agent_header);
+    return request;
+}
+
+/**
+ * Builds a request for a connection of the given HTTP version. HTTP/2 requests carry the request line
+ * in pseudo-headers and frame the body in DATA frames, so they have no content-length.
+ */
+static struct aws_http_message *s_make_request(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    enum aws_http_version http_version,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_byte_cursor target,
+    struct aws_input_stream *request_data_stream) {
+
+    struct aws_http_message *request = http_version == AWS_HTTP_VERSION_2
+                                           ? s_make_http2_request(rest_client, method, path)
+                                           : s_make_http1_request(rest_client, method, path, request_data_stream);
+    if (request == NULL) {
+        return NULL;
+    }
+
+    aws_http_message_add_header_array(
+        request, rest_client->request_headers, AWS_ARRAY_SIZE(rest_client->request_headers));
+
+    struct aws_http_header target_header = {.name = aws_byte_cursor_from_c_str("x-amz-target"), .value = target};
+    aws_http_message_add_header(request, target_header);
 
     aws_http_message_set_body_stream(request, request_data_stream);
 
     return request;
 }
 
-static void s_on_sign_complete(struct aws_signing_result *signing_result, int error_code, void *userdata) {
-    struct request_ctx *ctx = userdata;
+/* Sends the signed request on the client connection, or completes it with @error_code if signing failed. */
+static void s_request_ctx_activate(struct request_ctx *ctx, int error_code) {
+    struct aws_http_stream *stream = NULL;
 
-    if (error_code != AWS_OP_SUCCESS) {
-        goto err_clean;
-    }
+    uint64_t now_ns = 0;
+    aws_high_res_clock_get_ticks(&now_ns);
+    ctx->response->sign_duration_ns = now_ns - ctx->sign_start_ns;
 
-    if (aws_apply_signing_result_to_http_request(ctx->request, ctx->rest_client->allocator, signing_result) !=
-        AWS_OP_SUCCESS) {
+    if (error_code != AWS_OP_SUCCESS) {
         goto err_clean;
     }
 
@@ -413,53 +913,224 @@ static void s_on_sign_complete(struct aws_signing_result *signing_result, int er
         .on_complete = s_on_stream_complete_fn,
     };
 
-    struct aws_http_stream *stream = aws_http_connection_make_request(ctx->rest_client->connection, &request_options);
+    /*
+     * The connection may have dropped since the request was queued. Holding the client mutex keeps the
+     * shutdown callback from releasing the connection until the stream holds its own reference, and
+     * keeps the caller from abandoning the request while the stream is being activated.
+     */
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+    bool activated = false;
+    aws_mutex_lock(&rest_client->mutex);
+    if (ctx->is_abandoned) {
+        error_code = AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED;
+    } else if (rest_client->connection == NULL) {
+        error_code = AWS_ERROR_HTTP_CONNECTION_CLOSED;
+    } else {
+        stream = aws_http_connection_make_request(rest_client->connection, &request_options);
+        activated = stream != NULL && aws_http_stream_activate(stream) == AWS_OP_SUCCESS;
+        if (activated) {
+            ctx->stream = stream;
+            ctx->connection = rest_client->connection;
+            rest_client->total_streams++;
+        } else {
+            error_code = aws_last_error();
+        }
+    }
+    aws_mutex_unlock(&rest_client->mutex);
 
-    if (stream == NULL || aws_http_stream_activate(stream) != AWS_OP_SUCCESS) {
-        fprintf(stderr, "failed to create request.");
+    if (!activated) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_REST,
+            "id=%p: Failed to create request: %s.",
+            (void *)rest_client,
+            aws_error_debug_str(error_code));
         goto err_clean;
     }
 
     return;
 err_clean:
-    ctx->error_code = AWS_OP_ERR;
     aws_http_stream_release(stream);
-    aws_condition_variable_notify_all(&ctx->c_var);
+    s_request_ctx_complete(ctx, error_code != AWS_OP_SUCCESS ? error_code : AWS_ERROR_UNKNOWN);
+    s_request_ctx_on_async_done(ctx);
 }
 
-struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_blocking(
+static void s_on_sign_complete(struct aws_signing_result *signing_result, int error_code, void *userdata) {
+    struct request_ctx *ctx = userdata;
+
+    if (error_code == AWS_OP_SUCCESS &&
+        aws_apply_signing_result_to_http_request(ctx->request, ctx->allocator, signing_result) != AWS_OP_SUCCESS) {
+        error_code = aws_last_error();
+    }
+
+    s_request_ctx_activate(ctx, error_code);
+}
+
+/**
+ * Stops a request the caller gave up on. A stream that is still running is reset on HTTP/2. On
+ * HTTP/1.1 the connection cannot be reused after an unfinished response, so it is closed and the
+ * client reconnects.
+ */
+static void s_request_ctx_abort(struct request_ctx *ctx) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+
+    aws_mutex_lock(&rest_client->mutex);
+    ctx->is_abandoned = true;
+    if (ctx->stream != NULL) {
+        if (aws_http_connection_get_version(ctx->connection) == AWS_HTTP_VERSION_2) {
+            aws_http2_stream_reset(ctx->stream, AWS_HTTP2_ERR_CANCEL);
+        } else {
+            aws_http_connection_close(ctx->connection);
+        }
+    }
+    aws_mutex_unlock(&rest_client->mutex);
+}
+
+static struct aws_nitro_enclaves_rest_response *s_rest_response_new(struct aws_allocator *allocator) {
+    struct aws_nitro_enclaves_rest_response *response =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_rest_response));
+    if (response == NULL) {
+        return NULL;
+    }
+
+    response->allocator = allocator;
+    response->response = aws_http_message_new_response(allocator);
+    if (response->response == NULL) {
+        aws_mem_release(allocator, response);
+        return NULL;
+    }
+    aws_byte_buf_init(&response->__data, allocator, 0);
+
+    return response;
+}
+
+static void s_request_ctx_destroy(void *arg) {
+    struct request_ctx *ctx = arg;
+
+    aws_signable_destroy(ctx->sign_request);
+    aws_http_message_destroy(ctx->request);
+    aws_input_stream_destroy(ctx->request_data_stream);
+    aws_byte_buf_clean_up_secure(&ctx->request_body);
+    aws_nitro_enclaves_rest_response_destroy(ctx->response);
+    aws_nitro_enclaves_future_release(ctx->future);
+    if (ctx->waiter != NULL) {
+        aws_ref_count_release(&ctx->waiter->ref_count);
+    }
+    aws_mem_release(ctx->allocator, ctx);
+}
+
+static struct request_ctx *s_request_ctx_new(
     struct aws_nitro_enclaves_rest_client *rest_client,
     struct aws_byte_cursor method,
     struct aws_byte_cursor path,
     struct aws_byte_cursor target,
-    struct aws_byte_cursor data) {
-    AWS_PRECONDITION(rest_client);
-    AWS_PRECONDITION(rest_client->connection);
+    struct aws_byte_cursor data,
+    struct aws_nitro_enclaves_rest_cancellation_token *cancellation_token) {
+    struct request_ctx *ctx = aws_mem_calloc(rest_client->allocator, 1, sizeof(struct request_ctx));
+    if (ctx == NULL) {
+        return NULL;
+    }
 
-    struct request_ctx ctx;
-    AWS_ZERO_STRUCT(ctx);
+    ctx->allocator = rest_client->allocator;
+    ctx->rest_client = rest_client;
+    ctx->cancellation_token = cancellation_token;
+    aws_ref_count_init(&ctx->ref_count, ctx, s_request_ctx_destroy);
 
-    if (aws_mutex_init(&ctx.mutex) != AWS_OP_SUCCESS || aws_condition_variable_init(&ctx.c_var) != AWS_OP_SUCCESS) {
+    ctx->future = aws_nitro_enclaves_future_pool_get(rest_client->future_pool);
+    if (ctx->future == NULL) {
         goto err_clean;
     }
 
-    ctx.request_data_stream = aws_input_stream_new_from_cursor(rest_client->allocator, &data);
+    if (aws_byte_buf_init_copy_from_cursor(&ctx->request_body, ctx->allocator, data) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    ctx->request_body_cursor = aws_byte_cursor_from_buf(&ctx->request_body);
+    ctx->request_data_stream = aws_input_stream_new_from_cursor(ctx->allocator, &ctx->request_body_cursor);
+    if (ctx->request_data_stream == NULL) {
+        goto err_clean;
+    }
 
-    ctx.request = s_make_request(rest_client, method, path, target, ctx.request_data_stream);
-    ctx.rest_client = rest_client;
+    /*
+     * Requests are built for the version negotiated on the last connection. Requests signed through the
+     * credentials provider stay HTTP/1.1 messages, which aws-c-http converts on HTTP/2 connections, since
+     * the aws-c-auth signer expects a request line.
+     */
+    aws_mutex_lock(&rest_client->mutex);
+    enum aws_http_version http_version = rest_client->http_version;
+    aws_mutex_unlock(&rest_client->mutex);
+    if (rest_client->signer == NULL) {
+        http_version = AWS_HTTP_VERSION_1_1;
+    }
 
-    ctx.response = aws_mem_calloc(rest_client->allocator, 1, sizeof(struct aws_nitro_enclaves_rest_response));
-    if (ctx.response == NULL) {
+    ctx->request = s_make_request(rest_client, http_version, method, path, target, ctx->request_data_stream);
+    if (ctx->request == NULL) {
         goto err_clean;
     }
-    ctx.response->allocator = rest_client->allocator;
-    ctx.response->response = aws_http_message_new_response(ctx.response->allocator);
-    if (ctx.response->response == NULL) {
+
+    /* Only requests signed through the credentials provider go through the aws-c-auth signing pipeline. */
+    if (rest_client->signer == NULL) {
+        ctx->sign_request = aws_signable_new_http_request(ctx->allocator, ctx->request);
+        if (ctx->sign_request == NULL) {
+            goto err_clean;
+        }
+    }
+
+    ctx->response = s_rest_response_new(ctx->allocator);
+    if (ctx->response == NULL) {
         goto err_clean;
     }
-    aws_byte_buf_init(&ctx.response->__data, rest_client->allocator, 0);
 
-    struct aws_signable *sign_request = aws_signable_new_http_request(rest_client->allocator, ctx.request);
+    return ctx;
+err_clean:
+    s_request_ctx_destroy(ctx);
+    return NULL;
+}
+
+/* Reads the state of a request and of its hedged copy. */
+static void s_get_attempts(struct request_ctx *ctx, struct aws_nitro_enclaves_rest_attempts *attempts) {
+    struct request_ctx *hedge = ctx->hedge;
+    attempts->is_complete = aws_nitro_enclaves_future_is_done(ctx->future);
+    attempts->error_code = attempts->is_complete ? aws_nitro_enclaves_future_get_error(ctx->future) : AWS_OP_SUCCESS;
+    attempts->has_hedge = hedge != NULL;
+    attempts->is_hedge_complete = hedge != NULL && aws_nitro_enclaves_future_is_done(hedge->future);
+    attempts->hedge_error_code =
+        attempts->is_hedge_complete ? aws_nitro_enclaves_future_get_error(hedge->future) : AWS_OP_SUCCESS;
+}
+
+static bool s_is_request_done(void *arg) {
+    struct request_ctx *ctx = arg;
+    if (s_is_cancelled(ctx->cancellation_token)) {
+        return true;
+    }
+
+    struct aws_nitro_enclaves_rest_attempts attempts;
+    s_get_attempts(ctx, &attempts);
+    return aws_nitro_enclaves_rest_attempts_are_done(&attempts);
+}
+
+/* Signs the request and sends it once signed. The caller must have taken a stream slot for it. */
+static int s_request_ctx_send(struct request_ctx *ctx) {
+    struct aws_nitro_enclaves_rest_client *rest_client = ctx->rest_client;
+
+    struct aws_date_time now;
+    aws_date_time_init_now(&now);
+    aws_high_res_clock_get_ticks(&ctx->sign_start_ns);
+
+    /* The callbacks hold their own reference, released once they no longer touch the request. */
+    aws_ref_count_acquire(&ctx->ref_count);
+
+    if (rest_client->signer != NULL) {
+        int error_code = AWS_OP_SUCCESS;
+        if (aws_nitro_enclaves_sigv4_signer_sign_request(
+                rest_client->signer,
+                rest_client->credentials,
+                ctx->request,
+                aws_byte_cursor_from_buf(&ctx->request_body),
+                &now) != AWS_OP_SUCCESS) {
+            error_code = aws_last_error();
+        }
+        s_request_ctx_activate(ctx, error_code);
+        return AWS_OP_SUCCESS;
+    }
 
     struct aws_signing_config_aws signing_config = {
         .config_type = AWS_SIGNING_CONFIG_AWS,
@@ -467,43 +1138,293 @@ struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_
         .signature_type = AWS_ST_HTTP_REQUEST_HEADERS,
         .region = aws_byte_cursor_from_string(rest_client->region),
         .service = aws_byte_cursor_from_string(rest_client->service),
-        .credentials = rest_client->credentials,
+        .date = now,
         .credentials_provider = rest_client->credentials_provider,
         .signed_body_header = AWS_SBHT_X_AMZ_CONTENT_SHA256,
     };
 
-    aws_date_time_init_now(&signing_config.date);
-
     if (aws_sign_request_aws(
             rest_client->allocator,
-            sign_request,
+            ctx->sign_request,
             (const struct aws_signing_config_base *)&signing_config,
             s_on_sign_complete,
-            &ctx) != AWS_OP_SUCCESS) {
-        goto err_clean;
+            ctx) != AWS_OP_SUCCESS) {
+        s_request_ctx_on_async_done(ctx);
+        return AWS_OP_ERR;
     }
 
-    aws_mutex_lock(&ctx.mutex);
-    aws_condition_variable_wait(&ctx.c_var, &ctx.mutex);
-    aws_mutex_unlock(&ctx.mutex);
+    return AWS_OP_SUCCESS;
+}
 
-    if (ctx.error_code != AWS_OP_SUCCESS) {
-        fprintf(stderr, "failed  to process request");
-        goto err_clean;
+/**
+ * Sends a hedged copy of @ctx on the hedge client. Hedging is skipped, returning NULL, if the caller
+ * declines it or the hedge client has no connection or free stream, since waiting defeats its purpose.
+ */
+static struct request_ctx *s_request_ctx_send_hedge(
+    struct request_ctx *ctx,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_byte_cursor target,
+    const struct aws_nitro_enclaves_rest_request_options *options) {
+    struct aws_nitro_enclaves_rest_client *hedge_client = options->hedge_client;
+
+    if (options->should_hedge != NULL && !options->should_hedge(options->should_hedge_user_data)) {
+        return NULL;
     }
 
-    aws_http_message_destroy(ctx.request);
-    aws_input_stream_destroy(ctx.request_data_stream);
-    aws_signable_destroy(sign_request);
+    struct request_ctx *hedge =
+        s_request_ctx_new(hedge_client, method, path, target, aws_byte_cursor_from_buf(&ctx->request_body), NULL);
+    if (hedge == NULL) {
+        return NULL;
+    }
+    hedge->waiter = ctx;
+    aws_ref_count_acquire(&ctx->ref_count);
 
-    return ctx.response;
-err_clean:
-    aws_http_message_destroy(ctx.request);
-    aws_input_stream_destroy(ctx.request_data_stream);
-    aws_signable_destroy(sign_request);
+    aws_mutex_lock(&hedge_client->mutex);
+    bool has_stream = hedge_client->connection != NULL && s_has_stream_slot_synced(hedge_client);
+    if (has_stream) {
+        s_take_stream_slot_synced(hedge_client);
+    }
+    aws_mutex_unlock(&hedge_client->mutex);
+    if (!has_stream) {
+        aws_ref_count_release(&hedge->ref_count);
+        return NULL;
+    }
 
-    aws_nitro_enclaves_rest_response_destroy(ctx.response);
-    return NULL;
+    if (s_request_ctx_send(hedge) != AWS_OP_SUCCESS) {
+        aws_ref_count_release(&hedge->ref_count);
+        return NULL;
+    }
+
+    return hedge;
+}
+
+void aws_nitro_enclaves_rest_client_get_stats(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_nitro_enclaves_rest_client_stats *stats) {
+    AWS_PRECONDITION(rest_client);
+    AWS_PRECONDITION(stats);
+
+    aws_mutex_lock(&rest_client->mutex);
+    stats->http_version = rest_client->http_version;
+    stats->max_concurrent_streams = s_max_streams_synced(rest_client);
+    stats->active_streams = rest_client->pending_requests;
+    stats->peak_active_streams = rest_client->peak_pending_requests;
+    stats->queued_requests = rest_client->queued_requests;
+    stats->total_streams = rest_client->total_streams;
+    stats->is_connected = rest_client->is_connected;
+    stats->reconnect_attempts = rest_client->reconnect_attempts;
+    stats->total_connections = rest_client->total_connections;
+    aws_mutex_unlock(&rest_client->mutex);
+}
+
+static void s_cancellation_token_register(struct request_ctx *ctx) {
+    struct aws_nitro_enclaves_rest_cancellation_token *token = ctx->cancellation_token;
+    if (token == NULL) {
+        return;
+    }
+
+    aws_mutex_lock(&token->mutex);
+    aws_linked_list_push_back(&token->requests, &ctx->cancellation_node);
+    aws_mutex_unlock(&token->mutex);
+}
+
+static void s_cancellation_token_unregister(struct request_ctx *ctx) {
+    struct aws_nitro_enclaves_rest_cancellation_token *token = ctx->cancellation_token;
+    if (token == NULL) {
+        return;
+    }
+
+    aws_mutex_lock(&token->mutex);
+    aws_linked_list_remove(&ctx->cancellation_node);
+    aws_mutex_unlock(&token->mutex);
+}
+
+struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_blocking(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_byte_cursor target,
+    struct aws_byte_cursor data) {
+    return aws_nitro_enclaves_rest_client_request_blocking_with_options(rest_client, method, path, target, data, NULL);
+}
+
+struct aws_nitro_enclaves_rest_response *aws_nitro_enclaves_rest_client_request_blocking_with_options(
+    struct aws_nitro_enclaves_rest_client *rest_client,
+    struct aws_byte_cursor method,
+    struct aws_byte_cursor path,
+    struct aws_byte_cursor target,
+    struct aws_byte_cursor data,
+    const struct aws_nitro_enclaves_rest_request_options *options) {
+    AWS_PRECONDITION(rest_client);
+
+    struct aws_nitro_enclaves_rest_cancellation_token *cancellation_token =
+        options != NULL ? options->cancellation_token : NULL;
+    uint64_t timeout_ns = rest_client->request_timeout_ns;
+    if (options != NULL && options->timeout_ms != 0) {
+        timeout_ns = aws_timestamp_convert(options->timeout_ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    }
+
+    uint64_t deadline_ns = 0;
+    if (timeout_ns != 0) {
+        aws_high_res_clock_get_ticks(&deadline_ns);
+        deadline_ns += timeout_ns;
+    }
+
+    if (s_is_cancelled(cancellation_token)) {
+        aws_raise_error(AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED);
+        return NULL;
+    }
+
+    struct request_ctx *ctx = s_request_ctx_new(rest_client, method, path, target, data, cancellation_token);
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    struct aws_nitro_enclaves_rest_response *response = NULL;
+    s_cancellation_token_register(ctx);
+
+    if (s_wait_for_stream(ctx, deadline_ns) != AWS_OP_SUCCESS) {
+        AWS_LOGF_ERROR(
+            AWS_LS_NITRO_ENCLAVES_REST,
+            "id=%p: No connection available: %s.",
+            (void *)rest_client,
+            aws_error_debug_str(aws_last_error()));
+        goto finalize;
+    }
+
+    if (s_request_ctx_send(ctx) != AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+
+    if (options != NULL && options->hedge_client != NULL) {
+        uint64_t now_ns = 0;
+        aws_high_res_clock_get_ticks(&now_ns);
+        uint64_t hedge_at_ns = aws_nitro_enclaves_rest_hedge_at_ns(now_ns, options->hedge_delay_ms, deadline_ns);
+
+        /* Reaching the hedge delay is not an error. The hedge is only read by this thread. */
+        if (hedge_at_ns != 0 &&
+            !aws_nitro_enclaves_future_wait_pred(ctx->future, hedge_at_ns, s_is_request_done, ctx)) {
+            ctx->hedge = s_request_ctx_send_hedge(ctx, method, path, target, options);
+        }
+    }
+    aws_nitro_enclaves_future_wait_pred(ctx->future, deadline_ns, s_is_request_done, ctx);
+
+    struct aws_nitro_enclaves_rest_attempts attempts;
+    s_get_attempts(ctx, &attempts);
+    struct aws_nitro_enclaves_rest_hedge_outcome outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+
+    if (outcome.abort_request) {
+        s_request_ctx_abort(ctx);
+    }
+    if (outcome.abort_hedge) {
+        s_request_ctx_abort(ctx->hedge);
+    }
+
+    struct request_ctx *winner = NULL;
+    if (outcome.winner == AWS_NITRO_ENCLAVES_REST_WINNER_REQUEST) {
+        winner = ctx;
+    } else if (outcome.winner == AWS_NITRO_ENCLAVES_REST_WINNER_HEDGE) {
+        winner = ctx->hedge;
+    }
+
+    if (winner == NULL) {
+        if (outcome.error_code != AWS_OP_SUCCESS) {
+            aws_raise_error(outcome.error_code);
+            AWS_LOGF_ERROR(
+                AWS_LS_NITRO_ENCLAVES_REST,
+                "id=%p: Failed to process request: %s.",
+                (void *)rest_client,
+                aws_error_debug_str(outcome.error_code));
+        } else {
+            aws_raise_error(
+                s_is_cancelled(cancellation_token) ? AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED
+                                                   : AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT);
+            AWS_LOGF_ERROR(
+                AWS_LS_NITRO_ENCLAVES_REST,
+                "id=%p: Request did not complete: %s.",
+                (void *)rest_client,
+                aws_error_debug_str(aws_last_error()));
+        }
+        goto finalize;
+    }
+
+    /* Hand the response over to the caller. */
+    response = winner->response;
+    winner->response = NULL;
+
+finalize:
+    s_cancellation_token_unregister(ctx);
+    if (ctx->hedge != NULL) {
+        aws_ref_count_release(&ctx->hedge->ref_count);
+    }
+    aws_ref_count_release(&ctx->ref_count);
+
+    return response;
+}
+
+struct aws_nitro_enclaves_rest_cancellation_token *aws_nitro_enclaves_rest_cancellation_token_new(
+    struct aws_allocator *allocator) {
+    if (allocator == NULL) {
+        allocator = aws_nitro_enclaves_get_allocator();
+    }
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_rest_cancellation_token *token =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_rest_cancellation_token));
+    if (token == NULL) {
+        return NULL;
+    }
+
+    if (aws_mutex_init(&token->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, token);
+        return NULL;
+    }
+
+    token->allocator = allocator;
+    aws_atomic_init_int(&token->cancelled, 0);
+    aws_linked_list_init(&token->requests);
+
+    return token;
+}
+
+void aws_nitro_enclaves_rest_cancellation_token_cancel(struct aws_nitro_enclaves_rest_cancellation_token *token) {
+    AWS_PRECONDITION(token);
+
+    aws_atomic_store_int(&token->cancelled, 1);
+
+    /* Wake up the requests, whether they wait for a connection or for their response. */
+    aws_mutex_lock(&token->mutex);
+    for (struct aws_linked_list_node *node = aws_linked_list_begin(&token->requests);
+         node != aws_linked_list_end(&token->requests);
+         node = aws_linked_list_next(node)) {
+        struct request_ctx *ctx = AWS_CONTAINER_OF(node, struct request_ctx, cancellation_node);
+
+        aws_mutex_lock(&ctx->rest_client->mutex);
+        aws_condition_variable_notify_all(&ctx->rest_client->c_var);
+        aws_mutex_unlock(&ctx->rest_client->mutex);
+
+        aws_nitro_enclaves_future_notify(ctx->future);
+    }
+    aws_mutex_unlock(&token->mutex);
+}
+
+bool aws_nitro_enclaves_rest_cancellation_token_is_cancelled(
+    const struct aws_nitro_enclaves_rest_cancellation_token *token) {
+    AWS_PRECONDITION(token);
+
+    return s_is_cancelled(token);
+}
+
+void aws_nitro_enclaves_rest_cancellation_token_destroy(struct aws_nitro_enclaves_rest_cancellation_token *token) {
+    if (token == NULL) {
+        return;
+    }
+
+    AWS_PRECONDITION(aws_linked_list_empty(&token->requests));
+
+    aws_mutex_clean_up(&token->mutex);
+    aws_mem_release(token->allocator, token);
 }
 
 void aws_nitro_enclaves_rest_response_destroy(struct aws_nitro_enclaves_rest_response *response) {
@@ -0,0 +1,365 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/sigv4.h>
+
+#include <aws/common/byte_buf.h>
+#include <aws/common/mutex.h>
+#include <aws/common/string.h>
+
+#include <openssl/digest.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SIGV4_ALGORITHM "AWS4-HMAC-SHA256"
+#define SIGV4_TERMINATOR "aws4_request"
+#define SIGV4_SHORT_DATE_LEN 8
+#define SIGV4_MAX_SIGNED_HEADERS 32
+#define SIGV4_MAX_SECRET_LEN 128
+
+struct aws_nitro_enclaves_sigv4_signer {
+    struct aws_allocator *allocator;
+    struct aws_string *region;
+    struct aws_string *service;
+
+    /*
+     * Signing key cache, protected by mutex. The key is valid for the date and the credentials it was
+     * derived from. Credentials are immutable and a reference is held, so they are compared by address.
+     */
+    struct aws_mutex mutex;
+    const struct aws_credentials *cached_credentials;
+    uint8_t cached_date[SIGV4_SHORT_DATE_LEN];
+    uint8_t cached_key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN];
+};
+
+struct aws_nitro_enclaves_sigv4_signer *aws_nitro_enclaves_sigv4_signer_new(
+    struct aws_allocator *allocator,
+    struct aws_byte_cursor region,
+    struct aws_byte_cursor service) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_sigv4_signer *signer =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_sigv4_signer));
+    if (signer == NULL) {
+        return NULL;
+    }
+
+    signer->allocator = allocator;
+    if (aws_mutex_init(&signer->mutex) != AWS_OP_SUCCESS) {
+        aws_mem_release(allocator, signer);
+        return NULL;
+    }
+
+    signer->region = aws_string_new_from_cursor(allocator, &region);
+    signer->service = aws_string_new_from_cursor(allocator, &service);
+    if (signer->region == NULL || signer->service == NULL) {
+        aws_nitro_enclaves_sigv4_signer_destroy(signer);
+        return NULL;
+    }
+
+    return signer;
+}
+
+void aws_nitro_enclaves_sigv4_signer_destroy(struct aws_nitro_enclaves_sigv4_signer *signer) {
+    if (signer == NULL) {
+        return;
+    }
+
+    aws_secure_zero(signer->cached_key, sizeof(signer->cached_key));
+    aws_credentials_release(signer->cached_credentials);
+    aws_string_destroy(signer->region);
+    aws_string_destroy(signer->service);
+    aws_mutex_clean_up(&signer->mutex);
+    aws_mem_release(signer->allocator, signer);
+}
+
+static int s_hmac_sha256(
+    const uint8_t *key,
+    size_t key_len,
+    struct aws_byte_cursor data,
+    uint8_t out[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN]) {
+    unsigned int out_len = 0;
+    if (HMAC(EVP_sha256(), key, key_len, data.ptr, data.len, out, &out_len) == NULL ||
+        out_len != AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN) {
+        return aws_raise_error(AWS_ERROR_UNKNOWN);
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_sigv4_derive_signing_key(
+    struct aws_byte_cursor secret_access_key,
+    struct aws_byte_cursor date,
+    struct aws_byte_cursor region,
+    struct aws_byte_cursor service,
+    uint8_t signing_key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN]) {
+    if (secret_access_key.len > SIGV4_MAX_SECRET_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    uint8_t secret[4 + SIGV4_MAX_SECRET_LEN];
+    memcpy(secret, "AWS4", 4);
+    memcpy(secret + 4, secret_access_key.ptr, secret_access_key.len);
+
+    uint8_t key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN];
+    int rc = AWS_OP_ERR;
+    if (s_hmac_sha256(secret, 4 + secret_access_key.len, date, key) != AWS_OP_SUCCESS ||
+        s_hmac_sha256(key, sizeof(key), region, key) != AWS_OP_SUCCESS ||
+        s_hmac_sha256(key, sizeof(key), service, key) != AWS_OP_SUCCESS ||
+        s_hmac_sha256(key, sizeof(key), aws_byte_cursor_from_c_str(SIGV4_TERMINATOR), signing_key) !=
+            AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+
+    rc = AWS_OP_SUCCESS;
+finalize:
+    aws_secure_zero(secret, sizeof(secret));
+    aws_secure_zero(key, sizeof(key));
+    return rc;
+}
+
+/* Copies the signing key for @credentials and @date into @key, deriving it only when the cache misses. */
+static int s_get_signing_key(
+    struct aws_nitro_enclaves_sigv4_signer *signer,
+    const struct aws_credentials *credentials,
+    struct aws_byte_cursor date,
+    uint8_t key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN]) {
+    AWS_PRECONDITION(date.len == SIGV4_SHORT_DATE_LEN);
+
+    int rc = AWS_OP_SUCCESS;
+    aws_mutex_lock(&signer->mutex);
+    if (signer->cached_credentials != credentials || memcmp(signer->cached_date, date.ptr, date.len) != 0) {
+        rc = aws_nitro_enclaves_sigv4_derive_signing_key(
+            aws_credentials_get_secret_access_key(credentials),
+            date,
+            aws_byte_cursor_from_string(signer->region),
+            aws_byte_cursor_from_string(signer->service),
+            signer->cached_key);
+        aws_credentials_release(signer->cached_credentials);
+        signer->cached_credentials = NULL;
+        if (rc == AWS_OP_SUCCESS) {
+            aws_credentials_acquire(credentials);
+            signer->cached_credentials = credentials;
+            memcpy(signer->cached_date, date.ptr, date.len);
+        }
+    }
+    if (rc == AWS_OP_SUCCESS) {
+        memcpy(key, signer->cached_key, AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN);
+    }
+    aws_mutex_unlock(&signer->mutex);
+
+    return rc;
+}
+
+static void s_hex_encode(const uint8_t *data, size_t len, char *out) {
+    static const char s_digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = s_digits[data[i] >> 4];
+        out[2 * i + 1] = s_digits[data[i] & 0x0f];
+    }
+}
+
+static int s_compare_headers(const void *a, const void *b) {
+    const struct aws_http_header *lhs = a;
+    const struct aws_http_header *rhs = b;
+    return aws_byte_cursor_compare_lookup(&lhs->name, &rhs->name, aws_lookup_table_to_lower_get());
+}
+
+static int s_append(struct aws_byte_buf *buf, struct aws_byte_cursor cursor) {
+    return aws_byte_buf_append_dynamic(buf, &cursor);
+}
+
+static int s_append_c_str(struct aws_byte_buf *buf, const char *c_str) {
+    return s_append(buf, aws_byte_cursor_from_c_str(c_str));
+}
+
+static int s_append_lower(struct aws_byte_buf *buf, struct aws_byte_cursor cursor) {
+    const uint8_t *to_lower = aws_lookup_table_to_lower_get();
+    for (size_t i = 0; i < cursor.len; i++) {
+        if (aws_byte_buf_append_byte_dynamic(buf, to_lower[cursor.ptr[i]]) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+/**
+ * Appends the canonical headers block of @request to @canonical and the signed header list to
+ * @signed_headers. Header values are trimmed; requests built by this library carry no values with
+ * inner runs of spaces, so those are not collapsed.
+ */
+static int s_append_canonical_headers(
+    const struct aws_http_message *request,
+    struct aws_byte_buf *canonical,
+    struct aws_byte_buf *signed_headers) {
+    struct aws_http_header headers[SIGV4_MAX_SIGNED_HEADERS];
+    size_t count = 0;
+
+    struct aws_byte_cursor user_agent = aws_byte_cursor_from_c_str("user-agent");
+    struct aws_byte_cursor authorization = aws_byte_cursor_from_c_str("authorization");
+    size_t header_count = aws_http_message_get_header_count(request);
+    for (size_t i = 0; i < header_count; i++) {
+        struct aws_http_header header;
+        if (aws_http_message_get_header(request, &header, i) != AWS_OP_SUCCESS) {
+            return AWS_OP_ERR;
+        }
+        /* HTTP/2 pseudo-headers are covered by the method, path and host. */
+        if ((header.name.len > 0 && header.name.ptr[0] == ':') ||
+            aws_byte_cursor_eq_ignore_case(&header.name, &user_agent) ||
+            aws_byte_cursor_eq_ignore_case(&header.name, &authorization)) {
+            continue;
+        }
+        if (count == SIGV4_MAX_SIGNED_HEADERS) {
+            return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+        }
+        headers[count++] = header;
+    }
+
+    qsort(headers, count, sizeof(struct aws_http_header), s_compare_headers);
+
+    for (size_t i = 0; i < count; i++) {
+        struct aws_byte_cursor value = aws_byte_cursor_trim_pred(&headers[i].value, aws_char_is_space);
+        if (s_append_lower(canonical, headers[i].name) || s_append_c_str(canonical, ":") ||
+            s_append(canonical, value) || s_append_c_str(canonical, "\n")) {
+            return AWS_OP_ERR;
+        }
+        if ((i > 0 && s_append_c_str(signed_headers, ";")) || s_append_lower(signed_headers, headers[i].name)) {
+            return AWS_OP_ERR;
+        }
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+int aws_nitro_enclaves_sigv4_signer_sign_request(
+    struct aws_nitro_enclaves_sigv4_signer *signer,
+    const struct aws_credentials *credentials,
+    struct aws_http_message *request,
+    struct aws_byte_cursor payload,
+    const struct aws_date_time *date) {
+    AWS_PRECONDITION(signer != NULL);
+    AWS_PRECONDITION(credentials != NULL);
+    AWS_PRECONDITION(request != NULL);
+    AWS_PRECONDITION(date != NULL);
+
+    struct aws_byte_cursor method;
+    struct aws_byte_cursor path;
+    if (aws_http_message_get_request_method(request, &method) != AWS_OP_SUCCESS ||
+        aws_http_message_get_request_path(request, &path) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (memchr(path.ptr, '?', path.len) != NULL) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    uint8_t amz_date_storage[32];
+    struct aws_byte_buf amz_date = aws_byte_buf_from_empty_array(amz_date_storage, sizeof(amz_date_storage));
+    uint8_t short_date_storage[16];
+    struct aws_byte_buf short_date = aws_byte_buf_from_empty_array(short_date_storage, sizeof(short_date_storage));
+    if (aws_date_time_to_utc_time_str(date, AWS_DATE_FORMAT_ISO_8601_BASIC, &amz_date) != AWS_OP_SUCCESS ||
+        aws_date_time_to_utc_time_short_str(date, AWS_DATE_FORMAT_ISO_8601_BASIC, &short_date) != AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (short_date.len != SIGV4_SHORT_DATE_LEN) {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    char payload_hash[2 * SHA256_DIGEST_LENGTH];
+    SHA256(payload.ptr, payload.len, digest);
+    s_hex_encode(digest, sizeof(digest), payload_hash);
+    struct aws_byte_cursor payload_hash_cursor = aws_byte_cursor_from_array(payload_hash, sizeof(payload_hash));
+
+    struct aws_http_headers *headers = aws_http_message_get_headers(request);
+    if (aws_http_headers_set(headers, aws_byte_cursor_from_c_str("x-amz-date"), aws_byte_cursor_from_buf(&amz_date)) !=
+            AWS_OP_SUCCESS ||
+        aws_http_headers_set(headers, aws_byte_cursor_from_c_str("x-amz-content-sha256"), payload_hash_cursor) !=
+            AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    struct aws_byte_cursor session_token = aws_credentials_get_session_token(credentials);
+    if (session_token.len > 0 &&
+        aws_http_headers_set(headers, aws_byte_cursor_from_c_str("x-amz-security-token"), session_token) !=
+            AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+
+    int rc = AWS_OP_ERR;
+    uint8_t key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN];
+    struct aws_byte_buf canonical;
+    struct aws_byte_buf signed_headers;
+    struct aws_byte_buf scratch;
+    AWS_ZERO_STRUCT(canonical);
+    AWS_ZERO_STRUCT(signed_headers);
+    AWS_ZERO_STRUCT(scratch);
+    if (aws_byte_buf_init(&canonical, signer->allocator, 512) != AWS_OP_SUCCESS ||
+        aws_byte_buf_init(&signed_headers, signer->allocator, 128) != AWS_OP_SUCCESS ||
+        aws_byte_buf_init(&scratch, signer->allocator, 256) != AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+
+    /* Canonical request. */
+    if (s_append(&canonical, method) || s_append_c_str(&canonical, "\n") || s_append(&canonical, path) ||
+        s_append_c_str(&canonical, "\n\n") ||
+        s_append_canonical_headers(request, &canonical, &signed_headers) != AWS_OP_SUCCESS ||
+        s_append_c_str(&canonical, "\n") || s_append(&canonical, aws_byte_cursor_from_buf(&signed_headers)) ||
+        s_append_c_str(&canonical, "\n") || s_append(&canonical, payload_hash_cursor)) {
+        goto finalize;
+    }
+
+    /* String to sign, in scratch. */
+    char canonical_hash[2 * SHA256_DIGEST_LENGTH];
+    SHA256(canonical.buffer, canonical.len, digest);
+    s_hex_encode(digest, sizeof(digest), canonical_hash);
+
+    struct aws_byte_cursor region = aws_byte_cursor_from_string(signer->region);
+    struct aws_byte_cursor service = aws_byte_cursor_from_string(signer->service);
+    if (s_append_c_str(&scratch, SIGV4_ALGORITHM "\n") || s_append(&scratch, aws_byte_cursor_from_buf(&amz_date)) ||
+        s_append_c_str(&scratch, "\n") || s_append(&scratch, aws_byte_cursor_from_buf(&short_date)) ||
+        s_append_c_str(&scratch, "/") || s_append(&scratch, region) || s_append_c_str(&scratch, "/") ||
+        s_append(&scratch, service) || s_append_c_str(&scratch, "/" SIGV4_TERMINATOR "\n") ||
+        s_append(&scratch, aws_byte_cursor_from_array(canonical_hash, sizeof(canonical_hash)))) {
+        goto finalize;
+    }
+
+    char signature[2 * AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN];
+    if (s_get_signing_key(signer, credentials, aws_byte_cursor_from_buf(&short_date), key) != AWS_OP_SUCCESS ||
+        s_hmac_sha256(key, sizeof(key), aws_byte_cursor_from_buf(&scratch), digest) != AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+    s_hex_encode(digest, sizeof(digest), signature);
+
+    /* Authorization header value, reusing scratch. */
+    aws_byte_buf_reset(&scratch, false);
+    if (s_append_c_str(&scratch, SIGV4_ALGORITHM " Credential=") ||
+        s_append(&scratch, aws_credentials_get_access_key_id(credentials)) || s_append_c_str(&scratch, "/") ||
+        s_append(&scratch, aws_byte_cursor_from_buf(&short_date)) || s_append_c_str(&scratch, "/") ||
+        s_append(&scratch, region) || s_append_c_str(&scratch, "/") || s_append(&scratch, service) ||
+        s_append_c_str(&scratch, "/" SIGV4_TERMINATOR ", SignedHeaders=") ||
+        s_append(&scratch, aws_byte_cursor_from_buf(&signed_headers)) ||
+        s_append_c_str(&scratch, ", Signature=") ||
+        s_append(&scratch, aws_byte_cursor_from_array(signature, sizeof(signature)))) {
+        goto finalize;
+    }
+
+    struct aws_byte_cursor authorization = aws_byte_cursor_from_buf(&scratch);
+    if (aws_http_headers_set(headers, aws_byte_cursor_from_c_str("authorization"), authorization) != AWS_OP_SUCCESS) {
+        goto finalize;
+    }
+
+    rc = AWS_OP_SUCCESS;
+finalize:
+    aws_secure_zero(key, sizeof(key));
+    aws_byte_buf_clean_up(&canonical);
+    aws_byte_buf_clean_up(&signed_headers);
+    aws_byte_buf_clean_up(&scratch);
+    return rc;
+}
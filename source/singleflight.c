@@ -0,0 +1,190 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/future.h>
+#include <aws/nitro_enclaves/internal/singleflight.h>
+
+#include <aws/common/hash_table.h>
+#include <aws/common/mutex.h>
+#include <aws/common/string.h>
+
+/* Number of completed futures kept for the next calls. */
+#define SINGLEFLIGHT_POOLED_FUTURES 8
+
+/* A call in flight, or completed and not yet copied by all of its callers. */
+struct singleflight_call {
+    struct aws_string *key;
+    struct aws_nitro_enclaves_future *future;
+    /* Written by the caller making the call, before the future completes; read-only afterwards. */
+    struct aws_byte_buf result;
+    /* Number of callers still using the call, protected by the group mutex. */
+    size_t ref_count;
+};
+
+struct aws_nitro_enclaves_singleflight {
+    struct aws_allocator *allocator;
+    struct aws_nitro_enclaves_future_pool *future_pool;
+
+    /* The calls in flight by key, protected by mutex. */
+    struct aws_mutex mutex;
+    struct aws_hash_table calls;
+};
+
+static void s_call_destroy(struct aws_nitro_enclaves_singleflight *group, struct singleflight_call *call) {
+    aws_byte_buf_clean_up_secure(&call->result);
+    aws_nitro_enclaves_future_release(call->future);
+    aws_string_destroy(call->key);
+    aws_mem_release(group->allocator, call);
+}
+
+/* Drops a caller's reference, destroying the call with the last one. */
+static void s_call_release(struct aws_nitro_enclaves_singleflight *group, struct singleflight_call *call) {
+    aws_mutex_lock(&group->mutex);
+    bool last = --call->ref_count == 0;
+    aws_mutex_unlock(&group->mutex);
+
+    if (last) {
+        s_call_destroy(group, call);
+    }
+}
+
+struct aws_nitro_enclaves_singleflight *aws_nitro_enclaves_singleflight_new(struct aws_allocator *allocator) {
+    AWS_PRECONDITION(aws_allocator_is_valid(allocator));
+
+    struct aws_nitro_enclaves_singleflight *group =
+        aws_mem_calloc(allocator, 1, sizeof(struct aws_nitro_enclaves_singleflight));
+    if (group == NULL) {
+        return NULL;
+    }
+    group->allocator = allocator;
+
+    group->future_pool = aws_nitro_enclaves_future_pool_new(allocator, SINGLEFLIGHT_POOLED_FUTURES);
+    if (group->future_pool == NULL) {
+        goto err_clean;
+    }
+    if (aws_mutex_init(&group->mutex) != AWS_OP_SUCCESS) {
+        goto err_clean;
+    }
+    /* The calls own their key. */
+    if (aws_hash_table_init(
+            &group->calls, allocator, 16, aws_hash_string, aws_hash_callback_string_eq, NULL, NULL) !=
+        AWS_OP_SUCCESS) {
+        aws_mutex_clean_up(&group->mutex);
+        goto err_clean;
+    }
+
+    return group;
+
+err_clean:
+    aws_nitro_enclaves_future_pool_release(group->future_pool);
+    aws_mem_release(allocator, group);
+    return NULL;
+}
+
+void aws_nitro_enclaves_singleflight_destroy(struct aws_nitro_enclaves_singleflight *group) {
+    if (group == NULL) {
+        return;
+    }
+
+    AWS_ASSERT(aws_hash_table_get_entry_count(&group->calls) == 0);
+    aws_hash_table_clean_up(&group->calls);
+    aws_mutex_clean_up(&group->mutex);
+    aws_nitro_enclaves_future_pool_release(group->future_pool);
+    aws_mem_release(group->allocator, group);
+}
+
+/* Makes a new call and publishes its completion. The caller keeps its reference to the call. */
+static void s_call_run(
+    struct aws_nitro_enclaves_singleflight *group,
+    struct singleflight_call *call,
+    aws_nitro_enclaves_singleflight_fn *fn,
+    void *user_data) {
+    int error_code = AWS_ERROR_SUCCESS;
+    if (fn(user_data, &call->result) != AWS_OP_SUCCESS) {
+        error_code = aws_last_error();
+        if (error_code == AWS_ERROR_SUCCESS) {
+            error_code = AWS_ERROR_UNKNOWN;
+        }
+    }
+
+    /* Callers arriving from now on make a new call. */
+    aws_mutex_lock(&group->mutex);
+    aws_hash_table_remove(&group->calls, call->key, NULL, NULL);
+    aws_mutex_unlock(&group->mutex);
+
+    aws_nitro_enclaves_future_complete(call->future, error_code);
+}
+
+int aws_nitro_enclaves_singleflight_do(
+    struct aws_nitro_enclaves_singleflight *group,
+    struct aws_byte_cursor key,
+    aws_nitro_enclaves_singleflight_fn *fn,
+    void *user_data,
+    struct aws_allocator *result_allocator,
+    struct aws_byte_buf *result,
+    bool *shared) {
+    AWS_PRECONDITION(group != NULL);
+    AWS_PRECONDITION(fn != NULL);
+    AWS_PRECONDITION(aws_allocator_is_valid(result_allocator));
+    AWS_PRECONDITION(result != NULL);
+
+    struct aws_string *key_string = aws_string_new_from_array(group->allocator, key.ptr, key.len);
+    if (key_string == NULL) {
+        return AWS_OP_ERR;
+    }
+
+    struct singleflight_call *call = NULL;
+    struct aws_hash_element *elem = NULL;
+    bool is_waiter = false;
+
+    aws_mutex_lock(&group->mutex);
+    aws_hash_table_find(&group->calls, key_string, &elem);
+    if (elem != NULL) {
+        call = elem->value;
+        call->ref_count++;
+        is_waiter = true;
+        aws_string_destroy(key_string);
+    } else {
+        call = aws_mem_calloc(group->allocator, 1, sizeof(struct singleflight_call));
+        if (call == NULL) {
+            goto err_unlock;
+        }
+        call->key = key_string;
+        call->ref_count = 1;
+        call->future = aws_nitro_enclaves_future_pool_get(group->future_pool);
+        if (call->future == NULL || aws_hash_table_put(&group->calls, call->key, call, NULL) != AWS_OP_SUCCESS) {
+            aws_nitro_enclaves_future_release(call->future);
+            aws_mem_release(group->allocator, call);
+            goto err_unlock;
+        }
+    }
+
+    aws_mutex_unlock(&group->mutex);
+
+    if (is_waiter) {
+        aws_nitro_enclaves_future_wait(call->future, 0);
+    } else {
+        s_call_run(group, call, fn, user_data);
+    }
+    if (shared != NULL) {
+        *shared = is_waiter;
+    }
+
+    int rc = AWS_OP_SUCCESS;
+    int error_code = aws_nitro_enclaves_future_get_error(call->future);
+    if (error_code != AWS_ERROR_SUCCESS) {
+        rc = aws_raise_error(error_code);
+    } else {
+        rc = aws_byte_buf_init_copy(result, result_allocator, &call->result);
+    }
+    s_call_release(group, call);
+
+    return rc;
+
+err_unlock:
+    aws_string_destroy(key_string);
+    aws_mutex_unlock(&group->mutex);
+    return AWS_OP_ERR;
+}
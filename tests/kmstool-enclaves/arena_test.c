@@ -0,0 +1,95 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/arena.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/byte_buf.h>
+#include <aws/testing/aws_test_harness.h>
+
+#include <string.h>
+
+struct counting_allocator {
+    struct aws_allocator *parent;
+    size_t acquired;
+};
+
+static void *s_counting_mem_acquire(struct aws_allocator *allocator, size_t size) {
+    struct counting_allocator *counter = allocator->impl;
+    counter->acquired++;
+    return aws_mem_acquire(counter->parent, size);
+}
+
+static void s_counting_mem_release(struct aws_allocator *allocator, void *ptr) {
+    struct counting_allocator *counter = allocator->impl;
+    aws_mem_release(counter->parent, ptr);
+}
+
+AWS_TEST_CASE(test_arena_reuse_and_wipe, s_test_arena_reuse_and_wipe)
+static int s_test_arena_reuse_and_wipe(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct counting_allocator counter = {.parent = allocator};
+    struct aws_allocator counting = {
+        .mem_acquire = s_counting_mem_acquire,
+        .mem_release = s_counting_mem_release,
+        .impl = &counter,
+    };
+
+    struct aws_nitro_enclaves_arena_pool *pool = aws_nitro_enclaves_arena_pool_new(&counting, 256, 1);
+    ASSERT_NOT_NULL(pool);
+
+    /* A call that outgrows the block: a growing buffer and an allocation larger than a block. */
+    struct aws_nitro_enclaves_arena *arena = aws_nitro_enclaves_arena_pool_get(pool);
+    ASSERT_NOT_NULL(arena);
+    struct aws_allocator *arena_allocator = aws_nitro_enclaves_arena_allocator(arena);
+
+    struct aws_byte_buf buf;
+    ASSERT_SUCCESS(aws_byte_buf_init(&buf, arena_allocator, 16));
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_SUCCESS(aws_byte_buf_append_byte_dynamic(&buf, 0xAA));
+    }
+    uint8_t *large = aws_mem_acquire(arena_allocator, 1024);
+    ASSERT_NOT_NULL(large);
+    memset(large, 0xBB, 1024);
+    aws_byte_buf_clean_up(&buf);
+    aws_mem_release(arena_allocator, large);
+    aws_nitro_enclaves_arena_release(arena);
+
+    /* The same call again is served without touching the parent allocator. */
+    size_t acquired = counter.acquired;
+    arena = aws_nitro_enclaves_arena_pool_get(pool);
+    ASSERT_NOT_NULL(arena);
+    arena_allocator = aws_nitro_enclaves_arena_allocator(arena);
+
+    uint8_t *secret = aws_mem_acquire(arena_allocator, 1024);
+    ASSERT_NOT_NULL(secret);
+    memset(secret, 0xCC, 1024);
+    ASSERT_SUCCESS(aws_byte_buf_init(&buf, arena_allocator, 16));
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_SUCCESS(aws_byte_buf_append_byte_dynamic(&buf, 0xAA));
+    }
+    ASSERT_UINT_EQUALS(acquired, counter.acquired);
+    aws_byte_buf_clean_up(&buf);
+    aws_nitro_enclaves_arena_release(arena);
+
+    /* The next call gets the same memory back, wiped. */
+    arena = aws_nitro_enclaves_arena_pool_get(pool);
+    ASSERT_NOT_NULL(arena);
+    uint8_t *reused = aws_mem_acquire(aws_nitro_enclaves_arena_allocator(arena), 1024);
+    ASSERT_PTR_EQUALS(secret, reused);
+    for (size_t i = 0; i < 1024; ++i) {
+        ASSERT_UINT_EQUALS(0, reused[i]);
+    }
+    ASSERT_UINT_EQUALS(acquired, counter.acquired);
+    aws_nitro_enclaves_arena_release(arena);
+    aws_nitro_enclaves_arena_pool_destroy(pool);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
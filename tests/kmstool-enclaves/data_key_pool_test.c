@@ -0,0 +1,242 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/data_key_pool.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/data_key_pool.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
+#include <aws/testing/aws_test_harness.h>
+
+/* Time the tests wait for the refill threads before giving up. */
+#define DATA_KEY_POOL_TEST_TIMEOUT_MS 5000
+
+struct data_key_pool_test {
+    struct aws_allocator *allocator;
+    struct aws_atomic_var calls_a;
+    struct aws_atomic_var calls_b;
+    bool fail;
+};
+
+AWS_STATIC_STRING_FROM_LITERAL(s_key_id_a, "alias/a");
+AWS_STATIC_STRING_FROM_LITERAL(s_key_id_b, "alias/b");
+
+/* Generates a one byte plaintext holding the number of keys generated so far for the key id. */
+static int s_generate_data_key(
+    void *user_data,
+    const struct aws_string *key_id,
+    enum aws_key_spec key_spec,
+    struct aws_byte_buf *plaintext,
+    struct aws_byte_buf *ciphertext_blob) {
+    (void)key_spec;
+    struct data_key_pool_test *test = user_data;
+
+    struct aws_atomic_var *calls = aws_string_eq(key_id, s_key_id_a) ? &test->calls_a : &test->calls_b;
+    uint8_t serial = (uint8_t)(aws_atomic_fetch_add(calls, 1) + 1);
+    if (test->fail) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    if (aws_byte_buf_init_copy_from_cursor(plaintext, test->allocator, aws_byte_cursor_from_array(&serial, 1)) !=
+        AWS_OP_SUCCESS) {
+        return AWS_OP_ERR;
+    }
+    if (aws_byte_buf_init_copy_from_cursor(
+            ciphertext_blob, test->allocator, aws_byte_cursor_from_c_str("ciphertext")) != AWS_OP_SUCCESS) {
+        aws_byte_buf_clean_up_secure(plaintext);
+        return AWS_OP_ERR;
+    }
+
+    return AWS_OP_SUCCESS;
+}
+
+static void s_sleep_ms(uint64_t ms) {
+    aws_thread_current_sleep(aws_timestamp_convert(ms, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+}
+
+/* Waits until a counter reaches a value, or the test timeout elapses. */
+static bool s_wait_for_calls(struct aws_atomic_var *calls, size_t expected) {
+    for (size_t waited_ms = 0; waited_ms < DATA_KEY_POOL_TEST_TIMEOUT_MS; waited_ms += 10) {
+        if (aws_atomic_load_int(calls) >= expected) {
+            return true;
+        }
+        s_sleep_ms(10);
+    }
+
+    return false;
+}
+
+static void s_data_key_pool_test_init(struct data_key_pool_test *test, struct aws_allocator *allocator) {
+    test->allocator = allocator;
+    aws_atomic_init_int(&test->calls_a, 0);
+    aws_atomic_init_int(&test->calls_b, 0);
+    test->fail = false;
+}
+
+AWS_TEST_CASE(test_data_key_pool_refill_selection, s_test_data_key_pool_refill_selection)
+static int s_test_data_key_pool_refill_selection(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct data_key_pool_test test;
+    s_data_key_pool_test_init(&test, allocator);
+    struct aws_nitro_enclaves_data_key_pool_options options = {
+        .generate_data_key = s_generate_data_key,
+        .user_data = &test,
+        .keys_per_spec = 2,
+        .max_concurrent_refills = 1,
+    };
+    struct aws_nitro_enclaves_data_key_pool *pool = aws_nitro_enclaves_data_key_pool_new(allocator, &options);
+    ASSERT_NOT_NULL(pool);
+
+    /* Every warmed queue is filled up to keys_per_spec, and no further. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_data_key_pool_warm(pool, s_key_id_a, AWS_KS_AES_256));
+    ASSERT_SUCCESS(aws_nitro_enclaves_data_key_pool_warm(pool, s_key_id_b, AWS_KS_AES_256));
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_a, 2));
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_b, 2));
+    s_sleep_ms(100);
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&test.calls_a));
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&test.calls_b));
+    ASSERT_UINT_EQUALS(2, aws_nitro_enclaves_data_key_pool_queue_count(pool));
+
+    /* A ready key is issued without a call, and only its queue is refilled. */
+    struct aws_byte_buf plaintext = {0};
+    struct aws_byte_buf ciphertext_blob = {0};
+    ASSERT_SUCCESS(
+        aws_nitro_enclaves_data_key_pool_acquire(pool, s_key_id_a, AWS_KS_AES_256, &plaintext, &ciphertext_blob));
+    ASSERT_UINT_EQUALS(1, plaintext.len);
+    ASSERT_UINT_EQUALS(1, plaintext.buffer[0]);
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&ciphertext_blob, "ciphertext"));
+    aws_byte_buf_clean_up_secure(&plaintext);
+    aws_byte_buf_clean_up(&ciphertext_blob);
+
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_a, 3));
+    s_sleep_ms(100);
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&test.calls_a));
+    ASSERT_UINT_EQUALS(2, aws_atomic_load_int(&test.calls_b));
+
+    aws_nitro_enclaves_data_key_pool_destroy(pool);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_data_key_pool_key_expiry, s_test_data_key_pool_key_expiry)
+static int s_test_data_key_pool_key_expiry(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct data_key_pool_test test;
+    s_data_key_pool_test_init(&test, allocator);
+    struct aws_nitro_enclaves_data_key_pool_options options = {
+        .generate_data_key = s_generate_data_key,
+        .user_data = &test,
+        .keys_per_spec = 1,
+        .max_concurrent_refills = 1,
+        .key_ttl_ms = 50,
+    };
+    struct aws_nitro_enclaves_data_key_pool *pool = aws_nitro_enclaves_data_key_pool_new(allocator, &options);
+    ASSERT_NOT_NULL(pool);
+
+    /* The first key expires before it is issued: it is wiped and replaced. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_data_key_pool_warm(pool, s_key_id_a, AWS_KS_AES_256));
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_a, 2));
+
+    struct aws_byte_buf plaintext = {0};
+    struct aws_byte_buf ciphertext_blob = {0};
+    ASSERT_SUCCESS(
+        aws_nitro_enclaves_data_key_pool_acquire(pool, s_key_id_a, AWS_KS_AES_256, &plaintext, &ciphertext_blob));
+    ASSERT_UINT_EQUALS(1, plaintext.len);
+    ASSERT_TRUE(plaintext.buffer[0] > 1);
+    aws_byte_buf_clean_up_secure(&plaintext);
+    aws_byte_buf_clean_up(&ciphertext_blob);
+
+    aws_nitro_enclaves_data_key_pool_destroy(pool);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_data_key_pool_refill_backoff, s_test_data_key_pool_refill_backoff)
+static int s_test_data_key_pool_refill_backoff(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    /* The delay doubles with every consecutive failure, up to a minute. */
+    ASSERT_UINT_EQUALS(1000, aws_nitro_enclaves_data_key_pool_refill_delay_ms(1));
+    ASSERT_UINT_EQUALS(2000, aws_nitro_enclaves_data_key_pool_refill_delay_ms(2));
+    ASSERT_UINT_EQUALS(4000, aws_nitro_enclaves_data_key_pool_refill_delay_ms(3));
+    ASSERT_UINT_EQUALS(60000, aws_nitro_enclaves_data_key_pool_refill_delay_ms(7));
+    ASSERT_UINT_EQUALS(60000, aws_nitro_enclaves_data_key_pool_refill_delay_ms(SIZE_MAX));
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct data_key_pool_test test;
+    s_data_key_pool_test_init(&test, allocator);
+    test.fail = true;
+    struct aws_nitro_enclaves_data_key_pool_options options = {
+        .generate_data_key = s_generate_data_key,
+        .user_data = &test,
+        .keys_per_spec = 1,
+        .max_concurrent_refills = 1,
+    };
+    struct aws_nitro_enclaves_data_key_pool *pool = aws_nitro_enclaves_data_key_pool_new(allocator, &options);
+    ASSERT_NOT_NULL(pool);
+
+    /* A failed refill leaves the queue alone until the delay has elapsed. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_data_key_pool_warm(pool, s_key_id_a, AWS_KS_AES_256));
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_a, 1));
+    s_sleep_ms(500);
+    ASSERT_UINT_EQUALS(1, aws_atomic_load_int(&test.calls_a));
+
+    /* Acquiring still works, with the failure of the direct call. */
+    struct aws_byte_buf plaintext = {0};
+    struct aws_byte_buf ciphertext_blob = {0};
+    ASSERT_FAILS(
+        aws_nitro_enclaves_data_key_pool_acquire(pool, s_key_id_a, AWS_KS_AES_256, &plaintext, &ciphertext_blob));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_STATE, aws_last_error());
+
+    aws_nitro_enclaves_data_key_pool_destroy(pool);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_data_key_pool_idle_queue_removal, s_test_data_key_pool_idle_queue_removal)
+static int s_test_data_key_pool_idle_queue_removal(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct data_key_pool_test test;
+    s_data_key_pool_test_init(&test, allocator);
+    test.fail = true;
+    struct aws_nitro_enclaves_data_key_pool_options options = {
+        .generate_data_key = s_generate_data_key,
+        .user_data = &test,
+        .keys_per_spec = 1,
+        .max_concurrent_refills = 1,
+        .idle_timeout_ms = 100,
+    };
+    struct aws_nitro_enclaves_data_key_pool *pool = aws_nitro_enclaves_data_key_pool_new(allocator, &options);
+    ASSERT_NOT_NULL(pool);
+
+    ASSERT_SUCCESS(aws_nitro_enclaves_data_key_pool_warm(pool, s_key_id_a, AWS_KS_AES_256));
+    ASSERT_TRUE(s_wait_for_calls(&test.calls_a, 1));
+
+    /* Past the retry delay, the idle queue is neither refilled nor kept. */
+    s_sleep_ms(1500);
+    ASSERT_UINT_EQUALS(1, aws_atomic_load_int(&test.calls_a));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_data_key_pool_queue_count(pool));
+
+    aws_nitro_enclaves_data_key_pool_destroy(pool);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
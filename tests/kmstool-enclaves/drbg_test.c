@@ -0,0 +1,101 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/drbg.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/drbg.h>
+
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
+#include <aws/testing/aws_test_harness.h>
+
+/* Long enough that the calls of the test between a failed reseed and the retry all fall within it. */
+#define DRBG_TEST_RETRY_INTERVAL_MS 500
+
+struct drbg_test {
+    size_t calls;
+    bool fail;
+};
+
+/* Appends a fixed pattern, or fails when asked to. */
+static int s_seed(void *user_data, struct aws_byte_buf *seed, size_t len) {
+    struct drbg_test *test = user_data;
+    test->calls++;
+    if (test->fail) {
+        return aws_raise_error(AWS_ERROR_INVALID_STATE);
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+        if (!aws_byte_buf_write_u8(seed, (uint8_t)(test->calls + i))) {
+            return aws_raise_error(AWS_ERROR_SHORT_BUFFER);
+        }
+    }
+    return AWS_OP_SUCCESS;
+}
+
+/* Fills a buffer of the given size from the DRBG; the buffer is left empty on failure. */
+static int s_generate(struct aws_nitro_enclaves_drbg *drbg, size_t len) {
+    uint8_t storage[256];
+    AWS_FATAL_ASSERT(len <= sizeof(storage));
+    struct aws_byte_buf output = aws_byte_buf_from_empty_array(storage, len);
+
+    int rc = aws_nitro_enclaves_drbg_random_buffer(drbg, &output);
+    AWS_FATAL_ASSERT(rc == AWS_OP_SUCCESS ? output.len == len : output.len == 0);
+    return rc;
+}
+
+AWS_TEST_CASE(test_drbg_reseed_retry_and_cap, s_test_drbg_reseed_retry_and_cap)
+static int s_test_drbg_reseed_retry_and_cap(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    /* Seeded without KMS: only the injected source is called. */
+    struct drbg_test test = {0};
+    struct aws_nitro_enclaves_drbg_options options = {
+        .kms_client = NULL,
+        .reseed_bytes = 64,
+        .reseed_interval_ms = 3600000,
+        .reseed_retry_interval_ms = DRBG_TEST_RETRY_INTERVAL_MS,
+        .max_bytes_without_reseed = 128,
+    };
+    struct aws_nitro_enclaves_drbg *drbg =
+        aws_nitro_enclaves_drbg_new_with_seed_source(allocator, &options, s_seed, &test);
+    ASSERT_NOT_NULL(drbg);
+    ASSERT_UINT_EQUALS(1, test.calls);
+
+    /* Below reseed_bytes, no reseed is attempted. */
+    ASSERT_SUCCESS(s_generate(drbg, 64));
+    ASSERT_UINT_EQUALS(1, test.calls);
+
+    /* A failed reseed still generates, and is not retried before the retry interval. */
+    test.fail = true;
+    ASSERT_SUCCESS(s_generate(drbg, 32));
+    ASSERT_UINT_EQUALS(2, test.calls);
+    ASSERT_SUCCESS(s_generate(drbg, 16));
+    ASSERT_UINT_EQUALS(2, test.calls);
+
+    /* A single call that would go past the cap fails without generating anything. */
+    ASSERT_FAILS(s_generate(drbg, 32));
+    ASSERT_FAILS(s_generate(drbg, 256));
+    ASSERT_UINT_EQUALS(2, test.calls);
+
+    /* Up to the cap is allowed; past it, every call fails. */
+    ASSERT_SUCCESS(s_generate(drbg, 16));
+    ASSERT_FAILS(s_generate(drbg, 1));
+
+    /* Once the retry interval has elapsed, a successful reseed lifts the cap. */
+    aws_thread_current_sleep(
+        aws_timestamp_convert(DRBG_TEST_RETRY_INTERVAL_MS + 100, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+    test.fail = false;
+    ASSERT_SUCCESS(s_generate(drbg, 64));
+    ASSERT_UINT_EQUALS(3, test.calls);
+
+    aws_nitro_enclaves_drbg_destroy(drbg);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,305 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/nitro_enclaves/internal/entropy.h>
+
+#include <aws/common/condition_variable.h>
+#include <aws/common/math.h>
+#include <aws/common/mutex.h>
+#include <aws/common/thread.h>
+#include <aws/testing/aws_test_harness.h>
+
+#include <linux/random.h>
+
+/* Time the tests wait for the feeder before giving up. */
+#define ENTROPY_TEST_TIMEOUT_MS 5000
+
+#define ENTROPY_TEST_MAX_BATCHES 16
+
+/* An entropy source recording what the feeder asks of it. */
+struct entropy_test {
+    struct aws_mutex mutex;
+    struct aws_condition_variable c_var;
+
+    /* Behavior of the source. */
+    bool fail_open;
+    bool fail_random;
+    bool block_random;
+    size_t max_yield;
+    int entropy_count;
+
+    /* What the source was asked for. */
+    bool closed;
+    size_t random_calls;
+    size_t max_request;
+    size_t batches[ENTROPY_TEST_MAX_BATCHES];
+    size_t batch_count;
+    bool bad_entropy_count;
+};
+
+static int s_open(void *user_data) {
+    struct entropy_test *test = user_data;
+    aws_mutex_lock(&test->mutex);
+    bool fail = test->fail_open;
+    aws_mutex_unlock(&test->mutex);
+    return fail ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+static void s_close(void *user_data) {
+    struct entropy_test *test = user_data;
+    aws_mutex_lock(&test->mutex);
+    test->closed = true;
+    aws_mutex_unlock(&test->mutex);
+}
+
+static bool s_is_unblocked(void *arg) {
+    struct entropy_test *test = arg;
+    return !test->block_random;
+}
+
+/* Yields at most max_yield bytes per call, and blocks while block_random is set. */
+static int s_get_random(void *user_data, uint8_t *buf, size_t *len) {
+    struct entropy_test *test = user_data;
+    aws_mutex_lock(&test->mutex);
+    aws_condition_variable_wait_pred(&test->c_var, &test->mutex, s_is_unblocked, test);
+    test->random_calls++;
+    test->max_request = aws_max_size(test->max_request, *len);
+    bool fail = test->fail_random;
+    *len = aws_min_size(*len, test->max_yield);
+    aws_mutex_unlock(&test->mutex);
+
+    memset(buf, 0xa5, *len);
+    return fail ? AWS_OP_ERR : AWS_OP_SUCCESS;
+}
+
+static int s_get_entropy_count(void *user_data, int *bits) {
+    struct entropy_test *test = user_data;
+    aws_mutex_lock(&test->mutex);
+    *bits = test->entropy_count;
+    aws_mutex_unlock(&test->mutex);
+    return AWS_OP_SUCCESS;
+}
+
+static int s_add_entropy(void *user_data, const struct rand_pool_info *pool) {
+    struct entropy_test *test = user_data;
+    aws_mutex_lock(&test->mutex);
+    if (test->batch_count < ENTROPY_TEST_MAX_BATCHES) {
+        test->batches[test->batch_count++] = (size_t)pool->buf_size;
+    }
+    if (pool->entropy_count != pool->buf_size * 8) {
+        test->bad_entropy_count = true;
+    }
+    aws_mutex_unlock(&test->mutex);
+    return AWS_OP_SUCCESS;
+}
+
+static void s_entropy_test_init(struct entropy_test *test, struct aws_nitro_enclaves_entropy_source *source) {
+    AWS_ZERO_STRUCT(*test);
+    aws_mutex_init(&test->mutex);
+    aws_condition_variable_init(&test->c_var);
+    test->max_yield = SIZE_MAX;
+
+    source->open = s_open;
+    source->close = s_close;
+    source->get_random = s_get_random;
+    source->get_entropy_count = s_get_entropy_count;
+    source->add_entropy = s_add_entropy;
+    source->user_data = test;
+}
+
+static void s_entropy_test_clean_up(struct entropy_test *test) {
+    aws_condition_variable_clean_up(&test->c_var);
+    aws_mutex_clean_up(&test->mutex);
+}
+
+AWS_TEST_CASE(test_entropy_feed_batches, s_test_entropy_feed_batches)
+static int s_test_entropy_feed_batches(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct entropy_test test;
+    struct aws_nitro_enclaves_entropy_source source;
+    s_entropy_test_init(&test, &source);
+
+    /* Batches of 1024 bytes, each filled by requests of at most 256 bytes; short reads are completed. */
+    test.max_yield = 100;
+    ASSERT_SUCCESS(aws_nitro_enclaves_entropy_feed(&source, 2500));
+    ASSERT_UINT_EQUALS(3, test.batch_count);
+    ASSERT_UINT_EQUALS(1024, test.batches[0]);
+    ASSERT_UINT_EQUALS(1024, test.batches[1]);
+    ASSERT_UINT_EQUALS(452, test.batches[2]);
+    ASSERT_FALSE(test.bad_entropy_count);
+    ASSERT_UINT_EQUALS(256, test.max_request);
+    ASSERT_UINT_EQUALS(11 + 11 + 5, test.random_calls);
+
+    /* A source yielding nothing fails the feed before anything is credited. */
+    test.max_yield = 0;
+    ASSERT_FAILS(aws_nitro_enclaves_entropy_feed(&source, 10));
+    ASSERT_INT_EQUALS(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE, aws_last_error());
+    ASSERT_UINT_EQUALS(3, test.batch_count);
+
+    test.max_yield = SIZE_MAX;
+    test.fail_random = true;
+    ASSERT_FAILS(aws_nitro_enclaves_entropy_feed(&source, 10));
+    ASSERT_INT_EQUALS(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE, aws_last_error());
+    ASSERT_UINT_EQUALS(3, test.batch_count);
+
+    s_entropy_test_clean_up(&test);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_entropy_feeder_wait_ready, s_test_entropy_feeder_wait_ready)
+static int s_test_entropy_feeder_wait_ready(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    /* Waiting without a feeder fails at once. */
+    ASSERT_FAILS(aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_TEST_TIMEOUT_MS));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_STATE, aws_last_error());
+
+    struct entropy_test test;
+    struct aws_nitro_enclaves_entropy_source source;
+    s_entropy_test_init(&test, &source);
+
+    struct aws_nitro_enclaves_entropy_feeder_options options = {
+        .initial_bytes = 2048,
+        .target_bits = 256,
+        .check_interval_ms = 60000,
+    };
+    ASSERT_SUCCESS(aws_nitro_enclaves_entropy_feeder_start_with_source(&options, &source));
+    ASSERT_SUCCESS(aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_TEST_TIMEOUT_MS));
+
+    /*
+     * The pool never reports any entropy: the first check feeds the initial bytes, then tops up
+     * the missing 256 bits, up to the limit of feeds per check.
+     */
+    aws_mutex_lock(&test.mutex);
+    size_t batch_count = test.batch_count;
+    size_t batches[ENTROPY_TEST_MAX_BATCHES];
+    memcpy(batches, test.batches, sizeof(batches));
+    aws_mutex_unlock(&test.mutex);
+    ASSERT_UINT_EQUALS(5, batch_count);
+    ASSERT_UINT_EQUALS(1024, batches[0]);
+    ASSERT_UINT_EQUALS(1024, batches[1]);
+    ASSERT_UINT_EQUALS(32, batches[2]);
+    ASSERT_UINT_EQUALS(32, batches[3]);
+    ASSERT_UINT_EQUALS(32, batches[4]);
+
+    /* Once ready, waiting returns at once. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_library_wait_for_entropy(0));
+
+    aws_nitro_enclaves_entropy_feeder_stop();
+    ASSERT_TRUE(test.closed);
+    ASSERT_FAILS(aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_TEST_TIMEOUT_MS));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_STATE, aws_last_error());
+
+    s_entropy_test_clean_up(&test);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_entropy_feeder_wait_failure, s_test_entropy_feeder_wait_failure)
+static int s_test_entropy_feeder_wait_failure(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct entropy_test test;
+    struct aws_nitro_enclaves_entropy_source source;
+    s_entropy_test_init(&test, &source);
+
+    /* A source that cannot be opened fails the waiters, and is closed all the same. */
+    test.fail_open = true;
+    ASSERT_SUCCESS(aws_nitro_enclaves_entropy_feeder_start_with_source(NULL, &source));
+    ASSERT_FAILS(aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_TEST_TIMEOUT_MS));
+    ASSERT_INT_EQUALS(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE, aws_last_error());
+    aws_nitro_enclaves_entropy_feeder_stop();
+    ASSERT_TRUE(test.closed);
+    ASSERT_UINT_EQUALS(0, test.random_calls);
+
+    /* So does a source that fails while feeding. */
+    test.fail_open = false;
+    test.fail_random = true;
+    test.closed = false;
+    ASSERT_SUCCESS(aws_nitro_enclaves_entropy_feeder_start_with_source(NULL, &source));
+    ASSERT_FAILS(aws_nitro_enclaves_library_wait_for_entropy(ENTROPY_TEST_TIMEOUT_MS));
+    ASSERT_INT_EQUALS(AWS_ERROR_NITRO_ENCLAVES_ENTROPY_SOURCE_UNAVAILABLE, aws_last_error());
+    aws_nitro_enclaves_entropy_feeder_stop();
+    ASSERT_TRUE(test.closed);
+    ASSERT_UINT_EQUALS(0, test.batch_count);
+
+    s_entropy_test_clean_up(&test);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+struct entropy_waiter {
+    int rc;
+    int error_code;
+};
+
+static void s_wait_for_entropy_main(void *arg) {
+    struct entropy_waiter *waiter = arg;
+    waiter->rc = aws_nitro_enclaves_library_wait_for_entropy(2 * ENTROPY_TEST_TIMEOUT_MS);
+    waiter->error_code = aws_last_error();
+}
+
+static void s_feeder_stop_main(void *arg) {
+    (void)arg;
+    aws_nitro_enclaves_entropy_feeder_stop();
+}
+
+AWS_TEST_CASE(test_entropy_feeder_wait_timeout_and_stop, s_test_entropy_feeder_wait_timeout_and_stop)
+static int s_test_entropy_feeder_wait_timeout_and_stop(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct entropy_test test;
+    struct aws_nitro_enclaves_entropy_source source;
+    s_entropy_test_init(&test, &source);
+
+    /* The source blocks, so the feeder never gets ready. */
+    test.block_random = true;
+    ASSERT_SUCCESS(aws_nitro_enclaves_entropy_feeder_start_with_source(NULL, &source));
+    ASSERT_FAILS(aws_nitro_enclaves_library_wait_for_entropy(50));
+    ASSERT_INT_EQUALS(AWS_ERROR_COND_VARIABLE_TIMED_OUT, aws_last_error());
+
+    /* Stopping releases a waiter while the feeder thread is still busy. */
+    struct entropy_waiter waiter = {0};
+    struct aws_thread waiter_thread;
+    struct aws_thread stop_thread;
+    ASSERT_SUCCESS(aws_thread_init(&waiter_thread, allocator));
+    ASSERT_SUCCESS(aws_thread_init(&stop_thread, allocator));
+    ASSERT_SUCCESS(aws_thread_launch(&waiter_thread, s_wait_for_entropy_main, &waiter, NULL));
+    ASSERT_SUCCESS(aws_thread_launch(&stop_thread, s_feeder_stop_main, NULL, NULL));
+
+    ASSERT_SUCCESS(aws_thread_join(&waiter_thread));
+    ASSERT_INT_EQUALS(AWS_OP_ERR, waiter.rc);
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_STATE, waiter.error_code);
+
+    /* Unblocking the source lets the feeder thread exit, and the stop complete. */
+    aws_mutex_lock(&test.mutex);
+    test.block_random = false;
+    aws_condition_variable_notify_all(&test.c_var);
+    aws_mutex_unlock(&test.mutex);
+    ASSERT_SUCCESS(aws_thread_join(&stop_thread));
+    ASSERT_TRUE(test.closed);
+
+    aws_thread_clean_up(&waiter_thread);
+    aws_thread_clean_up(&stop_thread);
+    s_entropy_test_clean_up(&test);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
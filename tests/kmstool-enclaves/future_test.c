@@ -0,0 +1,57 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/future.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/clock.h>
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_future_pool_reuse, s_test_future_pool_reuse)
+static int s_test_future_pool_reuse(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_future_pool *pool = aws_nitro_enclaves_future_pool_new(allocator, 1);
+    ASSERT_NOT_NULL(pool);
+
+    struct aws_nitro_enclaves_future *future = aws_nitro_enclaves_future_pool_get(pool);
+    ASSERT_NOT_NULL(future);
+    ASSERT_FALSE(aws_nitro_enclaves_future_is_done(future));
+
+    /* A pending future times out. */
+    uint64_t deadline = 0;
+    aws_high_res_clock_get_ticks(&deadline);
+    deadline += aws_timestamp_convert(1, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL);
+    ASSERT_FALSE(aws_nitro_enclaves_future_wait(future, deadline));
+
+    /* Only the first completion counts. */
+    ASSERT_TRUE(aws_nitro_enclaves_future_complete(future, AWS_ERROR_OOM));
+    ASSERT_FALSE(aws_nitro_enclaves_future_complete(future, AWS_ERROR_SUCCESS));
+    ASSERT_TRUE(aws_nitro_enclaves_future_wait(future, 0));
+    ASSERT_INT_EQUALS(AWS_ERROR_OOM, aws_nitro_enclaves_future_get_error(future));
+
+    /* The last reference returns the future to the pool, pending again. */
+    aws_nitro_enclaves_future_acquire(future);
+    aws_nitro_enclaves_future_release(future);
+    aws_nitro_enclaves_future_release(future);
+
+    struct aws_nitro_enclaves_future *reused = aws_nitro_enclaves_future_pool_get(pool);
+    ASSERT_PTR_EQUALS(future, reused);
+    ASSERT_FALSE(aws_nitro_enclaves_future_is_done(reused));
+
+    /* A future in use keeps the pool alive after its owner released it. */
+    struct aws_nitro_enclaves_future *other = aws_nitro_enclaves_future_pool_get(pool);
+    ASSERT_NOT_NULL(other);
+    ASSERT_TRUE(other != reused);
+    aws_nitro_enclaves_future_pool_release(pool);
+    aws_nitro_enclaves_future_release(reused);
+    aws_nitro_enclaves_future_release(other);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
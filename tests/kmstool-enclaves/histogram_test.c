@@ -0,0 +1,62 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/histogram.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_histogram_percentiles, s_test_histogram_percentiles)
+static int s_test_histogram_percentiles(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_histogram *histogram = aws_nitro_enclaves_histogram_new(allocator);
+    ASSERT_NOT_NULL(histogram);
+
+    struct aws_nitro_enclaves_latency_summary summary;
+    aws_nitro_enclaves_histogram_summarize(histogram, &summary);
+    ASSERT_UINT_EQUALS(0, summary.count);
+    ASSERT_UINT_EQUALS(0, summary.p99_ns);
+
+    /* Small values are exact. */
+    for (uint64_t value = 1; value <= 10; ++value) {
+        aws_nitro_enclaves_histogram_record(histogram, value);
+    }
+    aws_nitro_enclaves_histogram_summarize(histogram, &summary);
+    ASSERT_UINT_EQUALS(10, summary.count);
+    ASSERT_UINT_EQUALS(55, summary.sum_ns);
+    ASSERT_UINT_EQUALS(1, summary.min_ns);
+    ASSERT_UINT_EQUALS(10, summary.max_ns);
+    ASSERT_UINT_EQUALS(5, summary.p50_ns);
+    ASSERT_UINT_EQUALS(9, summary.p90_ns);
+    ASSERT_UINT_EQUALS(10, summary.p99_ns);
+    aws_nitro_enclaves_histogram_destroy(histogram);
+
+    /* 1ms to 1s in 1ms steps: large values are known to within 1/16. */
+    histogram = aws_nitro_enclaves_histogram_new(allocator);
+    ASSERT_NOT_NULL(histogram);
+    for (uint64_t ms = 1; ms <= 1000; ++ms) {
+        aws_nitro_enclaves_histogram_record(histogram, ms * 1000000);
+    }
+    aws_nitro_enclaves_histogram_summarize(histogram, &summary);
+    ASSERT_UINT_EQUALS(1000, summary.count);
+    ASSERT_UINT_EQUALS(1000000, summary.min_ns);
+    ASSERT_UINT_EQUALS(1000000000, summary.max_ns);
+
+    const uint64_t expected[] = {500000000, 900000000, 990000000, 999000000};
+    const uint64_t actual[] = {summary.p50_ns, summary.p90_ns, summary.p99_ns, summary.p999_ns};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(expected); ++i) {
+        ASSERT_TRUE(actual[i] >= expected[i]);
+        ASSERT_TRUE(actual[i] <= expected[i] + expected[i] / 16);
+        ASSERT_TRUE(actual[i] <= summary.max_ns);
+    }
+    aws_nitro_enclaves_histogram_destroy(histogram);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
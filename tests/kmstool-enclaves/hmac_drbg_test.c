@@ -0,0 +1,56 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/hmac_drbg.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+/* The expected outputs were computed with an independent implementation of SP 800-90A HMAC_DRBG (SHA-256). */
+AWS_TEST_CASE(test_hmac_drbg_known_answer, s_test_hmac_drbg_known_answer)
+static int s_test_hmac_drbg_known_answer(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    uint8_t seed[48];
+    for (size_t i = 0; i < sizeof(seed); ++i) {
+        seed[i] = (uint8_t)i;
+    }
+    uint8_t reseed[32];
+    for (size_t i = 0; i < sizeof(reseed); ++i) {
+        reseed[i] = (uint8_t)(0x80 + i);
+    }
+
+    const uint8_t expected_second[] = {
+        0xca, 0xc8, 0x49, 0x0b, 0xa9, 0xb2, 0x3f, 0xfc, 0x16, 0xf1, 0x4f, 0x9b, 0x05, 0xd4,
+        0x2a, 0xdb, 0xab, 0xc2, 0xf9, 0xb9, 0x6b, 0x2a, 0xbe, 0x25, 0x61, 0x24, 0x04, 0x50,
+        0xcd, 0xd3, 0x8b, 0x52, 0xb9, 0x9c, 0x23, 0x20, 0x18, 0x19, 0x6a, 0x00};
+    const uint8_t expected_reseeded[] = {
+        0xf9, 0x78, 0x7c, 0xf6, 0x78, 0x79, 0xe7, 0x63, 0x39, 0xb2, 0x8b, 0x30, 0x38, 0x9f,
+        0xcd, 0xf1, 0xd9, 0xd9, 0x33, 0x6c, 0xa2, 0x56, 0xe6, 0x5c, 0xa5, 0x3c, 0x84, 0xbf,
+        0x79, 0x8d, 0xa7, 0x61, 0x70, 0xbc, 0xc3, 0x40, 0x30, 0x3b, 0x40, 0x9e};
+
+    struct aws_nitro_enclaves_hmac_drbg drbg;
+    ASSERT_SUCCESS(aws_nitro_enclaves_hmac_drbg_init(&drbg, aws_byte_cursor_from_array(seed, sizeof(seed))));
+
+    /* 40 bytes span two HMAC blocks. */
+    uint8_t out[40];
+    ASSERT_SUCCESS(aws_nitro_enclaves_hmac_drbg_generate(&drbg, out, sizeof(out)));
+    ASSERT_SUCCESS(aws_nitro_enclaves_hmac_drbg_generate(&drbg, out, sizeof(out)));
+    ASSERT_BIN_ARRAYS_EQUALS(expected_second, sizeof(expected_second), out, sizeof(out));
+
+    ASSERT_SUCCESS(aws_nitro_enclaves_hmac_drbg_reseed(&drbg, aws_byte_cursor_from_array(reseed, sizeof(reseed))));
+    ASSERT_SUCCESS(aws_nitro_enclaves_hmac_drbg_generate(&drbg, out, sizeof(out)));
+    ASSERT_BIN_ARRAYS_EQUALS(expected_reseeded, sizeof(expected_reseeded), out, sizeof(out));
+
+    ASSERT_FAILS(
+        aws_nitro_enclaves_hmac_drbg_generate(&drbg, out, AWS_NITRO_ENCLAVES_HMAC_DRBG_MAX_GENERATE + 1));
+
+    aws_nitro_enclaves_hmac_drbg_clean_up(&drbg);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
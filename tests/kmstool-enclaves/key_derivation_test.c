@@ -0,0 +1,94 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/key_derivation.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_derive_key_hkdf_sha256, s_test_derive_key_hkdf_sha256)
+static int s_test_derive_key_hkdf_sha256(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    uint8_t secret[22];
+    memset(secret, 0x0b, sizeof(secret));
+    uint8_t info[10];
+    for (size_t i = 0; i < sizeof(info); ++i) {
+        info[i] = (uint8_t)(0xf0 + i);
+    }
+
+    /* RFC 5869, test case 3: zero-length salt and info. */
+    const uint8_t expected_no_info[] = {
+        0x8d, 0xa4, 0xe7, 0x75, 0xa5, 0x63, 0xc1, 0x8f, 0x71, 0x5f, 0x80, 0x2a, 0x06, 0x3c,
+        0x5a, 0x31, 0xb8, 0xa1, 0x1f, 0x5c, 0x5e, 0xe1, 0x87, 0x9e, 0xc3, 0x45, 0x4e, 0x5f,
+        0x3c, 0x73, 0x8d, 0x2d, 0x9d, 0x20, 0x13, 0x95, 0xfa, 0xa4, 0xb6, 0x1a, 0x96, 0xc8};
+    /* Same input key material, with the info of RFC 5869 test case 1. */
+    const uint8_t expected_info[] = {
+        0xab, 0xba, 0xfb, 0x13, 0xf5, 0xc1, 0xbc, 0x48, 0x9d, 0x42, 0x03, 0x13, 0x58, 0x17,
+        0x95, 0x6d, 0xd5, 0x21, 0xb3, 0x9e, 0x3b, 0xd6, 0x1d, 0x1c, 0xc8, 0x5c, 0xef, 0x88,
+        0x4d, 0x1f, 0x8e, 0x2e, 0x2c, 0xa9, 0xc1, 0x9f, 0x23, 0xdf, 0x62, 0x0d, 0xd3, 0x94};
+
+    struct aws_byte_cursor secret_cur = aws_byte_cursor_from_array(secret, sizeof(secret));
+    struct aws_byte_buf key;
+    ASSERT_SUCCESS(aws_nitro_enclaves_derive_key(allocator, secret_cur, aws_byte_cursor_from_c_str(""), 42, &key));
+    ASSERT_BIN_ARRAYS_EQUALS(expected_no_info, sizeof(expected_no_info), key.buffer, key.len);
+    aws_byte_buf_clean_up_secure(&key);
+
+    ASSERT_SUCCESS(aws_nitro_enclaves_derive_key(
+        allocator, secret_cur, aws_byte_cursor_from_array(info, sizeof(info)), 42, &key));
+    ASSERT_BIN_ARRAYS_EQUALS(expected_info, sizeof(expected_info), key.buffer, key.len);
+    aws_byte_buf_clean_up_secure(&key);
+
+    ASSERT_FAILS(aws_nitro_enclaves_derive_key(
+        allocator, secret_cur, aws_byte_cursor_from_c_str(""), AWS_NITRO_ENCLAVES_DERIVED_KEY_MAX_LEN + 1, &key));
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_derivation_record_round_trip, s_test_derivation_record_round_trip)
+static int s_test_derivation_record_round_trip(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_byte_cursor blob = aws_byte_cursor_from_c_str("wrapped root key");
+    struct aws_byte_cursor first_context = aws_byte_cursor_from_c_str("object-1");
+    struct aws_byte_cursor second_context = aws_byte_cursor_from_c_str("");
+
+    struct aws_byte_buf records = {0};
+    ASSERT_SUCCESS(aws_nitro_enclaves_derivation_record_write(allocator, blob, first_context, 32, &records));
+    ASSERT_SUCCESS(aws_nitro_enclaves_derivation_record_write(allocator, blob, second_context, 16, &records));
+
+    struct aws_byte_cursor cursor = aws_byte_cursor_from_buf(&records);
+    struct aws_byte_cursor read_blob;
+    struct aws_byte_cursor read_context;
+    size_t key_len = 0;
+
+    ASSERT_SUCCESS(aws_nitro_enclaves_derivation_record_read(&cursor, &read_blob, &read_context, &key_len));
+    ASSERT_TRUE(aws_byte_cursor_eq(&read_blob, &blob));
+    ASSERT_TRUE(aws_byte_cursor_eq(&read_context, &first_context));
+    ASSERT_UINT_EQUALS(32, key_len);
+
+    ASSERT_SUCCESS(aws_nitro_enclaves_derivation_record_read(&cursor, &read_blob, &read_context, &key_len));
+    ASSERT_TRUE(aws_byte_cursor_eq(&read_blob, &blob));
+    ASSERT_UINT_EQUALS(0, read_context.len);
+    ASSERT_UINT_EQUALS(16, key_len);
+    ASSERT_UINT_EQUALS(0, cursor.len);
+
+    /* A truncated record is rejected and left unread. */
+    cursor = aws_byte_cursor_from_buf(&records);
+    cursor.len = 10;
+    ASSERT_FAILS(aws_nitro_enclaves_derivation_record_read(&cursor, &read_blob, &read_context, &key_len));
+    ASSERT_UINT_EQUALS(10, cursor.len);
+
+    aws_byte_buf_clean_up(&records);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,207 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/key_policy_cache.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/clock.h>
+#include <aws/testing/aws_test_harness.h>
+
+#define MS_TO_NS(ms) aws_timestamp_convert((ms), AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL)
+
+AWS_STATIC_STRING_FROM_LITERAL(s_key_id_a, "alias/a");
+AWS_STATIC_STRING_FROM_LITERAL(s_key_id_b, "alias/b");
+AWS_STATIC_STRING_FROM_LITERAL(s_cache_key_a, "GetKeyPolicy {\"KeyId\":\"alias/a\"}");
+AWS_STATIC_STRING_FROM_LITERAL(s_cache_key_a_list, "ListKeyPolicies {\"KeyId\":\"alias/a\"}");
+AWS_STATIC_STRING_FROM_LITERAL(s_cache_key_b, "GetKeyPolicy {\"KeyId\":\"alias/b\"}");
+
+/* Looks up @cache_key and checks the outcome: not found, the cached error, or the cached response. */
+static int s_check_get(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    uint64_t now_ns,
+    bool expect_found,
+    int expect_error_code,
+    const char *expect_response) {
+    struct aws_byte_buf response_json = {0};
+    int error_code = AWS_ERROR_SUCCESS;
+    uint64_t generation = 0;
+
+    bool found = aws_nitro_enclaves_key_policy_cache_get(
+        cache, cache_key, now_ns, allocator, &response_json, &error_code, &generation);
+    ASSERT_TRUE(found == expect_found);
+    if (found) {
+        ASSERT_INT_EQUALS(expect_error_code, error_code);
+        if (expect_response != NULL) {
+            ASSERT_TRUE(aws_byte_buf_eq_c_str(&response_json, expect_response));
+        }
+    }
+    aws_byte_buf_clean_up(&response_json);
+
+    return SUCCESS;
+}
+
+/* Stores a response for @cache_key with the generation of a fresh lookup. */
+static int s_put_response(
+    struct aws_allocator *allocator,
+    struct aws_nitro_enclaves_key_policy_cache *cache,
+    const struct aws_string *cache_key,
+    const struct aws_string *key_id,
+    const char *response,
+    uint64_t now_ns) {
+    struct aws_byte_buf response_json = {0};
+    int error_code = AWS_ERROR_SUCCESS;
+    uint64_t generation = 0;
+    aws_nitro_enclaves_key_policy_cache_get(
+        cache, cache_key, now_ns, allocator, &response_json, &error_code, &generation);
+    aws_byte_buf_clean_up(&response_json);
+
+    struct aws_byte_buf answer = aws_byte_buf_from_c_str(response);
+    return aws_nitro_enclaves_key_policy_cache_put(
+        cache, cache_key, key_id, AWS_ERROR_SUCCESS, &answer, now_ns, generation);
+}
+
+AWS_TEST_CASE(test_key_policy_cache_ttl, s_test_key_policy_cache_ttl)
+static int s_test_key_policy_cache_ttl(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_nitro_enclaves_key_policy_cache_new(allocator, 1000, 100, 16);
+    ASSERT_NOT_NULL(cache);
+
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, 0, false, 0, NULL));
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a, s_key_id_a, "policy", 0));
+
+    /* A response is reused until its TTL elapses, and only for the same request. */
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, MS_TO_NS(999), true, AWS_ERROR_SUCCESS, "policy"));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a_list, MS_TO_NS(1), false, 0, NULL));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, MS_TO_NS(1000), false, 0, NULL));
+
+    aws_nitro_enclaves_key_policy_cache_destroy(cache);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_cache_negative, s_test_key_policy_cache_negative)
+static int s_test_key_policy_cache_negative(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_nitro_enclaves_key_policy_cache_new(allocator, 1000, 100, 16);
+    ASSERT_NOT_NULL(cache);
+
+    /* A failure is reused with its error code, for the shorter negative TTL. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_key_policy_cache_put(
+        cache, s_cache_key_a, s_key_id_a, AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND, NULL, 0, 0));
+    ASSERT_SUCCESS(s_check_get(
+        allocator, cache, s_cache_key_a, MS_TO_NS(99), true, AWS_ERROR_NITRO_ENCLAVES_KMS_NOT_FOUND, NULL));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, MS_TO_NS(100), false, 0, NULL));
+
+    aws_nitro_enclaves_key_policy_cache_destroy(cache);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_cache_invalidate, s_test_key_policy_cache_invalidate)
+static int s_test_key_policy_cache_invalidate(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_nitro_enclaves_key_policy_cache_new(allocator, 1000, 100, 16);
+    ASSERT_NOT_NULL(cache);
+
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a, s_key_id_a, "policy a", 0));
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a_list, s_key_id_a, "list a", 0));
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_b, s_key_id_b, "policy b", 0));
+    ASSERT_UINT_EQUALS(3, aws_nitro_enclaves_key_policy_cache_size(cache));
+
+    /* Invalidating a key drops all of its answers, and only them. */
+    aws_nitro_enclaves_key_policy_cache_invalidate(cache, s_key_id_a);
+    ASSERT_UINT_EQUALS(1, aws_nitro_enclaves_key_policy_cache_size(cache));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, 1, false, 0, NULL));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a_list, 1, false, 0, NULL));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_b, 1, true, AWS_ERROR_SUCCESS, "policy b"));
+
+    /* Invalidating NULL drops everything. */
+    aws_nitro_enclaves_key_policy_cache_invalidate(cache, NULL);
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_key_policy_cache_size(cache));
+
+    aws_nitro_enclaves_key_policy_cache_destroy(cache);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_cache_generation, s_test_key_policy_cache_generation)
+static int s_test_key_policy_cache_generation(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_nitro_enclaves_key_policy_cache_new(allocator, 1000, 100, 16);
+    ASSERT_NOT_NULL(cache);
+
+    /* An answer obtained across an invalidation, even of another key, is not stored. */
+    struct aws_byte_buf response_json = {0};
+    int error_code = AWS_ERROR_SUCCESS;
+    uint64_t generation = 0;
+    ASSERT_FALSE(aws_nitro_enclaves_key_policy_cache_get(
+        cache, s_cache_key_a, 0, allocator, &response_json, &error_code, &generation));
+    aws_nitro_enclaves_key_policy_cache_invalidate(cache, s_key_id_b);
+
+    struct aws_byte_buf answer = aws_byte_buf_from_c_str("stale policy");
+    ASSERT_SUCCESS(aws_nitro_enclaves_key_policy_cache_put(
+        cache, s_cache_key_a, s_key_id_a, AWS_ERROR_SUCCESS, &answer, 0, generation));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_key_policy_cache_size(cache));
+
+    /* The next lookup returns the new generation, with which the answer is stored. */
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a, s_key_id_a, "policy", 0));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, 1, true, AWS_ERROR_SUCCESS, "policy"));
+
+    aws_nitro_enclaves_key_policy_cache_destroy(cache);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_cache_bounded, s_test_key_policy_cache_bounded)
+static int s_test_key_policy_cache_bounded(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_key_policy_cache *cache =
+        aws_nitro_enclaves_key_policy_cache_new(allocator, 1000, 100, 2);
+    ASSERT_NOT_NULL(cache);
+
+    /* Once full, the answer closest to expiry makes room for the new one. */
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a, s_key_id_a, "policy a", 0));
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a_list, s_key_id_a, "list a", MS_TO_NS(10)));
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_b, s_key_id_b, "policy b", MS_TO_NS(20)));
+    ASSERT_UINT_EQUALS(2, aws_nitro_enclaves_key_policy_cache_size(cache));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a, MS_TO_NS(30), false, 0, NULL));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_a_list, MS_TO_NS(30), true, AWS_ERROR_SUCCESS, "list a"));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_b, MS_TO_NS(30), true, AWS_ERROR_SUCCESS, "policy b"));
+
+    /* Storing an answer drops the expired ones. */
+    ASSERT_SUCCESS(s_put_response(allocator, cache, s_cache_key_a, s_key_id_a, "policy a", MS_TO_NS(1015)));
+    ASSERT_UINT_EQUALS(2, aws_nitro_enclaves_key_policy_cache_size(cache));
+    ASSERT_SUCCESS(s_check_get(allocator, cache, s_cache_key_b, MS_TO_NS(1015), true, AWS_ERROR_SUCCESS, "policy b"));
+
+    aws_nitro_enclaves_key_policy_cache_destroy(cache);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/key_policy_iterator.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/atomics.h>
+#include <aws/testing/aws_test_harness.h>
+
+AWS_STATIC_STRING_FROM_LITERAL(s_key_id, "alias/key");
+
+struct key_policy_iterator_test {
+    struct aws_allocator *allocator;
+    struct aws_atomic_var calls;
+    struct aws_atomic_var bad_requests;
+};
+
+/* Serves three pages: two names, no name, and one name on the last page. */
+static int s_list_key_policies(
+    void *user_data,
+    const struct aws_string *key_id,
+    int limit,
+    const struct aws_string *marker,
+    struct aws_byte_buf *response_json) {
+    struct key_policy_iterator_test *test = user_data;
+    aws_atomic_fetch_add(&test->calls, 1);
+    if (!aws_string_eq(key_id, s_key_id) || limit != 2) {
+        aws_atomic_fetch_add(&test->bad_requests, 1);
+    }
+
+    const char *page = NULL;
+    if (marker == NULL) {
+        page = "{\"PolicyNames\":[\"first\",\"second\"],\"NextMarker\":\"m1\",\"Truncated\":true}";
+    } else if (aws_string_eq_c_str(marker, "m1")) {
+        page = "{\"PolicyNames\":[],\"NextMarker\":\"m2\",\"Truncated\":true}";
+    } else if (aws_string_eq_c_str(marker, "m2")) {
+        page = "{\"PolicyNames\":[\"third\"],\"Truncated\":false}";
+    } else {
+        return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+    }
+
+    return aws_byte_buf_init_copy_from_cursor(response_json, test->allocator, aws_byte_cursor_from_c_str(page));
+}
+
+/* Walks all of the policy names of s_key_id and checks them. */
+static int s_walk(struct aws_allocator *allocator, struct key_policy_iterator_test *test) {
+    struct aws_nitro_enclaves_key_policy_iterator_options options = {
+        .list_key_policies = s_list_key_policies,
+        .user_data = test,
+        .key_id = s_key_id,
+        .page_size = 2,
+    };
+    struct aws_nitro_enclaves_key_policy_iterator *iterator =
+        aws_nitro_enclaves_key_policy_iterator_new(allocator, &options);
+    ASSERT_NOT_NULL(iterator);
+
+    const char *expected[] = {"first", "second", "third"};
+    struct aws_byte_cursor policy_name;
+    bool end = false;
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(expected); ++i) {
+        ASSERT_SUCCESS(aws_nitro_enclaves_key_policy_iterator_next(iterator, &policy_name, &end));
+        ASSERT_FALSE(end);
+        ASSERT_CURSOR_VALUE_CSTRING_EQUALS(policy_name, expected[i]);
+    }
+    ASSERT_SUCCESS(aws_nitro_enclaves_key_policy_iterator_next(iterator, &policy_name, &end));
+    ASSERT_TRUE(end);
+
+    aws_nitro_enclaves_key_policy_iterator_destroy(iterator);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_iterator_walk, s_test_key_policy_iterator_walk)
+static int s_test_key_policy_iterator_walk(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct key_policy_iterator_test test = {.allocator = allocator};
+    aws_atomic_init_int(&test.calls, 0);
+    aws_atomic_init_int(&test.bad_requests, 0);
+
+    /* Pages are followed by marker, across the empty one, until one is not truncated. */
+    ASSERT_SUCCESS(s_walk(allocator, &test));
+    ASSERT_UINT_EQUALS(3, aws_atomic_load_int(&test.calls));
+    ASSERT_UINT_EQUALS(0, aws_atomic_load_int(&test.bad_requests));
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_key_policy_iterator_holds_no_pages, s_test_key_policy_iterator_holds_no_pages)
+static int s_test_key_policy_iterator_holds_no_pages(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct key_policy_iterator_test test = {.allocator = allocator};
+    aws_atomic_init_int(&test.calls, 0);
+    aws_atomic_init_int(&test.bad_requests, 0);
+
+    /* Nothing is kept across walks: every page of the second walk is fetched again. */
+    ASSERT_SUCCESS(s_walk(allocator, &test));
+    ASSERT_SUCCESS(s_walk(allocator, &test));
+    ASSERT_UINT_EQUALS(6, aws_atomic_load_int(&test.calls));
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
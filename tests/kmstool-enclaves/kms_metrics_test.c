@@ -0,0 +1,66 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/kms_metrics.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_kms_metrics_counters, s_test_kms_metrics_counters)
+static int s_test_kms_metrics_counters(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_kms_metrics_recorder *recorder =
+        aws_nitro_enclaves_kms_metrics_recorder_new(allocator, 0, NULL, NULL);
+    ASSERT_NOT_NULL(recorder);
+
+    struct aws_byte_cursor no_error = {0};
+    struct aws_byte_cursor throttling = aws_byte_cursor_from_c_str("ThrottlingException");
+    aws_nitro_enclaves_kms_metrics_record_attempt(recorder, 200, no_error, 100, 1000);
+    aws_nitro_enclaves_kms_metrics_record_attempt(recorder, 400, throttling, 100, 50);
+    aws_nitro_enclaves_kms_metrics_record_attempt(recorder, 400, throttling, 100, 50);
+    aws_nitro_enclaves_kms_metrics_record_attempt(recorder, 0, no_error, 100, 0);
+    aws_nitro_enclaves_kms_metrics_record_call(recorder, AWS_KMS_OPERATION_DECRYPT, true, 2000);
+    aws_nitro_enclaves_kms_metrics_record_call(recorder, AWS_KMS_OPERATION_DECRYPT, false, 4000);
+    aws_nitro_enclaves_kms_metrics_record_stage(recorder, AWS_KMS_STAGE_SIGN, 10);
+    aws_nitro_enclaves_kms_metrics_record_attestation(recorder, false);
+    aws_nitro_enclaves_kms_metrics_record_attestation(recorder, true);
+    aws_nitro_enclaves_kms_metrics_record_attestation(recorder, true);
+
+    struct aws_nitro_enclaves_kms_metrics metrics;
+    aws_nitro_enclaves_kms_metrics_snapshot(recorder, &metrics);
+
+    ASSERT_UINT_EQUALS(2, metrics.http_status_count);
+    ASSERT_INT_EQUALS(200, metrics.http_statuses[0].status);
+    ASSERT_UINT_EQUALS(1, metrics.http_statuses[0].count);
+    ASSERT_INT_EQUALS(400, metrics.http_statuses[1].status);
+    ASSERT_UINT_EQUALS(2, metrics.http_statuses[1].count);
+    ASSERT_UINT_EQUALS(1, metrics.connection_errors);
+
+    ASSERT_UINT_EQUALS(1, metrics.error_type_count);
+    ASSERT_STR_EQUALS("ThrottlingException", metrics.error_types[0].name);
+    ASSERT_UINT_EQUALS(2, metrics.error_types[0].count);
+
+    ASSERT_UINT_EQUALS(400, metrics.bytes_out);
+    ASSERT_UINT_EQUALS(1100, metrics.bytes_in);
+    ASSERT_UINT_EQUALS(1, metrics.attestation_cache_misses);
+    ASSERT_UINT_EQUALS(2, metrics.attestation_cache_hits);
+
+    ASSERT_UINT_EQUALS(2, metrics.operations[AWS_KMS_OPERATION_DECRYPT].calls);
+    ASSERT_UINT_EQUALS(1, metrics.operations[AWS_KMS_OPERATION_DECRYPT].errors);
+    ASSERT_UINT_EQUALS(2, metrics.operations[AWS_KMS_OPERATION_DECRYPT].latency.count);
+    ASSERT_UINT_EQUALS(4000, metrics.operations[AWS_KMS_OPERATION_DECRYPT].latency.max_ns);
+    ASSERT_UINT_EQUALS(0, metrics.operations[AWS_KMS_OPERATION_ENCRYPT].calls);
+    ASSERT_UINT_EQUALS(1, metrics.stages[AWS_KMS_STAGE_SIGN].count);
+    ASSERT_UINT_EQUALS(0, metrics.stages[AWS_KMS_STAGE_NETWORK].count);
+
+    aws_nitro_enclaves_kms_metrics_recorder_destroy(recorder);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
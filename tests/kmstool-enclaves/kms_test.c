@@ -3,9 +3,13 @@
  * SPDX-License-Identifier: Apache-2.0.
  */
 
+#include <aws/nitro_enclaves/internal/kms.h>
 #include <aws/nitro_enclaves/kms.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
 #include <aws/testing/aws_test_harness.h>
 #include <json-c/json.h>
+#include <openssl/bytestring.h>
+#include <openssl/evp.h>
 
 /**
  * Data used for JSON serialization and deserialization.
@@ -644,6 +648,146 @@ static int s_test_kms_decrypt_request_from_json(struct aws_allocator *allocator,
     return SUCCESS;
 }
 
+AWS_TEST_CASE(test_kms_decrypt_request_view_to_json, s_test_kms_decrypt_request_view_to_json)
+static int s_test_kms_decrypt_request_view_to_json(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_kms_decrypt_request_view view = {
+        .ciphertext_blob = aws_byte_cursor_from_c_str(CIPHERTEXT_BLOB_DATA),
+        .encryption_algorithm = aws_byte_cursor_from_c_str(ENCRYPTION_ALGORITHM),
+        .key_id = aws_byte_cursor_from_c_str(KEY_ID),
+    };
+
+    struct aws_byte_buf json;
+    ASSERT_SUCCESS(aws_kms_decrypt_request_view_to_json(allocator, &view, NULL, &json));
+    ASSERT_BIN_ARRAYS_EQUALS(
+        "{\"CiphertextBlob\":\"" CIPHERTEXT_BLOB_BASE64 "\",\"EncryptionAlgorithm\":\"" ENCRYPTION_ALGORITHM
+        "\",\"KeyId\":\"" KEY_ID "\"}",
+        sizeof("{\"CiphertextBlob\":\"" CIPHERTEXT_BLOB_BASE64 "\",\"EncryptionAlgorithm\":\"" ENCRYPTION_ALGORITHM
+               "\",\"KeyId\":\"" KEY_ID "\"}") -
+            1,
+        json.buffer,
+        json.len);
+    aws_byte_buf_clean_up(&json);
+
+    /* Every parameter, with strings that need escaping, reads back as a request structure. */
+    struct aws_kms_encryption_context_entry context[] = {
+        {aws_byte_cursor_from_c_str(ENCRYPTION_CONTEXT_KEY), aws_byte_cursor_from_c_str("quoted \"value\"\n")},
+    };
+    struct aws_byte_cursor tokens[] = {
+        aws_byte_cursor_from_c_str(TOKEN_FIRST),
+        aws_byte_cursor_from_c_str(TOKEN_SECOND),
+    };
+    view.encryption_context = context;
+    view.encryption_context_count = AWS_ARRAY_SIZE(context);
+    view.grant_tokens = tokens;
+    view.grant_tokens_count = AWS_ARRAY_SIZE(tokens);
+
+    struct aws_recipient *recipient = aws_recipient_new(allocator);
+    ASSERT_NOT_NULL(recipient);
+    recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
+    ASSERT_SUCCESS(aws_byte_buf_init_copy_from_cursor(
+        &recipient->attestation_document, allocator, aws_byte_cursor_from_c_str(CIPHERTEXT_BLOB_DATA)));
+
+    ASSERT_SUCCESS(aws_kms_decrypt_request_view_to_json(allocator, &view, recipient, &json));
+    struct aws_string *json_string = aws_string_new_from_buf(allocator, &json);
+    ASSERT_NOT_NULL(json_string);
+    struct aws_kms_decrypt_request *request = aws_kms_decrypt_request_from_json(allocator, json_string);
+    ASSERT_NOT_NULL(request);
+
+    ASSERT_BIN_ARRAYS_EQUALS(
+        CIPHERTEXT_BLOB_DATA,
+        sizeof(CIPHERTEXT_BLOB_DATA) - 1,
+        (char *)request->ciphertext_blob.buffer,
+        request->ciphertext_blob.len);
+    ASSERT_INT_EQUALS(AWS_EA_SYMMETRIC_DEFAULT, request->encryption_algorithm);
+    ASSERT_UINT_EQUALS(1, aws_hash_table_get_entry_count(&request->encryption_context));
+    for (struct aws_hash_iter iter = aws_hash_iter_begin(&request->encryption_context); !aws_hash_iter_done(&iter);
+         aws_hash_iter_next(&iter)) {
+        ASSERT_STR_EQUALS(ENCRYPTION_CONTEXT_KEY, aws_string_c_str(iter.element.key));
+        ASSERT_STR_EQUALS("quoted \"value\"\n", aws_string_c_str(iter.element.value));
+    }
+    ASSERT_INT_EQUALS(2, aws_array_list_length(&request->grant_tokens));
+    struct aws_string *elem = NULL;
+    AWS_FATAL_ASSERT(aws_array_list_get_at(&request->grant_tokens, &elem, 1) == AWS_OP_SUCCESS);
+    ASSERT_STR_EQUALS(TOKEN_SECOND, aws_string_c_str(elem));
+    ASSERT_STR_EQUALS(KEY_ID, aws_string_c_str(request->key_id));
+    ASSERT_NOT_NULL(request->recipient);
+    ASSERT_INT_EQUALS(AWS_KEA_RSAES_OAEP_SHA_256, request->recipient->key_encryption_algorithm);
+    ASSERT_BIN_ARRAYS_EQUALS(
+        CIPHERTEXT_BLOB_DATA,
+        sizeof(CIPHERTEXT_BLOB_DATA) - 1,
+        (char *)request->recipient->attestation_document.buffer,
+        request->recipient->attestation_document.len);
+
+    aws_kms_decrypt_request_destroy(request);
+    aws_string_destroy(json_string);
+    aws_byte_buf_clean_up(&json);
+
+    /* Unknown encryption algorithms are rejected. */
+    view.encryption_algorithm = aws_byte_cursor_from_c_str(SUFIX);
+    ASSERT_FAILS(aws_kms_decrypt_request_view_to_json(allocator, &view, recipient, &json));
+
+    aws_recipient_destroy(recipient);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_kms_decrypt_request_template_to_json, s_test_kms_decrypt_request_template_to_json)
+static int s_test_kms_decrypt_request_template_to_json(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_kms_encryption_context_entry context[] = {
+        {aws_byte_cursor_from_c_str(ENCRYPTION_CONTEXT_KEY), aws_byte_cursor_from_c_str(ENCRYPTION_CONTEXT_VALUE)},
+    };
+    struct aws_byte_cursor tokens[] = {aws_byte_cursor_from_c_str(TOKEN_FIRST)};
+    struct aws_kms_decrypt_request_view view = {
+        .ciphertext_blob = aws_byte_cursor_from_c_str(CIPHERTEXT_BLOB_DATA),
+        .encryption_algorithm = aws_byte_cursor_from_c_str(ENCRYPTION_ALGORITHM),
+        .encryption_context = context,
+        .encryption_context_count = AWS_ARRAY_SIZE(context),
+        .grant_tokens = tokens,
+        .grant_tokens_count = AWS_ARRAY_SIZE(tokens),
+        .key_id = aws_byte_cursor_from_c_str(KEY_ID),
+    };
+
+    struct aws_recipient *recipient = aws_recipient_new(allocator);
+    ASSERT_NOT_NULL(recipient);
+    recipient->key_encryption_algorithm = AWS_KEA_RSAES_OAEP_SHA_256;
+    ASSERT_SUCCESS(aws_byte_buf_init_copy_from_cursor(
+        &recipient->attestation_document, allocator, aws_byte_cursor_from_c_str(CIPHERTEXT_BLOB_DATA)));
+
+    struct aws_kms_decrypt_request_template *request_template = aws_kms_decrypt_request_template_new(allocator, &view);
+    ASSERT_NOT_NULL(request_template);
+
+    /* Requests made from the template are those of its view, with or without a Recipient, for any ciphertext. */
+    const char *ciphertexts[] = {CIPHERTEXT_BLOB_DATA, SUFIX};
+    for (size_t i = 0; i < AWS_ARRAY_SIZE(ciphertexts); ++i) {
+        view.ciphertext_blob = aws_byte_cursor_from_c_str(ciphertexts[i]);
+        for (int with_recipient = 0; with_recipient < 2; ++with_recipient) {
+            const struct aws_recipient *request_recipient = with_recipient ? recipient : NULL;
+            struct aws_byte_buf expected;
+            struct aws_byte_buf json;
+            ASSERT_SUCCESS(aws_kms_decrypt_request_view_to_json(allocator, &view, request_recipient, &expected));
+            ASSERT_SUCCESS(aws_kms_decrypt_request_template_to_json(
+                request_template, allocator, view.ciphertext_blob, request_recipient, &json));
+            ASSERT_BIN_ARRAYS_EQUALS(expected.buffer, expected.len, json.buffer, json.len);
+            aws_byte_buf_clean_up(&json);
+            aws_byte_buf_clean_up(&expected);
+        }
+    }
+
+    /* The ciphertext is required. */
+    struct aws_byte_buf json;
+    ASSERT_FAILS(aws_kms_decrypt_request_template_to_json(
+        request_template, allocator, aws_byte_cursor_from_c_str(""), recipient, &json));
+
+    aws_kms_decrypt_request_template_destroy(request_template);
+    aws_recipient_destroy(recipient);
+
+    return SUCCESS;
+}
+
 AWS_TEST_CASE(test_kms_encrypt_request_cipher_to_json, s_test_kms_encrypt_request_cipher_to_json)
 static int s_test_kms_encrypt_request_cipher_to_json(struct aws_allocator *allocator, void *ctx) {
     (void)ctx;
@@ -2141,3 +2285,168 @@ static int s_test_kms_get_key_policy_request_to_json(struct aws_allocator *alloc
 
     return AWS_OP_SUCCESS;
 }
+
+AWS_TEST_CASE(test_kms_list_key_policies_response_from_json, s_test_kms_list_key_policies_response_from_json)
+static int s_test_kms_list_key_policies_response_from_json(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_string *json = aws_string_new_from_c_str(
+        allocator,
+        "{ \"NextMarker\": \"marker-2\", "
+        "\"PolicyNames\": [ \"default\", \"admission\" ], "
+        "\"Truncated\": true }");
+    ASSERT_NOT_NULL(json);
+
+    struct aws_kms_list_key_policies_response *response =
+        aws_kms_list_key_policies_response_from_json(allocator, json);
+    ASSERT_NOT_NULL(response);
+
+    ASSERT_TRUE(response->truncated);
+    ASSERT_STR_EQUALS("marker-2", aws_string_c_str(response->next_marker));
+    ASSERT_UINT_EQUALS(2, aws_array_list_length(&response->policy_names));
+    struct aws_string *policy_name = NULL;
+    ASSERT_SUCCESS(aws_array_list_get_at(&response->policy_names, &policy_name, 1));
+    ASSERT_STR_EQUALS("admission", aws_string_c_str(policy_name));
+
+    aws_string_destroy(json);
+    aws_kms_list_key_policies_response_destroy(response);
+
+    /* The last page has no marker. */
+    json = aws_string_new_from_c_str(allocator, "{ \"PolicyNames\": [ \"default\" ], \"Truncated\": false }");
+    ASSERT_NOT_NULL(json);
+    response = aws_kms_list_key_policies_response_from_json(allocator, json);
+    ASSERT_NOT_NULL(response);
+    ASSERT_FALSE(response->truncated);
+    ASSERT_NULL(response->next_marker);
+    aws_string_destroy(json);
+    aws_kms_list_key_policies_response_destroy(response);
+
+    /* Policy names must be strings. */
+    json = aws_string_new_from_c_str(allocator, "{ \"PolicyNames\": [ 1 ], \"Truncated\": false }");
+    ASSERT_NOT_NULL(json);
+    ASSERT_NULL(aws_kms_list_key_policies_response_from_json(allocator, json));
+    aws_string_destroy(json);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_kms_get_public_key_response_from_json, s_test_kms_get_public_key_response_from_json)
+static int s_test_kms_get_public_key_response_from_json(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_string *json = aws_string_new_from_c_str(
+        allocator,
+        "{ \"KeyId\": \"" KEY_ID "\", "
+        "\"PublicKey\": \"" CIPHERTEXT_BLOB_BASE64 "\", "
+        "\"KeyUsage\": \"ENCRYPT_DECRYPT\", "
+        "\"KeySpec\": \"RSA_2048\", "
+        "\"EncryptionAlgorithms\": [ \"RSAES_OAEP_SHA_1\", \"RSAES_OAEP_SHA_256\" ] }");
+    ASSERT_NOT_NULL(json);
+
+    struct aws_kms_get_public_key_response *response = aws_kms_get_public_key_response_from_json(allocator, json);
+    ASSERT_NOT_NULL(response);
+
+    ASSERT_STR_EQUALS(KEY_ID, aws_string_c_str(response->key_id));
+    ASSERT_BIN_ARRAYS_EQUALS(
+        CIPHERTEXT_BLOB_DATA,
+        sizeof(CIPHERTEXT_BLOB_DATA) - 1,
+        (char *)response->public_key.buffer,
+        response->public_key.len);
+    ASSERT_STR_EQUALS("ENCRYPT_DECRYPT", aws_string_c_str(response->key_usage));
+
+    ASSERT_UINT_EQUALS(2, aws_array_list_length(&response->encryption_algorithms));
+    struct aws_string *algorithm = NULL;
+    ASSERT_SUCCESS(aws_array_list_get_at(&response->encryption_algorithms, &algorithm, 1));
+    ASSERT_STR_EQUALS("RSAES_OAEP_SHA_256", aws_string_c_str(algorithm));
+
+    aws_string_destroy(json);
+    aws_kms_get_public_key_response_destroy(response);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_kms_encrypt_with_public_key, s_test_kms_encrypt_with_public_key)
+static int s_test_kms_encrypt_with_public_key(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    struct aws_rsa_keypair *keypair = aws_attestation_rsa_keypair_new(allocator, AWS_RSA_2048);
+    ASSERT_NOT_NULL(keypair);
+
+    CBB cbb;
+    ASSERT_INT_EQUALS(1, CBB_init(&cbb, 0));
+    ASSERT_INT_EQUALS(1, EVP_marshal_public_key(&cbb, keypair->key_impl));
+    struct aws_byte_cursor public_key = aws_byte_cursor_from_array(CBB_data(&cbb), CBB_len(&cbb));
+    struct aws_byte_cursor plaintext = aws_byte_cursor_from_c_str(CIPHERTEXT_BLOB_DATA);
+
+    /* OAEP is randomized, so the ciphertext is checked by decrypting it with the private key. */
+    struct aws_byte_buf ciphertext;
+    ASSERT_SUCCESS(
+        aws_kms_encrypt_with_public_key(allocator, public_key, AWS_EA_RSAES_OAEP_SHA_256, plaintext, &ciphertext));
+    ASSERT_UINT_EQUALS(2048 / 8, ciphertext.len);
+
+    struct aws_byte_buf decrypted;
+    ASSERT_SUCCESS(aws_attestation_rsa_decrypt(allocator, keypair, &ciphertext, &decrypted));
+    ASSERT_BIN_ARRAYS_EQUALS(plaintext.ptr, plaintext.len, decrypted.buffer, decrypted.len);
+    aws_byte_buf_clean_up_secure(&decrypted);
+    aws_byte_buf_clean_up(&ciphertext);
+
+    /* Symmetric algorithms cannot be used with a public key. */
+    ASSERT_FAILS(
+        aws_kms_encrypt_with_public_key(allocator, public_key, AWS_EA_SYMMETRIC_DEFAULT, plaintext, &ciphertext));
+
+    CBB_cleanup(&cbb);
+    aws_attestation_rsa_keypair_destroy(keypair);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_kms_call_is_retryable, s_test_kms_call_is_retryable)
+static int s_test_kms_call_is_retryable(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    AWS_STATIC_STRING_FROM_LITERAL(throttling, "{\"__type\":\"ThrottlingException\",\"message\":\"Rate exceeded\"}");
+    AWS_STATIC_STRING_FROM_LITERAL(qualified_throttling, "{\"__type\":\"com.amazonaws.kms#ThrottlingException\"}");
+    AWS_STATIC_STRING_FROM_LITERAL(validation, "{\"__type\":\"ValidationException\"}");
+    AWS_STATIC_STRING_FROM_LITERAL(not_json, "Service Unavailable");
+
+    enum aws_retry_error_type error_type = AWS_RETRY_ERROR_TYPE_CLIENT_ERROR;
+
+    /* Connection failures, without a response. */
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(AWS_OP_ERR, AWS_IO_SOCKET_CLOSED, NULL, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_TRANSIENT, error_type);
+
+    /* Requests past their deadline or cancelled are final, so that the deadline covers the retries. */
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(
+        AWS_OP_ERR, AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT, NULL, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(
+        AWS_OP_ERR, AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED, NULL, &error_type));
+
+    /* Throttling, with either status. */
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(429, AWS_ERROR_SUCCESS, NULL, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_THROTTLING, error_type);
+    error_type = AWS_RETRY_ERROR_TYPE_CLIENT_ERROR;
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(400, AWS_ERROR_SUCCESS, throttling, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_THROTTLING, error_type);
+    error_type = AWS_RETRY_ERROR_TYPE_CLIENT_ERROR;
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(400, AWS_ERROR_SUCCESS, qualified_throttling, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_THROTTLING, error_type);
+
+    /* Server errors, whatever the body. */
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(500, AWS_ERROR_SUCCESS, NULL, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_SERVER_ERROR, error_type);
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(503, AWS_ERROR_SUCCESS, not_json, &error_type));
+    ASSERT_INT_EQUALS(AWS_RETRY_ERROR_TYPE_SERVER_ERROR, error_type);
+    ASSERT_TRUE(aws_nitro_enclaves_kms_call_is_retryable(599, AWS_ERROR_SUCCESS, NULL, &error_type));
+
+    /* Successes and other client errors are final. */
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(200, AWS_ERROR_SUCCESS, NULL, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(400, AWS_ERROR_SUCCESS, validation, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(400, AWS_ERROR_SUCCESS, not_json, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(400, AWS_ERROR_SUCCESS, NULL, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(403, AWS_ERROR_SUCCESS, throttling, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(404, AWS_ERROR_SUCCESS, NULL, &error_type));
+    ASSERT_FALSE(aws_nitro_enclaves_kms_call_is_retryable(600, AWS_ERROR_SUCCESS, NULL, &error_type));
+
+    return SUCCESS;
+}
@@ -0,0 +1,49 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/latency_tracker.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_latency_tracker_percentile, s_test_latency_tracker_percentile)
+static int s_test_latency_tracker_percentile(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_latency_tracker *tracker = aws_nitro_enclaves_latency_tracker_new(allocator, 100);
+    ASSERT_NOT_NULL(tracker);
+
+    uint64_t latency = 0;
+    ASSERT_FALSE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 50, 0, &latency));
+
+    /* Samples 100 down to 1, recorded out of order. */
+    for (uint64_t i = 100; i > 0; i--) {
+        aws_nitro_enclaves_latency_tracker_record(tracker, i);
+    }
+    ASSERT_FALSE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 50, 101, &latency));
+    ASSERT_TRUE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 50, 100, &latency));
+    ASSERT_UINT_EQUALS(50, latency);
+    ASSERT_TRUE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 95, 100, &latency));
+    ASSERT_UINT_EQUALS(95, latency);
+    ASSERT_TRUE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 100, 100, &latency));
+    ASSERT_UINT_EQUALS(100, latency);
+
+    /* Once full, new samples replace the oldest ones: 100 down to 51 are replaced by 1000. */
+    for (size_t i = 0; i < 50; i++) {
+        aws_nitro_enclaves_latency_tracker_record(tracker, 1000);
+    }
+    ASSERT_TRUE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 50, 100, &latency));
+    ASSERT_UINT_EQUALS(50, latency);
+    ASSERT_TRUE(aws_nitro_enclaves_latency_tracker_percentile(tracker, 51, 100, &latency));
+    ASSERT_UINT_EQUALS(1000, latency);
+
+    aws_nitro_enclaves_latency_tracker_destroy(tracker);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/logging.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+#include <string.h>
+
+AWS_TEST_CASE(test_async_logger_writes_lines, s_test_async_logger_writes_lines)
+static int s_test_async_logger_writes_lines(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    FILE *file = tmpfile();
+    ASSERT_NOT_NULL(file);
+
+    struct aws_logger logger;
+    struct aws_nitro_enclaves_async_logger_options options = {
+        .file = file,
+        .level = AWS_LL_INFO,
+        .line_size = 64,
+    };
+    ASSERT_SUCCESS(aws_nitro_enclaves_logger_init_async(&logger, allocator, &options));
+    ASSERT_INT_EQUALS(AWS_LL_INFO, logger.vtable->get_log_level(&logger, AWS_LS_NITRO_ENCLAVES_KMS));
+
+    ASSERT_SUCCESS(logger.vtable->log(&logger, AWS_LL_INFO, AWS_LS_NITRO_ENCLAVES_KMS, "first %d", 1));
+    ASSERT_SUCCESS(logger.vtable->log(&logger, AWS_LL_ERROR, AWS_LS_NITRO_ENCLAVES_REST, "%0100d", 2));
+    /* Writes the remaining lines before returning. */
+    aws_logger_clean_up(&logger);
+
+    char contents[1024] = {0};
+    rewind(file);
+    size_t len = fread(contents, 1, sizeof(contents) - 1, file);
+    fclose(file);
+
+    /* Two lines, the second one truncated to the line size. */
+    char *second = strchr(contents, '\n');
+    ASSERT_NOT_NULL(second);
+    second++;
+    ASSERT_NOT_NULL(strstr(contents, "[INFO]"));
+    ASSERT_NOT_NULL(strstr(contents, "first 1\n"));
+    ASSERT_TRUE(strncmp(second, "[ERROR]", strlen("[ERROR]")) == 0);
+    ASSERT_UINT_EQUALS(64, (size_t)(contents + len - second));
+    ASSERT_TRUE(contents[len - 1] == '\n');
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/rate_limiter.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/clock.h>
+#include <aws/testing/aws_test_harness.h>
+
+#define MS_TO_NS(ms) aws_timestamp_convert((ms), AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL)
+
+AWS_TEST_CASE(test_rate_limiter_burst_then_reject, s_test_rate_limiter_burst_then_reject)
+static int s_test_rate_limiter_burst_then_reject(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    /* 10 requests per second, bursts of 3, no queueing. */
+    struct aws_nitro_enclaves_rate_limiter *limiter = aws_nitro_enclaves_rate_limiter_new(allocator, 10, 3, 0);
+    ASSERT_NOT_NULL(limiter);
+
+    uint64_t now = MS_TO_NS(1000);
+    uint64_t delay = 0;
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+        ASSERT_UINT_EQUALS(0, delay);
+    }
+    ASSERT_ERROR(
+        AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED, aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+
+    /* A rejected request does not consume a token: one is available after a single interval. */
+    ASSERT_ERROR(
+        AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED,
+        aws_nitro_enclaves_rate_limiter_reserve(limiter, now + MS_TO_NS(99), &delay));
+    ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now + MS_TO_NS(100), &delay));
+    ASSERT_UINT_EQUALS(0, delay);
+
+    /* After an idle second the bucket is full again, but never holds more than the burst. */
+    now += MS_TO_NS(2000);
+    for (size_t i = 0; i < 3; i++) {
+        ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+        ASSERT_UINT_EQUALS(0, delay);
+    }
+    ASSERT_FAILS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+
+    aws_nitro_enclaves_rate_limiter_destroy(limiter);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_rate_limiter_queue_with_deadline, s_test_rate_limiter_queue_with_deadline)
+static int s_test_rate_limiter_queue_with_deadline(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    /* 10 requests per second, no burst, requests may be queued for up to 250ms. */
+    struct aws_nitro_enclaves_rate_limiter *limiter = aws_nitro_enclaves_rate_limiter_new(allocator, 10, 1, 250);
+    ASSERT_NOT_NULL(limiter);
+
+    uint64_t now = MS_TO_NS(1000);
+    uint64_t delay = 0;
+    ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+    ASSERT_UINT_EQUALS(0, delay);
+    ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+    ASSERT_UINT_EQUALS(MS_TO_NS(100), delay);
+    ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+    ASSERT_UINT_EQUALS(MS_TO_NS(200), delay);
+    ASSERT_ERROR(
+        AWS_ERROR_NITRO_ENCLAVES_KMS_RATE_LIMITED, aws_nitro_enclaves_rate_limiter_reserve(limiter, now, &delay));
+
+    /* A NULL limiter admits everything. */
+    ASSERT_SUCCESS(aws_nitro_enclaves_rate_limiter_acquire(NULL));
+
+    aws_nitro_enclaves_rate_limiter_destroy(limiter);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/rest.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+#include <aws/nitro_enclaves/rest.h>
+#include <aws/testing/aws_test_harness.h>
+
+AWS_TEST_CASE(test_rest_cancellation_token, s_test_rest_cancellation_token)
+static int s_test_rest_cancellation_token(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_nitro_enclaves_rest_cancellation_token *token = aws_nitro_enclaves_rest_cancellation_token_new(NULL);
+    ASSERT_NOT_NULL(token);
+    ASSERT_FALSE(aws_nitro_enclaves_rest_cancellation_token_is_cancelled(token));
+
+    /* Cancelling without waiting requests only marks the token, and can be repeated. */
+    aws_nitro_enclaves_rest_cancellation_token_cancel(token);
+    ASSERT_TRUE(aws_nitro_enclaves_rest_cancellation_token_is_cancelled(token));
+    aws_nitro_enclaves_rest_cancellation_token_cancel(token);
+    ASSERT_TRUE(aws_nitro_enclaves_rest_cancellation_token_is_cancelled(token));
+
+    aws_nitro_enclaves_rest_cancellation_token_destroy(token);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_rest_reconnect_delay, s_test_rest_reconnect_delay)
+static int s_test_rest_reconnect_delay(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* The backoff doubles with every attempt, from the base up to the maximum. */
+    ASSERT_UINT_EQUALS(100, aws_nitro_enclaves_rest_reconnect_delay_ms(0, 100, 5000, 100));
+    ASSERT_UINT_EQUALS(400, aws_nitro_enclaves_rest_reconnect_delay_ms(2, 100, 5000, 400));
+    ASSERT_UINT_EQUALS(5000, aws_nitro_enclaves_rest_reconnect_delay_ms(10, 100, 5000, 5000));
+    ASSERT_UINT_EQUALS(5000, aws_nitro_enclaves_rest_reconnect_delay_ms(SIZE_MAX, 100, 5000, 5000));
+
+    /* The delay is anywhere between 0 and the backoff, wrapping around it. */
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_rest_reconnect_delay_ms(0, 100, 5000, 0));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_rest_reconnect_delay_ms(0, 100, 5000, 101));
+    ASSERT_UINT_EQUALS(42, aws_nitro_enclaves_rest_reconnect_delay_ms(3, 100, 5000, 42));
+    for (uint64_t random = 0; random < 100000; random += 997) {
+        ASSERT_TRUE(aws_nitro_enclaves_rest_reconnect_delay_ms(4, 100, 1000, random) <= 1000);
+    }
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_rest_hedge_decision, s_test_rest_hedge_decision)
+static int s_test_rest_hedge_decision(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* The hedged copy is sent after the delay, unless the deadline comes first. */
+    ASSERT_UINT_EQUALS(1000 + 50000000, aws_nitro_enclaves_rest_hedge_at_ns(1000, 50, 0));
+    ASSERT_UINT_EQUALS(1000 + 50000000, aws_nitro_enclaves_rest_hedge_at_ns(1000, 50, 1000 + 50000001));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_rest_hedge_at_ns(1000, 50, 1000 + 50000000));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_rest_hedge_at_ns(1000, 50, 2000));
+    ASSERT_UINT_EQUALS(UINT64_MAX, aws_nitro_enclaves_rest_hedge_at_ns(UINT64_MAX - 1, 50, 0));
+
+    const int error = AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_TIMEOUT;
+    struct aws_nitro_enclaves_rest_attempts attempts;
+    struct aws_nitro_enclaves_rest_hedge_outcome outcome;
+
+    /* Without a hedge, the request is waited for and is the only candidate. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.is_complete = false};
+    ASSERT_FALSE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_NONE, outcome.winner);
+    ASSERT_TRUE(outcome.abort_request);
+    ASSERT_FALSE(outcome.abort_hedge);
+    ASSERT_INT_EQUALS(0, outcome.error_code);
+
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.is_complete = true, .error_code = error};
+    ASSERT_TRUE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_NONE, outcome.winner);
+    ASSERT_FALSE(outcome.abort_request);
+    ASSERT_INT_EQUALS(error, outcome.error_code);
+
+    /* The hedge wins while the request is still running, which is aborted. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.has_hedge = true, .is_hedge_complete = true};
+    ASSERT_TRUE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_HEDGE, outcome.winner);
+    ASSERT_TRUE(outcome.abort_request);
+    ASSERT_FALSE(outcome.abort_hedge);
+
+    /* The request wins while the hedge is still running, which is aborted. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.is_complete = true, .has_hedge = true};
+    ASSERT_TRUE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_REQUEST, outcome.winner);
+    ASSERT_FALSE(outcome.abort_request);
+    ASSERT_TRUE(outcome.abort_hedge);
+
+    /* When both succeeded, the request is preferred. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){
+        .is_complete = true, .has_hedge = true, .is_hedge_complete = true};
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_REQUEST, outcome.winner);
+    ASSERT_FALSE(outcome.abort_request);
+    ASSERT_FALSE(outcome.abort_hedge);
+
+    /* A failed request keeps the caller waiting on the hedge, and the other way around. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.is_complete = true, .error_code = error, .has_hedge = true};
+    ASSERT_FALSE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    attempts = (struct aws_nitro_enclaves_rest_attempts){
+        .has_hedge = true, .is_hedge_complete = true, .hedge_error_code = error};
+    ASSERT_FALSE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+
+    /* A failure and a success: the success wins. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){
+        .is_complete = true, .error_code = error, .has_hedge = true, .is_hedge_complete = true};
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_HEDGE, outcome.winner);
+
+    /* Both failed: the error of the request is reported. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){
+        .is_complete = true,
+        .error_code = error,
+        .has_hedge = true,
+        .is_hedge_complete = true,
+        .hedge_error_code = AWS_ERROR_NITRO_ENCLAVES_REST_REQUEST_CANCELLED};
+    ASSERT_TRUE(aws_nitro_enclaves_rest_attempts_are_done(&attempts));
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_NONE, outcome.winner);
+    ASSERT_FALSE(outcome.abort_request);
+    ASSERT_FALSE(outcome.abort_hedge);
+    ASSERT_INT_EQUALS(error, outcome.error_code);
+
+    /* The deadline passed with a failed request and a running hedge: the hedge is aborted, and no error chosen. */
+    attempts = (struct aws_nitro_enclaves_rest_attempts){.is_complete = true, .error_code = error, .has_hedge = true};
+    outcome = aws_nitro_enclaves_rest_hedge_outcome(&attempts);
+    ASSERT_INT_EQUALS(AWS_NITRO_ENCLAVES_REST_WINNER_NONE, outcome.winner);
+    ASSERT_FALSE(outcome.abort_request);
+    ASSERT_TRUE(outcome.abort_hedge);
+    ASSERT_INT_EQUALS(0, outcome.error_code);
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_rest_max_streams, s_test_rest_max_streams)
+static int s_test_rest_max_streams(struct aws_allocator *allocator, void *ctx) {
+    (void)allocator;
+    (void)ctx;
+
+    /* HTTP/1.1 connections carry one request at a time, whatever the limits. */
+    ASSERT_UINT_EQUALS(1, aws_nitro_enclaves_rest_max_streams(AWS_HTTP_VERSION_1_1, 100, UINT32_MAX));
+    ASSERT_UINT_EQUALS(1, aws_nitro_enclaves_rest_max_streams(AWS_HTTP_VERSION_UNKNOWN, 100, 100));
+
+    /* HTTP/2 connections are bound by the lower of the local and remote limits. */
+    ASSERT_UINT_EQUALS(100, aws_nitro_enclaves_rest_max_streams(AWS_HTTP_VERSION_2, 100, UINT32_MAX));
+    ASSERT_UINT_EQUALS(10, aws_nitro_enclaves_rest_max_streams(AWS_HTTP_VERSION_2, 100, 10));
+    ASSERT_UINT_EQUALS(0, aws_nitro_enclaves_rest_max_streams(AWS_HTTP_VERSION_2, 100, 0));
+
+    return SUCCESS;
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/sigv4.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/testing/aws_test_harness.h>
+
+#include <string.h>
+
+#define TEST_SECRET_ACCESS_KEY "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY"
+
+AWS_TEST_CASE(test_sigv4_derive_signing_key, s_test_sigv4_derive_signing_key)
+static int s_test_sigv4_derive_signing_key(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    /* Example from the AWS General Reference, "Examples of how to derive a signing key". */
+    const uint8_t expected[] = {0xf4, 0x78, 0x0e, 0x2d, 0x9f, 0x65, 0xfa, 0x89, 0x5f, 0x9c, 0x67,
+                                0xb3, 0x2c, 0xe1, 0xba, 0xf0, 0xb0, 0xd8, 0xa4, 0x35, 0x05, 0xa0,
+                                0x00, 0xa1, 0xa9, 0xe0, 0x90, 0xd4, 0x14, 0xdb, 0x40, 0x4d};
+    uint8_t signing_key[AWS_NITRO_ENCLAVES_SIGV4_KEY_LEN];
+    ASSERT_SUCCESS(aws_nitro_enclaves_sigv4_derive_signing_key(
+        aws_byte_cursor_from_c_str(TEST_SECRET_ACCESS_KEY),
+        aws_byte_cursor_from_c_str("20120215"),
+        aws_byte_cursor_from_c_str("us-east-1"),
+        aws_byte_cursor_from_c_str("iam"),
+        signing_key));
+    ASSERT_BIN_ARRAYS_EQUALS(expected, sizeof(expected), signing_key, sizeof(signing_key));
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
+
+AWS_TEST_CASE(test_sigv4_sign_request, s_test_sigv4_sign_request)
+static int s_test_sigv4_sign_request(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct aws_credentials *credentials = aws_credentials_new(
+        allocator,
+        aws_byte_cursor_from_c_str("AKIDEXAMPLE"),
+        aws_byte_cursor_from_c_str(TEST_SECRET_ACCESS_KEY),
+        aws_byte_cursor_from_c_str(""),
+        UINT64_MAX);
+    ASSERT_NOT_NULL(credentials);
+
+    struct aws_nitro_enclaves_sigv4_signer *signer = aws_nitro_enclaves_sigv4_signer_new(
+        allocator, aws_byte_cursor_from_c_str("us-east-1"), aws_byte_cursor_from_c_str("kms"));
+    ASSERT_NOT_NULL(signer);
+
+    struct aws_http_message *request = aws_http_message_new_request(allocator);
+    ASSERT_NOT_NULL(request);
+    const struct aws_http_header headers[] = {
+        {.name = aws_byte_cursor_from_c_str("host"),
+         .value = aws_byte_cursor_from_c_str("kms.us-east-1.amazonaws.com")},
+        {.name = aws_byte_cursor_from_c_str("content-type"),
+         .value = aws_byte_cursor_from_c_str("application/x-amz-json-1.1")},
+        {.name = aws_byte_cursor_from_c_str("user-agent"), .value = aws_byte_cursor_from_c_str("test")},
+        {.name = aws_byte_cursor_from_c_str("x-amz-target"),
+         .value = aws_byte_cursor_from_c_str("TrentService.Decrypt")},
+        {.name = aws_byte_cursor_from_c_str("content-length"), .value = aws_byte_cursor_from_c_str("22")},
+    };
+    ASSERT_SUCCESS(aws_http_message_add_header_array(request, headers, AWS_ARRAY_SIZE(headers)));
+    ASSERT_SUCCESS(aws_http_message_set_request_method(request, aws_byte_cursor_from_c_str("POST")));
+    ASSERT_SUCCESS(aws_http_message_set_request_path(request, aws_byte_cursor_from_c_str("/")));
+
+    /* 2015-08-30T12:36:00Z */
+    struct aws_date_time date;
+    aws_date_time_init_epoch_secs(&date, 1440938160);
+
+    const char *expected =
+        "AWS4-HMAC-SHA256 Credential=AKIDEXAMPLE/20150830/us-east-1/kms/aws4_request, "
+        "SignedHeaders=content-length;content-type;host;x-amz-content-sha256;x-amz-date;x-amz-target, "
+        "Signature=353a5c76cecbb1ba61bcd599a63d7f0ddf068344afd82d26ce6fc61315fff645";
+
+    /* The second signature is computed with the cached signing key and replaces the first one. */
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_SUCCESS(aws_nitro_enclaves_sigv4_signer_sign_request(
+            signer, credentials, request, aws_byte_cursor_from_c_str("{\"KeyId\":\"alias/test\"}"), &date));
+
+        struct aws_byte_cursor authorization;
+        ASSERT_SUCCESS(aws_http_headers_get(
+            aws_http_message_get_headers(request), aws_byte_cursor_from_c_str("authorization"), &authorization));
+        ASSERT_BIN_ARRAYS_EQUALS(expected, strlen(expected), authorization.ptr, authorization.len);
+    }
+    ASSERT_UINT_EQUALS(AWS_ARRAY_SIZE(headers) + 3, aws_http_message_get_header_count(request));
+
+    aws_http_message_destroy(request);
+    aws_nitro_enclaves_sigv4_signer_destroy(signer);
+    aws_credentials_release(credentials);
+
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}
@@ -0,0 +1,100 @@
+/**
+ * Copyright 2020 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0.
+ */
+
+#include <aws/nitro_enclaves/internal/singleflight.h>
+#include <aws/nitro_enclaves/nitro_enclaves.h>
+
+#include <aws/common/atomics.h>
+#include <aws/common/clock.h>
+#include <aws/common/thread.h>
+#include <aws/testing/aws_test_harness.h>
+
+#define SINGLEFLIGHT_TEST_CALLERS 4
+
+struct singleflight_test {
+    struct aws_allocator *allocator;
+    struct aws_nitro_enclaves_singleflight *group;
+    struct aws_atomic_var calls;
+    struct aws_atomic_var shared;
+    struct aws_atomic_var mismatches;
+};
+
+static int s_slow_call(void *user_data, struct aws_byte_buf *result) {
+    struct singleflight_test *test = user_data;
+    aws_atomic_fetch_add(&test->calls, 1);
+    /* Keeps the call in flight long enough for the other callers to find it. */
+    aws_thread_current_sleep(aws_timestamp_convert(100, AWS_TIMESTAMP_MILLIS, AWS_TIMESTAMP_NANOS, NULL));
+
+    struct aws_byte_cursor value = aws_byte_cursor_from_c_str("plaintext");
+    return aws_byte_buf_init_copy_from_cursor(result, test->allocator, value);
+}
+
+static int s_failing_call(void *user_data, struct aws_byte_buf *result) {
+    (void)user_data;
+    (void)result;
+    return aws_raise_error(AWS_ERROR_INVALID_ARGUMENT);
+}
+
+static void s_caller_run(void *arg) {
+    struct singleflight_test *test = arg;
+    struct aws_byte_buf result = {0};
+    bool shared = false;
+
+    if (aws_nitro_enclaves_singleflight_do(
+            test->group, aws_byte_cursor_from_c_str("key"), s_slow_call, test, test->allocator, &result, &shared) !=
+            AWS_OP_SUCCESS ||
+        !aws_byte_buf_eq_c_str(&result, "plaintext")) {
+        aws_atomic_fetch_add(&test->mismatches, 1);
+    }
+    if (shared) {
+        aws_atomic_fetch_add(&test->shared, 1);
+    }
+    aws_byte_buf_clean_up(&result);
+}
+
+AWS_TEST_CASE(test_singleflight_coalesces_calls, s_test_singleflight_coalesces_calls)
+static int s_test_singleflight_coalesces_calls(struct aws_allocator *allocator, void *ctx) {
+    (void)ctx;
+
+    aws_nitro_enclaves_library_init(allocator);
+
+    struct singleflight_test test = {.allocator = allocator};
+    aws_atomic_init_int(&test.calls, 0);
+    aws_atomic_init_int(&test.shared, 0);
+    aws_atomic_init_int(&test.mismatches, 0);
+    test.group = aws_nitro_enclaves_singleflight_new(allocator);
+    ASSERT_NOT_NULL(test.group);
+
+    struct aws_thread threads[SINGLEFLIGHT_TEST_CALLERS];
+    for (size_t i = 0; i < SINGLEFLIGHT_TEST_CALLERS; ++i) {
+        ASSERT_SUCCESS(aws_thread_init(&threads[i], allocator));
+        ASSERT_SUCCESS(aws_thread_launch(&threads[i], s_caller_run, &test, NULL));
+    }
+    for (size_t i = 0; i < SINGLEFLIGHT_TEST_CALLERS; ++i) {
+        ASSERT_SUCCESS(aws_thread_join(&threads[i]));
+        aws_thread_clean_up(&threads[i]);
+    }
+
+    /* Every caller got the result, either from its own call or from the one it waited for. */
+    ASSERT_UINT_EQUALS(0, aws_atomic_load_int(&test.mismatches));
+    ASSERT_TRUE(aws_atomic_load_int(&test.calls) >= 1);
+    ASSERT_UINT_EQUALS(
+        SINGLEFLIGHT_TEST_CALLERS, aws_atomic_load_int(&test.calls) + aws_atomic_load_int(&test.shared));
+
+    /* A failed call raises its error, and is not kept for the next callers. */
+    struct aws_byte_buf result = {0};
+    ASSERT_FAILS(aws_nitro_enclaves_singleflight_do(
+        test.group, aws_byte_cursor_from_c_str("key"), s_failing_call, NULL, allocator, &result, NULL));
+    ASSERT_INT_EQUALS(AWS_ERROR_INVALID_ARGUMENT, aws_last_error());
+    ASSERT_SUCCESS(aws_nitro_enclaves_singleflight_do(
+        test.group, aws_byte_cursor_from_c_str("key"), s_slow_call, &test, allocator, &result, NULL));
+    ASSERT_TRUE(aws_byte_buf_eq_c_str(&result, "plaintext"));
+    aws_byte_buf_clean_up(&result);
+
+    aws_nitro_enclaves_singleflight_destroy(test.group);
+    aws_nitro_enclaves_library_clean_up();
+
+    return SUCCESS;
+}